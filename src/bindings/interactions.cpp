@@ -16,6 +16,32 @@ void exportInteractions(py::module& m)
 {
     py::handlers_class<Interaction> pyInt(m, "Interaction", "Base interaction class");
 
+    pyInt.def("setBackend", [] (Interaction& interaction, std::string backend) {
+            interaction.setBackend(backendFromString(backend));
+        }, "backend"_a, R"(
+            Choose where the interaction is computed
+
+            Args:
+                backend: either "device" (default) or "host".
+                    The host backend computes the forces with OpenMP threads on the CPU,
+                    it is only available for :any:`DPD` and :any:`LJ` interactions.
+    )");
+
+    pyInt.def("setVerletList", &Interaction::setVerletList, "skin"_a, R"(
+            Compute the local self interactions with Verlet lists instead of traversing the cells every time-step.
+            The lists keep all the neighbours within the cut-off radius plus the *skin* and are only rebuilt
+            when a particle moves by more than half of the skin, or when new particles arrive to the subdomain.
+
+            Only the force computation uses the lists: cell-lists are still rebuilt every time-step,
+            since halo exchange and redistribution rely on them. The lists save the distance checks
+            with the particles of the neighbouring cells that are out of reach, and are worth it when the
+            force kernel dominates over the cell-list build.
+
+            Args:
+                skin: extra distance kept in the lists, 0 disables the Verlet lists.
+                    Only :any:`DPD` and :any:`LJ` interactions on the device support Verlet lists.
+    )");
+
     py::handlers_class<InteractionDPD> pyIntDPD(m, "DPD", pyInt, R"(
         Pairwise interaction with conservative part and dissipative + random part acting as a thermostat, see [Groot1997]_
     
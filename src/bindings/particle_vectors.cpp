@@ -55,6 +55,23 @@ void exportParticleVectors(py::module& m)
         .def("setForces",      &ParticleVector::setForces_vector, "forces"_a, R"(
             Args:
                 forces: A list of :math:`N \times 3` floats: 3 components of force for every of the N particles
+        )")
+        .def("setCheckpointCompression", &ParticleVector::setCheckpointCompression,
+             "channels"_a=std::vector<std::string>(), "shuffle"_a=true, "deflate"_a=4,
+             "codec"_a=0, "codec_params"_a=std::vector<unsigned>(), R"(
+            Compress the checkpoint files of this PV with HDF5 filters. The datasets are chunked,
+            and the files are still written collectively by all the ranks (needs HDF5 1.10.2 or newer)
+            
+            Args:
+                channels: names of the channels to compress, e.g. "position", "velocity", "ids"
+                    (or the object channels of the object vectors), empty list means all the channels
+                shuffle: apply byte shuffling before the other filters
+                deflate: gzip compression level from 1 to 9, 0 disables it
+                codec: id of a registered HDF5 filter plugin applied before the others, e.g. a lossless
+                    floating point codec found in HDF5_PLUGIN_PATH. 0 disables it
+                codec_params: parameters passed to the codec filter as is
+                
+            Achieved compression ratio and write throughput of every compressed checkpoint file are reported in the log
         )");
 
     py::handlers_class<Mesh> pymesh(m, "Mesh", R"(
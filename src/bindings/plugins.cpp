@@ -15,6 +15,13 @@ void exportPlugins(py::module& m)
     py::handlers_class<SimulationPlugin>  pysim(m, "SimulationPlugin", R"(
         Base simulation plugin class
     )");
+
+    pysim.def("set_send_buffers", &SimulationPlugin::setSendBuffers, "n"_a, R"(
+        Let up to **n** messages of this plugin be in flight to the postprocess (2 by default).
+        The simulation only waits if the postprocess has not received any of them yet,
+        the number and the time of such waits is reported at the end.
+        Every buffer may take as much memory as one message, e.g. a particle dump
+    )");
     
     py::handlers_class<PostprocessPlugin> pypost(m, "PostprocessPlugin", R"(
         Base postprocess plugin class
@@ -71,6 +78,7 @@ void exportPlugins(py::module& m)
                 pybind11::dtype dt;
                 if (ch.datatype == XDMF::Channel::Datatype::Float) dt = pybind11::dtype::of<float>();
                 if (ch.datatype == XDMF::Channel::Datatype::Int)   dt = pybind11::dtype::of<int>();
+                if (ch.datatype == XDMF::Channel::Datatype::Int64) dt = pybind11::dtype::of<int64_t>();
             
                 return py::array(dt, resolution, (float*)ch.data, py::cast(dumper));
             });
@@ -347,7 +355,9 @@ void exportPlugins(py::module& m)
 
     m.def("__createDumpParticles", &PluginFactory::createDumpParticlesPlugin, 
           "compute_task"_a, "name"_a, "pv"_a, "dump_every"_a,
-          "channels"_a, "path"_a, R"(
+          "channels"_a, "path"_a, "time_series"_a = false,
+          "box"_a = std::vector<float>(), "sphere"_a = std::vector<float>(),
+          "wall"_a = nullptr, "wall_sdf_range"_a = PyTypes::float2(-1.0f, 0.0f), "subsample_every"_a = 1, R"(
         Create :any:`ParticleSenderPlugin` plugin
         
         Args:
@@ -355,6 +365,9 @@ void exportPlugins(py::module& m)
             pv: :any:`ParticleVector` that we'll work with
             dump_every: write files every this many time-steps 
             path: Path and filename prefix for the dumps. For every dump two files will be created: <path>_NNNNN.xmf and <path>_NNNNN.h5
+            time_series: append all the dumps to a single <path>.h5 with a single temporal collection <path>.xmf.
+                Datasets "step_offset", "step_size" and "step_time" of the h5 file give the first particle, the number of particles and the time of each dump.
+                Dataset sizes of the steps in the xmf file are only brought up to date at the end of the simulation
             channels: list of pairs name - type.
                 Name is the channel (per particle) name.
                 The "velocity" channel is always activated by default.
@@ -364,7 +377,19 @@ void exportPlugins(py::module& m)
                 * 'scalar': 1 float per particle
                 * 'vector': 3 floats per particle
                 * 'tensor6': 6 floats per particle, symmetric tensor in order xx, xy, xz, yy, yz, zz
-                
+
+            box: if not empty, only dump the particles within the box given by its low and high corners
+                (6 numbers: low x, y, z, high x, y, z) in global coordinates
+            sphere: if not empty, only dump the particles within the sphere given by its center and radius
+                (4 numbers: x, y, z, r) in global coordinates
+            wall: if given, only dump the particles with the SDF of this wall within **wall_sdf_range**
+            wall_sdf_range: range of the wall SDF, which is negative in the simulation domain and positive inside the wall.
+                The default keeps a layer of thickness 1 next to the wall
+            subsample_every: only dump one particle out of this many, picked by the particle id.
+                The same particles are dumped every time
+
+            The particles are selected on the device, before they are downloaded and sent to the postprocess.
+            If several regions are given, only the particles inside all of them are dumped
     )");
     
     m.def("__createDumpParticlesWithMesh", &PluginFactory::createDumpParticlesWithMeshPlugin, 
@@ -390,7 +415,7 @@ void exportPlugins(py::module& m)
     )");
     
     m.def("__createDumpXYZ", &PluginFactory::createDumpXYZPlugin, 
-          "compute_task"_a, "name"_a, "pv"_a, "dump_every"_a, "path"_a, R"(
+          "compute_task"_a, "name"_a, "pv"_a, "dump_every"_a, "path"_a, "format"_a = "xyz", R"(
         Create :any:`XYZPlugin` plugin
         
         Args:
@@ -398,6 +423,8 @@ void exportPlugins(py::module& m)
             pvs: list of :any:`ParticleVector` that we'll work with
             dump_every: write files every this many time-steps
             path: the files will look like this: <path>/<pv_name>_NNNNN.xyz
+            format: 'xyz' for a text file per dump, or 'dcd' to append all the dumps to a binary trajectory <path>/<pv_name>.dcd.
+                Particles of the trajectory are ordered by their ids, the number of particles has to stay the same
     )");
 
     m.def("__createExchangePVSFluxPlane", &PluginFactory::createExchangePVSFluxPlanePlugin,
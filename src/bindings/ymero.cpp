@@ -27,7 +27,10 @@ void exportYmero(py::module& m)
              "restart_folder"_a="restart/", "cuda_aware_mpi"_a=false, "no_splash"_a=false, R"(
             Args:
                 nranks:
-                    number of MPI simulation tasks per axis: x,y,z. If postprocess is enabled, the same number of the postprocess tasks will be running
+                    number of MPI simulation tasks per axis: x,y,z. The postprocess is enabled if more tasks are started:
+                    there may be at most as many additional ones as simulation tasks, and each of them serves a group of
+                    consecutive simulation tasks, the groups differ in size by one at most.
+                    Twice as many tasks gives one postprocess task per simulation task
                 domain:
                     size of the simulation domain in x,y,z. Periodic boundary conditions are applied at the domain boundaries.
                     The domain will be split in equal chunks between the MPI ranks.
@@ -194,5 +197,159 @@ void exportYmero(py::module& m)
         .def("stop_profiler",  &YMeRo::stopProfiler,  "Tells nvprof to stop recording timeline")
         .def("save_dependency_graph_graphml",  &YMeRo::saveDependencyGraph_GraphML,  R"(
             Exports `GraphML <http://graphml.graphdrawing.org/>`_ file with task graph for the current simulation time-step)")
+        .def("setCellListOrdering", &YMeRo::setCellListOrdering, "ordering"_a, R"(
+            Choose the order of the cells in memory for all the cell-lists. Has to be called before :any:`run`
+            
+            Args:
+                ordering: one of
+                
+                    * "rowmajor": plain x-fastest layout (default)
+                    * "morton": cells are ordered along the Morton (Z-order) space-filling curve
+                    * "hilbert": cells are ordered along the Hilbert space-filling curve
+                    
+                    Curve orderings keep the neighbouring cells closer in memory,
+                    at the cost of traversing the cells one by one instead of the whole rows
+        )")
+        .def("setTaskExecutor", &YMeRo::setTaskExecutor, "executor"_a, "nthreads"_a=0, R"(
+            Choose how the tasks of each time-step are executed
+            
+            Args:
+                executor: one of
+                
+                    * "streams": tasks are launched from the main thread on separate CUDA streams (default)
+                    * "threads": tasks are executed by a pool of host threads with work stealing, so that
+                      host work of independent tasks (e.g. MPI halo exchange and local forces) overlaps.
+                      Tasks calling MPI run one at a time and in the same order on all the ranks.
+                      MPI has to support MPI_THREAD_MULTIPLE, otherwise "streams" is used
+                      
+                nthreads: number of threads for the "threads" executor, 0 means the number of hardware threads
+                
+            Mean wall and queue wait time of each task are reported in the log at the end of :any:`run`
+        )")
+        .def("setCheckpointMode", &YMeRo::setCheckpointMode, "mode"_a, R"(
+            Choose how the checkpoints are written
+            
+            Args:
+                mode: one of
+                
+                    * "sync": the simulation waits until all the checkpoint files are written (default)
+                    * "async": particle and object data are copied to host memory and written by a background
+                      thread, while the simulation continues. A new checkpoint waits until the previous one is
+                      written, so at most one is in flight. MPI has to support MPI_THREAD_MULTIPLE, otherwise "sync" is used
+                      
+            Time the simulation was blocked and time spent writing are reported in the log at the end of :any:`run`
+        )")
+        .def("setPostprocessThreads", &YMeRo::setPostprocessThreads, "nthreads"_a, R"(
+            Set the number of threads on the postprocess ranks that receive, deserialize and write the plugin data
+            
+            Args:
+                nthreads: number of worker threads, 1 processes the plugins one by one on the main thread (default)
+                
+            Different plugins receive their messages concurrently, while the messages of a single plugin are always
+            handled one at a time and in order. Deserialization and writing of the data, which may be collective,
+            are done one plugin at a time in the same order on all the postprocess ranks.
+            MPI has to support MPI_THREAD_MULTIPLE, otherwise 1 is used
+        )")
+        .def("setTracing", &YMeRo::setTracing, "path"_a, "dump_every"_a, "capacity"_a=100000, R"(
+            Record the start and end time of every task executed in each time-step and periodically
+            write them in the Chrome trace format, that can be viewed with chrome://tracing or https://ui.perfetto.dev
+            
+            Args:
+                path: file name prefix, each rank writes to <path>_rank<rank>_<step>.json
+                dump_every: write the trace every this many time-steps, 0 disables tracing
+                capacity: maximum number of events kept between the dumps, older events are discarded
+                
+            Timestamps are taken from the system clock, so that traces of different ranks can be merged
+        )")
+        .def("setAutoTaskPriorities", &YMeRo::setAutoTaskPriorities,
+             "enabled"_a=true, "measure_steps"_a=10, "slack_tolerance"_a=0.05, R"(
+            Assign priorities of the tasks from the critical path of the task graph.
+            Tasks that lie on the critical path get high priority in addition to the hand-picked ones,
+            and the ready tasks with the longest remaining path are started first.
+            
+            Args:
+                enabled: switch automatic priorities on or off
+                measure_steps: priorities are recomputed from the measured task durations after this many time-steps,
+                    before that every task is assumed to take the same time
+                slack_tolerance: tasks with slack below this fraction of the critical path length are considered critical
+                
+            The slack of every task is reported in the log at the end of :any:`run`
+        )")
+        .def("setExchangeProtocol", &YMeRo::setExchangeProtocol, "protocol"_a, R"(
+            Choose how the halo and redistribution data is communicated between the MPI ranks.
+            Has to be called before the first :any:`run`
+            
+            Args:
+                protocol: one of
+                
+                    * "sizes_first": the number of entities is sent first, and the data is received when the sizes have arrived (default)
+                    * "single_message": the number of entities is sent together with the data in one message,
+                      received into over-allocated persistent buffers. Saves one latency per exchange,
+                      the data always goes through the host memory
+                    * "aggregated": data of all the particle vectors going to the same neighbour is sent
+                      in one message with a table of sizes in front, so that each exchange sends one message per neighbour
+                    * "neighbor": data of all the particle vectors is exchanged at once with MPI neighborhood collectives
+                      (MPI_Ineighbor_alltoallv) on a distributed graph communicator, the data goes through the host memory
+                      even with GPU aware MPI
+                    * "shared_memory": neighbours on the same node copy the data directly from the shared memory
+                      window of the sender (MPI_Win_allocate_shared), synchronizing with flags instead of messages.
+                      Neighbours on other nodes are treated as with "sizes_first"
+        )")
+        .def("setHalfShellHalo", &YMeRo::setHalfShellHalo, "half_shell"_a=true, R"(
+            Use half-shell halos for the particle vectors that are not object vectors.
+            Each rank then receives halo particles only from 13 out of 26 neighbours, computes the interactions
+            across the subdomain boundaries once, and sends the forces acting on the halo particles back to their owners.
+            This halves the amount of halo data and of the halo interactions.
+            Has to be called before the first :any:`run`
+            
+            Note:
+                Per-particle stresses are not sent back, so the interactions computing stresses
+                (:any:`DPDWithStress`, :any:`LJWithStress`) can't be used together with half-shell halos
+        )")
+        .def("setHaloCompression", &YMeRo::setHaloCompression, "pv"_a, "compress"_a=true, R"(
+            Send the halo particles of a particle vector in a compressed lossy form, 16 bytes instead of 32:
+            coordinates as 16-bit fixed point numbers relative to the subdomain boundaries of the receiver,
+            velocities in half precision. Only the lower 32 bits of the particle ids are sent.
+            Has to be called after the particle vector is registered and before the first :any:`run`
+            
+            Args:
+                pv: particle vector, not an object vector
+                compress: turn the compression on or off
+                
+            Note:
+                Coordinates across the boundary are resolved with 1/4096 of the cut-off radius,
+                and along the boundary with 1/49152 of the subdomain size.
+                Only use it with the interactions that tolerate such errors, e.g. DPD
+        )")
+        .def("setDecomposition", &YMeRo::setDecomposition,
+             "x"_a=std::vector<float>(), "y"_a=std::vector<float>(), "z"_a=std::vector<float>(), R"(
+            Split the domain between the ranks with the given boundaries instead of equal subdomains.
+            Has to be called before registering anything, like :any:`restart`
+            
+            Args:
+                x: boundaries of the subdomains along x: (number of ranks along x) + 1 increasing values,
+                   starting at 0 and ending at the domain size. Empty list (default) means equal subdomains
+                y: same along y
+                z: same along z
+                
+            Note:
+                Grid-based outputs (average flow, wall SDF dumps) require equal subdomains
+        )")
+        .def("setLoadBalancing", &YMeRo::setLoadBalancing,
+             "metric"_a="particles", "relaxation"_a=1.0f, "min_size"_a=0.0f, R"(
+            Measure the load of each rank and move the subdomain boundaries to balance it.
+            The boundaries along each axis are chosen such that every slab of ranks has the same load.
+            New decomposition is computed at every global checkpoint, saved together with it and used after :any:`restart`
+            
+            Args:
+                metric: one of
+                
+                    * "particles": number of particles in the subdomain
+                    * "time": execution time of the tasks on the rank, excluding the communication
+                    * "none": turn the balancing off
+                    
+                relaxation: fraction of the way to the balanced boundaries to move at once, in (0, 1]
+                min_size: minimum subdomain size, it is at least the largest cut-off radius
+        )")
         .def("run", &YMeRo::run, "Run the simulation");
 }
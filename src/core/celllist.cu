@@ -8,6 +8,13 @@
 
 #include <extern/cub/cub/device/device_scan.cuh>
 
+#include <algorithm>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 static __device__ bool outgoingParticle(float4 pos)
 {
     return Float3_int(pos).isMarked();
@@ -57,10 +64,10 @@ __global__ void reorderParticles(PVview view, CellListInfo cinfo, float4* outPar
         dstId = otherDst;
 
     if (dstId >= 0)
-    {
         writeNoCache(outParticles + 2*dstId+sh, val);
-        if (sh == 0) cinfo.order[pid] = dstId;
-    }
+
+    // outgoing particles get -1
+    if (sh == 0) cinfo.order[pid] = dstId;
 }
 
 __global__ void addForcesKernel(PVview view, CellListInfo cinfo)
@@ -68,7 +75,130 @@ __global__ void addForcesKernel(PVview view, CellListInfo cinfo)
     const int pid = blockIdx.x * blockDim.x + threadIdx.x;
     if (pid >= view.size) return;
 
-    view.forces[pid] += cinfo.forces[cinfo.order[pid]];
+    const int cellPid = cinfo.order[pid];
+    if (cellPid >= 0)
+        view.forces[pid] += cinfo.forces[cellPid];
+}
+
+__global__ void addHostForcesKernel(int n, const float4* hostForces, float4* forces)
+{
+    const int pid = blockIdx.x * blockDim.x + threadIdx.x;
+    if (pid >= n) return;
+
+    atomicAdd(forces + pid, f4tof3(hostForces[pid]));
+}
+
+//=================================================================================
+// Host helpers
+//=================================================================================
+
+static int maxHostThreads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+/**
+ * Parallel exclusive prefix sum of \p n elements:
+ * each thread scans its own block, block sums are scanned serially
+ */
+static void exclusiveSumHost(const int* in, int* out, int n)
+{
+    const int nblocks = maxHostThreads();
+    const int blockSize = (n + nblocks - 1) / nblocks;
+    std::vector<int> blockSums(nblocks + 1, 0);
+
+    #pragma omp parallel for schedule(static)
+    for (int b = 0; b < nblocks; b++)
+    {
+        const int start = b * blockSize, end = std::min(start + blockSize, n);
+        int sum = 0;
+        for (int i = start; i < end; i++)
+            sum += in[i];
+        blockSums[b+1] = sum;
+    }
+
+    for (int b = 0; b < nblocks; b++)
+        blockSums[b+1] += blockSums[b];
+
+    #pragma omp parallel for schedule(static)
+    for (int b = 0; b < nblocks; b++)
+    {
+        const int start = b * blockSize, end = std::min(start + blockSize, n);
+        int sum = blockSums[b];
+        for (int i = start; i < end; i++)
+        {
+            const int v = in[i];
+            out[i] = sum;
+            sum += v;
+        }
+    }
+}
+
+//=================================================================================
+// Space-filling curves
+//=================================================================================
+
+/// Key along the Morton (Z-order) curve: interleaved bits of the coordinates
+static uint64_t mortonKey(uint32_t ix, uint32_t iy, uint32_t iz, int nbits)
+{
+    uint64_t key = 0;
+    for (int bit = nbits-1; bit >= 0; bit--)
+    {
+        key = (key << 1) | ((iz >> bit) & 1);
+        key = (key << 1) | ((iy >> bit) & 1);
+        key = (key << 1) | ((ix >> bit) & 1);
+    }
+    return key;
+}
+
+/**
+ * Key along the Hilbert curve, following
+ * J. Skilling, "Programming the Hilbert curve", AIP Conf. Proc. 707 (2004)
+ */
+static uint64_t hilbertKey(uint32_t ix, uint32_t iy, uint32_t iz, int nbits)
+{
+    uint32_t X[3] = {iz, iy, ix};
+    const uint32_t M = 1u << (nbits-1);
+
+    // Inverse undo
+    for (uint32_t Q = M; Q > 1; Q >>= 1)
+    {
+        const uint32_t P = Q - 1;
+        for (int i = 0; i < 3; i++)
+        {
+            if (X[i] & Q)
+                X[0] ^= P;
+            else
+            {
+                const uint32_t t = (X[0] ^ X[i]) & P;
+                X[0] ^= t;
+                X[i] ^= t;
+            }
+        }
+    }
+
+    // Gray encode
+    for (int i = 1; i < 3; i++)
+        X[i] ^= X[i-1];
+
+    uint32_t t = 0;
+    for (uint32_t Q = M; Q > 1; Q >>= 1)
+        if (X[2] & Q) t ^= Q - 1;
+
+    for (int i = 0; i < 3; i++)
+        X[i] ^= t;
+
+    // Transposed form to the key
+    uint64_t key = 0;
+    for (int bit = nbits-1; bit >= 0; bit--)
+        for (int i = 0; i < 3; i++)
+            key = (key << 1) | ((X[i] >> bit) & 1);
+
+    return key;
 }
 
 //=================================================================================
@@ -162,6 +292,167 @@ void CellList::_build(cudaStream_t stream)
             view, cellInfo(), (float4*)particlesContainer.devPtr() );
 
     changedStamp = pv->cellListStamp;
+    nbuilds++;
+}
+
+void CellList::_sortHost()
+{
+    auto& coosvels = pv->local()->coosvels;
+    const int np = coosvels.size();
+    const Particle* src = coosvels.hostPtr();
+
+    order.resize_anew(np);
+    particlesContainer.resize_anew(np);
+    hostCellIds.resize_anew(np);
+
+    // Every chunk of particles has its own histogram, that keeps the sort stable
+    // Limit the memory taken by the histograms to a few integers per particle
+    const int nchunks   = std::max(1, std::min(maxHostThreads(), 4 * (np / (totcells+1))));
+    const int chunkSize = (np + nchunks - 1) / nchunks;
+    hostHistograms.resize_anew(nchunks * totcells);
+
+    const CellListInfo info = cellInfoHost();
+
+    int* cellIds    = hostCellIds.hostPtr();
+    int* histograms = hostHistograms.hostPtr();
+    int* sizes      = cellSizes.hostPtr();
+    int* starts     = cellStarts.hostPtr();
+    int* ord        = order.hostPtr();
+    Particle* dst   = particlesContainer.hostPtr();
+
+    debug2("Computing cell sizes for %d %s particles on host with %d chunks", np, pv->name.c_str(), nchunks);
+
+    #pragma omp parallel for schedule(static)
+    for (int pid = 0; pid < np; pid++)
+    {
+        // XXX: relying here only on redistribution
+        const bool outgoing = Float3_int(src[pid].r, src[pid].i1).isMarked();
+        cellIds[pid] = outgoing ? -1 : info.getCellId(src[pid].r);
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (int chunk = 0; chunk < nchunks; chunk++)
+    {
+        int* hist = histograms + chunk*totcells;
+        std::fill(hist, hist + totcells, 0);
+
+        const int start = chunk * chunkSize, end = std::min(start + chunkSize, np);
+        for (int pid = start; pid < end; pid++)
+            if (cellIds[pid] >= 0) hist[cellIds[pid]]++;
+    }
+
+    // Histograms now become offsets of every chunk within each cell
+    #pragma omp parallel for schedule(static)
+    for (int cid = 0; cid < totcells; cid++)
+    {
+        int sum = 0;
+        for (int chunk = 0; chunk < nchunks; chunk++)
+        {
+            int& h = histograms[chunk*totcells + cid];
+            const int n = h;
+            h = sum;
+            sum += n;
+        }
+        sizes[cid] = sum;
+    }
+    sizes[totcells] = 0;
+
+    exclusiveSumHost(sizes, starts, totcells+1);
+
+    debug2("Reordering %d %s particles on host", np, pv->name.c_str());
+
+    #pragma omp parallel for schedule(static)
+    for (int chunk = 0; chunk < nchunks; chunk++)
+    {
+        int* offsets = histograms + chunk*totcells;
+
+        const int start = chunk * chunkSize, end = std::min(start + chunkSize, np);
+        for (int pid = start; pid < end; pid++)
+        {
+            const int cid = cellIds[pid];
+            if (cid < 0)
+            {
+                ord[pid] = -1;
+                continue;
+            }
+
+            const int dstId = starts[cid] + offsets[cid]++;
+            dst[dstId] = src[pid];
+            ord[pid] = dstId;
+        }
+    }
+}
+
+void CellList::_buildHost(cudaStream_t stream)
+{
+    pv->local()->coosvels.downloadFromDevice(stream, ContainersSynch::Synch);
+
+    _sortHost();
+
+    cellSizes .uploadToDevice(stream);
+    cellStarts.uploadToDevice(stream);
+    order     .uploadToDevice(stream);
+    particlesContainer.uploadToDevice(stream);
+
+    changedStamp = pv->cellListStamp;
+    nbuilds++;
+
+    // Host copies are up-to-date, no need to download them for the host interactions
+    hostStamp = changedStamp;
+}
+
+void CellList::setBackend(ExecutionBackend backend)
+{
+    debug("Cell-list of %s will be built on %s", pv->name.c_str(), backendToString(backend).c_str());
+    this->backend = backend;
+}
+
+void CellList::setOrdering(CellListOrdering ordering)
+{
+    this->ordering = ordering;
+    changedStamp = -1;
+
+    if (ordering == CellListOrdering::RowMajor)
+    {
+        cellMap.resize_anew(0);
+        cellMapInverse.resize_anew(0);
+        return;
+    }
+
+    int nbits = 1;
+    while ( (1 << nbits) < std::max({ncells.x, ncells.y, ncells.z}) )
+        nbits++;
+
+    std::vector< std::pair<uint64_t, int> > keys(totcells);
+    for (int iz = 0; iz < ncells.z; iz++)
+        for (int iy = 0; iy < ncells.y; iy++)
+            for (int ix = 0; ix < ncells.x; ix++)
+            {
+                const int rowMajorId = (iz*ncells.y + iy)*ncells.x + ix;
+                const uint64_t key = ordering == CellListOrdering::Morton ?
+                        mortonKey (ix, iy, iz, nbits) :
+                        hilbertKey(ix, iy, iz, nbits);
+
+                keys[rowMajorId] = {key, rowMajorId};
+            }
+
+    std::sort(keys.begin(), keys.end());
+
+    cellMap.resize_anew(totcells);
+    cellMapInverse.resize_anew(totcells);
+
+    for (int i = 0; i < totcells; i++)
+    {
+        cellMap[keys[i].second] = i;
+        cellMapInverse[i] = keys[i].second;
+    }
+
+    cellMap.uploadToDevice(0);
+    cellMapInverse.uploadToDevice(0);
+    CUDA_Check( cudaStreamSynchronize(0) );
+
+    debug("Cell-list of %s will use %s cell ordering", pv->name.c_str(),
+          ordering == CellListOrdering::Morton ? "Morton" : "Hilbert");
 }
 
 void CellList::build(cudaStream_t stream)
@@ -178,11 +469,50 @@ void CellList::build(cudaStream_t stream)
         return;
     }
 
-    _build(stream);
+    if (backend == ExecutionBackend::Host)
+        _buildHost(stream);
+    else
+        _build(stream);
 
     forcesContainer.resize_anew(pv->local()->size());
 }
 
+void CellList::downloadToHost(cudaStream_t stream)
+{
+    std::lock_guard<std::mutex> lock(hostMutex);
+    const int np = pv->local()->size();
+
+    if (hostStamp != changedStamp || particles->size() != np)
+    {
+        debug2("Downloading cell-list of %s to host", pv->name.c_str());
+
+        particles->downloadFromDevice(stream, ContainersSynch::Asynch);
+        cellStarts.downloadFromDevice(stream, ContainersSynch::Asynch);
+        hostStamp = changedStamp;
+    }
+
+    CUDA_Check( cudaStreamSynchronize(stream) );
+}
+
+void CellList::uploadHostForces(PinnedBuffer<Force>& hostForces, cudaStream_t stream)
+{
+    addHostForces(hostForces, forces, stream);
+    CUDA_Check( cudaStreamSynchronize(stream) );
+}
+
+void CellList::addHostForces(PinnedBuffer<Force>& hostForces, DeviceBuffer<Force>* forces, cudaStream_t stream)
+{
+    const int np = hostForces.size();
+    const int nthreads = 128;
+
+    hostForces.uploadToDevice(stream);
+
+    SAFE_KERNEL_LAUNCH(
+            addHostForcesKernel,
+            getNblocks(np, nthreads), nthreads, 0, stream,
+            np, (const float4*)hostForces.devPtr(), (float4*)forces->devPtr() );
+}
+
 void CellList::addForces(cudaStream_t stream)
 {
     PVview view(pv, pv->local());
@@ -234,12 +564,20 @@ void PrimaryCellList::build(cudaStream_t stream)
         return;
     }
 
-    _build(stream);
-
     // Now we need the new size of particles array.
     int newSize;
-    CUDA_Check( cudaMemcpyAsync(&newSize, cellStarts.devPtr() + totcells, sizeof(int), cudaMemcpyDeviceToHost, stream) );
-    CUDA_Check( cudaStreamSynchronize(stream) );
+
+    if (backend == ExecutionBackend::Host)
+    {
+        _buildHost(stream);
+        newSize = cellStarts[totcells];
+    }
+    else
+    {
+        _build(stream);
+        CUDA_Check( cudaMemcpyAsync(&newSize, cellStarts.devPtr() + totcells, sizeof(int), cudaMemcpyDeviceToHost, stream) );
+        CUDA_Check( cudaStreamSynchronize(stream) );
+    }
 
     debug2("Reordering completed, new size of %s particle vector is %d", pv->name.c_str(), newSize);
 
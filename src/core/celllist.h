@@ -1,11 +1,13 @@
 #pragma once
 
 #include <cstdint>
+#include <mutex>
 
 #include <core/datatypes.h>
 #include <core/containers.h>
 #include <core/logger.h>
 #include <core/utils/cuda_common.h>
+#include <core/utils/execution_backend.h>
 
 class ParticleVector;
 
@@ -14,6 +16,18 @@ enum class CellListsProjection
     Clamp, NoClamp
 };
 
+/**
+ * Order in which the cells (and hence the particles) are stored in memory
+ *
+ * RowMajor is the plain (iz*ny + iy)*nx + ix layout.
+ * Morton and Hilbert follow the corresponding space-filling curves,
+ * such that cells close in space are also close in memory
+ */
+enum class CellListOrdering
+{
+    RowMajor, Morton, Hilbert
+};
+
 
 class CellListInfo
 {
@@ -27,6 +41,10 @@ public:
     int *cellSizes, *cellStarts, *order;
     float4 *particles, *forces;
 
+    CellListOrdering ordering{CellListOrdering::RowMajor};
+    int *cellMap{nullptr};         ///< row-major cell id -> position on the curve, only with curve ordering
+    int *cellMapInverse{nullptr};  ///< position on the curve -> row-major cell id
+
     CellListInfo(float3 h, float3 localDomainSize);
     CellListInfo(float rc, float3 localDomainSize);
 
@@ -36,11 +54,20 @@ public:
 // ==========================================================================================================================================
     __device__ __host__ inline int encode(int ix, int iy, int iz) const
     {
-        return (iz*ncells.y + iy)*ncells.x + ix;
+        const int rowMajorId = (iz*ncells.y + iy)*ncells.x + ix;
+
+        if (ordering == CellListOrdering::RowMajor) return rowMajorId;
+
+        // cells outside of the domain are not on the curve
+        if (rowMajorId < 0 || rowMajorId >= totcells) return rowMajorId;
+        return cellMap[rowMajorId];
     }
 
     __device__ __host__ inline void decode(int cid, int& ix, int& iy, int& iz) const
     {
+        if (ordering != CellListOrdering::RowMajor)
+            cid = cellMapInverse[cid];
+
         ix = cid % ncells.x;
         iy = (cid / ncells.x) % ncells.y;
         iz = cid / (ncells.x * ncells.y);
@@ -89,6 +116,7 @@ class CellList : public CellListInfo
 {
 protected:
     int changedStamp{-1};
+    int nbuilds{0};
 
     DeviceBuffer<char> scanBuffer;
     PinnedBuffer<Particle> particlesContainer = {};
@@ -96,11 +124,33 @@ protected:
 
     ParticleVector* pv;
 
+    int hostStamp{-1};
+
+    /// Local and halo host interactions may download the cell-list at the same time
+    std::mutex hostMutex;
+
+    ExecutionBackend backend{ExecutionBackend::Device};
+    HostBuffer<int> hostCellIds, hostHistograms;
+
     void _build(cudaStream_t stream);
 
+    /**
+     * Same as _build(), but the particles are sorted on the host,
+     * see _sortHost(). Results are uploaded back to the device
+     */
+    void _buildHost(cudaStream_t stream);
+
+    /**
+     * Stable counting sort of the host copy of the local particles by cell id.
+     * Fills the host parts of #cellSizes, #cellStarts, #order
+     * and #particlesContainer
+     */
+    void _sortHost();
+
 public:
 
-    DeviceBuffer<int> cellStarts, cellSizes, order;
+    PinnedBuffer<int> cellStarts, cellSizes, order;
+    PinnedBuffer<int> cellMap, cellMapInverse;
 
     // TODO: hide this?
     PinnedBuffer<Particle>* particles;
@@ -117,9 +167,80 @@ public:
         CellListInfo::cellStarts = cellStarts.devPtr();
         CellListInfo::order      = order.devPtr();
 
+        CellListInfo::cellMap        = cellMap.devPtr();
+        CellListInfo::cellMapInverse = cellMapInverse.devPtr();
+
         return *((CellListInfo*)this);
     }
 
+    /**
+     * Same as cellInfo(), but all the pointers refer to host memory.
+     * Forces point to \p hostForces, that is owned by the caller:
+     * the cell-list itself keeps no host force buffer, such that
+     * several host computations may use it at the same time.
+     * Only valid after downloadToHost().
+     * Unlike cellInfo(), the cell-list is not modified
+     */
+    inline CellListInfo cellInfoHost(PinnedBuffer<Force>* hostForces = nullptr)
+    {
+        CellListInfo info = *((CellListInfo*)this);
+
+        info.particles  = reinterpret_cast<float4*>(particles->hostPtr());
+        info.forces     = hostForces != nullptr ? reinterpret_cast<float4*>(hostForces->hostPtr()) : nullptr;
+        info.cellSizes  = cellSizes.hostPtr();
+        info.cellStarts = cellStarts.hostPtr();
+        info.order      = order.hostPtr();
+
+        info.cellMap        = cellMap.hostPtr();
+        info.cellMapInverse = cellMapInverse.hostPtr();
+
+        return info;
+    }
+
+    /**
+     * Make host copies of the particles and cell starts.
+     * Copies are skipped if the cell-list hasn't changed since the last call.
+     * Synchronizes the \p stream, safe to call from several threads at once
+     */
+    void downloadToHost(cudaStream_t stream);
+
+    /**
+     * Atomically add \p hostForces to the #forces on the device.
+     * Synchronizes the \p stream
+     */
+    void uploadHostForces(PinnedBuffer<Force>& hostForces, cudaStream_t stream);
+
+    /**
+     * Upload \p hostForces and atomically add them to the device \p forces,
+     * entry by entry. Does not synchronize the \p stream
+     */
+    static void addHostForces(PinnedBuffer<Force>& hostForces, DeviceBuffer<Force>* forces, cudaStream_t stream);
+
+    /**
+     * Number of times the particles were actually reordered.
+     * Between two consecutive builds #order maps particle ids
+     * in the ParticleVector to the ids in the cell-list, outgoing
+     * particles are mapped to -1
+     */
+    int getBuildCount() const { return nbuilds; }
+
+    /**
+     * Sort the host copy of the local particles, only the host parts
+     * of the cell-list are filled and nothing is copied to or from the device.
+     * Lets the host sort be timed alone, build() should be used otherwise
+     */
+    void sortHost() { _sortHost(); }
+
+    /// Choose where the cell-list is built, default is on the device
+    void setBackend(ExecutionBackend backend);
+    ExecutionBackend getBackend() const { return backend; }
+
+    /**
+     * Choose the order of the cells in memory, default is row-major.
+     * Forces the cell-list to be rebuilt on the next build() call
+     */
+    void setOrdering(CellListOrdering ordering);
+
     virtual void build(cudaStream_t stream);
     virtual void addForces(cudaStream_t stream);
 
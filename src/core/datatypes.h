@@ -171,6 +171,29 @@ struct __align__(16) Particle
         i2 = tmp.i;
     }
 
+    /// @return full 64-bit particle id, assembled from #i1 (lower) and #i2 (higher part)
+    __HD__ inline int64_t getId() const
+    {
+        return (int64_t) ( ((uint64_t)(uint32_t)i2 << 32) | (uint64_t)(uint32_t)i1 );
+    }
+
+    /// Split the 64-bit \p id between #i1 and #i2
+    __HD__ inline void setId(int64_t id)
+    {
+        i1 = (int32_t) (uint32_t) ( (uint64_t)id & 0xffffffffull );
+        i2 = (int32_t) (uint32_t) ( (uint64_t)id >> 32 );
+    }
+
+    /**
+     * 32-bit key of the id, used to seed pairwise random numbers.
+     * Equal to #i1 for ids below 2^32, such that smaller
+     * systems keep exactly the same random streams.
+     */
+    __HD__ inline int32_t idKey() const
+    {
+        return (int32_t) ( (uint32_t)i1 ^ ((uint32_t)i2 * 0x9E3779B1u) );
+    }
+
     __HD__ inline Float3_int r2Float3_int() const
     {
         return Float3_int{r, i1};
@@ -0,0 +1,268 @@
+#include "decomposition.h"
+
+#include <core/logger.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <numeric>
+
+static std::vector<float> uniformBoundaries(int n, float L)
+{
+    std::vector<float> b(n+1);
+    for (int i = 0; i <= n; i++)
+        b[i] = L * i / n;
+
+    b[n] = L;
+    return b;
+}
+
+static int component(int3 v, int d)
+{
+    return d == 0 ? v.x : (d == 1 ? v.y : v.z);
+}
+
+static float component(float3 v, int d)
+{
+    return d == 0 ? v.x : (d == 1 ? v.y : v.z);
+}
+
+static void setComponent(float3& v, int d, float val)
+{
+    if      (d == 0) v.x = val;
+    else if (d == 1) v.y = val;
+    else             v.z = val;
+}
+
+Decomposition::Decomposition(int3 nranks3D, float3 globalSize) :
+    nranks3D(nranks3D), globalSize(globalSize)
+{
+    for (int d = 0; d < 3; d++)
+        boundaries[d] = uniformBoundaries(component(nranks3D, d), component(globalSize, d));
+}
+
+Decomposition::Decomposition(int3 nranks3D, float3 globalSize, std::vector<float> bx, std::vector<float> by, std::vector<float> bz) :
+    Decomposition(nranks3D, globalSize)
+{
+    std::vector<float>* explicitBoundaries[3] = {&bx, &by, &bz};
+
+    for (int d = 0; d < 3; d++)
+        if (!explicitBoundaries[d]->empty())
+            boundaries[d] = *explicitBoundaries[d];
+
+    check();
+}
+
+void Decomposition::check() const
+{
+    const char axes[] = {'x', 'y', 'z'};
+
+    for (int d = 0; d < 3; d++)
+    {
+        const int n = component(nranks3D, d);
+        const float L = component(globalSize, d);
+        auto& b = boundaries[d];
+
+        if (b.size() != n+1)
+            die("Decomposition along %c needs %d boundaries, got %d", axes[d], n+1, (int)b.size());
+
+        if (fabs(b[0]) > 1e-5f*L || fabs(b[n] - L) > 1e-5f*L)
+            die("Decomposition along %c has to start at 0 and end at %f, got [%f %f]", axes[d], L, b[0], b[n]);
+
+        for (int i = 0; i < n; i++)
+            if (b[i] >= b[i+1])
+                die("Decomposition boundaries along %c are not increasing: %f >= %f", axes[d], b[i], b[i+1]);
+    }
+}
+
+Decomposition Decomposition::gather(MPI_Comm cartComm, const DomainInfo& domain)
+{
+    int dims[3], periods[3], coords[3];
+    int nranks;
+
+    MPI_Check( MPI_Cart_get(cartComm, 3, dims, periods, coords) );
+    MPI_Check( MPI_Comm_size(cartComm, &nranks) );
+
+    Decomposition res;
+    res.nranks3D = {dims[0], dims[1], dims[2]};
+    res.globalSize = domain.globalSize;
+
+    float mine[6] = { domain.globalStart.x, domain.globalStart.y, domain.globalStart.z,
+                      domain.localSize.x,   domain.localSize.y,   domain.localSize.z };
+    std::vector<float> all(6*nranks);
+
+    MPI_Check( MPI_Allgather(mine, 6, MPI_FLOAT, all.data(), 6, MPI_FLOAT, cartComm) );
+
+    for (int d = 0; d < 3; d++)
+        res.boundaries[d].resize(dims[d]+1);
+
+    for (int r = 0; r < nranks; r++)
+    {
+        int c[3];
+        MPI_Check( MPI_Cart_coords(cartComm, r, 3, c) );
+
+        for (int d = 0; d < 3; d++)
+        {
+            res.boundaries[d][c[d]]   = all[6*r + d];
+            res.boundaries[d][c[d]+1] = all[6*r + d] + all[6*r + 3+d];
+        }
+    }
+
+    return res;
+}
+
+DomainInfo Decomposition::createDomain(int3 coords) const
+{
+    DomainInfo domain;
+    domain.globalSize = globalSize;
+
+    for (int d = 0; d < 3; d++)
+    {
+        const int n = component(nranks3D, d);
+        const int c = component(coords, d);
+        auto& b = boundaries[d];
+
+        auto size = [&b, n] (int i) {
+            i = (i + n) % n;
+            return b[i+1] - b[i];
+        };
+
+        setComponent(domain.globalStart,        d, b[c]);
+        setComponent(domain.localSize,          d, size(c));
+        setComponent(domain.lowerNeighbourSize, d, size(c-1));
+        setComponent(domain.upperNeighbourSize, d, size(c+1));
+    }
+
+    return domain;
+}
+
+int3 Decomposition::locate(float3 r) const
+{
+    int res[3];
+
+    for (int d = 0; d < 3; d++)
+    {
+        auto& b = boundaries[d];
+        const int n = b.size() - 1;
+        const int c = std::upper_bound(b.begin(), b.end(), component(r, d)) - b.begin() - 1;
+
+        res[d] = (c >= 0 && c < n) ? c : -1;
+    }
+
+    return {res[0], res[1], res[2]};
+}
+
+bool Decomposition::isUniform(float tolerance) const
+{
+    for (int d = 0; d < 3; d++)
+    {
+        const float L = component(globalSize, d);
+        auto uniform = uniformBoundaries(component(nranks3D, d), L);
+
+        for (int i = 0; i < uniform.size(); i++)
+            if (fabs(uniform[i] - boundaries[d][i]) > tolerance * L)
+                return false;
+    }
+
+    return true;
+}
+
+Decomposition Decomposition::balance(const std::vector<double> loads[3], float minSize, float relaxation) const
+{
+    const char axes[] = {'x', 'y', 'z'};
+    Decomposition res = *this;
+
+    for (int d = 0; d < 3; d++)
+    {
+        const int n = component(nranks3D, d);
+        const float L = component(globalSize, d);
+        auto& oldb = boundaries[d];
+        auto& newb = res.boundaries[d];
+
+        if (loads[d].size() != n)
+            die("Need %d slab loads along %c to balance the decomposition, got %d", n, axes[d], (int)loads[d].size());
+
+        if (n*minSize > L)
+            die("Cannot split %f along %c into %d subdomains at least %f wide", L, axes[d], n, minSize);
+
+        const double total = std::accumulate(loads[d].begin(), loads[d].end(), 0.0);
+        if (n == 1 || total <= 0.0) continue;
+
+        // Invert the cumulative load, piecewise linear between the old boundaries
+        double cumulative = 0.0;
+        int slab = 0;
+        for (int k = 1; k < n; k++)
+        {
+            const double target = total * k / n;
+
+            while (slab < n-1 && cumulative + loads[d][slab] < target)
+                cumulative += loads[d][slab++];
+
+            const double fraction = loads[d][slab] > 0.0 ?
+                    std::min(1.0, (target - cumulative) / loads[d][slab]) : 0.0;
+            const float balanced = oldb[slab] + fraction * (oldb[slab+1] - oldb[slab]);
+
+            newb[k] = oldb[k] + relaxation * (balanced - oldb[k]);
+        }
+
+        // Keep every subdomain at least minSize wide
+        for (int k = 1; k < n; k++)
+            newb[k] = std::max(newb[k], newb[k-1] + minSize);
+        for (int k = n-1; k > 0; k--)
+            newb[k] = std::min(newb[k], newb[k+1] - minSize);
+    }
+
+    res.check();
+    return res;
+}
+
+void Decomposition::write(std::string fname) const
+{
+    std::ofstream fout(fname);
+    fout.precision(std::numeric_limits<float>::max_digits10);
+
+    fout << nranks3D.x << " " << nranks3D.y << " " << nranks3D.z << std::endl;
+    fout << globalSize.x << " " << globalSize.y << " " << globalSize.z << std::endl;
+
+    for (int d = 0; d < 3; d++)
+    {
+        for (auto b : boundaries[d])
+            fout << b << " ";
+        fout << std::endl;
+    }
+}
+
+bool Decomposition::read(std::string fname)
+{
+    std::ifstream fin(fname);
+    if (!fin.good()) return false;
+
+    int3 n;
+    float3 L;
+    if ( (fin >> n.x >> n.y >> n.z >> L.x >> L.y >> L.z).fail() )
+        return false;
+
+    if (n.x != nranks3D.x || n.y != nranks3D.y || n.z != nranks3D.z)
+    {
+        warn("Decomposition in file '%s' is for %d x %d x %d ranks, but running with %d x %d x %d",
+             fname.c_str(), n.x, n.y, n.z, nranks3D.x, nranks3D.y, nranks3D.z);
+        return false;
+    }
+
+    if (length(L - globalSize) > 1e-5f * length(globalSize))
+    {
+        warn("Decomposition in file '%s' is for domain [%f %f %f], but the domain is [%f %f %f]",
+             fname.c_str(), L.x, L.y, L.z, globalSize.x, globalSize.y, globalSize.z);
+        return false;
+    }
+
+    Decomposition res(nranks3D, globalSize);
+    for (int d = 0; d < 3; d++)
+        for (auto& b : res.boundaries[d])
+            if ( (fin >> b).fail() ) return false;
+
+    res.check();
+    *this = res;
+    return true;
+}
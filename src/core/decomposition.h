@@ -0,0 +1,67 @@
+#pragma once
+
+#include "domain.h"
+
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+/**
+ * Rectilinear decomposition of the global domain between the ranks
+ * of a Cartesian communicator
+ *
+ * Each axis is split by its own set of boundaries, so all the ranks with
+ * the same Cartesian coordinate along an axis have the same extent along it.
+ * This keeps the subdomain faces, edges and corners aligned, and every rank
+ * still has exactly 26 neighbours, as the exchangers expect.
+ */
+class Decomposition
+{
+public:
+    Decomposition() = default;
+
+    /// Equal subdomains, the default decomposition
+    Decomposition(int3 nranks3D, float3 globalSize);
+
+    /**
+     * Explicit boundaries along each axis: nranks+1 increasing values,
+     * first is 0 and last is the global domain size. Empty vector means uniform split
+     */
+    Decomposition(int3 nranks3D, float3 globalSize, std::vector<float> bx, std::vector<float> by, std::vector<float> bz);
+
+    /// Collective, reconstruct the decomposition from the subdomains of all the ranks
+    static Decomposition gather(MPI_Comm cartComm, const DomainInfo& domain);
+
+    /// Domain of the rank with Cartesian coordinates \p coords, including the neighbour sizes
+    DomainInfo createDomain(int3 coords) const;
+
+    /// @return Cartesian coordinates of the rank owning global position \p r, or -1 if it's outside
+    int3 locate(float3 r) const;
+
+    bool isUniform(float tolerance = 1e-5f) const;
+
+    /**
+     * Move the boundaries such that each slab of ranks gets the same load
+     *
+     * The load inside each slab is assumed uniform, and the new boundaries
+     * are found by inverting the piecewise linear cumulative load.
+     *
+     * @param loads load of each slab along each axis (nranks values per axis)
+     * @param minSize subdomains are never made thinner than that
+     * @param relaxation fraction of the way to the balanced boundaries to move,
+     *        smaller values damp the oscillations coming from noisy measurements
+     */
+    Decomposition balance(const std::vector<double> loads[3], float minSize, float relaxation) const;
+
+    void write(std::string fname) const;
+
+    /// @return false if the file cannot be read or doesn't match the number of ranks
+    bool read(std::string fname);
+
+    int3 nranks3D{1, 1, 1};
+    float3 globalSize{0, 0, 0};
+    std::vector<float> boundaries[3];
+
+private:
+    void check() const;
+};
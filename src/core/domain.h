@@ -9,6 +9,10 @@ struct DomainInfo
 {
     float3 globalSize, globalStart, localSize;
 
+    /// Sizes of the neighbouring subdomains along each axis,
+    /// differ from localSize only if the decomposition is not uniform
+    float3 lowerNeighbourSize, upperNeighbourSize;
+
     inline __HD__ float3 local2global(float3 x) const
     {
         return x + globalStart + 0.5f * localSize;
@@ -24,5 +28,32 @@ struct DomainInfo
         return (globalStart.x <= xg.x) && (xg.x < (globalStart.x + localSize.x))
             && (globalStart.y <= xg.y) && (xg.y < (globalStart.y + localSize.y))
             && (globalStart.z <= xg.z) && (xg.z < (globalStart.z + localSize.z));
-    }    
+    }
+
+    /**
+     * Distance between the center of this subdomain and the center
+     * of the neighbour in direction \p dir (components are -1, 0 or 1)
+     */
+    inline __HD__ float3 neighbourShift(int3 dir) const
+    {
+        return make_float3( shift1d(dir.x, localSize.x, lowerNeighbourSize.x, upperNeighbourSize.x),
+                            shift1d(dir.y, localSize.y, lowerNeighbourSize.y, upperNeighbourSize.y),
+                            shift1d(dir.z, localSize.z, lowerNeighbourSize.z, upperNeighbourSize.z) );
+    }
+
+    /// Size of the neighbour in direction \p dir (components are -1, 0 or 1)
+    inline __HD__ float3 neighbourSize(int3 dir) const
+    {
+        return make_float3( dir.x < 0 ? lowerNeighbourSize.x : (dir.x > 0 ? upperNeighbourSize.x : localSize.x),
+                            dir.y < 0 ? lowerNeighbourSize.y : (dir.y > 0 ? upperNeighbourSize.y : localSize.y),
+                            dir.z < 0 ? lowerNeighbourSize.z : (dir.z > 0 ? upperNeighbourSize.z : localSize.z) );
+    }
+
+private:
+    static inline __HD__ float shift1d(int d, float L, float lower, float upper)
+    {
+        if (d < 0) return -0.5f * (L + lower);
+        if (d > 0) return  0.5f * (L + upper);
+        return 0.0f;
+    }
 };
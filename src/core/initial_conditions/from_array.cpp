@@ -29,24 +29,24 @@ void FromArrayIC::exec(const MPI_Comm& comm, ParticleVector *pv, DomainInfo doma
 
             r = domain.global2local(r);
 
-            int id = localCount++;
-            
-            Particle p(Float3_int(r, id).toFloat4(),
-                       Float3_int(u,  0).toFloat4());
+            Particle p;
+            p.r = r;
+            p.u = u;
+            p.setId(localCount++);
 
             localParticles.push_back(p);
         }
     }
 
-    int localStart = 0;
-    MPI_Check( MPI_Exscan(&localCount, &localStart, 1, MPI_INT, MPI_SUM, comm) );
+    int64_t localCount64 = localCount, localStart = 0;
+    MPI_Check( MPI_Exscan(&localCount64, &localStart, 1, MPI_INT64_T, MPI_SUM, comm) );
     
     pv->local()->resize_anew(localParticles.size());
     auto coovelPtr = pv->local()->coosvels.hostPtr();
     
     for (int i = 0; i < localParticles.size(); ++i) {
         Particle p = localParticles[i];
-        p.i1 += localStart;
+        p.setId(p.getId() + localStart);
         coovelPtr[i] = p;
     }
 
@@ -75,7 +75,8 @@ void MembraneIC::exec(const MPI_Comm& comm, ParticleVector* pv, DomainInfo domai
 
     // Set ids
     // Need to do that, as not all the objects in com_q may be valid
-    int totalCount=0; // TODO: int64!
+    // Object ids fit in 32 bits, particle ids may not
+    int totalCount=0;
     MPI_Check( MPI_Exscan(&nObjs, &totalCount, 1, MPI_INT, MPI_SUM, comm) );
 
     auto ids = ov->local()->extraPerObject.getData<int>("ids");
@@ -83,7 +84,7 @@ void MembraneIC::exec(const MPI_Comm& comm, ParticleVector* pv, DomainInfo domai
         (*ids)[i] = totalCount + i;
 
     for (int i=0; i < ov->local()->size(); i++)
-        ov->local()->coosvels[i].i1 = totalCount*ov->objSize + i;
+        ov->local()->coosvels[i].setId((int64_t)totalCount*ov->objSize + i);
 
 
     ids->uploadToDevice(stream);
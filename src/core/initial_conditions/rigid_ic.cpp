@@ -107,7 +107,8 @@ void RigidIC::exec(const MPI_Comm& comm, ParticleVector* pv, DomainInfo domain,
 
     // Set ids
     // Need to do that, as not all the objects in com_q may be valid
-    int totalCount=0; // TODO: int64!
+    // Object ids fit in 32 bits, particle ids may not
+    int totalCount=0;
     MPI_Check( MPI_Exscan(&nObjs, &totalCount, 1, MPI_INT, MPI_SUM, comm) );
 
     auto ids = ov->local()->extraPerObject.getData<int>("ids");
@@ -118,7 +119,7 @@ void RigidIC::exec(const MPI_Comm& comm, ParticleVector* pv, DomainInfo domain,
     for (int i=0; i < ov->local()->size(); i++)
     {
         Particle p(make_float4(0), make_float4(0));
-        p.i1 = totalCount*ov->objSize + i;
+        p.setId((int64_t)totalCount*ov->objSize + i);
         ov->local()->coosvels[i] = p;
     }
 
@@ -25,12 +25,8 @@ UniformIC::~UniformIC() = default;
  *
  * Here \f$ \rho \f$ is the target number density: #density
  *
- * Each particle will have a unique id across all MPI processes in Particle::i1.
- *
- * \rst
- * .. note::
- *    Currently ids are only 32-bit wide
- * \endrst
+ * Each particle will have a unique 64-bit id across all MPI processes,
+ * see Particle::getId()
  */
 void UniformIC::exec(const MPI_Comm& comm, ParticleVector* pv, DomainInfo domain, cudaStream_t stream)
 {
@@ -72,8 +68,6 @@ void UniformIC::exec(const MPI_Comm& comm, ParticleVector* pv, DomainInfo domain
                     cooPtr[mycount].r.x = i*h.x - 0.5*domain.localSize.x + udistr(gen);
                     cooPtr[mycount].r.y = j*h.y - 0.5*domain.localSize.y + udistr(gen);
                     cooPtr[mycount].r.z = k*h.z - 0.5*domain.localSize.z + udistr(gen);
-                    cooPtr[mycount].i1 = mycount;
-
                     cooPtr[mycount].u.x = 0.0f * (udistr(gen) - 0.5);
                     cooPtr[mycount].u.y = 0.0f * (udistr(gen) - 0.5);
                     cooPtr[mycount].u.z = 0.0f * (udistr(gen) - 0.5);
@@ -82,7 +76,7 @@ void UniformIC::exec(const MPI_Comm& comm, ParticleVector* pv, DomainInfo domain
                     avgMomentum.y += cooPtr[mycount].u.y;
                     avgMomentum.z += cooPtr[mycount].u.z;
 
-                    cooPtr[mycount].i1 = mycount;
+                    cooPtr[mycount].setId(mycount);
                     mycount++;
                 }
             }
@@ -99,10 +93,10 @@ void UniformIC::exec(const MPI_Comm& comm, ParticleVector* pv, DomainInfo domain
         cooPtr[i].u.z -= avgMomentum.z;
     }
 
-    int totalCount=0; // TODO: int64!
-    MPI_Check( MPI_Exscan(&mycount, &totalCount, 1, MPI_INT, MPI_SUM, comm) );
+    int64_t localCount = mycount, totalCount = 0;
+    MPI_Check( MPI_Exscan(&localCount, &totalCount, 1, MPI_INT64_T, MPI_SUM, comm) );
     for (int i=0; i < pv->local()->size(); i++)
-        pv->local()->coosvels[i].i1 += totalCount;
+        pv->local()->coosvels[i].setId(totalCount + i);
     
     //pv->createIndicesHost();
 
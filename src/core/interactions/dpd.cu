@@ -28,6 +28,21 @@ void InteractionDPD::setPrerequisites(ParticleVector* pv1, ParticleVector* pv2)
     impl->setPrerequisites(pv1, pv2);
 }
 
+void InteractionDPD::setBackend(ExecutionBackend backend)
+{
+    impl->setBackend(backend);
+}
+
+ExecutionBackend InteractionDPD::getBackend() const
+{
+    return impl->getBackend();
+}
+
+void InteractionDPD::setVerletList(float skin)
+{
+    impl->setVerletList(skin);
+}
+
 void InteractionDPD::regular(ParticleVector* pv1, ParticleVector* pv2,
                              CellList* cl1, CellList* cl2,
                              const float t, cudaStream_t stream)
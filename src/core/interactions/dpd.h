@@ -15,6 +15,9 @@ public:
     ~InteractionDPD();
 
     void setPrerequisites(ParticleVector* pv1, ParticleVector* pv2) override;
+    void setBackend(ExecutionBackend backend) override;
+    ExecutionBackend getBackend() const override;
+    void setVerletList(float skin) override;
     void regular(ParticleVector* pv1, ParticleVector* pv2, CellList* cl1, CellList* cl2, const float t, cudaStream_t stream) override;
     void halo   (ParticleVector* pv1, ParticleVector* pv2, CellList* cl1, CellList* cl2, const float t, cudaStream_t stream) override;
     
@@ -13,6 +13,8 @@ public:
                          float a=Default, float gamma=Default, float kbt=Default,
                          float dt=Default, float power=Default) override;
 
+    bool computesStress() const override { return true; }
+
 protected:
     float stressPeriod;
 };
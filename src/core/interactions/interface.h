@@ -4,6 +4,8 @@
 #include <mpi.h>
 
 #include "core/ymero_object.h"
+#include "core/logger.h"
+#include "core/utils/execution_backend.h"
 
 class CellList;
 class ParticleVector;
@@ -31,6 +33,33 @@ public:
      */
     virtual void setPrerequisites(ParticleVector* pv1, ParticleVector* pv2) {}
 
+    /**
+     * Choose where the interaction will be computed.
+     * Default: only ExecutionBackend::Device is supported
+     */
+    virtual void setBackend(ExecutionBackend backend)
+    {
+        if (backend != ExecutionBackend::Device)
+            die("Interaction '%s' can only be executed on the device", name.c_str());
+    }
+
+    /// @return where the interaction is computed
+    virtual ExecutionBackend getBackend() const { return ExecutionBackend::Device; }
+
+    /// @return true if the interaction also computes per-particle stresses
+    virtual bool computesStress() const { return false; }
+
+    /**
+     * Use Verlet lists with the given \p skin for the local self interactions
+     * instead of traversing the cells every time step.
+     * Cell-lists are still built every time step
+     * Default: Verlet lists are not supported
+     */
+    virtual void setVerletList(float skin)
+    {
+        die("Interaction '%s' doesn't support Verlet lists", name.c_str());
+    }
+
     /**
      * Interface to compute local interactions.
      * For now order of \e pv1 and \e pv2 is important for computational reasons,
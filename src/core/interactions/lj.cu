@@ -31,6 +31,21 @@ void InteractionLJ::setPrerequisites(ParticleVector* pv1, ParticleVector* pv2)
     impl->setPrerequisites(pv1, pv2);
 }
 
+void InteractionLJ::setBackend(ExecutionBackend backend)
+{
+    impl->setBackend(backend);
+}
+
+ExecutionBackend InteractionLJ::getBackend() const
+{
+    return impl->getBackend();
+}
+
+void InteractionLJ::setVerletList(float skin)
+{
+    impl->setVerletList(skin);
+}
+
 void InteractionLJ::regular(ParticleVector* pv1, ParticleVector* pv2,
                              CellList* cl1, CellList* cl2,
                              const float t, cudaStream_t stream)
@@ -11,6 +11,8 @@ struct InteractionLJWithStress : public InteractionLJ
     void setSpecificPair(ParticleVector* pv1, ParticleVector* pv2, 
                          float epsilon, float sigma, float maxForce) override;
 
+    bool computesStress() const override { return true; }
+
 protected:
     float stressPeriod;
 };
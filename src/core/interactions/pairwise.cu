@@ -5,9 +5,12 @@
 #include <core/celllist.h>
 #include <core/pvs/particle_vector.h>
 #include <core/pvs/views/pv.h>
+#include <core/pvs/object_vector.h>
 #include <core/logger.h>
+#include <core/utils/make_unique.h>
 
 #include "pairwise_kernels.h"
+#include "pairwise_kernels_host.h"
 
 #include "pairwise_interactions/stress_wrapper.h"
 #include "pairwise_interactions/dpd.h"
@@ -16,6 +19,54 @@
 
 #include "pairwise_interactions/norandom_dpd.h"
 
+#include <type_traits>
+
+/**
+ * Whether the pairwise interaction can be evaluated on host,
+ * i.e. its operator() is \c \_\_host\_\_ \c \_\_device\_\_
+ */
+template<class PairwiseInteraction>
+struct HasHostImplementation : std::false_type {};
+
+template<> struct HasHostImplementation<Pairwise_Norandom_DPD>  : std::true_type {};
+template<> struct HasHostImplementation<Pairwise_DPD>           : std::true_type {};
+template<> struct HasHostImplementation<Pairwise_LJ>            : std::true_type {};
+template<> struct HasHostImplementation<Pairwise_LJObjectAware> : std::true_type {};
+
+/**
+ * Wrappers around the host kernels that only get instantiated
+ * for the interactions having host implementation
+ */
+template<typename Interaction>
+static void selfInteractionsHost(int np, CellListInfo cinfo, float rc2, const Interaction& pair, std::true_type)
+{
+    computeSelfInteractionsHost(np, cinfo, rc2, pair);
+}
+
+template<typename Interaction>
+static void selfInteractionsHost(int np, CellListInfo cinfo, float rc2, const Interaction& pair, std::false_type)
+{
+    die("Interaction has no host implementation");
+}
+
+static void zeroHostForces(PinnedBuffer<Force>& forces, int n)
+{
+    forces.resize_anew(n);
+    forces.clearHost();
+}
+
+template<InteractionOut NeedDstAcc, InteractionOut NeedSrcAcc, InteractionMode Variant, typename Interaction>
+static void externalInteractionsHost(PVview view, CellListInfo cinfo, float rc2, const Interaction& pair, std::true_type)
+{
+    computeExternalInteractionsHost<NeedDstAcc, NeedSrcAcc, Variant>(view, cinfo, rc2, pair);
+}
+
+template<InteractionOut NeedDstAcc, InteractionOut NeedSrcAcc, InteractionMode Variant, typename Interaction>
+static void externalInteractionsHost(PVview view, CellListInfo cinfo, float rc2, const Interaction& pair, std::false_type)
+{
+    die("Interaction has no host implementation");
+}
+
 
 /**
  * Convenience macro wrapper
@@ -60,6 +111,9 @@ void InteractionPair<PariwiseInteraction>::regular(ParticleVector* pv1, Particle
  * - Both are ParticleVector. Then if they are different, two _compute() calls
  *   are made such that halo1 \<-\> local2 and halo2 \<-\> local1. If \p pv1 and
  *   \p pv2 are the same, only one call is needed
+ *
+ * With ParticleVector::halfShellHalo the forces on the halo particles are also
+ * computed, they are sent back to the owners by ParticleForcesReverseExchanger
  */
 template<class PairwiseInteraction>
 void InteractionPair<PairwiseInteraction>::halo(ParticleVector* pv1, ParticleVector* pv2, CellList* cl1, CellList* cl2, const float t, cudaStream_t stream)
@@ -128,6 +182,12 @@ void InteractionPair<PairwiseInteraction>::_compute(InteractionType type,
 
     auto& pair = (it == intMap.end()) ? defaultPair : it->second;
 
+    if (backend == ExecutionBackend::Host)
+    {
+        _computeHost(type, pv1, pv2, cl1, cl2, pair, t, stream);
+        return;
+    }
+
     if (type == InteractionType::Regular)
     {
         pair.setup(pv1->local(), pv2->local(), cl1, cl2, t);
@@ -141,10 +201,28 @@ void InteractionPair<PairwiseInteraction>::_compute(InteractionType type,
             const int nth = 128;
 
             auto cinfo = cl1->cellInfo();
-            SAFE_KERNEL_LAUNCH(
-                    computeSelfInteractions,
-                    getNblocks(np, nth), nth, 0, stream,
-                    np, cinfo, rc*rc, pair);
+
+            // Verlet lists can only follow the particles reordered by primary cell-lists
+            if (verletSkin > 0.0f && dynamic_cast<PrimaryCellList*>(cl1) != nullptr)
+            {
+                auto& vlist = verletLists[cl1];
+                if (!vlist) vlist = std::make_unique<VerletList>(rc, verletSkin);
+
+                vlist->update(cl1, stream);
+                auto view = vlist->view();
+
+                SAFE_KERNEL_LAUNCH(
+                        computeSelfInteractionsVerlet,
+                        getNblocks(view.size, nth), nth, 0, stream,
+                        view, cinfo, rc*rc, pair);
+            }
+            else
+            {
+                SAFE_KERNEL_LAUNCH(
+                        computeSelfInteractions,
+                        getNblocks(np, nth), nth, 0, stream,
+                        np, cinfo, rc*rc, pair);
+            }
         }
         else /*  External interaction */
         {
@@ -174,13 +252,141 @@ void InteractionPair<PairwiseInteraction>::_compute(InteractionType type,
         PVview view(pv1, pv1->halo());
         const int nth = 128;
         if (np1 > 0 && np2 > 0)
-            if (dynamic_cast<ObjectVector*>(pv1) == nullptr) // don't need forces for pure particle halo
+            if (dynamic_cast<ObjectVector*>(pv1) == nullptr && !pv1->halfShellHalo) // don't need forces for pure particle halo
                 CHOOSE_EXTERNAL(InteractionOut::NoAcc,   InteractionOut::NeedAcc, InteractionMode::Dilute, pair );
             else
                 CHOOSE_EXTERNAL(InteractionOut::NeedAcc, InteractionOut::NeedAcc, InteractionMode::Dilute, pair );
     }
 }
 
+/**
+ * Host execution backend counterpart of _compute().
+ *
+ * Particles and cell-lists are copied to host, forces are computed
+ * with OpenMP threads (see pairwise_kernels_host.h) and atomically
+ * added to the device forces afterwards. All the operations are
+ * synchronous with respect to the \p stream.
+ */
+template<class PairwiseInteraction>
+void InteractionPair<PairwiseInteraction>::_computeHost(InteractionType type,
+        ParticleVector* pv1, ParticleVector* pv2, CellList* cl1, CellList* cl2,
+        PairwiseInteraction& pair, const float t, cudaStream_t stream)
+{
+    const HasHostImplementation<PairwiseInteraction> hostImpl;
+    const float rc2 = rc*rc;
+
+    if (type == InteractionType::Regular)
+    {
+        pair.setup(pv1->local(), pv2->local(), cl1, cl2, t);
+
+        /*  Self interaction */
+        if (pv1 == pv2)
+        {
+            const int np = pv1->local()->size();
+            debug("Computing internal forces for %s (%d particles) on host", pv1->name.c_str(), np);
+
+            auto& forces = hostRegularForces.forces1;
+            zeroHostForces(forces, np);
+
+            cl1->downloadToHost(stream);
+            selfInteractionsHost(np, cl1->cellInfoHost(&forces), rc2, pair, hostImpl);
+            cl1->uploadHostForces(forces, stream);
+        }
+        else /*  External interaction */
+        {
+            const int np1 = pv1->local()->size();
+            const int np2 = pv2->local()->size();
+            debug("Computing external forces for %s - %s (%d - %d particles) on host", pv1->name.c_str(), pv2->name.c_str(), np1, np2);
+
+            if (np1 == 0 || np2 == 0) return;
+
+            auto& forces1 = hostRegularForces.forces1;
+            auto& forces2 = hostRegularForces.forces2;
+            zeroHostForces(forces1, np1);
+            zeroHostForces(forces2, np2);
+
+            cl1->downloadToHost(stream);
+            cl2->downloadToHost(stream);
+
+            auto cinfo1 = cl1->cellInfoHost(&forces1);
+            PVview view(pv1, pv1->local());
+            view.particles = cinfo1.particles;
+            view.forces    = cinfo1.forces;
+
+            externalInteractionsHost<InteractionOut::NeedAcc, InteractionOut::NeedAcc, InteractionMode::RowWise>
+                (view, cl2->cellInfoHost(&forces2), rc2, pair, hostImpl);
+
+            cl1->uploadHostForces(forces1, stream);
+            cl2->uploadHostForces(forces2, stream);
+        }
+    }
+
+    /*  Halo interaction */
+    if (type == InteractionType::Halo)
+    {
+        pair.setup(pv1->halo(), pv2->local(), cl1, cl2, t);
+
+        const int np1 = pv1->halo()->size();  // note halo here
+        const int np2 = pv2->local()->size();
+        debug("Computing halo forces for %s(halo) - %s (%d - %d particles) on host", pv1->name.c_str(), pv2->name.c_str(), np1, np2);
+
+        if (np1 == 0 || np2 == 0) return;
+
+        auto& haloForces = hostHaloForces.forces1;
+        auto& forces2    = hostHaloForces.forces2;
+        zeroHostForces(forces2, np2);
+
+        auto lhalo = pv1->halo();
+        lhalo->coosvels.downloadFromDevice(stream, ContainersSynch::Asynch);
+        cl2->downloadToHost(stream);
+
+        PVview view(pv1, lhalo);
+        view.particles = reinterpret_cast<float4*>(lhalo->coosvels.hostPtr());
+
+        if (dynamic_cast<ObjectVector*>(pv1) == nullptr && !pv1->halfShellHalo) // don't need forces for pure particle halo
+        {
+            externalInteractionsHost<InteractionOut::NoAcc,   InteractionOut::NeedAcc, InteractionMode::Dilute>
+                (view, cl2->cellInfoHost(&forces2), rc2, pair, hostImpl);
+        }
+        else
+        {
+            zeroHostForces(haloForces, np1);
+            view.forces = reinterpret_cast<float4*>(haloForces.hostPtr());
+
+            externalInteractionsHost<InteractionOut::NeedAcc, InteractionOut::NeedAcc, InteractionMode::Dilute>
+                (view, cl2->cellInfoHost(&forces2), rc2, pair, hostImpl);
+
+            CellList::addHostForces(haloForces, &lhalo->forces, stream);
+        }
+
+        cl2->uploadHostForces(forces2, stream);
+    }
+}
+
+template<class PairwiseInteraction>
+void InteractionPair<PairwiseInteraction>::setBackend(ExecutionBackend backend)
+{
+    if (backend == ExecutionBackend::Host && !HasHostImplementation<PairwiseInteraction>::value)
+        die("Interaction '%s' has no host implementation", name.c_str());
+
+    debug("Interaction '%s' will be executed on %s", name.c_str(), backendToString(backend).c_str());
+    this->backend = backend;
+}
+
+template<class PairwiseInteraction>
+void InteractionPair<PairwiseInteraction>::setVerletList(float skin)
+{
+    if (skin < 0.0f)
+        die("Interaction '%s': skin of the Verlet lists has to be non-negative, got %f", name.c_str(), skin);
+
+    if (skin > 0.0f && backend == ExecutionBackend::Host)
+        warn("Interaction '%s': Verlet lists are only used on the device, host backend will traverse the cells", name.c_str());
+
+    debug("Interaction '%s' will use Verlet lists with skin %f", name.c_str(), skin);
+    verletSkin = skin;
+    verletLists.clear();
+}
+
 template<class PairwiseInteraction>
 void InteractionPair<PairwiseInteraction>::setSpecificPair(std::string pv1name, std::string pv2name, PairwiseInteraction pair)
 {
@@ -1,7 +1,12 @@
 #pragma once
 #include "interface.h"
+#include "verlet_list.h"
+
+#include <core/datatypes.h>
+#include <core/containers.h>
 
 #include <map>
+#include <memory>
 
 /**
  * Implementation of short-range symmetric pairwise interactions
@@ -23,9 +28,34 @@ public:
 
     void setSpecificPair(std::string pv1name, std::string pv2name, PairwiseInteraction pair);
 
+    void setBackend(ExecutionBackend backend) override;
+    ExecutionBackend getBackend() const override { return backend; }
+
+    void setVerletList(float skin) override;
+
     ~InteractionPair() = default;
 
 private:
     PairwiseInteraction defaultPair;
     std::map< std::pair<std::string, std::string>, PairwiseInteraction > intMap;
+
+    ExecutionBackend backend{ExecutionBackend::Device};
+
+    /// Skin of the Verlet lists, they are not used if it is 0
+    float verletSkin{0.0f};
+    std::map< CellList*, std::unique_ptr<VerletList> > verletLists;
+
+    /**
+     * Host force increments of the host backend, for the first and the second
+     * ParticleVector of an interaction. Regular and halo interactions are
+     * separate tasks that may run concurrently, each of them has its own buffers
+     */
+    struct HostForces
+    {
+        PinnedBuffer<Force> forces1, forces2;
+    };
+    HostForces hostRegularForces, hostHaloForces;
+
+    void _computeHost(InteractionType type, ParticleVector* pv1, ParticleVector* pv2, CellList* cl1, CellList* cl2,
+                      PairwiseInteraction& pair, const float t, cudaStream_t stream);
 };
@@ -16,6 +16,11 @@ float fastPower(float x, float a)
 {
     return pow(x, a);
 }
+
+float invSqrt(float x)
+{
+    return 1.0f / sqrt(x);
+}
 #else
 #include <core/utils/cuda_common.h>
 #endif
@@ -44,13 +49,13 @@ public:
         seed = udistr(gen);
     }
 
-    __D__ inline float3 operator()(const Particle dst, int dstId, const Particle src, int srcId) const
+    __HD__ inline float3 operator()(const Particle dst, int dstId, const Particle src, int srcId) const
     {
         const float3 dr = dst.r - src.r;
         const float rij2 = dot(dr, dr);
         if (rij2 > rc2) return make_float3(0.0f);
 
-        const float invrij = rsqrtf(rij2);
+        const float invrij = invSqrt(rij2);
         const float rij = rij2 * invrij;
         const float argwr = 1.0f - rij * invrc;
         const float wr = fastPower(argwr, power);
@@ -59,7 +64,7 @@ public:
         const float3 du = dst.u - src.u;
         const float rdotv = dot(dr_r, du);
 
-        const float myrandnr = Logistic::mean0var1(seed, min(src.i1, dst.i1), max(src.i1, dst.i1));
+        const float myrandnr = Logistic::mean0var1(seed, min(src.idKey(), dst.idKey()), max(src.idKey(), dst.idKey()));
 
         const float strength = a * argwr - (gamma * wr * rdotv + sigma * myrandnr) * wr;
 
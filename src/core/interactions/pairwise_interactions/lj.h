@@ -23,7 +23,7 @@ public:
     void setup(LocalParticleVector* pv1, LocalParticleVector* pv2, CellList* cl1, CellList* cl2, float t)
     {    }
 
-    __D__ inline float3 operator()(Particle dst, int dstId, Particle src, int srcId) const
+    __HD__ inline float3 operator()(Particle dst, int dstId, Particle src, int srcId) const
     {
         const float3 dr = dst.r - src.r;
         const float rij2 = dot(dr, dr);
@@ -28,12 +28,12 @@ public:
         }
     }
 
-    __D__ inline float3 operator()(Particle dst, int dstId, Particle src, int srcId) const
+    __HD__ inline float3 operator()(Particle dst, int dstId, Particle src, int srcId) const
     {
         if (self)
         {
-            const int dstObjId = dst.i1 / objSize;
-            const int srcObjId = src.i1 / objSize;
+            const int64_t dstObjId = dst.getId() / objSize;
+            const int64_t srcObjId = src.getId() / objSize;
 
             if (dstObjId == srcObjId) return make_float3(0.0f);
         }
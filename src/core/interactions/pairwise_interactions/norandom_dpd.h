@@ -26,13 +26,13 @@ public:
     void setup(LocalParticleVector* lpv1, LocalParticleVector* lpv2, CellList* cl1, CellList* cl2, float t)
     {    }
 
-    __D__ inline float3 operator()(const Particle dst, int dstId, const Particle src, int srcId) const
+    __HD__ inline float3 operator()(const Particle dst, int dstId, const Particle src, int srcId) const
     {
         const float3 dr = dst.r - src.r;
         const float rij2 = dot(dr, dr);
         if (rij2 > rc2) return make_float3(0.0f);
 
-        const float invrij = rsqrtf(rij2);
+        const float invrij = invSqrt(rij2);
         const float rij = rij2 * invrij;
         const float argwr = 1.0f - rij * invrc;
         const float wr = fastPower(argwr, power);
@@ -41,7 +41,7 @@ public:
         const float3 du = dst.u - src.u;
         const float rdotv = dot(dr_r, du);
 
-        const float myrandnr = ((min(src.i1, dst.i1) ^ max(src.i1, dst.i1)) % 13) - 6;
+        const float myrandnr = ((min(src.idKey(), dst.idKey()) ^ max(src.idKey(), dst.idKey())) % 13) - 6;
 
         const float strength = a * argwr - (gamma * wr * rdotv + sigma * myrandnr) * wr;
 
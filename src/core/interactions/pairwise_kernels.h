@@ -1,3 +1,5 @@
+#pragma once
+
 #include <cassert>
 #include <type_traits>
 
@@ -6,6 +8,8 @@
 
 #include <core/pvs/views/pv.h>
 
+#include "verlet_list.h"
+
 enum class InteractionWith
 {
     Self, Other
@@ -24,7 +28,7 @@ enum class InteractionMode
 /// Squared distance between vectors with components
 /// (\p a.x, \p a.y, \p a.z) and (\p b.x, \p b.y, \p b.z)
 template<typename Ta, typename Tb>
-__device__ inline float distance2(const Ta a, const Tb b)
+__device__ __host__ inline float distance2(const Ta a, const Tb b)
 {
     auto sqr = [] (float x) { return x*x; };
     return sqr(a.x - b.x) + sqr(a.y - b.y) + sqr(a.z - b.z);
@@ -97,6 +101,58 @@ __device__ inline void computeCell(
     }
 }
 
+/**
+ * Compute interactions between one destination particle and all source
+ * particles in the cells (\p cellX - 1 ... \p cellX + \p lastShift, \p cellY, \p cellZ)
+ * with computeCell()
+ *
+ * With row-major cell ordering these cells are contiguous in memory and
+ * processed as a single range of particles. Otherwise, e.g. for the
+ * space-filling curve orderings, the cells are processed one by one.
+ *
+ * For self interactions (\p lastShift = 0) only the pairs within the own cell
+ * are selected by the particle ids, all the pairs with the cell \p cellX - 1
+ * are computed: whatever the ordering, they are not seen by its particles
+ */
+template<InteractionOut NeedDstAcc, InteractionOut NeedSrcAcc, InteractionWith InteractWith, typename Interaction>
+__device__ inline void computeRow(
+        int cellX, int cellY, int cellZ, int lastShift,
+        Particle dstP, int dstId, float3& dstFrc,
+        CellListInfo cinfo,
+        float rc2, Interaction& interaction)
+{
+    if (cinfo.ordering == CellListOrdering::RowMajor)
+    {
+        const int midCellId = cinfo.encode(cellX, cellY, cellZ);
+        int rowStart  = max(midCellId-1, 0);
+        int rowEnd    = min(midCellId+1+lastShift, cinfo.totcells);
+
+        if (rowStart >= rowEnd) return;
+
+        const int pstart = cinfo.cellStarts[rowStart];
+        const int pend   = cinfo.cellStarts[rowEnd];
+
+        computeCell<NeedDstAcc, NeedSrcAcc, InteractWith> (pstart, pend, dstP, dstId, dstFrc, cinfo, rc2, interaction);
+    }
+    else
+    {
+        for (int x = max(cellX-1, 0); x <= min(cellX+lastShift, cinfo.ncells.x-1); x++)
+        {
+            const int cid = cinfo.encode(x, cellY, cellZ);
+            const int pstart = cinfo.cellStarts[cid];
+            const int pend   = cinfo.cellStarts[cid+1];
+
+            // Ids don't grow along x with these orderings, the id test only
+            // holds within the own cell. The pairs with the neighbouring cells
+            // are not visited by any other thread, so all of them are computed here
+            if (InteractWith == InteractionWith::Self && x != cellX)
+                computeCell<NeedDstAcc, NeedSrcAcc, InteractionWith::Other> (pstart, pend, dstP, dstId, dstFrc, cinfo, rc2, interaction);
+            else
+                computeCell<NeedDstAcc, NeedSrcAcc, InteractWith>           (pstart, pend, dstP, dstId, dstFrc, cinfo, rc2, interaction);
+        }
+    }
+}
+
 /**
  * Compute interactions within a single ParticleVector.
  *
@@ -134,25 +190,68 @@ __global__ void computeSelfInteractions(
                 if ( !(cellY >= 0 && cellY < cinfo.ncells.y && cellZ >= 0 && cellZ < cinfo.ncells.z) ) continue;
                 if (cellY == cell0.y && cellZ > cell0.z) continue;
 
-                const int midCellId = cinfo.encode(cell0.x, cellY, cellZ);
-                int rowStart  = max(midCellId-1, 0);
-                int rowEnd    = min(midCellId+2, cinfo.totcells);
-
-                if ( cellY == cell0.y && cellZ == cell0.z ) rowEnd = midCellId + 1; // this row is already partly covered
-
-                const int pstart = cinfo.cellStarts[rowStart];
-                const int pend   = cinfo.cellStarts[rowEnd];
-
+                // this row is already partly covered
                 if (cellY == cell0.y && cellZ == cell0.z)
-                    computeCell<InteractionOut::NeedAcc, InteractionOut::NeedAcc, InteractionWith::Self>  (pstart, pend, dstP, dstId, dstFrc, cinfo, rc2, interaction);
+                    computeRow<InteractionOut::NeedAcc, InteractionOut::NeedAcc, InteractionWith::Self>  (cell0.x, cellY, cellZ, 0, dstP, dstId, dstFrc, cinfo, rc2, interaction);
                 else
-                    computeCell<InteractionOut::NeedAcc, InteractionOut::NeedAcc, InteractionWith::Other> (pstart, pend, dstP, dstId, dstFrc, cinfo, rc2, interaction);
+                    computeRow<InteractionOut::NeedAcc, InteractionOut::NeedAcc, InteractionWith::Other> (cell0.x, cellY, cellZ, 1, dstP, dstId, dstFrc, cinfo, rc2, interaction);
             }
 
     atomicAdd(cinfo.forces + dstId, dstFrc);
 }
 
 
+/**
+ * Compute interactions within a single ParticleVector using a VerletList
+ * instead of traversing the cells.
+ *
+ * Mapping is one thread per particle of the list. Each pair is stored in
+ * the list only once, so the source forces are updated as well.
+ *
+ * @param vlist view of the Verlet list, built for the same cell-list
+ * @param cinfo cell-list data
+ * @param rc2 squared cut-off distance
+ * @param interaction see computeSelfInteractions()
+ */
+template<typename Interaction>
+__launch_bounds__(128, 16)
+__global__ void computeSelfInteractionsVerlet(
+        VerletListView vlist, CellListInfo cinfo,
+        const float rc2, Interaction interaction)
+{
+    const int id = blockIdx.x*blockDim.x + threadIdx.x;
+    if (id >= vlist.size) return;
+
+    const int dstId = vlist.current[id];
+    if (dstId < 0) return;
+
+    const Particle dstP(cinfo.particles, dstId);
+    float3 dstFrc = make_float3(0.0f);
+
+    const int nNeighbours = vlist.nNeighbours[id];
+
+    for (int i = 0; i < nNeighbours; i++)
+    {
+        const int srcId = vlist.current[ vlist.neighbours[i*vlist.size + id] ];
+        if (srcId < 0) continue;
+
+        Particle srcP;
+        srcP.readCoordinate(cinfo.particles, srcId);
+
+        if (distance2(srcP.r, dstP.r) < rc2)
+        {
+            srcP.readVelocity(cinfo.particles, srcId);
+
+            const float3 frc = interaction(dstP, dstId, srcP, srcId);
+
+            dstFrc += frc;
+            atomicAdd(cinfo.forces + srcId, -frc);
+        }
+    }
+
+    atomicAdd(cinfo.forces + dstId, dstFrc);
+}
+
 /**
  * Compute interactions between particle of two different ParticleVector.
  *
@@ -206,16 +305,7 @@ __global__ void computeExternalInteractions_1tpp(
             {
                 if ( !(cellY >= 0 && cellY < srcCinfo.ncells.y && cellZ >= 0 && cellZ < srcCinfo.ncells.z) ) continue;
 
-                const int midCellId = srcCinfo.encode(cell0.x, cellY, cellZ);
-                int rowStart  = max(midCellId-1, 0);
-                int rowEnd    = min(midCellId+2, srcCinfo.totcells);
-
-                if (rowStart >= rowEnd) continue;
-                
-                const int pstart = srcCinfo.cellStarts[rowStart];
-                const int pend   = srcCinfo.cellStarts[rowEnd];
-
-                computeCell<NeedDstAcc, NeedSrcAcc, InteractionWith::Other> (pstart, pend, dstP, dstId, dstFrc, srcCinfo, rc2, interaction);
+                computeRow<NeedDstAcc, NeedSrcAcc, InteractionWith::Other> (cell0.x, cellY, cellZ, 1, dstP, dstId, dstFrc, srcCinfo, rc2, interaction);
             }
             else
             {
@@ -272,16 +362,7 @@ __global__ void computeExternalInteractions_3tpp(
         {
             if ( !(cellY >= 0 && cellY < srcCinfo.ncells.y && cellZ >= 0 && cellZ < srcCinfo.ncells.z) ) continue;
 
-            const int midCellId = srcCinfo.encode(cell0.x, cellY, cellZ);
-            int rowStart  = max(midCellId-1, 0);
-            int rowEnd    = min(midCellId+2, srcCinfo.totcells);
-
-            if (rowStart >= rowEnd) continue;
-            
-            const int pstart = srcCinfo.cellStarts[rowStart];
-            const int pend   = srcCinfo.cellStarts[rowEnd];
-
-            computeCell<NeedDstAcc, NeedSrcAcc, InteractionWith::Other> (pstart, pend, dstP, dstId, dstFrc, srcCinfo, rc2, interaction);
+            computeRow<NeedDstAcc, NeedSrcAcc, InteractionWith::Other> (cell0.x, cellY, cellZ, 1, dstP, dstId, dstFrc, srcCinfo, rc2, interaction);
         }
         else
         {
@@ -338,16 +419,7 @@ __global__ void computeExternalInteractions_9tpp(
     {
         if ( !(cellY >= 0 && cellY < srcCinfo.ncells.y && cellZ >= 0 && cellZ < srcCinfo.ncells.z) ) return;
 
-        const int midCellId = srcCinfo.encode(cell0.x, cellY, cellZ);
-        int rowStart  = max(midCellId-1, 0);
-        int rowEnd    = min(midCellId+2, srcCinfo.totcells);
-
-        if (rowStart >= rowEnd) return;
-        
-        const int pstart = srcCinfo.cellStarts[rowStart];
-        const int pend   = srcCinfo.cellStarts[rowEnd];
-
-        computeCell<NeedDstAcc, NeedSrcAcc, InteractionWith::Other> (pstart, pend, dstP, dstId, dstFrc, srcCinfo, rc2, interaction);
+        computeRow<NeedDstAcc, NeedSrcAcc, InteractionWith::Other> (cell0.x, cellY, cellZ, 1, dstP, dstId, dstFrc, srcCinfo, rc2, interaction);
     }
     else
     {
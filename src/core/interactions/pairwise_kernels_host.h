@@ -0,0 +1,223 @@
+#pragma once
+
+#include "pairwise_kernels.h"
+
+/**
+ * Host (CPU) counterparts of the kernels in pairwise_kernels.h
+ *
+ * Work is distributed between OpenMP threads one destination particle
+ * per loop iteration. All the data (cell-list, particles and forces)
+ * has to reside in host memory, see CellList::cellInfoHost().
+ *
+ * In contrast to the GPU kernels, self interactions traverse the
+ * full shell of 27 neighbouring cells and only update forces of the
+ * destination particle: that requires twice more pair evaluations,
+ * but needs no atomic operations and lets the compiler vectorize
+ * the innermost loop over the cell contents.
+ */
+
+/// Thread-safe addition of a force to the \e float4 force array on host
+inline void atomicAddHost(float4* addr, const float3 v)
+{
+    float* f = reinterpret_cast<float*>(addr);
+
+    #pragma omp atomic
+    f[0] += v.x;
+    #pragma omp atomic
+    f[1] += v.y;
+    #pragma omp atomic
+    f[2] += v.z;
+}
+
+/**
+ * Host version of computeCell(). Interactions between one destination
+ * particle and source particles with ids in [\p pstart, \p pend)
+ *
+ * If the source forces are not needed, the loop is vectorized.
+ * Otherwise the source forces are updated atomically, as the same source
+ * particle may be processed by several threads at the same time.
+ */
+template<InteractionOut NeedDstAcc, InteractionOut NeedSrcAcc, InteractionWith InteractWith, typename Interaction>
+inline void computeCellHost(
+        int pstart, int pend,
+        const Particle dstP, int dstId, float3& dstFrc,
+        const CellListInfo& cinfo,
+        float rc2, const Interaction& interaction)
+{
+    float fx = 0.0f, fy = 0.0f, fz = 0.0f;
+
+    if (NeedSrcAcc == InteractionOut::NoAcc)
+    {
+        #pragma omp simd reduction(+:fx, fy, fz)
+        for (int srcId = pstart; srcId < pend; srcId++)
+        {
+            const Particle srcP(cinfo.particles, srcId);
+
+            bool interacting = distance2(srcP.r, dstP.r) < rc2;
+
+            if (InteractWith == InteractionWith::Self)
+                if (dstId == srcId) interacting = false;
+
+            if (interacting)
+            {
+                const float3 frc = interaction(dstP, dstId, srcP, srcId);
+
+                fx += frc.x;
+                fy += frc.y;
+                fz += frc.z;
+            }
+        }
+    }
+    else
+    {
+        for (int srcId = pstart; srcId < pend; srcId++)
+        {
+            const Particle srcP(cinfo.particles, srcId);
+
+            bool interacting = distance2(srcP.r, dstP.r) < rc2;
+
+            if (InteractWith == InteractionWith::Self)
+                if (dstId == srcId) interacting = false;
+
+            if (interacting)
+            {
+                const float3 frc = interaction(dstP, dstId, srcP, srcId);
+
+                fx += frc.x;
+                fy += frc.y;
+                fz += frc.z;
+
+                atomicAddHost(cinfo.forces + srcId, -frc);
+            }
+        }
+    }
+
+    if (NeedDstAcc == InteractionOut::NeedAcc)
+        dstFrc += make_float3(fx, fy, fz);
+}
+
+/// Host version of computeRow()
+template<InteractionOut NeedDstAcc, InteractionOut NeedSrcAcc, InteractionWith InteractWith, typename Interaction>
+inline void computeRowHost(
+        int cellX, int cellY, int cellZ, int lastShift,
+        const Particle dstP, int dstId, float3& dstFrc,
+        const CellListInfo& cinfo,
+        float rc2, const Interaction& interaction)
+{
+    if (cinfo.ordering == CellListOrdering::RowMajor)
+    {
+        const int midCellId = cinfo.encode(cellX, cellY, cellZ);
+        const int rowStart  = max(midCellId-1, 0);
+        const int rowEnd    = min(midCellId+1+lastShift, cinfo.totcells);
+
+        if (rowStart >= rowEnd) return;
+
+        const int pstart = cinfo.cellStarts[rowStart];
+        const int pend   = cinfo.cellStarts[rowEnd];
+
+        computeCellHost<NeedDstAcc, NeedSrcAcc, InteractWith>
+            (pstart, pend, dstP, dstId, dstFrc, cinfo, rc2, interaction);
+    }
+    else
+    {
+        for (int x = max(cellX-1, 0); x <= min(cellX+lastShift, cinfo.ncells.x-1); x++)
+        {
+            const int cid = cinfo.encode(x, cellY, cellZ);
+
+            computeCellHost<NeedDstAcc, NeedSrcAcc, InteractWith>
+                (cinfo.cellStarts[cid], cinfo.cellStarts[cid+1], dstP, dstId, dstFrc, cinfo, rc2, interaction);
+        }
+    }
+}
+
+/**
+ * Host version of computeSelfInteractions()
+ *
+ * Every particle sums up the forces from all the 27 neighbouring cells,
+ * so each force entry is only written by the thread owning the particle.
+ * The interaction has to be antisymmetric: F(i,j) == -F(j,i)
+ */
+template<typename Interaction>
+void computeSelfInteractionsHost(
+        const int np, CellListInfo cinfo,
+        const float rc2, const Interaction& interaction)
+{
+    #pragma omp parallel for schedule(static)
+    for (int dstId = 0; dstId < np; dstId++)
+    {
+        const Particle dstP(cinfo.particles, dstId);
+        float3 dstFrc = make_float3(0.0f);
+
+        const int3 cell0 = cinfo.getCellIdAlongAxes(dstP.r);
+
+        for (int cellZ = cell0.z-1; cellZ <= cell0.z+1; cellZ++)
+            for (int cellY = cell0.y-1; cellY <= cell0.y+1; cellY++)
+            {
+                if ( !(cellY >= 0 && cellY < cinfo.ncells.y && cellZ >= 0 && cellZ < cinfo.ncells.z) ) continue;
+
+                computeRowHost<InteractionOut::NeedAcc, InteractionOut::NoAcc, InteractionWith::Self>
+                    (cell0.x, cellY, cellZ, 1, dstP, dstId, dstFrc, cinfo, rc2, interaction);
+            }
+
+        float4& frc = cinfo.forces[dstId];
+        frc.x += dstFrc.x;
+        frc.y += dstFrc.y;
+        frc.z += dstFrc.z;
+    }
+}
+
+/**
+ * Host version of computeExternalInteractions_1tpp()
+ *
+ * Destination forces are owned by the threads, source forces
+ * (if needed) are updated atomically
+ */
+template<InteractionOut NeedDstAcc, InteractionOut NeedSrcAcc, InteractionMode Variant, typename Interaction>
+void computeExternalInteractionsHost(
+        PVview dstView, CellListInfo srcCinfo,
+        const float rc2, const Interaction& interaction)
+{
+    static_assert(NeedDstAcc == InteractionOut::NeedAcc || NeedSrcAcc == InteractionOut::NeedAcc,
+                  "External interactions should return at least some accelerations");
+
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int dstId = 0; dstId < dstView.size; dstId++)
+    {
+        const Particle dstP(dstView.particles, dstId);
+        float3 dstFrc = make_float3(0.0f);
+
+        const int3 cell0 = srcCinfo.getCellIdAlongAxes<CellListsProjection::NoClamp>(dstP.r);
+
+        for (int cellZ = cell0.z-1; cellZ <= cell0.z+1; cellZ++)
+            for (int cellY = cell0.y-1; cellY <= cell0.y+1; cellY++)
+            {
+                if ( !(cellY >= 0 && cellY < srcCinfo.ncells.y && cellZ >= 0 && cellZ < srcCinfo.ncells.z) ) continue;
+
+                if (Variant == InteractionMode::RowWise)
+                {
+                    computeRowHost<NeedDstAcc, NeedSrcAcc, InteractionWith::Other>
+                        (cell0.x, cellY, cellZ, 1, dstP, dstId, dstFrc, srcCinfo, rc2, interaction);
+                }
+                else
+                {
+                    for (int cellX = max(cell0.x-1, 0); cellX <= min(cell0.x+1, srcCinfo.ncells.x-1); cellX++)
+                    {
+                        const int cid = srcCinfo.encode(cellX, cellY, cellZ);
+                        const int pstart = srcCinfo.cellStarts[cid];
+                        const int pend   = srcCinfo.cellStarts[cid+1];
+
+                        computeCellHost<NeedDstAcc, NeedSrcAcc, InteractionWith::Other>
+                            (pstart, pend, dstP, dstId, dstFrc, srcCinfo, rc2, interaction);
+                    }
+                }
+            }
+
+        if (NeedDstAcc == InteractionOut::NeedAcc)
+        {
+            float4& frc = dstView.forces[dstId];
+            frc.x += dstFrc.x;
+            frc.y += dstFrc.y;
+            frc.z += dstFrc.z;
+        }
+    }
+}
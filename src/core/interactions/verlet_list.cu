@@ -0,0 +1,190 @@
+#include "verlet_list.h"
+
+#include <core/celllist.h>
+#include <core/logger.h>
+#include <core/utils/cuda_common.h>
+#include <core/utils/kernel_launch.h>
+
+#include <cstring>
+
+namespace VerletListKernels
+{
+enum Stats
+{
+    Alive = 0, MaxDisplacement2 = 1, MaxNeighbours = 2
+};
+
+__global__ void trackParticles(int n, const int* order, int* current)
+{
+    const int id = blockIdx.x * blockDim.x + threadIdx.x;
+    if (id >= n) return;
+
+    const int cur = current[id];
+    current[id] = cur >= 0 ? order[cur] : -1;
+}
+
+__global__ void checkDisplacements(int n, const int* current, const float4* particles,
+                                   const float4* refPositions, int* stats)
+{
+    const int id = blockIdx.x * blockDim.x + threadIdx.x;
+    if (id >= n) return;
+
+    const int cur = current[id];
+    if (cur < 0) return;
+
+    const float3 r   = make_float3(particles[2*cur]);
+    const float3 ref = make_float3(refPositions[id]);
+    const float3 dr  = r - ref;
+
+    atomicAdd(stats + Stats::Alive, 1);
+    atomicMax(stats + Stats::MaxDisplacement2, __float_as_int(dot(dr, dr)));
+}
+
+__global__ void buildVerletList(int np, CellListInfo cinfo, float rv2, int maxNeighbours,
+                                int* nNeighbours, int* neighbours, int* current, float4* refPositions,
+                                int* stats)
+{
+    const int dstId = blockIdx.x * blockDim.x + threadIdx.x;
+    if (dstId >= np) return;
+
+    const Particle dstP(cinfo.particles, dstId);
+    const int3 cell0 = cinfo.getCellIdAlongAxes(dstP.r);
+
+    int count = 0;
+
+    for (int cellZ = max(cell0.z-1, 0); cellZ <= min(cell0.z+1, cinfo.ncells.z-1); cellZ++)
+        for (int cellY = max(cell0.y-1, 0); cellY <= min(cell0.y+1, cinfo.ncells.y-1); cellY++)
+            for (int cellX = max(cell0.x-1, 0); cellX <= min(cell0.x+1, cinfo.ncells.x-1); cellX++)
+            {
+                const int cid = cinfo.encode(cellX, cellY, cellZ);
+                const int pstart = cinfo.cellStarts[cid];
+                const int pend   = cinfo.cellStarts[cid+1];
+
+                for (int srcId = pstart; srcId < pend; srcId++)
+                {
+                    if (srcId <= dstId) continue;
+
+                    Particle srcP;
+                    srcP.readCoordinate(cinfo.particles, srcId);
+
+                    const float3 dr = dstP.r - srcP.r;
+                    if (dot(dr, dr) < rv2)
+                    {
+                        if (count < maxNeighbours)
+                            neighbours[count*np + dstId] = srcId;
+                        count++;
+                    }
+                }
+            }
+
+    nNeighbours[dstId] = count;
+    current[dstId] = dstId;
+    refPositions[dstId] = make_float4(dstP.r.x, dstP.r.y, dstP.r.z, 0.0f);
+
+    atomicMax(stats + Stats::MaxNeighbours, count);
+}
+}
+
+VerletList::VerletList(float rc, float skin) :
+    rc(rc), skin(skin)
+{}
+
+void VerletList::rebuild(CellList* cl, cudaStream_t stream)
+{
+    const int np = cl->particles->size();
+    const int nthreads = 128;
+    const float rv = rc + skin;
+
+    this->cl = cl;
+    clBuilds = cl->getBuildCount();
+    nrebuilds++;
+
+    current     .resize_anew(np);
+    nNeighbours .resize_anew(np);
+    refPositions.resize_anew(np);
+
+    if (maxNeighbours == 0)
+    {
+        // Every pair is stored once, take a good margin over the mean
+        const float3 L = cl->localDomainSize;
+        const float density = np / (L.x * L.y * L.z);
+        const float mean = 0.5f * density * 4.0f / 3.0f * M_PI * rv*rv*rv;
+        maxNeighbours = (int)(1.5f * mean) + 8;
+    }
+
+    while (true)
+    {
+        neighbours.resize_anew(np * maxNeighbours);
+        stats.clearDevice(stream);
+
+        SAFE_KERNEL_LAUNCH(
+                VerletListKernels::buildVerletList,
+                getNblocks(np, nthreads), nthreads, 0, stream,
+                np, cl->cellInfo(), rv*rv, maxNeighbours,
+                nNeighbours.devPtr(), neighbours.devPtr(), current.devPtr(), refPositions.devPtr(),
+                stats.devPtr() );
+
+        stats.downloadFromDevice(stream, ContainersSynch::Synch);
+
+        const int needed = stats[VerletListKernels::Stats::MaxNeighbours];
+        if (needed <= maxNeighbours) break;
+
+        debug("Verlet list needs %d neighbours per particle instead of %d, rebuilding", needed, maxNeighbours);
+        maxNeighbours = needed + needed / 8 + 1;
+    }
+
+    debug2("Verlet list rebuilt for %d particles with at most %d neighbours per particle", np, maxNeighbours);
+}
+
+void VerletList::update(CellList* cl, cudaStream_t stream)
+{
+    const int buildsSinceUpdate = cl->getBuildCount() - clBuilds;
+
+    // Can only track one reordering of the particles
+    if (cl != this->cl || buildsSinceUpdate < 0 || buildsSinceUpdate > 1)
+    {
+        rebuild(cl, stream);
+        return;
+    }
+
+    const int n  = current.size();
+    const int np = cl->particles->size();
+    const int nthreads = 128;
+    auto cinfo = cl->cellInfo();
+
+    if (buildsSinceUpdate == 1)
+        SAFE_KERNEL_LAUNCH(
+                VerletListKernels::trackParticles,
+                getNblocks(n, nthreads), nthreads, 0, stream,
+                n, cinfo.order, current.devPtr() );
+
+    clBuilds = cl->getBuildCount();
+
+    stats.clearDevice(stream);
+    SAFE_KERNEL_LAUNCH(
+            VerletListKernels::checkDisplacements,
+            getNblocks(n, nthreads), nthreads, 0, stream,
+            n, current.devPtr(), cinfo.particles, refPositions.devPtr(), stats.devPtr() );
+
+    stats.downloadFromDevice(stream, ContainersSynch::Synch);
+
+    const int alive = stats[VerletListKernels::Stats::Alive];
+    float maxDisplacement2;
+    memcpy(&maxDisplacement2, &stats[VerletListKernels::Stats::MaxDisplacement2], sizeof(float));
+
+    if (alive < np)
+    {
+        debug2("%d new particles arrived since the last Verlet list build, rebuilding", np - alive);
+        rebuild(cl, stream);
+    }
+    else if (maxDisplacement2 > 0.25f * skin*skin)
+    {
+        debug2("Max displacement %f exceeded half of the skin %f, rebuilding the Verlet list", sqrt(maxDisplacement2), skin);
+        rebuild(cl, stream);
+    }
+}
+
+VerletListView VerletList::view() const
+{
+    return { current.size(), maxNeighbours, nNeighbours.devPtr(), neighbours.devPtr(), current.devPtr() };
+}
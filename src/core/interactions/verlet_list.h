@@ -0,0 +1,67 @@
+#pragma once
+
+#include <core/datatypes.h>
+#include <core/containers.h>
+
+class CellList;
+
+/// Device view of the VerletList, see computeSelfInteractionsVerlet()
+struct VerletListView
+{
+    int size;           ///< number of particles at the time of the last rebuild
+    int maxNeighbours;  ///< stride of the #neighbours array
+    const int *nNeighbours, *neighbours, *current;
+};
+
+/**
+ * Neighbour lists with a skin for the self interactions of a ParticleVector.
+ *
+ * For each particle the list keeps the ids of the particles within the
+ * distance rc + skin from it at the time of the last rebuild.
+ * Every pair is only stored once, by the particle with smaller id.
+ *
+ * The ids refer to the order of the particles at the last rebuild,
+ * #current maps them to the ids in the up-to-date cell-list. Every time the
+ * cell-list reorders the particles, #current is updated with CellList::order,
+ * particles that left the domain are mapped to -1.
+ *
+ * The list is rebuilt when one of the particles moved further than skin/2,
+ * when new particles arrived or when the cell-list changed in a way
+ * that can't be tracked. Only works with the PrimaryCellList
+ *
+ * The list doesn't save the cell-list builds: halo exchange and redistribution
+ * need the particles sorted into their current cells every step, and the
+ * redistribution changes the set of local particles. It only replaces the
+ * traversal of the neighbouring cells by the force kernel
+ */
+class VerletList
+{
+public:
+    VerletList(float rc, float skin);
+
+    /**
+     * Bring the list in accordance with the cell-list \p cl,
+     * which has to be built already. Synchronizes the \p stream
+     */
+    void update(CellList* cl, cudaStream_t stream);
+
+    VerletListView view() const;
+
+    int getRebuildCount() const { return nrebuilds; }
+
+private:
+    float rc, skin;
+    int maxNeighbours{0};
+
+    CellList* cl{nullptr};
+    int clBuilds{-1};  ///< CellList::getBuildCount() at the last update
+    int nrebuilds{0};
+
+    DeviceBuffer<int> nNeighbours, neighbours, current;
+    DeviceBuffer<float4> refPositions;
+
+    /// Number of tracked particles, max squared displacement (as int) and max number of neighbours
+    PinnedBuffer<int> stats{3};
+
+    void rebuild(CellList* cl, cudaStream_t stream);
+};
@@ -174,16 +174,28 @@ static __global__ void findBouncesInMesh(
     for (cid3.z = cidLow.z; cid3.z <= cidHigh.z; cid3.z++)
         for (cid3.y = cidLow.y; cid3.y <= cidHigh.y; cid3.y++)
             {
-                cid3.x = cidLow.x;
-                int cidLo = max(cinfo.encode(cid3), 0);
-
-                cid3.x = cidHigh.x;
-                int cidHi = min(cinfo.encode(cid3)+1, cinfo.totcells);
-
-                int pstart = cinfo.cellStarts[cidLo];
-                int pend   = cinfo.cellStarts[cidHi];
-
-                findBouncesInCell(pstart, pend, gid, tr, trOld, pvView, mesh, triangleTable);
+                // Rows of cells are only contiguous in the row-major ordering
+                if (cinfo.ordering == CellListOrdering::RowMajor)
+                {
+                    cid3.x = cidLow.x;
+                    int cidLo = max(cinfo.encode(cid3), 0);
+
+                    cid3.x = cidHigh.x;
+                    int cidHi = min(cinfo.encode(cid3)+1, cinfo.totcells);
+
+                    int pstart = cinfo.cellStarts[cidLo];
+                    int pend   = cinfo.cellStarts[cidHi];
+
+                    findBouncesInCell(pstart, pend, gid, tr, trOld, pvView, mesh, triangleTable);
+                }
+                else
+                {
+                    for (cid3.x = cidLow.x; cid3.x <= cidHigh.x; cid3.x++)
+                    {
+                        const int cid = cinfo.encode(cid3);
+                        findBouncesInCell(cinfo.cellStarts[cid], cinfo.cellStarts[cid+1], gid, tr, trOld, pvView, mesh, triangleTable);
+                    }
+                }
             }
 }
 
@@ -4,6 +4,7 @@
 
 #include "exchanger_interfaces.h"
 #include "mpi_engine.h"
+#include "neighbor_engine.h"
 #include "single_node_engine.h"
 
 #include "particle_halo_exchanger.h"
@@ -12,3 +13,4 @@
 #include "particle_redistributor.h"
 #include "object_redistributor.h"
 #include "object_forces_reverse_exchanger.h"
+#include "particle_forces_reverse_exchanger.h"
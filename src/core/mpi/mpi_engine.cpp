@@ -2,14 +2,22 @@
 
 #include <core/utils/timer.h>
 #include <core/logger.h>
+#include <core/utils/make_unique.h>
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
 
 MPIExchangeEngine::MPIExchangeEngine(std::unique_ptr<ParticleExchanger> exchanger,
-                                     MPI_Comm comm, bool gpuAwareMPI) :
-        nActiveNeighbours(26), gpuAwareMPI(gpuAwareMPI),
-        exchanger(std::move(exchanger))
+                                     MPI_Comm comm, bool gpuAwareMPI, ExchangeProtocol protocol) :
+        exchanger(std::move(exchanger)), protocol(protocol),
+        nActiveNeighbours(26), gpuAwareMPI(gpuAwareMPI)
 {
     MPI_Check( MPI_Comm_dup(comm, &haloComm) );
+    MPI_Check( MPI_Comm_dup(comm, &overflowComm) );
+
+    if (protocol == ExchangeProtocol::NeighborCollective)
+        die("Neighborhood collectives are implemented by NeighborExchangeEngine");
 
     int dims[3], periods[3], coords[3];
     MPI_Check( MPI_Cart_get (haloComm, 3, dims, periods, coords) );
@@ -31,7 +39,35 @@ MPIExchangeEngine::MPIExchangeEngine(std::unique_ptr<ParticleExchanger> exchange
         int cy = -( (i/3)%3 - 1 ) + 1;
         int cz = -( i/9 - 1 ) + 1;
         dir2recvTag[i] = (cz*3 + cy)*3 + cx;
+
+        dir2nodeRank[i] = -1;
+        sizesViaMPI[i] = true;
     }
+
+    if (protocol == ExchangeProtocol::SharedMemory)
+        setupNodeComm();
+}
+
+MPIExchangeEngine::~MPIExchangeEngine()
+{
+    int finalized;
+    MPI_Check( MPI_Finalized(&finalized) );
+    if (finalized) return;
+
+    for (auto& channel : channels)
+        freeRequests(channel.get());
+
+    if (!aggSendRequests.empty())
+        MPI_Check( MPI_Waitall(aggSendRequests.size(), aggSendRequests.data(), MPI_STATUSES_IGNORE) );
+
+    if (shmRequiredRequest != MPI_REQUEST_NULL)
+        MPI_Check( MPI_Wait(&shmRequiredRequest, MPI_STATUS_IGNORE) );
+
+    freeSharedWindow();
+    if (nodeComm != MPI_COMM_NULL)
+        MPI_Check( MPI_Comm_free(&nodeComm) );
+
+    MPI_Check( MPI_Comm_free(&overflowComm) );
 }
 
 void MPIExchangeEngine::init(cudaStream_t stream)
@@ -41,9 +77,82 @@ void MPIExchangeEngine::init(cudaStream_t stream)
     for (int i=0; i<helpers.size(); i++)
         if (!exchanger->needExchange(i)) debug("Exchange of PV '%s' is skipped", helpers[i]->name.c_str());
     
+    if (protocol == ExchangeProtocol::SingleMessage)
+    {
+        while (channels.size() < helpers.size())
+        {
+            auto channel = std::make_unique<PersistentChannel>();
+            for (int i = 0; i < 27; i++)
+                channel->sendCapacity[i] = channel->recvCapacity[i] = minCapacity;
+
+            channels.push_back(std::move(channel));
+        }
+
+        // Receives are posted before anything else, the sizes come with the data
+        for (int i=0; i<helpers.size(); i++)
+            if (exchanger->needExchange(i)) startRecvSingle(i, channels[i].get());
+
+        for (int i=0; i<helpers.size(); i++)
+            if (exchanger->needExchange(i)) exchanger->prepareSizes(i, stream);
+
+        for (int i=0; i<helpers.size(); i++)
+            if (exchanger->needExchange(i)) exchanger->prepareData(i, stream);
+
+        for (int i=0; i<helpers.size(); i++)
+            if (exchanger->needExchange(i)) sendSingle(i, channels[i].get(), stream);
+
+        return;
+    }
+
+    if (protocol == ExchangeProtocol::Aggregated)
+    {
+        for (int i=0; i<helpers.size(); i++)
+            if (exchanger->needExchange(i)) exchanger->prepareSizes(i, stream);
+
+        for (int i=0; i<helpers.size(); i++)
+            if (exchanger->needExchange(i)) exchanger->prepareData(i, stream);
+
+        sendAggregated(stream);
+        return;
+    }
+
+    if (protocol == ExchangeProtocol::SharedMemory)
+    {
+        growSharedWindow(helpers.size());
+        shmEpoch++;
+        shmChannels.resize(helpers.size());
+
+        // Sizes for the off-node neighbours go through MPI
+        for (int i=0; i<helpers.size(); i++)
+            if (exchanger->needExchange(i)) postRecvSize(i, sizesViaMPI);
+
+        for (int i=0; i<helpers.size(); i++)
+            if (exchanger->needExchange(i)) exchanger->prepareSizes(i, stream);
+
+        for (int i=0; i<helpers.size(); i++)
+            if (exchanger->needExchange(i)) sendSizes(i, sizesViaMPI);
+
+        publishSharedSizes();
+
+        for (int i=0; i<helpers.size(); i++)
+            if (exchanger->needExchange(i)) exchanger->prepareData(i, stream);
+
+        receiveSharedSizes();
+
+        // Data for the off-node neighbours and whatever did not fit into the window
+        for (int i=0; i<helpers.size(); i++)
+            if (exchanger->needExchange(i)) postRecv(i, shmChannels[i].recvViaMPI);
+
+        for (int i=0; i<helpers.size(); i++)
+            if (exchanger->needExchange(i)) send(i, stream, shmChannels[i].sendViaMPI);
+
+        publishSharedData(stream);
+        return;
+    }
+
     // Post irecv for sizes
     for (int i=0; i<helpers.size(); i++)
-        if (exchanger->needExchange(i)) postRecvSize(helpers[i]);
+        if (exchanger->needExchange(i)) postRecvSize(i);
 
     // Derived class determines what to send
     for (int i=0; i<helpers.size(); i++)
@@ -51,7 +160,7 @@ void MPIExchangeEngine::init(cudaStream_t stream)
 
     // Send sizes
     for (int i=0; i<helpers.size(); i++)
-        if (exchanger->needExchange(i)) sendSizes(helpers[i]);
+        if (exchanger->needExchange(i)) sendSizes(i);
 
     // Derived class determines what to send
     for (int i=0; i<helpers.size(); i++)
@@ -59,11 +168,11 @@ void MPIExchangeEngine::init(cudaStream_t stream)
 
     // Post big data irecv (after prepereData cause it waits for the sizes)
     for (int i=0; i<helpers.size(); i++)
-        if (exchanger->needExchange(i)) postRecv(helpers[i]);
+        if (exchanger->needExchange(i)) postRecv(i);
 
     // Send
     for (int i=0; i<helpers.size(); i++)
-        if (exchanger->needExchange(i)) send(helpers[i], stream);
+        if (exchanger->needExchange(i)) send(i, stream);
 }
 
 void MPIExchangeEngine::finalize(cudaStream_t stream)
@@ -71,8 +180,20 @@ void MPIExchangeEngine::finalize(cudaStream_t stream)
     auto& helpers = exchanger->helpers;
 
     // Wait for the irecvs to finish
-    for (int i=0; i<helpers.size(); i++)
-        if (exchanger->needExchange(i)) wait(helpers[i], stream);
+    if (protocol == ExchangeProtocol::Aggregated)
+        recvAggregated(stream);
+    else for (int i=0; i<helpers.size(); i++)
+        if (exchanger->needExchange(i))
+        {
+            if (protocol == ExchangeProtocol::SingleMessage)
+                waitSingle(i, channels[i].get(), stream);
+            else
+                wait(helpers[i], stream);
+        }
+
+    // On-node data is copied after the MPI data has been uploaded
+    if (protocol == ExchangeProtocol::SharedMemory)
+        receiveSharedData(stream);
 
     // Derived class unpack implementation
     for (int i=0; i<helpers.size(); i++)
@@ -80,17 +201,26 @@ void MPIExchangeEngine::finalize(cudaStream_t stream)
 }
 
 
-int MPIExchangeEngine::tagByName(std::string name)
+/**
+ * Messages of the helper \p id are tagged with tagBase(id) + direction.
+ * Helpers are attached in the same order on all the ranks, so their ids
+ * match, unlike hashes of the names that may collide
+ */
+int MPIExchangeEngine::tagBase(int id)
 {
-    // TODO: better tagging policy (unique id?)
-    static std::hash<std::string> nameHash;
-    return (int)( nameHash(name) % (32767 / 27) );
+    const int nBuffers = exchanger->helpers[id]->nBuffers;
+
+    // Tags up to 32767 are guaranteed by the MPI standard
+    if ((id + 1) * nBuffers > 32767)
+        die("Too many exchanged ParticleVectors (%d), their messages can't be tagged", id + 1);
+
+    return id * nBuffers;
 }
 
 
-void MPIExchangeEngine::postRecvSize(ExchangeHelper* helper)
+void MPIExchangeEngine::postRecvSize(int id, const bool* viaMPI)
 {
-    std::string pvName = helper->name;
+    auto helper = exchanger->helpers[id];
 
     auto nBuffers = helper->nBuffers;
     auto rSizes   = helper->recvSizes.  hostPtr();
@@ -101,10 +231,10 @@ void MPIExchangeEngine::postRecvSize(ExchangeHelper* helper)
     helper->recvSizes.clearHost();
 
     for (int i=0; i < nBuffers; i++)
-        if (i != 13 && dir2rank[i] >= 0)
+        if (i != 13 && dir2rank[i] >= 0 && (viaMPI == nullptr || viaMPI[i]))
         {
             MPI_Request req;
-            const int tag = nBuffers * tagByName(pvName) + dir2recvTag[i];
+            const int tag = tagBase(id) + dir2recvTag[i];
 
             MPI_Check( MPI_Irecv(rSizes + i, 1, MPI_INT, dir2rank[i], tag, haloComm, &req) );
             helper->requests.push_back(req);
@@ -114,24 +244,25 @@ void MPIExchangeEngine::postRecvSize(ExchangeHelper* helper)
 /**
  * Expects helper->sendSizes and helper->sendOffsets to be ON HOST
  */
-void MPIExchangeEngine::sendSizes(ExchangeHelper* helper)
+void MPIExchangeEngine::sendSizes(int id, const bool* viaMPI)
 {
-    std::string pvName = helper->name;
+    auto helper = exchanger->helpers[id];
 
     auto nBuffers = helper->nBuffers;
     auto sSizes   = helper->sendSizes.hostPtr();
 
     // Do blocking send in hope that it will be immediate due to small size
     for (int i=0; i < nBuffers; i++)
-        if (i != 13 && dir2rank[i] >= 0)
+        if (i != 13 && dir2rank[i] >= 0 && (viaMPI == nullptr || viaMPI[i]))
         {
-            const int tag = nBuffers * tagByName(pvName) + dir2sendTag[i];
+            const int tag = tagBase(id) + dir2sendTag[i];
             MPI_Check( MPI_Send(sSizes+i, 1, MPI_INT, dir2rank[i], tag, haloComm) );
         }
 }
 
-void MPIExchangeEngine::postRecv(ExchangeHelper* helper)
+void MPIExchangeEngine::postRecv(int id, const bool* viaMPI)
 {
+    auto helper = exchanger->helpers[id];
     std::string pvName = helper->name;
 
     auto nBuffers = helper->nBuffers;
@@ -152,10 +283,10 @@ void MPIExchangeEngine::postRecv(ExchangeHelper* helper)
     helper->requests.clear();
     helper->reqIndex.clear();
     for (int i=0; i < nBuffers; i++)
-        if (i != 13 && dir2rank[i] >= 0)
+        if (i != 13 && dir2rank[i] >= 0 && (viaMPI == nullptr || viaMPI[i]))
         {
             MPI_Request req;
-            const int tag = nBuffers * tagByName(pvName) + dir2recvTag[i];
+            const int tag = tagBase(id) + dir2recvTag[i];
 
             debug3("Receiving %s entities from rank %d, %d entities (buffer %d)",
                     pvName.c_str(), dir2rank[i], rSizes[i], i);
@@ -231,8 +362,9 @@ void MPIExchangeEngine::wait(ExchangeHelper* helper, cudaStream_t stream)
  * Expects helper->sendSizes and helper->sendOffsets to be ON HOST
  * helper->sendBuf data is ON DEVICE
  */
-void MPIExchangeEngine::send(ExchangeHelper* helper, cudaStream_t stream)
+void MPIExchangeEngine::send(int id, cudaStream_t stream, const bool* viaMPI)
 {
+    auto helper = exchanger->helpers[id];
     std::string pvName = helper->name;
 
     auto nBuffers = helper->nBuffers;
@@ -249,12 +381,12 @@ void MPIExchangeEngine::send(ExchangeHelper* helper, cudaStream_t stream)
     MPI_Request req;
     int totSent = 0;
     for (int i=0; i < nBuffers; i++)
-        if (i != 13 && dir2rank[i] >= 0)
+        if (i != 13 && dir2rank[i] >= 0 && (viaMPI == nullptr || viaMPI[i]))
         {
             debug3("Sending %s entities to rank %d in dircode %d [%2d %2d %2d], %d entities",
                     pvName.c_str(), dir2rank[i], i, i%3 - 1, (i/3)%3 - 1, i/9 - 1, sSizes[i]);
 
-            const int tag = nBuffers * tagByName(pvName) + dir2sendTag[i];
+            const int tag = tagBase(id) + dir2sendTag[i];
 
             // Send actual data
             if (sSizes[i] > 0)
@@ -285,3 +417,678 @@ void MPIExchangeEngine::send(ExchangeHelper* helper, cudaStream_t stream)
 }
 
 
+
+//=================================================================================
+// Single message protocol
+//=================================================================================
+
+/// Both sides of a message apply this rule, so their capacities stay equal
+int MPIExchangeEngine::grownCapacity(int capacity, int nbytes)
+{
+    if (nbytes <= capacity) return capacity;
+
+    const int page = 4096;
+    const int grown = (int)(nbytes * capacityGrowth);
+    return ((grown + page - 1) / page) * page;
+}
+
+void MPIExchangeEngine::freeRequests(PersistentChannel* channel)
+{
+    if (!channel->sendRequests.empty())
+        MPI_Check( MPI_Waitall(channel->sendRequests.size(), channel->sendRequests.data(), MPI_STATUSES_IGNORE) );
+    channel->sendRequests.clear();
+
+    for (auto& req : channel->recvRequests)
+        MPI_Check( MPI_Request_free(&req) );
+
+    channel->recvRequests.clear();
+    channel->recvDirs.clear();
+    channel->requestsValid = false;
+}
+
+void MPIExchangeEngine::createRecvRequests(int id, PersistentChannel* channel)
+{
+    auto helper = exchanger->helpers[id];
+    for (auto& req : channel->recvRequests)
+        MPI_Check( MPI_Request_free(&req) );
+
+    channel->recvRequests.clear();
+    channel->recvDirs.clear();
+
+    const int nBuffers = helper->nBuffers;
+    const int baseTag  = tagBase(id);
+
+    int total = 0;
+    for (int i=0; i < nBuffers; i++)
+    {
+        channel->recvMsgOffsets[i] = total;
+        if (i != 13 && dir2rank[i] >= 0)
+            total += headerSize + channel->recvCapacity[i];
+    }
+    channel->recvMsg.resize_anew(total);
+
+    for (int i=0; i < nBuffers; i++)
+        if (i != 13 && dir2rank[i] >= 0)
+        {
+            MPI_Request req;
+            MPI_Check( MPI_Recv_init(channel->recvMsg.hostPtr() + channel->recvMsgOffsets[i],
+                                     headerSize + channel->recvCapacity[i], MPI_BYTE,
+                                     dir2rank[i], baseTag + dir2recvTag[i], haloComm, &req) );
+
+            channel->recvRequests.push_back(req);
+            channel->recvDirs.push_back(i);
+        }
+
+    channel->requestsValid = true;
+    debug("Created persistent receives for '%s' with total capacity of %d bytes", helper->name.c_str(), total);
+}
+
+void MPIExchangeEngine::startRecvSingle(int id, PersistentChannel* channel)
+{
+    auto helper = exchanger->helpers[id];
+    if (!channel->requestsValid)
+        createRecvRequests(id, channel);
+
+    MPI_Check( MPI_Startall(channel->recvRequests.size(), channel->recvRequests.data()) );
+}
+
+/**
+ * Expects helper->sendSizes and helper->sendOffsets to be ON HOST
+ * helper->sendBuf data is ON DEVICE
+ */
+void MPIExchangeEngine::sendSingle(int id, PersistentChannel* channel, cudaStream_t stream)
+{
+    auto helper = exchanger->helpers[id];
+    const int nBuffers  = helper->nBuffers;
+    const int datumSize = helper->datumSize;
+    const int baseTag   = tagBase(id);
+
+    auto sSizes   = helper->sendSizes.  hostPtr();
+    auto sOffsets = helper->sendOffsets.hostPtr();
+
+    // Previous messages still use the send buffer
+    if (!channel->sendRequests.empty())
+        MPI_Check( MPI_Waitall(channel->sendRequests.size(), channel->sendRequests.data(), MPI_STATUSES_IGNORE) );
+    channel->sendRequests.clear();
+
+    int total = 0;
+    for (int i=0; i < nBuffers; i++)
+    {
+        channel->sendMsgOffsets[i] = total;
+        total += headerSize + sSizes[i] * datumSize;
+    }
+    channel->sendMsg.resize_anew(total);
+
+    helper->sendBuf.downloadFromDevice(stream, ContainersSynch::Synch);
+
+    int totSent = 0, nOverflows = 0;
+    for (int i=0; i < nBuffers; i++)
+        if (i != 13 && dir2rank[i] >= 0)
+        {
+            char* msg = channel->sendMsg.hostPtr() + channel->sendMsgOffsets[i];
+            const int nbytes = sSizes[i] * datumSize;
+
+            memcpy(msg, sSizes + i, headerSize);
+            memcpy(msg + headerSize, helper->sendBuf.hostPtr() + sOffsets[i]*datumSize, nbytes);
+
+            const int tag = baseTag + dir2sendTag[i];
+            const bool fits = nbytes <= channel->sendCapacity[i];
+
+            MPI_Request req;
+            MPI_Check( MPI_Isend(msg, fits ? headerSize + nbytes : headerSize, MPI_BYTE, dir2rank[i], tag, haloComm, &req) );
+            channel->sendRequests.push_back(req);
+
+            // Data does not fit into the receiver buffer, send it separately
+            if (!fits)
+            {
+                MPI_Check( MPI_Isend(msg + headerSize, nbytes, MPI_BYTE, dir2rank[i], tag, overflowComm, &req) );
+                channel->sendRequests.push_back(req);
+                nOverflows++;
+            }
+
+            channel->sendCapacity[i] = grownCapacity(channel->sendCapacity[i], nbytes);
+            totSent += sSizes[i];
+        }
+
+    debug("Sent total %d '%s' entities in single messages, %d of them overflowed", totSent, helper->name.c_str(), nOverflows);
+}
+
+/**
+ * helper->recvBuf will contain all the data, ON DEVICE already
+ */
+void MPIExchangeEngine::waitSingle(int id, PersistentChannel* channel, cudaStream_t stream)
+{
+    auto helper = exchanger->helpers[id];
+    const int nBuffers  = helper->nBuffers;
+    const int datumSize = helper->datumSize;
+    const int baseTag   = tagBase(id);
+
+    auto rSizes   = helper->recvSizes.  hostPtr();
+    auto rOffsets = helper->recvOffsets.hostPtr();
+
+    mTimer tm;
+    tm.start();
+    MPI_Check( MPI_Waitall(channel->recvRequests.size(), channel->recvRequests.data(), MPI_STATUSES_IGNORE) );
+    double waitTime = tm.elapsed();
+
+    helper->recvSizes.clearHost();
+    for (auto i : channel->recvDirs)
+        memcpy(rSizes + i, channel->recvMsg.hostPtr() + channel->recvMsgOffsets[i], headerSize);
+
+    helper->makeRecvOffsets();
+    helper->resizeRecvBuf();
+
+    std::vector<MPI_Request> overflowRequests;
+    bool grown = false;
+
+    for (auto i : channel->recvDirs)
+    {
+        const int nbytes = rSizes[i] * datumSize;
+        char* dst = helper->recvBuf.hostPtr() + rOffsets[i]*datumSize;
+
+        if (nbytes <= channel->recvCapacity[i])
+            memcpy(dst, channel->recvMsg.hostPtr() + channel->recvMsgOffsets[i] + headerSize, nbytes);
+        else
+        {
+            MPI_Request req;
+            MPI_Check( MPI_Irecv(dst, nbytes, MPI_BYTE, dir2rank[i], baseTag + dir2recvTag[i], overflowComm, &req) );
+            overflowRequests.push_back(req);
+
+            channel->recvCapacity[i] = grownCapacity(channel->recvCapacity[i], nbytes);
+            grown = true;
+        }
+    }
+
+    if (!overflowRequests.empty())
+    {
+        tm.start();
+        MPI_Check( MPI_Waitall(overflowRequests.size(), overflowRequests.data(), MPI_STATUSES_IGNORE) );
+        waitTime += tm.elapsed();
+
+        debug("%d messages of '%s' did not fit into the receive buffers and were re-sent",
+              (int)overflowRequests.size(), helper->name.c_str());
+    }
+
+    // Requests point to the old buffer, the new ones will be created on the next start
+    if (grown)
+        channel->requestsValid = false;
+
+    helper->recvBuf.uploadToDevice(stream);
+
+    debug("Completed receive of %d '%s' entities, waiting took %f ms", rOffsets[nBuffers], helper->name.c_str(), waitTime);
+}
+
+//=================================================================================
+// Aggregated protocol
+//=================================================================================
+
+/**
+ * Expects helper->sendSizes and helper->sendOffsets to be ON HOST
+ * helper->sendBuf data is ON DEVICE
+ */
+void MPIExchangeEngine::sendAggregated(cudaStream_t stream)
+{
+    auto& helpers = exchanger->helpers;
+    const int nHelpers   = helpers.size();
+    const int tableSize  = nHelpers * sizeof(int);
+
+    // Previous messages still use the send buffer
+    if (!aggSendRequests.empty())
+        MPI_Check( MPI_Waitall(aggSendRequests.size(), aggSendRequests.data(), MPI_STATUSES_IGNORE) );
+    aggSendRequests.clear();
+
+    int total = 0;
+    for (int dir = 0; dir < 27; dir++)
+    {
+        aggSendOffsets[dir] = total;
+        if (dir == 13 || dir2rank[dir] < 0) continue;
+
+        total += tableSize;
+        for (int i = 0; i < nHelpers; i++)
+            if (exchanger->needExchange(i))
+                total += helpers[i]->sendSizes[dir] * helpers[i]->datumSize;
+    }
+    aggSendBuf.resize_anew(total);
+
+    for (int i = 0; i < nHelpers; i++)
+        if (exchanger->needExchange(i))
+            helpers[i]->sendBuf.downloadFromDevice(stream, ContainersSynch::Asynch);
+    CUDA_Check( cudaStreamSynchronize(stream) );
+
+    for (int dir = 0; dir < 27; dir++)
+    {
+        if (dir == 13 || dir2rank[dir] < 0) continue;
+
+        char* msg   = aggSendBuf.hostPtr() + aggSendOffsets[dir];
+        int*  table = (int*)msg;
+        char* dst   = msg + tableSize;
+
+        for (int i = 0; i < nHelpers; i++)
+        {
+            auto helper = helpers[i];
+            table[i] = exchanger->needExchange(i) ? helper->sendSizes[dir] : 0;
+
+            const int nbytes = table[i] * helper->datumSize;
+            if (nbytes == 0) continue;
+
+            memcpy(dst, helper->sendBuf.hostPtr() + helper->sendOffsets[dir] * helper->datumSize, nbytes);
+            dst += nbytes;
+        }
+
+        MPI_Request req;
+        MPI_Check( MPI_Isend(msg, dst - msg, MPI_BYTE, dir2rank[dir], dir2sendTag[dir], haloComm, &req) );
+        aggSendRequests.push_back(req);
+    }
+
+    debug("Sent %d aggregated messages with data of %d helpers, %d bytes total", (int)aggSendRequests.size(), nHelpers, total);
+}
+
+/**
+ * helper->recvBuf will contain all the data, ON DEVICE already
+ */
+void MPIExchangeEngine::recvAggregated(cudaStream_t stream)
+{
+    auto& helpers = exchanger->helpers;
+    const int nHelpers  = helpers.size();
+    const int tableSize = nHelpers * sizeof(int);
+
+    MPI_Message messages[27];
+    int msgSizes[27], msgOffsets[27];
+
+    // Probe all the messages first to find the total size
+    mTimer tm;
+    tm.start();
+
+    int total = 0;
+    for (int dir = 0; dir < 27; dir++)
+    {
+        msgOffsets[dir] = total;
+        msgSizes[dir] = 0;
+        if (dir == 13 || dir2rank[dir] < 0) continue;
+
+        MPI_Status status;
+        MPI_Check( MPI_Mprobe(dir2rank[dir], dir2recvTag[dir], haloComm, messages + dir, &status) );
+        MPI_Check( MPI_Get_count(&status, MPI_BYTE, msgSizes + dir) );
+        total += msgSizes[dir];
+    }
+    aggRecvBuf.resize_anew(total);
+
+    for (int dir = 0; dir < 27; dir++)
+        if (dir != 13 && dir2rank[dir] >= 0)
+            MPI_Check( MPI_Mrecv(aggRecvBuf.hostPtr() + msgOffsets[dir], msgSizes[dir], MPI_BYTE, messages + dir, MPI_STATUS_IGNORE) );
+
+    const double waitTime = tm.elapsed();
+
+    // Sizes from the tables
+    for (int i = 0; i < nHelpers; i++)
+    {
+        if (!exchanger->needExchange(i)) continue;
+
+        auto helper = helpers[i];
+        helper->recvSizes.clearHost();
+        for (int dir = 0; dir < 27; dir++)
+            if (dir != 13 && dir2rank[dir] >= 0)
+                helper->recvSizes[dir] = ((int*)(aggRecvBuf.hostPtr() + msgOffsets[dir]))[i];
+
+        helper->makeRecvOffsets();
+        helper->resizeRecvBuf();
+    }
+
+    // Split the data
+    for (int dir = 0; dir < 27; dir++)
+    {
+        if (dir == 13 || dir2rank[dir] < 0) continue;
+
+        const char* msg   = aggRecvBuf.hostPtr() + msgOffsets[dir];
+        const int*  table = (const int*)msg;
+        const char* src   = msg + tableSize;
+
+        for (int i = 0; i < nHelpers; i++)
+        {
+            auto helper = helpers[i];
+            const int nbytes = table[i] * helper->datumSize;
+            if (nbytes == 0) continue;
+
+            // Skipped helpers have no receive buffer prepared, their data is only stepped over
+            if (exchanger->needExchange(i))
+                memcpy(helper->recvBuf.hostPtr() + helper->recvOffsets[dir] * helper->datumSize, src, nbytes);
+            src += nbytes;
+        }
+    }
+
+    for (int i = 0; i < nHelpers; i++)
+        if (exchanger->needExchange(i))
+            helpers[i]->recvBuf.uploadToDevice(stream);
+
+    debug("Completed receive of aggregated messages, %d bytes total, waiting took %f ms", total, waitTime);
+}
+
+
+
+//=================================================================================
+// Shared memory protocol
+//=================================================================================
+
+namespace
+{
+    /// Head of the segment of every rank in the shared window
+    struct ShmControl
+    {
+        std::atomic<int64_t> sizesEpoch, dataEpoch;  ///< last exchange whose sizes / data are in the segment
+        std::atomic<int64_t> consumed[27];           ///< set by the neighbour in direction i when it's done reading
+    };
+
+    /// Where the data of one helper for one direction is in the segment of the sender
+    struct ShmEntry
+    {
+        int size;        ///< number of entities
+        int viaMPI;      ///< did not fit into the segment and is sent with MPI
+        int64_t offset;  ///< from the start of the data region of the segment
+    };
+
+    int64_t roundUp(int64_t n, int64_t alignment)
+    {
+        return ((n + alignment - 1) / alignment) * alignment;
+    }
+
+    ShmControl* shmControl(char* segment)
+    {
+        return reinterpret_cast<ShmControl*>(segment);
+    }
+
+    ShmEntry* shmEntries(char* segment)
+    {
+        return reinterpret_cast<ShmEntry*>(segment + sizeof(ShmControl));
+    }
+
+    int64_t shmHeaderSize(int nHelpers)
+    {
+        return roundUp(sizeof(ShmControl) + 27 * nHelpers * sizeof(ShmEntry), 128);
+    }
+
+    void waitForEpoch(const std::atomic<int64_t>& counter, int64_t epoch, MPI_Comm comm)
+    {
+        int flag;
+        while (counter.load(std::memory_order_acquire) < epoch)
+            // Keep MPI progressing, the neighbours may be waiting for our pending messages
+            MPI_Check( MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, comm, &flag, MPI_STATUS_IGNORE) );
+    }
+}
+
+void MPIExchangeEngine::setupNodeComm()
+{
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory exchange needs lock-free 64-bit atomics");
+
+    MPI_Check( MPI_Comm_split_type(haloComm, MPI_COMM_TYPE_SHARED, myrank, MPI_INFO_NULL, &nodeComm) );
+
+    MPI_Group haloGroup, nodeGroup;
+    MPI_Check( MPI_Comm_group(haloComm, &haloGroup) );
+    MPI_Check( MPI_Comm_group(nodeComm, &nodeGroup) );
+    MPI_Check( MPI_Group_translate_ranks(haloGroup, 27, dir2rank, nodeGroup, dir2nodeRank) );
+    MPI_Check( MPI_Group_free(&haloGroup) );
+    MPI_Check( MPI_Group_free(&nodeGroup) );
+
+    int nOnNode = 0;
+    for (int i = 0; i < 27; i++)
+    {
+        if (i == 13 || dir2rank[i] < 0 || dir2nodeRank[i] == MPI_UNDEFINED || dir2nodeRank[i] < 0)
+            dir2nodeRank[i] = -1;
+        else
+            nOnNode++;
+
+        sizesViaMPI[i] = dir2nodeRank[i] < 0;
+    }
+
+    info("%d out of 26 neighbours are on the same node and will be exchanged through shared memory", nOnNode);
+}
+
+void MPIExchangeEngine::allocateSharedWindow(int64_t capacity, int nHelpers)
+{
+    freeSharedWindow();
+
+    const int64_t segmentSize = roundUp(shmHeaderSize(nHelpers) + capacity, 4096);
+
+    char* base;
+    MPI_Check( MPI_Win_allocate_shared(segmentSize, 1, MPI_INFO_NULL, nodeComm, &base, &shm.win) );
+
+    shm.mine     = base;
+    shm.capacity = capacity;
+    shm.nHelpers = nHelpers;
+
+    // Pin all the segments we copy to or from, so that the copies are asynchronous DMA transfers
+    auto pin = [this] (char* ptr, MPI_Aint size) {
+        if (std::find(shm.registered.begin(), shm.registered.end(), ptr) != shm.registered.end())
+            return;
+
+        if (cudaHostRegister(ptr, size, cudaHostRegisterPortable) != cudaSuccess)
+        {
+            cudaGetLastError();
+            warn("Could not pin shared memory segment, exchange will be slower");
+            return;
+        }
+        shm.registered.push_back(ptr);
+    };
+
+    pin(shm.mine, segmentSize);
+
+    for (int i = 0; i < 27; i++)
+    {
+        shm.neighbours[i] = nullptr;
+        if (dir2nodeRank[i] < 0) continue;
+
+        MPI_Aint size;
+        int dispUnit;
+        MPI_Check( MPI_Win_shared_query(shm.win, dir2nodeRank[i], &size, &dispUnit, &shm.neighbours[i]) );
+        pin(shm.neighbours[i], size);
+    }
+
+    // All the previous exchanges are complete
+    auto control = new (shm.mine) ShmControl;
+    control->sizesEpoch.store(shmEpoch);
+    control->dataEpoch .store(shmEpoch);
+    for (auto& c : control->consumed)
+        c.store(shmEpoch);
+
+    MPI_Check( MPI_Barrier(nodeComm) );
+
+    debug("Allocated shared exchange window with %lld bytes per rank", (long long)segmentSize);
+}
+
+void MPIExchangeEngine::freeSharedWindow()
+{
+    if (shm.win == MPI_WIN_NULL) return;
+
+    for (auto ptr : shm.registered)
+        CUDA_Check( cudaHostUnregister(ptr) );
+    shm.registered.clear();
+
+    MPI_Check( MPI_Win_free(&shm.win) );
+    shm.mine = nullptr;
+}
+
+/**
+ * Collective within the node: the window is grown if any of the ranks
+ * did not fit into it during the previous exchange
+ */
+void MPIExchangeEngine::growSharedWindow(int nHelpers)
+{
+    if (shmRequiredRequest != MPI_REQUEST_NULL)
+        MPI_Check( MPI_Wait(&shmRequiredRequest, MPI_STATUS_IGNORE) );
+
+    if (shm.win != MPI_WIN_NULL && shm.nHelpers == nHelpers && shmMaxRequired <= shm.capacity)
+        return;
+
+    int64_t capacity = std::max(shmMinCapacity, shm.capacity);
+    if (shmMaxRequired > capacity)
+        capacity = roundUp((int64_t)(shmMaxRequired * capacityGrowth), 4096);
+
+    allocateSharedWindow(capacity, nHelpers);
+}
+
+/**
+ * Expects helper->sendSizes to be ON HOST
+ */
+void MPIExchangeEngine::publishSharedSizes()
+{
+    auto& helpers = exchanger->helpers;
+    auto control = shmControl(shm.mine);
+    auto entries = shmEntries(shm.mine);
+
+    // Receivers have to be done with the previous exchange before we overwrite it
+    for (int dir = 0; dir < 27; dir++)
+        if (dir2nodeRank[dir] >= 0)
+            waitForEpoch(control->consumed[dir], shmEpoch - 1, haloComm);
+
+    int64_t used = 0;
+    shmRequired = 0;
+
+    for (int i = 0; i < helpers.size(); i++)
+    {
+        if (!exchanger->needExchange(i)) continue;
+
+        auto helper = helpers[i];
+        auto& channel = shmChannels[i];
+
+        for (int dir = 0; dir < 27; dir++)
+        {
+            channel.sendViaMPI[dir] = sizesViaMPI[dir];
+            if (dir2nodeRank[dir] < 0) continue;
+
+            const int size = helper->sendSizes[dir];
+            const int64_t nbytes = roundUp((int64_t)size * helper->datumSize, shmAlignment);
+            const bool fits = used + nbytes <= shm.capacity;
+
+            auto& entry = entries[27*i + dir];
+            entry.size   = size;
+            entry.viaMPI = !fits;
+            entry.offset = used;
+
+            channel.sendViaMPI[dir] = !fits;
+            if (fits) used += nbytes;
+            shmRequired += nbytes;
+        }
+    }
+
+    control->sizesEpoch.store(shmEpoch, std::memory_order_release);
+
+    // Result is needed only at the next exchange
+    MPI_Check( MPI_Iallreduce(&shmRequired, &shmMaxRequired, 1, MPI_INT64_T, MPI_MAX, nodeComm, &shmRequiredRequest) );
+
+    if (used < shmRequired)
+        debug("Shared exchange window is too small (%lld bytes needed, %lld available), the rest goes through MPI",
+              (long long)shmRequired, (long long)shm.capacity);
+}
+
+/**
+ * Fills helper->recvSizes ON HOST for the on-node neighbours,
+ * postRecvSize() has to be called before
+ */
+void MPIExchangeEngine::receiveSharedSizes()
+{
+    auto& helpers = exchanger->helpers;
+
+    for (int dir = 0; dir < 27; dir++)
+        if (dir2nodeRank[dir] >= 0)
+            waitForEpoch(shmControl(shm.neighbours[dir])->sizesEpoch, shmEpoch, haloComm);
+
+    for (int i = 0; i < helpers.size(); i++)
+    {
+        if (!exchanger->needExchange(i)) continue;
+
+        auto helper = helpers[i];
+        auto& channel = shmChannels[i];
+
+        for (int dir = 0; dir < 27; dir++)
+        {
+            channel.recvViaMPI[dir] = sizesViaMPI[dir];
+            if (dir2nodeRank[dir] < 0) continue;
+
+            // The neighbour sees us in the opposite direction
+            const auto& entry = shmEntries(shm.neighbours[dir])[27*i + 26-dir];
+
+            helper->recvSizes[dir]    = entry.size;
+            channel.recvViaMPI[dir]   = entry.viaMPI;
+            channel.recvOffsets[dir]  = entry.offset;
+        }
+    }
+}
+
+/**
+ * helper->sendBuf data is ON DEVICE, copy it into our segment
+ */
+void MPIExchangeEngine::publishSharedData(cudaStream_t stream)
+{
+    auto& helpers = exchanger->helpers;
+    auto entries = shmEntries(shm.mine);
+    char* data = shm.mine + shmHeaderSize(shm.nHelpers);
+
+    for (int i = 0; i < helpers.size(); i++)
+    {
+        if (!exchanger->needExchange(i)) continue;
+
+        auto helper = helpers[i];
+
+        for (int dir = 0; dir < 27; dir++)
+        {
+            if (dir2nodeRank[dir] < 0 || shmChannels[i].sendViaMPI[dir]) continue;
+
+            const auto& entry = entries[27*i + dir];
+            if (entry.size == 0) continue;
+
+            CUDA_Check( cudaMemcpyAsync(
+                            data + entry.offset,
+                            helper->sendBuf.devPtr() + helper->sendOffsets[dir]*helper->datumSize,
+                            entry.size * helper->datumSize,
+                            cudaMemcpyDeviceToHost, stream) );
+        }
+    }
+
+    CUDA_Check( cudaStreamSynchronize(stream) );
+    shmControl(shm.mine)->dataEpoch.store(shmEpoch, std::memory_order_release);
+}
+
+/**
+ * helper->recvBuf will contain the on-node data ON DEVICE
+ */
+void MPIExchangeEngine::receiveSharedData(cudaStream_t stream)
+{
+    auto& helpers = exchanger->helpers;
+    const int64_t headerSize = shmHeaderSize(shm.nHelpers);
+
+    mTimer tm;
+    tm.start();
+    for (int dir = 0; dir < 27; dir++)
+        if (dir2nodeRank[dir] >= 0)
+            waitForEpoch(shmControl(shm.neighbours[dir])->dataEpoch, shmEpoch, haloComm);
+    const double waitTime = tm.elapsed();
+
+    for (int i = 0; i < helpers.size(); i++)
+    {
+        if (!exchanger->needExchange(i)) continue;
+
+        auto helper = helpers[i];
+        auto& channel = shmChannels[i];
+
+        for (int dir = 0; dir < 27; dir++)
+        {
+            if (dir2nodeRank[dir] < 0 || channel.recvViaMPI[dir]) continue;
+
+            const int size = helper->recvSizes[dir];
+            if (size == 0) continue;
+
+            CUDA_Check( cudaMemcpyAsync(
+                            helper->recvBuf.devPtr() + helper->recvOffsets[dir]*helper->datumSize,
+                            shm.neighbours[dir] + headerSize + channel.recvOffsets[dir],
+                            size * helper->datumSize,
+                            cudaMemcpyHostToDevice, stream) );
+        }
+    }
+
+    // Segments of the neighbours may be overwritten once the copies are done
+    CUDA_Check( cudaStreamSynchronize(stream) );
+    for (int dir = 0; dir < 27; dir++)
+        if (dir2nodeRank[dir] >= 0)
+            shmControl(shm.neighbours[dir])->consumed[26-dir].store(shmEpoch, std::memory_order_release);
+
+    debug("Completed shared memory receive, waiting took %f ms", waitTime);
+}
@@ -4,7 +4,39 @@
 #include "exchange_helpers.h"
 
 #include <mpi.h>
+#include <memory>
 #include <string>
+#include <vector>
+
+/**
+ * How sizes and data are communicated by MPIExchangeEngine
+ *
+ * SizesFirst: sizes are sent first, and the data receives are posted
+ * only when the sizes arrived, which costs two latencies per exchange.
+ *
+ * SingleMessage: the size is sent in a header of the same message as
+ * the data. Data is received into persistent over-allocated buffers
+ * with persistent MPI requests; if the data does not fit, only the
+ * header goes into the persistent buffer and the data is re-sent in
+ * a separate message, after which the buffer grows
+ *
+ * Aggregated: data of all the helpers going to the same neighbour is
+ * sent in one message, starting with a table of entity counts per helper.
+ * The receiver probes the message size with MPI_Mprobe(), so one message
+ * per neighbour and exchange is sent in total
+ *
+ * NeighborCollective: all the helpers are exchanged together with
+ * MPI neighborhood collectives by NeighborExchangeEngine
+ *
+ * SharedMemory: neighbours on the same node read the packed data
+ * directly from a shared memory window of the sender, synchronized with
+ * epoch counters instead of messages. Neighbours on other nodes are
+ * handled as with SizesFirst
+ */
+enum class ExchangeProtocol
+{
+    SizesFirst, SingleMessage, Aggregated, NeighborCollective, SharedMemory
+};
 
 /**
  * Engine implementing MPI exchange logic.
@@ -23,18 +55,91 @@
  *     data and data themselves are received and stored in the ExchangeHelper
  *   - calls exchanger combineAndUploadData() that takes care
  *     of storing data from the ExchangeHelper to where is has to be
+ *
+ * With ExchangeProtocol::SingleMessage sizes are not sent separately,
+ * and receives are started with MPI_Start() in init() already
+ *
+ * With ExchangeProtocol::SharedMemory every rank owns a segment of an
+ * MPI_Win_allocate_shared() window on its node. The sender writes the
+ * sizes and then the data for its on-node neighbours into its own segment
+ * and bumps the corresponding epoch counter, the receivers copy the data
+ * straight from there to the GPU and report back how far they've read.
+ * Data that does not fit into the segment goes through MPI, and the
+ * segments are grown for the next exchange
  */
 class MPIExchangeEngine : public ExchangeEngine
 {
 public:
-    MPIExchangeEngine(std::unique_ptr<ParticleExchanger> exchanger, MPI_Comm comm, bool gpuAwareMPI);
+    MPIExchangeEngine(std::unique_ptr<ParticleExchanger> exchanger, MPI_Comm comm, bool gpuAwareMPI,
+                      ExchangeProtocol protocol = ExchangeProtocol::SizesFirst);
     void init(cudaStream_t stream)     override;
     void finalize(cudaStream_t stream) override;
     
-    ~MPIExchangeEngine() = default;
+    ~MPIExchangeEngine();
 
 private:
+
+    /**
+     * Persistent communication state of one helper for ExchangeProtocol::SingleMessage
+     *
+     * Capacities are the number of payload bytes a single message may carry
+     * in each direction. Both the sender and the receiver update them
+     * with the same rule from the same message sizes, so they always agree
+     */
+    struct PersistentChannel
+    {
+        PinnedBuffer<char> sendMsg, recvMsg;  ///< [header | payload] per neighbour
+        int sendCapacity[27], recvCapacity[27];
+        int sendMsgOffsets[27], recvMsgOffsets[27];
+
+        std::vector<MPI_Request> recvRequests, sendRequests;
+        std::vector<int> recvDirs;
+        bool requestsValid = false;
+    };
+
+    static constexpr int headerSize      = sizeof(int);
+    static constexpr int minCapacity     = 4096;
+    static constexpr float capacityGrowth = 1.5f;
+
     std::unique_ptr<ParticleExchanger> exchanger;
+
+    ExchangeProtocol protocol;
+    MPI_Comm overflowComm;
+    std::vector< std::unique_ptr<PersistentChannel> > channels;
+
+    /// Per-helper state of ExchangeProtocol::SharedMemory
+    struct SharedChannel
+    {
+        bool sendViaMPI[27], recvViaMPI[27];  ///< data of that direction goes through MPI
+        int64_t recvOffsets[27];              ///< where the data is in the sender's segment
+    };
+
+    /// Node-local window, each rank owns one segment of the same size
+    struct SharedWindow
+    {
+        MPI_Win win = MPI_WIN_NULL;
+        char* mine = nullptr;
+        char* neighbours[27];
+        std::vector<char*> registered;
+        int64_t capacity = 0;                 ///< data bytes in one segment
+        int nHelpers = 0;
+    };
+
+    static constexpr int64_t shmMinCapacity = 1 << 20;
+    static constexpr int shmAlignment = 128;
+
+    MPI_Comm nodeComm = MPI_COMM_NULL;
+    int dir2nodeRank[27];
+    bool sizesViaMPI[27];
+    SharedWindow shm;
+    std::vector<SharedChannel> shmChannels;
+    int64_t shmEpoch = 0;
+    int64_t shmRequired = 0, shmMaxRequired = 0;
+    MPI_Request shmRequiredRequest = MPI_REQUEST_NULL;
+
+    PinnedBuffer<char> aggSendBuf, aggRecvBuf;  ///< [counts table | helper 0 data | helper 1 data | ...] per neighbour
+    int aggSendOffsets[27];
+    std::vector<MPI_Request> aggSendRequests;
     
     int dir2rank[27], dir2sendTag[27], dir2recvTag[27];
     int nActiveNeighbours;
@@ -44,11 +149,32 @@ private:
     bool gpuAwareMPI;
     int singleCopyThreshold = 4000000;
 
-    int tagByName(std::string);
+    int tagBase(int id);
 
-    void postRecvSize(ExchangeHelper* helper);
-    void sendSizes(ExchangeHelper* helper);
-    void postRecv(ExchangeHelper* helper);
+    /// \p viaMPI masks the directions to communicate, all of them if nullptr
+    void postRecvSize(int id, const bool* viaMPI = nullptr);
+    void sendSizes(int id, const bool* viaMPI = nullptr);
+    void postRecv(int id, const bool* viaMPI = nullptr);
     void wait(ExchangeHelper* helper, cudaStream_t stream);
-    void send(ExchangeHelper* helper, cudaStream_t stream);
+    void send(int id, cudaStream_t stream, const bool* viaMPI = nullptr);
+
+    static int grownCapacity(int capacity, int nbytes);
+    void createRecvRequests(int id, PersistentChannel* channel);
+    void freeRequests(PersistentChannel* channel);
+
+    void startRecvSingle(int id, PersistentChannel* channel);
+    void sendSingle     (int id, PersistentChannel* channel, cudaStream_t stream);
+    void waitSingle     (int id, PersistentChannel* channel, cudaStream_t stream);
+
+    void sendAggregated(cudaStream_t stream);
+    void recvAggregated(cudaStream_t stream);
+
+    void setupNodeComm();
+    void allocateSharedWindow(int64_t capacity, int nHelpers);
+    void freeSharedWindow();
+    void growSharedWindow(int nHelpers);
+    void publishSharedSizes();
+    void receiveSharedSizes();
+    void publishSharedData(cudaStream_t stream);
+    void receiveSharedData(cudaStream_t stream);
 };
@@ -0,0 +1,212 @@
+#include "neighbor_engine.h"
+
+#include <core/utils/timer.h>
+#include <core/logger.h>
+#include <cstring>
+
+NeighborExchangeEngine::NeighborExchangeEngine(std::unique_ptr<ParticleExchanger> exchanger, MPI_Comm comm, bool gpuAwareMPI) :
+        exchanger(std::move(exchanger))
+{
+    if (gpuAwareMPI)
+        warn("GPU aware MPI is not used by the neighborhood collectives exchange, data goes through the host memory");
+
+    int dims[3], periods[3], coords[3];
+    MPI_Check( MPI_Cart_get(comm, 3, dims, periods, coords) );
+
+    auto dir2rank = [&] (int i) {
+        int coordsNeigh[3] = { coords[0] + i%3 - 1, coords[1] + (i/3)%3 - 1, coords[2] + i/9 - 1 };
+        int rank;
+        MPI_Check( MPI_Cart_rank(comm, coordsNeigh, &rank) );
+        return rank;
+    };
+
+    // Data sent in direction i arrives from the opposite direction 26-i.
+    // Neighbour lists are ordered such that the k-th edge of the sender matches
+    // the k-th edge of the receiver, which keeps multiple edges between the same
+    // pair of ranks (few ranks per dimension) consistent
+    int sources[nNeighbours], destinations[nNeighbours];
+    for (int i = 0, k = 0; i < 27; i++)
+    {
+        if (i == 13) continue;
+
+        sendDirs[k] = i;
+        recvDirs[k] = 26 - i;
+
+        destinations[k] = dir2rank(sendDirs[k]);
+        sources[k]      = dir2rank(recvDirs[k]);
+        k++;
+    }
+
+    MPI_Check( MPI_Dist_graph_create_adjacent(comm,
+                                              nNeighbours, sources,      MPI_UNWEIGHTED,
+                                              nNeighbours, destinations, MPI_UNWEIGHTED,
+                                              MPI_INFO_NULL, 0, &graphComm) );
+
+    sendBytes .resize(nNeighbours);
+    sendDispls.resize(nNeighbours);
+    recvBytes .resize(nNeighbours);
+    recvDispls.resize(nNeighbours);
+}
+
+NeighborExchangeEngine::~NeighborExchangeEngine()
+{
+    int finalized;
+    MPI_Check( MPI_Finalized(&finalized) );
+    if (finalized) return;
+
+    if (active)
+        MPI_Check( MPI_Wait(&request, MPI_STATUS_IGNORE) );
+
+    MPI_Check( MPI_Comm_free(&graphComm) );
+}
+
+void NeighborExchangeEngine::init(cudaStream_t stream)
+{
+    auto& helpers = exchanger->helpers;
+    const int nHelpers = helpers.size();
+
+    for (int i = 0; i < nHelpers; i++)
+        if (!exchanger->needExchange(i)) debug("Exchange of PV '%s' is skipped", helpers[i]->name.c_str());
+
+    for (int i = 0; i < nHelpers; i++)
+        if (exchanger->needExchange(i)) exchanger->prepareSizes(i, stream);
+
+    // Sizes of all the helpers go in one message per neighbour
+    sendCounts.assign(nNeighbours * nHelpers, 0);
+    recvCounts.assign(nNeighbours * nHelpers, 0);
+
+    for (int i = 0; i < nHelpers; i++)
+        if (exchanger->needExchange(i))
+            for (int k = 0; k < nNeighbours; k++)
+                sendCounts[k*nHelpers + i] = helpers[i]->sendSizes[sendDirs[k]];
+
+    MPI_Request sizesRequest;
+    MPI_Check( MPI_Ineighbor_alltoall(sendCounts.data(), nHelpers, MPI_INT,
+                                      recvCounts.data(), nHelpers, MPI_INT, graphComm, &sizesRequest) );
+
+    for (int i = 0; i < nHelpers; i++)
+        if (exchanger->needExchange(i)) exchanger->prepareData(i, stream);
+
+    packSend(stream);
+
+    mTimer tm;
+    tm.start();
+    MPI_Check( MPI_Wait(&sizesRequest, MPI_STATUS_IGNORE) );
+    debug("Waiting for sizes of %d helpers took %f ms", nHelpers, tm.elapsed());
+
+    int total = 0;
+    for (int k = 0; k < nNeighbours; k++)
+    {
+        recvDispls[k] = total;
+        recvBytes[k]  = 0;
+        for (int i = 0; i < nHelpers; i++)
+            recvBytes[k] += recvCounts[k*nHelpers + i] * helpers[i]->datumSize;
+        total += recvBytes[k];
+    }
+    recvBuf.resize_anew(total);
+
+    MPI_Check( MPI_Ineighbor_alltoallv(sendBuf.hostPtr(), sendBytes.data(), sendDispls.data(), MPI_BYTE,
+                                       recvBuf.hostPtr(), recvBytes.data(), recvDispls.data(), MPI_BYTE,
+                                       graphComm, &request) );
+    active = true;
+
+    debug("Started neighbour exchange of %d helpers, sending %d bytes and receiving %d bytes",
+          nHelpers, sendDispls[nNeighbours-1] + sendBytes[nNeighbours-1], total);
+}
+
+void NeighborExchangeEngine::finalize(cudaStream_t stream)
+{
+    auto& helpers = exchanger->helpers;
+
+    mTimer tm;
+    tm.start();
+    MPI_Check( MPI_Wait(&request, MPI_STATUS_IGNORE) );
+    active = false;
+    debug("Completed neighbour exchange, waiting took %f ms", tm.elapsed());
+
+    unpackRecv(stream);
+
+    for (int i = 0; i < helpers.size(); i++)
+        if (exchanger->needExchange(i)) exchanger->combineAndUploadData(i, stream);
+}
+
+/**
+ * Expects helper->sendSizes and helper->sendOffsets to be ON HOST
+ * helper->sendBuf data is ON DEVICE
+ */
+void NeighborExchangeEngine::packSend(cudaStream_t stream)
+{
+    auto& helpers = exchanger->helpers;
+    const int nHelpers = helpers.size();
+
+    int total = 0;
+    for (int k = 0; k < nNeighbours; k++)
+    {
+        sendDispls[k] = total;
+        sendBytes[k]  = 0;
+        for (int i = 0; i < nHelpers; i++)
+            sendBytes[k] += sendCounts[k*nHelpers + i] * helpers[i]->datumSize;
+        total += sendBytes[k];
+    }
+    sendBuf.resize_anew(total);
+
+    for (int i = 0; i < nHelpers; i++)
+        if (exchanger->needExchange(i))
+            helpers[i]->sendBuf.downloadFromDevice(stream, ContainersSynch::Asynch);
+    CUDA_Check( cudaStreamSynchronize(stream) );
+
+    // Within the block of a neighbour, helpers follow one another
+    for (int k = 0; k < nNeighbours; k++)
+    {
+        char* dst = sendBuf.hostPtr() + sendDispls[k];
+        for (int i = 0; i < nHelpers; i++)
+        {
+            auto helper = helpers[i];
+            const int nbytes = sendCounts[k*nHelpers + i] * helper->datumSize;
+            if (nbytes == 0) continue;
+
+            memcpy(dst, helper->sendBuf.hostPtr() + helper->sendOffsets[sendDirs[k]] * helper->datumSize, nbytes);
+            dst += nbytes;
+        }
+    }
+}
+
+/**
+ * helper->recvBuf will contain all the data, ON DEVICE already
+ */
+void NeighborExchangeEngine::unpackRecv(cudaStream_t stream)
+{
+    auto& helpers = exchanger->helpers;
+    const int nHelpers = helpers.size();
+
+    for (int i = 0; i < nHelpers; i++)
+    {
+        if (!exchanger->needExchange(i)) continue;
+
+        auto helper = helpers[i];
+        helper->recvSizes.clearHost();
+        for (int k = 0; k < nNeighbours; k++)
+            helper->recvSizes[recvDirs[k]] = recvCounts[k*nHelpers + i];
+
+        helper->makeRecvOffsets();
+        helper->resizeRecvBuf();
+    }
+
+    for (int k = 0; k < nNeighbours; k++)
+    {
+        const char* src = recvBuf.hostPtr() + recvDispls[k];
+        for (int i = 0; i < nHelpers; i++)
+        {
+            auto helper = helpers[i];
+            const int nbytes = recvCounts[k*nHelpers + i] * helper->datumSize;
+            if (nbytes == 0) continue;
+
+            memcpy(helper->recvBuf.hostPtr() + helper->recvOffsets[recvDirs[k]] * helper->datumSize, src, nbytes);
+            src += nbytes;
+        }
+    }
+
+    for (int i = 0; i < nHelpers; i++)
+        if (exchanger->needExchange(i))
+            helpers[i]->recvBuf.uploadToDevice(stream);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "exchanger_interfaces.h"
+#include "exchange_helpers.h"
+
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+/**
+ * Engine implementing the exchange with MPI neighborhood collectives
+ *
+ * A distributed graph communicator connects each rank to its 26 neighbours,
+ * and the data of all the helpers of the exchanger is communicated together:
+ * - init() exchanges the sizes of all the helpers with one
+ *   MPI_Ineighbor_alltoall() overlapped with ParticleExchanger::prepareData(),
+ *   then packs the data of all the helpers into one host buffer and starts
+ *   MPI_Ineighbor_alltoallv()
+ * - finalize() waits for the collective, scatters the received data into
+ *   the helpers and calls ParticleExchanger::combineAndUploadData()
+ *
+ * No tags are involved, so different ParticleVectors can never be mixed up.
+ * The data is always staged through the host memory.
+ */
+class NeighborExchangeEngine : public ExchangeEngine
+{
+public:
+    /// Data is staged through the host even if \p gpuAwareMPI is set, there is a warning about that then
+    NeighborExchangeEngine(std::unique_ptr<ParticleExchanger> exchanger, MPI_Comm comm, bool gpuAwareMPI = false);
+    void init(cudaStream_t stream)     override;
+    void finalize(cudaStream_t stream) override;
+
+    ~NeighborExchangeEngine();
+
+private:
+    std::unique_ptr<ParticleExchanger> exchanger;
+
+    static const int nNeighbours = 26;
+
+    MPI_Comm graphComm;
+    int sendDirs[nNeighbours], recvDirs[nNeighbours];  ///< direction code of i-th graph neighbour
+
+    std::vector<int> sendCounts, recvCounts;           ///< sizes of every helper per neighbour
+    std::vector<int> sendBytes, sendDispls, recvBytes, recvDispls;
+    PinnedBuffer<char> sendBuf, recvBuf;
+
+    MPI_Request request;
+    bool active = false;
+
+    void packSend(cudaStream_t stream);
+    void unpackRecv(cudaStream_t stream);
+};
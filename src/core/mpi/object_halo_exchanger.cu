@@ -54,9 +54,7 @@ __global__ void getObjectHalos(const DomainInfo domain, const OVview view, const
         const int ix = bufId % 3;
         const int iy = (bufId / 3) % 3;
         const int iz = bufId / 9;
-        const float3 shift{ domain.localSize.x*(ix-1),
-                            domain.localSize.y*(iy-1),
-                            domain.localSize.z*(iz-1) };
+        const float3 shift = domain.neighbourShift({ix-1, iy-1, iz-1});
 
         __syncthreads();
         if (tid == 0)
@@ -33,9 +33,7 @@ __global__ void getExitingObjects(const DomainInfo domain, OVview view, const Ob
 
     __shared__ int shDstObjId;
 
-    const float3 shift{ domain.localSize.x*(cx-1),
-                        domain.localSize.y*(cy-1),
-                        domain.localSize.z*(cz-1) };
+    const float3 shift = domain.neighbourShift({cx-1, cy-1, cz-1});
 
     __syncthreads();
     if (tid == 0)
@@ -0,0 +1,81 @@
+#include "particle_forces_reverse_exchanger.h"
+#include "exchange_helpers.h"
+#include "particle_halo_exchanger.h"
+
+#include <core/utils/kernel_launch.h>
+#include <core/pvs/particle_vector.h>
+#include <core/logger.h>
+#include <core/utils/cuda_common.h>
+
+/// Same particle may have been sent to several neighbours, hence atomics
+__global__ void addReverseForces(int n, const float4* recvForces, const int* origins, float4* forces)
+{
+    const int pid = blockIdx.x * blockDim.x + threadIdx.x;
+    if (pid >= n) return;
+
+    atomicAdd(forces + origins[pid], f4tof3(recvForces[pid]));
+}
+
+//===============================================================================================
+// Member functions
+//===============================================================================================
+
+bool ParticleForcesReverseExchanger::needExchange(int id)
+{
+    return true;
+}
+
+void ParticleForcesReverseExchanger::attach(ParticleVector* pv)
+{
+    particles.push_back(pv);
+
+    auto helper = new ExchangeHelper(pv->name, sizeof(Force));
+    helpers.push_back(helper);
+}
+
+void ParticleForcesReverseExchanger::prepareSizes(int id, cudaStream_t stream)
+{
+    auto helper = helpers[id];
+    auto& offsets = entangledHaloExchanger->getRecvOffsets(id);
+
+    for (int i=0; i < helper->nBuffers; i++)
+        helper->sendSizes[i] = offsets[i+1] - offsets[i];
+}
+
+void ParticleForcesReverseExchanger::prepareData(int id, cudaStream_t stream)
+{
+    auto pv = particles[id];
+    auto helper = helpers[id];
+
+    helper->makeSendOffsets();
+    helper->resizeSendBuf();
+
+    debug2("Will send back forces of %d '%s' halo particles", helper->sendOffsets[helper->nBuffers], pv->name.c_str());
+
+    CUDA_Check( cudaMemcpyAsync( helper->sendBuf.devPtr(),
+                                 pv->halo()->forces.devPtr(),
+                                 helper->sendBuf.size(), cudaMemcpyDeviceToDevice, stream ) );
+
+    // The halo may stay valid for the next step, forces should not
+    pv->halo()->forces.clear(stream);
+}
+
+void ParticleForcesReverseExchanger::combineAndUploadData(int id, cudaStream_t stream)
+{
+    auto pv = particles[id];
+    auto helper = helpers[id];
+
+    int totalRecvd = helper->recvOffsets[helper->nBuffers];
+    auto& origins = entangledHaloExchanger->getOrigins(id);
+
+    debug("Adding back forces of %d '%s' particles", totalRecvd, pv->name.c_str());
+
+    const int nthreads = 128;
+    SAFE_KERNEL_LAUNCH(
+            addReverseForces,
+            getNblocks(totalRecvd, nthreads), nthreads, 0, stream,
+            totalRecvd,
+            (const float4*)helper->recvBuf.devPtr(),     /* source */
+            (const int*)origins.devPtr(),                /* destination ids here */
+            (float4*)pv->local()->forces.devPtr() );     /* add to */
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "exchanger_interfaces.h"
+
+#include <core/containers.h>
+
+class ParticleVector;
+class ParticleHaloExchanger;
+
+/**
+ * Sends the forces acting on the half-shell halo particles
+ * (see ParticleVector::halfShellHalo) back to the ranks owning them,
+ * and adds them to the local forces there.
+ * Works in pair with the ParticleHaloExchanger that sent the halo,
+ * the particle vectors have to be attached in the same order
+ */
+class ParticleForcesReverseExchanger : public ParticleExchanger
+{
+protected:
+    std::vector<ParticleVector*> particles;
+    ParticleHaloExchanger* entangledHaloExchanger;
+
+    void prepareSizes(int id, cudaStream_t stream) override;
+    void prepareData (int id, cudaStream_t stream) override;
+    void combineAndUploadData(int id, cudaStream_t stream) override;
+    bool needExchange(int id) override;
+
+public:
+    ParticleForcesReverseExchanger(ParticleHaloExchanger* entangledHaloExchanger) :
+        entangledHaloExchanger(entangledHaloExchanger)
+    { }
+
+    void attach(ParticleVector* pv);
+
+    virtual ~ParticleForcesReverseExchanger() = default;
+};
@@ -7,6 +7,7 @@
 #include <core/logger.h>
 #include <core/utils/cuda_common.h>
 #include <core/pvs/extra_data/packers.h>
+#include <core/utils/make_unique.h>
 
 #include <unistd.h>
 
@@ -15,12 +16,16 @@
 
 /**
  * Get halos
+ * @param domain used to compute the coordinate shift to each neighbour
  * @param cinfo
  * @param packer
  * @param dataWrap
+ * @param halfShell only send to the 13 neighbours with direction code > 13
+ * @param origins if not nullptr, local ids of the sent particles are stored there
  */
 template<bool QUERY=false>
-__global__ void getHalos(const CellListInfo cinfo, const ParticlePacker packer, BufferOffsetsSizesWrap dataWrap)
+__global__ void getHalos(const DomainInfo domain, const CellListInfo cinfo, const ParticlePacker packer, BufferOffsetsSizesWrap dataWrap,
+                         bool halfShell, int* origins)
 {
     const int gid = blockIdx.x*blockDim.x + threadIdx.x;
     const int tid = threadIdx.x;
@@ -52,6 +57,8 @@ __global__ void getHalos(const CellListInfo cinfo, const ParticlePacker packer,
                 if (ix == 1 && iy == 1 && iz == 1) continue;
 
                 const int bufId = (iz*3 + iy)*3 + ix;
+                if (halfShell && bufId < 13) continue;
+
                 validHalos[current] = bufId;
                 haloOffset[current] = atomicAdd(blockSum + bufId, pend-pstart);
                 current++;
@@ -77,9 +84,9 @@ __global__ void getHalos(const CellListInfo cinfo, const ParticlePacker packer,
             const int ix = bufId % 3;
             const int iy = (bufId / 3) % 3;
             const int iz = bufId / 9;
-            const float3 shift{ cinfo.localDomainSize.x*(ix-1),
-                                cinfo.localDomainSize.y*(iy-1),
-                                cinfo.localDomainSize.z*(iz-1) };
+            const int3 dir = {ix-1, iy-1, iz-1};
+            const float3 shift         = domain.neighbourShift(dir);
+            const float3 dstDomainSize = domain.neighbourSize (dir);
 
 #pragma unroll 3
             for (int i = 0; i < pend-pstart; i++)
@@ -89,7 +96,10 @@ __global__ void getHalos(const CellListInfo cinfo, const ParticlePacker packer,
 
                 auto bufferAddr = dataWrap.buffer + dataWrap.offsets[bufId]*packer.packedSize_byte;
 
-                packer.packShift(srcInd, bufferAddr + dstInd*packer.packedSize_byte, -shift);
+                packer.packShift(srcInd, bufferAddr + dstInd*packer.packedSize_byte, -shift, dstDomainSize);
+
+                if (origins != nullptr)
+                    origins[dataWrap.offsets[bufId] + dstInd] = srcInd;
             }
         }
     }
@@ -121,7 +131,11 @@ void ParticleHaloExchanger::attach(ParticleVector* pv, CellList* cl)
     auto helper = new ExchangeHelper(pv->name, sizeof(Particle));
     helpers.push_back(helper);
 
-    info("Particle halo exchanger takes pv '%s'", pv->name.c_str());
+    origins.push_back(std::make_unique<DeviceBuffer<int>>());
+
+    info("Particle halo exchanger takes pv '%s'%s%s", pv->name.c_str(),
+         pv->halfShellHalo  ? ", half-shell" : "",
+         pv->compressedHalo ? ", compressed" : "");
 }
 
 void ParticleHaloExchanger::prepareSizes(int id, cudaStream_t stream)
@@ -139,13 +153,13 @@ void ParticleHaloExchanger::prepareSizes(int id, cudaStream_t stream)
         const int nthreads = 64;
         const dim3 nblocks = dim3(getNblocks(maxdim*maxdim, nthreads), 6, 1);
 
-        auto packer = ParticlePacker(pv, pv->local(), stream);
+        auto packer = ParticlePacker(pv, pv->local(), stream, compressionSlab(id));
         helper->setDatumSize(packer.packedSize_byte);
 
         SAFE_KERNEL_LAUNCH(
                 getHalos<true>,
                 nblocks, nthreads, 0, stream,
-                cl->cellInfo(), packer, helper->wrapSendData() );
+                pv->domain, cl->cellInfo(), packer, helper->wrapSendData(), pv->halfShellHalo, nullptr );
 
         helper->makeSendOffsets_Dev2Dev(stream);
     }
@@ -165,14 +179,23 @@ void ParticleHaloExchanger::prepareData(int id, cudaStream_t stream)
         const int nthreads = 64;
         const dim3 nblocks = dim3(getNblocks(maxdim*maxdim, nthreads), 6, 1);
 
-        auto packer = ParticlePacker(pv, pv->local(), stream);
+        auto packer = ParticlePacker(pv, pv->local(), stream, compressionSlab(id));
 
         helper->resizeSendBuf();
         helper->sendSizes.clearDevice(stream);
+
+        // Forces on the half-shell halo will come back and need to find their particles
+        int* originsPtr = nullptr;
+        if (pv->halfShellHalo)
+        {
+            origins[id]->resize_anew(helper->sendOffsets[helper->nBuffers]);
+            originsPtr = origins[id]->devPtr();
+        }
+
         SAFE_KERNEL_LAUNCH(
                 getHalos<false>,
                 nblocks, nthreads, 0, stream,
-                cl->cellInfo(), packer, helper->wrapSendData() );
+                pv->domain, cl->cellInfo(), packer, helper->wrapSendData(), pv->halfShellHalo, originsPtr );
     }
 }
 
@@ -189,11 +212,33 @@ void ParticleHaloExchanger::combineAndUploadData(int id, cudaStream_t stream)
     SAFE_KERNEL_LAUNCH(
             unpackParticles,
             getNblocks(totalRecvd, nthreads), nthreads, 0, stream,
-            ParticlePacker(pv, pv->halo(), stream), 0, helper->recvBuf.devPtr(), totalRecvd );
+            ParticlePacker(pv, pv->halo(), stream, compressionSlab(id)), 0, helper->recvBuf.devPtr(), totalRecvd );
+
+    if (pv->halfShellHalo)
+        pv->halo()->forces.clear(stream);
 
     pv->haloValid = true;
 }
 
+/**
+ * Halo particles are taken from the boundary cells, which are never
+ * wider than twice the cut-off radius
+ */
+float ParticleHaloExchanger::compressionSlab(int id) const
+{
+    return particles[id]->compressedHalo ? 2.0f * cellLists[id]->rc : 0.0f;
+}
+
+PinnedBuffer<int>& ParticleHaloExchanger::getRecvOffsets(int id)
+{
+    return helpers[id]->recvOffsets;
+}
+
+DeviceBuffer<int>& ParticleHaloExchanger::getOrigins(int id)
+{
+    return *origins[id];
+}
+
 
 
 
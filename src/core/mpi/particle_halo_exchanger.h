@@ -2,6 +2,9 @@
 
 #include "exchanger_interfaces.h"
 
+#include <core/containers.h>
+#include <memory>
+
 class ParticleVector;
 class CellList;
 
@@ -11,13 +14,22 @@ private:
     std::vector<CellList*> cellLists;
     std::vector<ParticleVector*> particles;
 
+    /// Local ids of the sent halo particles, only filled for ParticleVector::halfShellHalo
+    std::vector< std::unique_ptr<DeviceBuffer<int>> > origins;
+
     void prepareSizes(int id, cudaStream_t stream) override;
     void prepareData (int id, cudaStream_t stream) override;
     void combineAndUploadData(int id, cudaStream_t stream) override;
     bool needExchange(int id) override;
 
+    /// Width of the slab for CompressedParticle, 0 if not compressed
+    float compressionSlab(int id) const;
+
 public:
     void attach(ParticleVector* pv, CellList* cl);
 
+    PinnedBuffer<int>& getRecvOffsets(int id);
+    DeviceBuffer<int>& getOrigins    (int id);
+
     ~ParticleHaloExchanger() = default;
 };
@@ -28,7 +28,7 @@ static __device__ bool hasToLeave(int3 code) {
 }
 
 template<bool QUERY=false>
-__global__ void getExitingParticles(const CellListInfo cinfo, ParticlePacker packer, BufferOffsetsSizesWrap dataWrap)
+__global__ void getExitingParticles(const DomainInfo domain, const CellListInfo cinfo, ParticlePacker packer, BufferOffsetsSizesWrap dataWrap)
 {
     const int gid = blockIdx.x*blockDim.x + threadIdx.x;
     int cid;
@@ -60,9 +60,7 @@ __global__ void getExitingParticles(const CellListInfo cinfo, ParticlePacker pac
         
         if (hasToLeave(code)) {
             const int bufId = (code.z*3 + code.y)*3 + code.x;
-            const float3 shift{ cinfo.localDomainSize.x*(code.x-1),
-                                cinfo.localDomainSize.y*(code.y-1),
-                                cinfo.localDomainSize.z*(code.z-1) };
+            const float3 shift = domain.neighbourShift(code - make_int3(1));
 
             int myid = atomicAdd(dataWrap.sizes + bufId, 1);
 
@@ -134,7 +132,7 @@ void ParticleRedistributor::prepareSizes(int id, cudaStream_t stream)
         SAFE_KERNEL_LAUNCH(
                 getExitingParticles<true>,
                 nblocks, nthreads, 0, stream,
-                cl->cellInfo(), packer, helper->wrapSendData() );
+                pv->domain, cl->cellInfo(), packer, helper->wrapSendData() );
 
         helper->makeSendOffsets_Dev2Dev(stream);
     }
@@ -162,7 +160,7 @@ void ParticleRedistributor::prepareData(int id, cudaStream_t stream)
         SAFE_KERNEL_LAUNCH(
                 getExitingParticles<false>,
                 nblocks, nthreads, 0, stream,
-                cl->cellInfo(), packer, helper->wrapSendData() );
+                pv->domain, cl->cellInfo(), packer, helper->wrapSendData() );
     }
 }
 
@@ -2,6 +2,7 @@
 
 #include <core/logger.h>
 
+#include <algorithm>
 #include <vector>
 #include <mpi.h>
 
@@ -10,6 +11,19 @@ Postprocess::Postprocess(MPI_Comm& comm, MPI_Comm& interComm) : comm(comm), inte
     info("Postprocessing initialized");
 }
 
+Postprocess::~Postprocess()
+{
+    stopWorkers();
+}
+
+void Postprocess::setWorkers(int n)
+{
+    if (n < 1)
+        die("Postprocess needs at least one worker, got %d", n);
+
+    nworkers = n;
+}
+
 void Postprocess::registerPlugin(std::shared_ptr<PostprocessPlugin> plugin)
 {
     info("New plugin registered: %s", plugin->name.c_str());
@@ -26,12 +40,193 @@ void Postprocess::init()
     }
 }
 
-std::vector<int> findGloballyReady(std::vector<MPI_Request>& requests, std::vector<MPI_Status>& statuses, MPI_Comm comm)
+void Postprocess::startWorkers()
+{
+    busy.assign(plugins.size(), false);
+    turnOf.assign(plugins.size(), 0);
+    nextTurn = nDispatched = 0;
+
+    if (nworkers <= 1) return;
+
+    int provided;
+    MPI_Check( MPI_Query_thread(&provided) );
+    if (provided < MPI_THREAD_MULTIPLE)
+    {
+        warn("MPI library doesn't provide MPI_THREAD_MULTIPLE, postprocess plugins will be processed by the main thread");
+        nworkers = 1;
+        return;
+    }
+
+    info("Postprocess plugins are processed by %d threads", nworkers);
+
+    // Workers wake up the main thread waiting for the plugin messages with an empty message to self
+    MPI_Check( MPI_Comm_dup(MPI_COMM_SELF, &wakeupComm) );
+    MPI_Check( MPI_Irecv(nullptr, 0, MPI_INT, 0, wakeupTag, wakeupComm, &wakeupReq) );
+
+    for (int i = 0; i < nworkers; i++)
+        workers.emplace_back(&Postprocess::workerLoop, this);
+}
+
+void Postprocess::stopWorkers()
+{
+    for (int i = 0; i < busy.size(); i++)
+        waitFinished(i);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+
+    for (auto& w : workers)
+        w.join();
+    workers.clear();
+
+    if (wakeupComm == MPI_COMM_NULL) return;
+
+    MPI_Check( MPI_Cancel(&wakeupReq) );
+    MPI_Check( MPI_Wait(&wakeupReq, MPI_STATUS_IGNORE) );
+
+    // Drop the wake-ups nobody waited for
+    int flag = 1;
+    while (flag)
+    {
+        MPI_Check( MPI_Iprobe(0, wakeupTag, wakeupComm, &flag, MPI_STATUS_IGNORE) );
+        if (flag)
+            MPI_Check( MPI_Recv(nullptr, 0, MPI_INT, 0, wakeupTag, wakeupComm, MPI_STATUS_IGNORE) );
+    }
+
+    MPI_Check( MPI_Comm_free(&wakeupComm) );
+}
+
+void Postprocess::workerLoop()
+{
+    while (true)
+    {
+        int index;
+        long turn;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] () { return stopping || !pending.empty(); });
+
+            if (pending.empty()) return;
+            index = pending.front();
+            pending.pop_front();
+            turn = turnOf[index];
+        }
+
+        debug2("Postprocess got a request from plugin '%s', executing now", plugins[index]->name.c_str());
+        plugins[index]->recv();
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this, turn] () { return nextTurn == turn; });
+        }
+
+        plugins[index]->deserialize(statuses[index]);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(index);
+            nextTurn++;
+        }
+        cv.notify_all();
+
+        MPI_Request req;
+        MPI_Check( MPI_Isend(nullptr, 0, MPI_INT, 0, wakeupTag, wakeupComm, &req) );
+        MPI_Check( MPI_Request_free(&req) );
+    }
+}
+
+void Postprocess::process(int index)
+{
+    debug2("Postprocess got a request from plugin '%s', executing now", plugins[index]->name.c_str());
+    plugins[index]->recv();
+    plugins[index]->deserialize(statuses[index]);
+}
+
+void Postprocess::dispatch(int index)
+{
+    if (workers.empty())
+    {
+        process(index);
+        requests[index] = plugins[index]->waitData();
+        return;
+    }
+
+    busy[index] = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        turnOf[index] = nDispatched++;
+        pending.push_back(index);
+    }
+    cv.notify_all();
+}
+
+void Postprocess::rearmFinished()
+{
+    std::vector<int> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::swap(done, finished);
+    }
+
+    for (auto index : done)
+    {
+        busy[index] = false;
+        requests[index] = plugins[index]->waitData();
+    }
+}
+
+void Postprocess::waitFinished(int index)
+{
+    while (busy[index])
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] () { return !finished.empty(); });
+        }
+        rearmFinished();
+    }
+}
+
+/**
+ * All the ranks process the same plugins in the same order, such that
+ * the collective I/O of the plugins matches between the ranks.
+ * The plugins still busy with the previous message are waited for here
+ */
+std::vector<int> Postprocess::findGloballyReady()
 {
     int index;
     MPI_Status stat;
-    MPI_Check( MPI_Waitany(requests.size(), requests.data(), &index, &stat) );
-    statuses[index] = stat;    
+
+    if (workers.empty())
+        MPI_Check( MPI_Waitany(requests.size(), requests.data(), &index, &stat) );
+    else
+    {
+        // Also wait for the wake-up of the workers,
+        // such that the plugins they finished listen again right away
+        const int wakeupIndex = requests.size();
+        std::vector<MPI_Request> allRequests;
+
+        while (true)
+        {
+            rearmFinished();
+
+            allRequests = requests;
+            allRequests.push_back(wakeupReq);
+            MPI_Check( MPI_Waitany(allRequests.size(), allRequests.data(), &index, &stat) );
+
+            std::copy(allRequests.begin(), allRequests.begin() + wakeupIndex, requests.begin());
+            wakeupReq = allRequests[wakeupIndex];
+
+            if (index != wakeupIndex) break;
+
+            MPI_Check( MPI_Irecv(nullptr, 0, MPI_INT, 0, wakeupTag, wakeupComm, &wakeupReq) );
+        }
+    }
+    statuses[index] = stat;
 
     std::vector<int> mask(requests.size(), 0);
     mask[index] = 1;
@@ -42,6 +237,8 @@ std::vector<int> findGloballyReady(std::vector<MPI_Request>& requests, std::vect
         if (mask[i] > 0)
         {
             ids.push_back(i);
+            if (i < busy.size())
+                waitFinished(i);
             if (requests[i] != MPI_REQUEST_NULL)
                 MPI_Check( MPI_Wait(&requests[i], &statuses[i]) );
         }
@@ -55,23 +252,31 @@ void Postprocess::run()
     const int tag = 424242;
 
     int dummy = 0;
-    int rank;
+    int rank, nranks, ncompute;
 
     MPI_Check( MPI_Comm_rank(comm, &rank) );
+    MPI_Check( MPI_Comm_size(comm, &nranks) );
+    MPI_Check( MPI_Comm_remote_size(interComm, &ncompute) );
+
+    // This task serves simulation tasks firstSource, ..., endSource - 1
+    const int firstSource = firstServedTask(rank,   ncompute, nranks);
+    const int endSource   = firstServedTask(rank+1, ncompute, nranks);
 
     MPI_Request endReq;
-    MPI_Check( MPI_Irecv(&dummy, 1, MPI_INT, rank, tag, interComm, &endReq) );
+    MPI_Check( MPI_Irecv(&dummy, 1, MPI_INT, firstSource, tag, interComm, &endReq) );
 
-    std::vector<MPI_Request> requests;
+    requests.clear();
     for (auto& pl : plugins)
         requests.push_back(pl->waitData());
     requests.push_back(endReq);
-    std::vector<MPI_Status> statuses(requests.size());
+    statuses.resize(requests.size());
+
+    startWorkers();
     
     info("Postprocess is listening to messages now");
     while (true)
     {
-        auto readyIds = findGloballyReady(requests, statuses, comm);
+        auto readyIds = findGloballyReady();
 
         for (auto index : readyIds)
         {
@@ -80,7 +285,13 @@ void Postprocess::run()
                 if (dummy != -1)
                     die("Something went terribly wrong");
     
+                // Other simulation tasks may still be finishing their last messages
+                for (int source = firstSource + 1; source < endSource; source++)
+                    MPI_Check( MPI_Recv(&dummy, 1, MPI_INT, source, tag, interComm, MPI_STATUS_IGNORE) );
+
                 info("Postprocess got a stopping message and will stop now");    
+
+                stopWorkers();
                 
                 for (int i=0; i<plugins.size(); i++)
                     MPI_Check( MPI_Cancel(requests.data() + i) );
@@ -88,11 +299,7 @@ void Postprocess::run()
                 return;
             }
         
-            debug2("Postprocess got a request from plugin '%s', executing now", plugins[index]->name.c_str());
-            plugins[index]->recv();
-            plugins[index]->deserialize(statuses[index]);
-            requests[index] = plugins[index]->waitData();
+            dispatch(index);
         }
     }
 }
-
@@ -2,7 +2,12 @@
 
 #include <mpi.h>
 #include <plugins/interface.h>
+
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 class Postprocess
 {
@@ -11,12 +16,48 @@ private:
     MPI_Comm interComm;
     std::vector< std::shared_ptr<PostprocessPlugin> > plugins;
     std::vector<MPI_Request> requests;
+    std::vector<MPI_Status> statuses;
+
+    // With several workers, plugins that got a message receive it concurrently,
+    // and a plugin only listens again after its previous message is processed.
+    // Deserialization may do collective I/O, which is not thread-safe with parallel HDF5,
+    // so the plugins take turns in the order they were dispatched, the same on all the ranks
+    int nworkers = 1;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<int> pending;
+    std::vector<int> finished;
+    std::vector<bool> busy;
+    std::vector<long> turnOf;
+    long nextTurn = 0, nDispatched = 0;
+    bool stopping = false;
+
+    // Workers signal the main thread, blocked in MPI, with empty messages on this communicator
+    const int wakeupTag = 0;
+    MPI_Comm wakeupComm = MPI_COMM_NULL;
+    MPI_Request wakeupReq = MPI_REQUEST_NULL;
+
+    std::vector<int> findGloballyReady();
+    void process(int index);
+    void dispatch(int index);
+    void rearmFinished();
+    void waitFinished(int index);
+
+    void startWorkers();
+    void stopWorkers();
+    void workerLoop();
 
 public:
     Postprocess(MPI_Comm& comm, MPI_Comm& interComm);
+    ~Postprocess();
+
     void registerPlugin( std::shared_ptr<PostprocessPlugin> plugin );
     void run();
     void init();
+
+    /// Number of threads deserializing the plugin messages, 1 means the main thread only
+    void setWorkers(int n);
     
     // TODO complete this
 //     void restart   (std::string folder);
@@ -1,9 +1,85 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
+#include <cuda_fp16.h>
 #include <core/pvs/particle_vector.h>
 #include <core/pvs/object_vector.h>
 
+/**
+ * Lossy 16 bytes representation of a halo Particle
+ *
+ * Coordinates are 16-bit fixed point in the frame of the receiving subdomain,
+ * velocities are half precision, and only the 32-bit Particle::idKey() of the id is kept,
+ * which is all the pairwise random numbers need.
+ * Each coordinate code falls in one of three ranges: the slab of width \e slab
+ * below the subdomain, the subdomain itself and the slab above it.
+ * Halo particles lie in the slabs along the axes they crossed, so these are
+ * resolved with slab / 8192, and the others with subdomain size / 49152.
+ * The upper slab has one code less than the lower one, such that both
+ * outer edges of the slabs are represented exactly
+ */
+struct __align__(16) CompressedParticle
+{
+    uint16_t r[3];
+    uint16_t u[3];
+    int32_t idKey;
+
+    static constexpr int slabCodes   = 8192;
+    static constexpr int insideCodes = 65536 - 2*slabCodes;
+
+    static inline __device__ uint16_t encode1d(float x, float L, float slab)
+    {
+        const float lo = -0.5f*L, hi = 0.5f*L;
+        float code;
+
+        if      (x < lo) code =                         (x - lo + slab) / slab * slabCodes;
+        else if (x < hi) code = slabCodes             + (x - lo)        / L    * insideCodes;
+        else             code = slabCodes+insideCodes + (x - hi)        / slab * (slabCodes-1);
+
+        return (uint16_t) fminf(fmaxf(rintf(code), 0.0f), 65535.0f);
+    }
+
+    static inline __device__ float decode1d(uint16_t code, float L, float slab)
+    {
+        const float lo = -0.5f*L, hi = 0.5f*L;
+
+        if (code < slabCodes)             return lo - slab + code * (slab / slabCodes);
+        if (code < slabCodes+insideCodes) return lo + (code - slabCodes) * (L / insideCodes);
+        return hi + (code - slabCodes - insideCodes) * (slab / (slabCodes-1));
+    }
+
+    /// \p p has to be already shifted to the frame of the subdomain of size \p L
+    inline __device__ void encode(const Particle& p, float3 L, float slab)
+    {
+        r[0] = encode1d(p.r.x, L.x, slab);
+        r[1] = encode1d(p.r.y, L.y, slab);
+        r[2] = encode1d(p.r.z, L.z, slab);
+
+        u[0] = __half_as_ushort(__float2half_rn(p.u.x));
+        u[1] = __half_as_ushort(__float2half_rn(p.u.y));
+        u[2] = __half_as_ushort(__float2half_rn(p.u.z));
+
+        idKey = p.idKey();
+    }
+
+    inline __device__ Particle decode(float3 L, float slab) const
+    {
+        Particle p;
+        p.r = make_float3( decode1d(r[0], L.x, slab), decode1d(r[1], L.y, slab), decode1d(r[2], L.z, slab) );
+        p.u = make_float3( __half2float(__ushort_as_half(u[0])),
+                           __half2float(__ushort_as_half(u[1])),
+                           __half2float(__ushort_as_half(u[2])) );
+        // idKey() of a decoded particle is the same as of the original one
+        p.i1 = idKey;
+        p.i2 = 0;
+
+        return p;
+    }
+};
+
+static_assert(sizeof(CompressedParticle) == 16, "CompressedParticle has to be 16 bytes");
+
 
 /**
  * Class that packs nChannels of arbitrary data into a chunk of contiguous memory
@@ -18,6 +94,9 @@ struct DevicePacker
     int* channelShiftTypes   = nullptr;   ///< if type is 4, then treat data to shift as float3, if it is 8 -- as double3
     char** channelData       = nullptr;   ///< device pointers of the packed data
 
+    float  compressionSlab = 0.0f;        ///< if positive, the first channel holds particles packed as CompressedParticle
+    float3 compressionDomainSize;         ///< size of the subdomain the particles are unpacked to
+
     /**
      * Pack entity with id srcId into memory starting with dstAddr
      * Don't apply no shifts
@@ -36,6 +115,15 @@ struct DevicePacker
         _packShift<true>  (srcId, dstAddr, shift);
     }
 
+    /**
+     * Same as packShift(), the shifted entity will be unpacked into the subdomain
+     * of size \p dstDomainSize, which is needed if the particles are compressed
+     */
+    inline __device__ void packShift(int srcId, char* dstAddr, float3 shift, float3 dstDomainSize) const
+    {
+        _packShift<true>  (srcId, dstAddr, shift, dstDomainSize);
+    }
+
     /**
      * Unpack entity from memory by srcAddr to the channels to id dstId
      */
@@ -43,6 +131,17 @@ struct DevicePacker
     {
         for (int i = 0; i < nChannels; i++)
         {
+            if (i == 0 && compressionSlab > 0.0f)
+            {
+                const Particle p = ((const CompressedParticle*)srcAddr)->decode(compressionDomainSize, compressionSlab);
+                auto dst = (float4*)(channelData[0] + channelSizes[0]*dstId);
+                dst[0] = p.r2Float4();
+                dst[1] = p.u2Float4();
+
+                srcAddr += sizeof(CompressedParticle);
+                continue;
+            }
+
             copy(channelData[i] + channelSizes[i]*dstId, srcAddr, channelSizes[i]);
             srcAddr += channelSizes[i];
         }
@@ -86,13 +185,23 @@ private:
      * Template parameter NEEDSHIFT governs shifting
      */
     template <bool NEEDSHIFT>
-    inline __device__ void _packShift(int srcId, char* dstAddr, float3 shift) const
+    inline __device__ void _packShift(int srcId, char* dstAddr, float3 shift, float3 dstDomainSize = {0, 0, 0}) const
     {
         for (int i = 0; i < nChannels; i++)
         {
             const int size = channelSizes[i];
             int done = 0;
 
+            if (i == 0 && compressionSlab > 0.0f)
+            {
+                Particle p((const float4*)channelData[0], srcId);
+                p.r += shift;
+                ((CompressedParticle*)dstAddr)->encode(p, dstDomainSize, compressionSlab);
+
+                dstAddr += sizeof(CompressedParticle);
+                continue;
+            }
+
             if (NEEDSHIFT)
             {
                 if (channelShiftTypes[i] == 4)
@@ -129,10 +238,17 @@ private:
  */
 struct ParticlePacker : public DevicePacker
 {
-    ParticlePacker(ParticleVector* pv, LocalParticleVector* lpv, cudaStream_t stream)
+    /**
+     * @param compressionSlab if positive, particles are packed as CompressedParticle, and
+     *        must lie within that distance from the subdomain they are unpacked to
+     */
+    ParticlePacker(ParticleVector* pv, LocalParticleVector* lpv, cudaStream_t stream, float compressionSlab = 0.0f)
     {
         if (pv == nullptr || lpv == nullptr) return;
 
+        this->compressionSlab = compressionSlab;
+        compressionDomainSize = pv->domain.localSize;
+
         auto& manager = lpv->extraPerParticle;
 
         int n = 0;
@@ -164,6 +280,9 @@ struct ParticlePacker : public DevicePacker
                 reinterpret_cast<char*>(lpv->coosvels.devPtr()),
                 sizeof(float) );
 
+        if (compressionSlab > 0.0f)
+            packedSize_byte += sizeof(CompressedParticle) - sizeof(Particle);
+
 
         for (const auto& name_desc : manager.getSortedChannels())
         {
@@ -5,6 +5,7 @@
 #include <core/utils/cuda_common.h>
 #include <core/utils/folders.h>
 #include <core/xdmf/xdmf.h>
+#include <core/decomposition.h>
 
 #include "restart_helpers.h"
 
@@ -63,8 +64,8 @@ void ObjectVector::findExtentAndCOM(cudaStream_t stream, ParticleVectorType type
 
 void ObjectVector::_getRestartExchangeMap(MPI_Comm comm, const std::vector<Particle> &parts, std::vector<int>& map)
 {
-    int dims[3], periods[3], coords[3];
-    MPI_Check( MPI_Cart_get(comm, 3, dims, periods, coords) );
+    // Subdomains may be of different sizes
+    auto decomposition = Decomposition::gather(comm, domain);
 
     int nObjs = parts.size() / objSize;
     map.resize(nObjs);
@@ -77,9 +78,9 @@ void ObjectVector::_getRestartExchangeMap(MPI_Comm comm, const std::vector<Parti
 
         com /= objSize;
 
-        int3 procId3 = make_int3(floorf(com / domain.localSize));
+        int3 procId3 = decomposition.locate(com);
 
-        if (procId3.x >= dims[0] || procId3.y >= dims[1] || procId3.z >= dims[2]) {
+        if (procId3.x < 0 || procId3.y < 0 || procId3.z < 0) {
             map[i] = -1;
             continue;
         }
@@ -91,20 +92,22 @@ void ObjectVector::_getRestartExchangeMap(MPI_Comm comm, const std::vector<Parti
 }
 
 
-std::vector<int> ObjectVector::_restartParticleData(MPI_Comm comm, std::string path)
+RestartMap ObjectVector::_restartParticleData(MPI_Comm comm, std::string path)
 {
     CUDA_Check( cudaDeviceSynchronize() );
 
     std::string filename = path + "/" + name + ".xmf";
     info("Restarting object vector %s from file %s", name.c_str(), filename.c_str());
 
-    XDMF::readParticleData(filename, comm, this, objSize);
+    RestartMap map;
+    map.indexed = XDMF::readParticleData(filename, comm, this, objSize, [this] (float3 lower, float3 upper) {
+        return _overlapsSubdomain(lower, upper);
+    }, &map.blocks);
 
     std::vector<Particle> parts(local()->coosvels.begin(), local()->coosvels.end());
-    std::vector<int> map;
     
-    _getRestartExchangeMap(comm, parts, map);
-    restart_helpers::exchangeData(comm, map, parts, objSize);    
+    _getRestartExchangeMap(comm, parts, map.ranks);
+    restart_helpers::redistribute(comm, map, parts, objSize);
     restart_helpers::copyShiftCoordinates(domain, parts, local());
 
     local()->coosvels.uploadToDevice(0);
@@ -113,7 +116,7 @@ std::vector<int> ObjectVector::_restartParticleData(MPI_Comm comm, std::string p
     // That's a kinda hack, will be properly fixed in the hdf5 per object restarts
     auto ids = local()->extraPerObject.getData<int>("ids");
     for (int i = 0; i < local()->nObjects; i++)
-        (*ids)[i] = local()->coosvels[i*objSize].i1 / objSize;
+        (*ids)[i] = local()->coosvels[i*objSize].getId() / objSize;
     ids->uploadToDevice(0);
 
     CUDA_Check( cudaDeviceSynchronize() );
@@ -151,35 +154,44 @@ void ObjectVector::_checkpointObjectData(MPI_Comm comm, std::string path)
 
     
     auto positions = std::make_shared<std::vector<float>>();
+    auto idsCopy   = std::make_shared<std::vector<int>>(ids->begin(), ids->end());
 
     splitCom(domain, *coms_extents, *positions);
 
-    XDMF::VertexGrid grid(positions, comm);
+    auto ovName = name;
+    auto compression = checkpointCompression;
+    _writeCheckpoint(comm, [=] (MPI_Comm comm) {
+        XDMF::VertexGrid grid(positions, comm);
+        grid.setPositionCompression(XDMF::compressionOf("position", compression));
+        // Same blocks as the particles: all the local objects in one
+        grid.setBlocks({positions->size() / 3});
 
-    std::vector<XDMF::Channel> channels;
-    channels.push_back(XDMF::Channel( "ids", ids->data(), XDMF::Channel::Type::Scalar, XDMF::Channel::Datatype::Int ));
-    
-    XDMF::write(filename, &grid, channels, comm);
+        std::vector<XDMF::Channel> channels;
+        channels.push_back(XDMF::Channel( "ids", idsCopy->data(), XDMF::Channel::Type::Scalar, XDMF::Channel::Datatype::Int ));
+        XDMF::applyCompression(channels, compression);
+
+        XDMF::write(filename, &grid, channels, comm);
 
-    restart_helpers::make_symlink(comm, path, name + ".obj", filename);
+        restart_helpers::make_symlink(comm, path, ovName + ".obj", filename);
 
-    debug("Checkpoint for object vector '%s' successfully written", name.c_str());
+        debug("Checkpoint for object vector '%s' successfully written", ovName.c_str());
+    });
 }
 
-void ObjectVector::_restartObjectData(MPI_Comm comm, std::string path, const std::vector<int>& map)
+void ObjectVector::_restartObjectData(MPI_Comm comm, std::string path, const RestartMap& map)
 {
     CUDA_Check( cudaDeviceSynchronize() );
 
     std::string filename = path + "/" + name + ".obj.xmf";
     info("Restarting object vector %s from file %s", name.c_str(), filename.c_str());
 
-    XDMF::readObjectData(filename, comm, this);
+    XDMF::readObjectData(filename, comm, this, map.indexed ? &map.blocks : nullptr);
 
     auto loc_ids = local()->extraPerObject.getData<int>("ids");
     
     std::vector<int> ids(loc_ids->begin(), loc_ids->end());
     
-    restart_helpers::exchangeData(comm, map, ids, 1);
+    restart_helpers::redistribute(comm, map, ids, 1);
 
     loc_ids->resize_anew(ids.size());
     std::copy(ids.begin(), ids.end(), loc_ids->begin());
@@ -87,6 +87,10 @@ protected:
 
         // object ids must always follow objects
         requireDataPerObject<int>("ids", true);
+
+        // objects can't be split between the blocks,
+        // and the blocks have to match between the particle and the object files
+        checkpointBlocks = {1, 1, 1};
     }
 
 public:
@@ -125,10 +129,10 @@ public:
 protected:
 
     void _getRestartExchangeMap(MPI_Comm comm, const std::vector<Particle> &parts, std::vector<int>& map) override;
-    std::vector<int> _restartParticleData(MPI_Comm comm, std::string path) override;
+    RestartMap _restartParticleData(MPI_Comm comm, std::string path) override;
 
     virtual void _checkpointObjectData(MPI_Comm comm, std::string path);
-    virtual void _restartObjectData(MPI_Comm comm, std::string path, const std::vector<int>& map);
+    virtual void _restartObjectData(MPI_Comm comm, std::string path, const RestartMap& map);
     
 private:
     template<typename T>
@@ -2,6 +2,8 @@
 
 #include "core/utils/folders.h"
 #include "core/xdmf/xdmf.h"
+#include "core/decomposition.h"
+#include "core/simulation.h"
 #include "particle_vector.h"
 #include "restart_helpers.h"
 
@@ -52,14 +54,14 @@ ParticleVector::ParticleVector(std::string name, float mass, int n) :
 { }
 
 
-std::vector<int> ParticleVector::getIndices_vector()
+std::vector<int64_t> ParticleVector::getIndices_vector()
 {
     auto& coosvels = local()->coosvels;
     coosvels.downloadFromDevice(0);
     
-    std::vector<int> res(coosvels.size());
+    std::vector<int64_t> res(coosvels.size());
     for (int i = 0; i < coosvels.size(); i++)
-        res[i] = coosvels[i].i1;
+        res[i] = coosvels[i].getId();
     
     return res;
 }
@@ -147,6 +149,25 @@ void ParticleVector::createIndicesHost()
 //         local()->coosvels[i].i1 += totalCount;
 }
 
+void ParticleVector::setCheckpointCompression(std::vector<std::string> channels, bool shuffle, int deflate,
+                                              unsigned codec, std::vector<unsigned> codecParams)
+{
+    if (deflate < 0 || deflate > 9)
+        die("Deflate level of the checkpoints of '%s' should be from 0 to 9, got %d", name.c_str(), deflate);
+
+    XDMF::Channel::Compression compression;
+    compression.shuffle     = shuffle;
+    compression.deflate     = deflate;
+    compression.codec       = codec;
+    compression.codecParams = codecParams;
+
+    if (channels.empty())
+        channels.push_back("");
+
+    for (auto& ch : channels)
+        checkpointCompression[ch] = compression;
+}
+
 void ParticleVector::setCoordinates_vector(PyTypes::VectorOfFloat3& coordinates)
 {
     auto& coosvels = local()->coosvels;
@@ -216,8 +237,9 @@ ParticleVector::ParticleVector( std::string name, float mass, LocalParticleVecto
     requireDataPerParticle<Particle> ("old_particles", false);
 }
 
-static void splitPV(DomainInfo domain, LocalParticleVector *local,
-                    std::vector<float> &positions, std::vector<float> &velocities, std::vector<int> &ids)
+static void splitPV(DomainInfo domain, int3 nblocks, LocalParticleVector *local,
+                    std::vector<float> &positions, std::vector<float> &velocities, std::vector<int64_t> &ids,
+                    std::vector<hsize_t> &blockSizes)
 {
     int n = local->size();
     positions.resize(3 * n);
@@ -225,13 +247,36 @@ static void splitPV(DomainInfo domain, LocalParticleVector *local,
     ids.resize(n);
 
     float3 *pos = (float3*) positions.data(), *vel = (float3*) velocities.data();
+
+    // Counting sort of the particles into nblocks sub-blocks of the subdomain
+    auto blockId = [domain, nblocks] (float3 r) {
+        auto h = domain.localSize / make_float3(nblocks);
+        int3 b = make_int3( floorf((r + 0.5f * domain.localSize) / h) );
+        b = min(max(b, make_int3(0)), nblocks - make_int3(1));
+        return (b.z * nblocks.y + b.y) * nblocks.x + b.x;
+    };
+
+    std::vector<int> blockOf(n);
+    blockSizes.assign(nblocks.x * nblocks.y * nblocks.z, 0);
+
+    for (int i = 0; i < n; i++)
+    {
+        blockOf[i] = blockId(local->coosvels[i].r);
+        blockSizes[blockOf[i]]++;
+    }
+
+    std::vector<hsize_t> dst(blockSizes.size(), 0);
+    for (int b = 1; b < blockSizes.size(); b++)
+        dst[b] = dst[b-1] + blockSizes[b-1];
     
     for (int i = 0; i < n; i++)
     {
         auto p = local->coosvels[i];
-        pos[i] = domain.local2global(p.r);
-        vel[i] = p.u;
-        ids[i] = p.i1;
+        auto j = dst[blockOf[i]]++;
+
+        pos[j] = domain.local2global(p.r);
+        vel[j] = p.u;
+        ids[j] = p.getId();
     }
 }
 
@@ -244,36 +289,54 @@ void ParticleVector::_checkpointParticleData(MPI_Comm comm, std::string path)
 
     local()->coosvels.downloadFromDevice(0, ContainersSynch::Synch);
 
-    auto positions = std::make_shared<std::vector<float>>();
-    std::vector<float> velocities;
-    std::vector<int> ids;
-    splitPV(domain, local(), *positions, velocities, ids);
+    auto positions  = std::make_shared<std::vector<float>>();
+    auto velocities = std::make_shared<std::vector<float>>();
+    auto ids        = std::make_shared<std::vector<int64_t>>();
+    auto blockSizes = std::make_shared<std::vector<hsize_t>>();
+    splitPV(domain, checkpointBlocks, local(), *positions, *velocities, *ids, *blockSizes);
 
-    XDMF::VertexGrid grid(positions, comm);
+    auto pvName = name;
+    auto compression = checkpointCompression;
+    _writeCheckpoint(comm, [=] (MPI_Comm comm) {
+        XDMF::VertexGrid grid(positions, comm);
+        grid.setPositionCompression(XDMF::compressionOf("position", compression));
+        grid.setBlocks(*blockSizes);
 
-    std::vector<XDMF::Channel> channels;
-    channels.push_back(XDMF::Channel("velocity", velocities.data(), XDMF::Channel::Type::Vector));
-    channels.push_back(XDMF::Channel( "ids", ids.data(), XDMF::Channel::Type::Scalar, XDMF::Channel::Datatype::Int ));
-    
-    XDMF::write(filename, &grid, channels, comm);
+        std::vector<XDMF::Channel> channels;
+        channels.push_back(XDMF::Channel("velocity", velocities->data(), XDMF::Channel::Type::Vector));
+        channels.push_back(XDMF::Channel( "ids", ids->data(), XDMF::Channel::Type::Scalar, XDMF::Channel::Datatype::Int64 ));
+        XDMF::applyCompression(channels, compression);
+
+        XDMF::write(filename, &grid, channels, comm);
+
+        restart_helpers::make_symlink(comm, path, pvName, filename);
+
+        debug("Checkpoint for particle vector '%s' successfully written", pvName.c_str());
+    });
+}
 
-    restart_helpers::make_symlink(comm, path, name, filename);
+void ParticleVector::_writeCheckpoint(MPI_Comm comm, AsyncWriter::Job write)
+{
+    auto writer = simulation != nullptr ? simulation->getCheckpointWriter() : nullptr;
 
-    debug("Checkpoint for particle vector '%s' successfully written", name.c_str());
+    if (writer != nullptr)
+        writer->add(std::move(write));
+    else
+        write(comm);
 }
 
 void ParticleVector::_getRestartExchangeMap(MPI_Comm comm, const std::vector<Particle> &parts, std::vector<int>& map)
 {
-    int dims[3], periods[3], coords[3];
-    MPI_Check( MPI_Cart_get(comm, 3, dims, periods, coords) );
+    // Subdomains may be of different sizes
+    auto decomposition = Decomposition::gather(comm, domain);
 
     map.resize(parts.size());
     
     for (int i = 0; i < parts.size(); ++i) {
         const auto& p = parts[i];
-        int3 procId3 = make_int3(floorf(p.r / domain.localSize));
+        int3 procId3 = decomposition.locate(p.r);
 
-        if (procId3.x >= dims[0] || procId3.y >= dims[1] || procId3.z >= dims[2]) {
+        if (procId3.x < 0 || procId3.y < 0 || procId3.z < 0) {
             map[i] = -1;
             continue;
         }
@@ -284,20 +347,33 @@ void ParticleVector::_getRestartExchangeMap(MPI_Comm comm, const std::vector<Par
     }
 }
 
-std::vector<int> ParticleVector::_restartParticleData(MPI_Comm comm, std::string path)
+bool ParticleVector::_overlapsSubdomain(float3 lower, float3 upper) const
+{
+    // Blocks touching the subdomain boundary must be read as well
+    const float tolerance = 1e-5f * length(domain.globalSize);
+    const float3 lo = domain.globalStart - tolerance;
+    const float3 hi = domain.globalStart + domain.localSize + tolerance;
+
+    return lower.x <= hi.x && lower.y <= hi.y && lower.z <= hi.z &&
+           upper.x >= lo.x && upper.y >= lo.y && upper.z >= lo.z;
+}
+
+RestartMap ParticleVector::_restartParticleData(MPI_Comm comm, std::string path)
 {
     CUDA_Check( cudaDeviceSynchronize() );
 
     std::string filename = path + "/" + name + ".xmf";
     info("Restarting particle vector %s from file %s", name.c_str(), filename.c_str());
 
-    XDMF::readParticleData(filename, comm, this);
+    RestartMap map;
+    map.indexed = XDMF::readParticleData(filename, comm, this, 1, [this] (float3 lower, float3 upper) {
+        return _overlapsSubdomain(lower, upper);
+    }, &map.blocks);
 
     std::vector<Particle> parts(local()->coosvels.begin(), local()->coosvels.end());
-    std::vector<int> map;
     
-    _getRestartExchangeMap(comm, parts, map);
-    restart_helpers::exchangeData(comm, map, parts, 1);    
+    _getRestartExchangeMap(comm, parts, map.ranks);
+    restart_helpers::redistribute(comm, map, parts, 1);
     restart_helpers::copyShiftCoordinates(domain, parts, local());
 
     local()->coosvels.uploadToDevice(0);
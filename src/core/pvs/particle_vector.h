@@ -5,6 +5,8 @@
 #include "core/containers.h"
 #include "core/domain.h"
 #include "core/utils/pytypes.h"
+#include "core/utils/async_writer.h"
+#include "core/xdmf/channel.h"
 
 #include "extra_data/extra_data_manager.h"
 
@@ -38,6 +40,18 @@ protected:
 };
 
 
+/**
+ * Destination rank of every particle (or object) read on restart, -1 if it's dropped.
+ * If the checkpoint has a spatial index, each rank only reads the blocks
+ * overlapping its subdomain and keeps its own particles, nothing is exchanged
+ */
+struct RestartMap
+{
+    std::vector<int> ranks;
+    bool indexed{false};
+    std::vector<int> blocks; ///< ids of the blocks read if indexed
+};
+
 class ParticleVector : public YmrSimulationObject
 {
 protected:
@@ -54,6 +68,14 @@ public:
     bool haloValid = false;
     bool redistValid = false;
 
+    /// Halo is only received from 13 neighbours, so the interactions have to compute
+    /// forces on the halo particles, and those are sent back to their owners
+    bool halfShellHalo = false;
+
+    /// Halo particles are sent as CompressedParticle: lossy positions and velocities,
+    /// upper part of the ids is not sent
+    bool compressedHalo = false;
+
     int cellListStamp{0};
 
     ParticleVector(std::string name, float mass, int n=0);
@@ -67,7 +89,7 @@ public:
     
     // Python getters / setters
     // Use default blocking stream
-    std::vector<int> getIndices_vector();
+    std::vector<int64_t> getIndices_vector();
     PyTypes::VectorOfFloat3 getCoordinates_vector();
     PyTypes::VectorOfFloat3 getVelocities_vector();
     PyTypes::VectorOfFloat3 getForces_vector();
@@ -75,6 +97,13 @@ public:
     void setCoosVels_globally(PyTypes::VectorOfFloat6& coosvels, cudaStream_t stream=0);
     void createIndicesHost();
 
+    /**
+     * HDF5 filters of the checkpoint \p channels (e.g. "position", "velocity", "ids"),
+     * all the channels if the list is empty
+     */
+    void setCheckpointCompression(std::vector<std::string> channels, bool shuffle, int deflate,
+                                  unsigned codec, std::vector<unsigned> codecParams);
+
     void setCoordinates_vector(PyTypes::VectorOfFloat3& coordinates);
     void setVelocities_vector(PyTypes::VectorOfFloat3& velocities);
     void setForces_vector(PyTypes::VectorOfFloat3& forces);
@@ -102,11 +131,27 @@ protected:
     virtual void _getRestartExchangeMap(MPI_Comm comm, const std::vector<Particle> &parts, std::vector<int>& map);
     
     virtual void _checkpointParticleData(MPI_Comm comm, std::string path);
-    virtual std::vector<int> _restartParticleData(MPI_Comm comm, std::string path);    
+    virtual RestartMap _restartParticleData(MPI_Comm comm, std::string path);
+
+    /// True if the block of a checkpoint index with the bounding box [\p lower, \p upper] (global coordinates) has to be read here
+    bool _overlapsSubdomain(float3 lower, float3 upper) const;
+
+    /**
+     * Execute \p write right away, or defer it to the background writer of the
+     * simulation if checkpoints are asynchronous. \p write must only use
+     * the host snapshot it owns and the communicator it receives
+     */
+    void _writeCheckpoint(MPI_Comm comm, AsyncWriter::Job write);
 
     void advanceRestartIdx();
     int restartIdx = 0;
 
+    /// Local particles are checkpointed in this many spatial blocks, to restart only reading the overlapping ones
+    int3 checkpointBlocks{2, 2, 2};
+
+    /// By channel name, empty name is the default for all the channels
+    std::map<std::string, XDMF::Channel::Compression> checkpointCompression;
+
 private:
 
     template<typename T>
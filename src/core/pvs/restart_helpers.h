@@ -70,4 +70,33 @@ namespace restart_helpers
 
         MPI_Check( MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE) );
     }
+
+    /**
+     * Send the data to the ranks of the \p map, or, if the checkpoint was read
+     * by blocks, keep only the local part: the rest is read by its owners
+     */
+    template<typename T>
+    static void redistribute(MPI_Comm comm, const RestartMap& map, std::vector<T>& data, int chunkSize = 1)
+    {
+        if (!map.indexed)
+        {
+            exchangeData(comm, map.ranks, data, chunkSize);
+            return;
+        }
+
+        if (data.size() != map.ranks.size() * chunkSize)
+            die("Restart read %d elements, but the map is for %d chunks of %d", (int)data.size(), (int)map.ranks.size(), chunkSize);
+
+        int rank;
+        MPI_Check( MPI_Comm_rank(comm, &rank) );
+
+        std::vector<T> kept;
+        for (int i = 0; i < map.ranks.size(); ++i)
+            if (map.ranks[i] == rank)
+                kept.insert(kept.end(),
+                            data.begin() +  i      * chunkSize,
+                            data.begin() + (i + 1) * chunkSize);
+
+        data.swap(kept);
+    }
 }
@@ -118,34 +118,49 @@ void RigidObjectVector::_checkpointObjectData(MPI_Comm comm, std::string path)
     ids         ->downloadFromDevice(0, ContainersSynch::Asynch);
     motions     ->downloadFromDevice(0, ContainersSynch::Synch);
     
-    auto positions = std::make_shared<std::vector<float>>();
-    std::vector<RigidReal4> quaternion;
-    std::vector<RigidReal3> vel, omega, force, torque;
-    
-    splitMotions(domain, *motions, *positions, quaternion, vel, omega, force, torque);
-
-    XDMF::VertexGrid grid(positions, comm);    
+    // Host snapshot, owned by the write job
+    struct Snapshot
+    {
+        std::shared_ptr<std::vector<float>> positions = std::make_shared<std::vector<float>>();
+        std::vector<int> ids;
+        std::vector<RigidReal4> quaternion;
+        std::vector<RigidReal3> vel, omega, force, torque;
+    };
+    auto s = std::make_shared<Snapshot>();
+
+    s->ids.assign(ids->begin(), ids->end());
+    splitMotions(domain, *motions, *s->positions, s->quaternion, s->vel, s->omega, s->force, s->torque);
+
+    auto ovName = name;
+    auto compression = checkpointCompression;
+    _writeCheckpoint(comm, [=] (MPI_Comm comm) {
+        XDMF::VertexGrid grid(s->positions, comm);
+        grid.setPositionCompression(XDMF::compressionOf("position", compression));
+        // Same blocks as the particles: all the local objects in one
+        grid.setBlocks({s->positions->size() / 3});
 
 #ifdef RIGID_MOTIONS_DOUBLE
-    auto rigidType = XDMF::Channel::Datatype::Double;
+        auto rigidType = XDMF::Channel::Datatype::Double;
 #else
-    auto rigidType = XDMF::Channel::Datatype::Float;
+        auto rigidType = XDMF::Channel::Datatype::Float;
 #endif
 
-    std::vector<XDMF::Channel> channels = {
-        XDMF::Channel( "ids",        ids       ->data(), XDMF::Channel::Type::Scalar,     XDMF::Channel::Datatype::Int ),
-        XDMF::Channel( "quaternion", quaternion .data(), XDMF::Channel::Type::Quaternion, rigidType ),
-        XDMF::Channel( "velocity",   vel        .data(), XDMF::Channel::Type::Vector,     rigidType ),
-        XDMF::Channel( "omega",      omega      .data(), XDMF::Channel::Type::Vector,     rigidType ),
-        XDMF::Channel( "force",      force      .data(), XDMF::Channel::Type::Vector,     rigidType ),
-        XDMF::Channel( "torque",     torque     .data(), XDMF::Channel::Type::Vector,     rigidType )
-    };         
-    
-    XDMF::write(filename, &grid, channels, comm);
+        std::vector<XDMF::Channel> channels = {
+            XDMF::Channel( "ids",        s->ids       .data(), XDMF::Channel::Type::Scalar,     XDMF::Channel::Datatype::Int ),
+            XDMF::Channel( "quaternion", s->quaternion.data(), XDMF::Channel::Type::Quaternion, rigidType ),
+            XDMF::Channel( "velocity",   s->vel       .data(), XDMF::Channel::Type::Vector,     rigidType ),
+            XDMF::Channel( "omega",      s->omega     .data(), XDMF::Channel::Type::Vector,     rigidType ),
+            XDMF::Channel( "force",      s->force     .data(), XDMF::Channel::Type::Vector,     rigidType ),
+            XDMF::Channel( "torque",     s->torque    .data(), XDMF::Channel::Type::Vector,     rigidType )
+        };
+        XDMF::applyCompression(channels, compression);
+
+        XDMF::write(filename, &grid, channels, comm);
 
-    restart_helpers::make_symlink(comm, path, name + ".obj", filename);
+        restart_helpers::make_symlink(comm, path, ovName + ".obj", filename);
 
-    debug("Checkpoint for object vector '%s' successfully written", name.c_str());
+        debug("Checkpoint for object vector '%s' successfully written", ovName.c_str());
+    });
 }
 
 static void shiftCoordinates(const DomainInfo& domain, std::vector<RigidMotion>& motions)
@@ -154,14 +169,14 @@ static void shiftCoordinates(const DomainInfo& domain, std::vector<RigidMotion>&
         m.r = make_rigidReal3( domain.global2local(make_float3(m.r)) );
 }
 
-void RigidObjectVector::_restartObjectData(MPI_Comm comm, std::string path, const std::vector<int>& map)
+void RigidObjectVector::_restartObjectData(MPI_Comm comm, std::string path, const RestartMap& map)
 {
     CUDA_Check( cudaDeviceSynchronize() );
 
     std::string filename = path + "/" + name + ".obj.xmf";
     info("Restarting rigid object vector %s from file %s", name.c_str(), filename.c_str());
 
-    XDMF::readRigidObjectData(filename, comm, this);
+    XDMF::readRigidObjectData(filename, comm, this, map.indexed ? &map.blocks : nullptr);
 
     auto loc_ids     = local()->extraPerObject.getData<int>("ids");
     auto loc_motions = local()->extraPerObject.getData<RigidMotion>("motions");
@@ -169,8 +184,8 @@ void RigidObjectVector::_restartObjectData(MPI_Comm comm, std::string path, cons
     std::vector<int>             ids(loc_ids    ->begin(), loc_ids    ->end());
     std::vector<RigidMotion> motions(loc_motions->begin(), loc_motions->end());
     
-    restart_helpers::exchangeData(comm, map, ids, 1);
-    restart_helpers::exchangeData(comm, map, motions, 1);
+    restart_helpers::redistribute(comm, map, ids, 1);
+    restart_helpers::redistribute(comm, map, motions, 1);
 
     shiftCoordinates(domain, motions);
     
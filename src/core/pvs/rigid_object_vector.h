@@ -43,7 +43,7 @@ protected:
                       std::shared_ptr<Mesh> mesh, const int nObjects = 0);
 
     void _checkpointObjectData(MPI_Comm comm, std::string path) override;
-    void _restartObjectData(MPI_Comm comm, std::string path, const std::vector<int>& map) override;
+    void _restartObjectData(MPI_Comm comm, std::string path, const RestartMap& map) override;
 };
 
 
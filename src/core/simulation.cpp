@@ -15,6 +15,7 @@
 #include <core/task_scheduler.h>
 #include <core/mpi/api.h>
 
+#include <core/utils/async_writer.h>
 #include <core/utils/folders.h>
 #include <core/utils/make_unique.h>
 #include <core/utils/restart_helpers.h>
@@ -28,7 +29,10 @@ Simulation::Simulation(int3 nranks3D, float3 globalDomainSize,
                        const MPI_Comm& comm, const MPI_Comm& interComm,
                        int globalCheckpointEvery, std::string checkpointFolder, bool gpuAwareMPI) :
 nranks3D(nranks3D), interComm(interComm),
-globalCheckpointEvery(globalCheckpointEvery), checkpointFolder(checkpointFolder), gpuAwareMPI(gpuAwareMPI)
+globalCheckpointEvery(globalCheckpointEvery), checkpointFolder(checkpointFolder), gpuAwareMPI(gpuAwareMPI),
+cellListOrdering(CellListOrdering::RowMajor),
+exchangeProtocol(ExchangeProtocol::SizesFirst),
+halfShellHalo(false)
 {
     int ranksArr[] = {nranks3D.x, nranks3D.y, nranks3D.z};
     int periods[] = {1, 1, 1};
@@ -40,9 +44,8 @@ globalCheckpointEvery(globalCheckpointEvery), checkpointFolder(checkpointFolder)
     
     rank3D = {coords[0], coords[1], coords[2]};
 
-    domain.globalSize = globalDomainSize;
-    domain.localSize = domain.globalSize / make_float3(nranks3D);
-    domain.globalStart = {domain.localSize.x * coords[0], domain.localSize.y * coords[1], domain.localSize.z * coords[2]};
+    decomposition = Decomposition(nranks3D, globalDomainSize);
+    domain = decomposition.createDomain(rank3D);
 
     createFoldersCollective(cartComm, checkpointFolder);
 
@@ -192,7 +195,11 @@ void Simulation::registerParticleVector(std::shared_ptr<ParticleVector> pv, std:
 
         auto pvPtr = pv.get();
         scheduler->addTask( task_checkpoint, [pvPtr, this] (cudaStream_t stream) {
+            if (checkpointWriter) checkpointWriter->begin();
+
             pvPtr->checkpoint(cartComm, checkpointFolder);
+
+            if (checkpointWriter) checkpointWriter->submit();
         }, checkpointEvery );
     }
 
@@ -236,6 +243,9 @@ void Simulation::registerInteraction(std::shared_ptr<Interaction> interaction)
     if (interactionMap.find(name) != interactionMap.end())
         die("More than one interaction is called %s", name.c_str());
 
+    if (halfShellHalo && interaction->computesStress())
+        die("Interaction '%s' computes stresses, which are not sent back with half-shell halos", name.c_str());
+
     interaction->setSimulation(this);
     if (restartStatus != RestartStatus::Anew)
         interaction->restart(cartComm, restartFolder);
@@ -433,6 +443,164 @@ void Simulation::applyObjectBelongingChecker(std::string checkerName,
 }
 
 
+void Simulation::setCellListOrdering(std::string ordering)
+{
+    if      (ordering == "rowmajor") cellListOrdering = CellListOrdering::RowMajor;
+    else if (ordering == "morton")   cellListOrdering = CellListOrdering::Morton;
+    else if (ordering == "hilbert")  cellListOrdering = CellListOrdering::Hilbert;
+    else
+        die("Unknown cell-list ordering '%s', expected 'rowmajor', 'morton' or 'hilbert'", ordering.c_str());
+
+    info("Cell-lists will use '%s' cell ordering", ordering.c_str());
+}
+
+void Simulation::setExchangeProtocol(std::string protocol)
+{
+    if      (protocol == "sizes_first")    exchangeProtocol = ExchangeProtocol::SizesFirst;
+    else if (protocol == "single_message") exchangeProtocol = ExchangeProtocol::SingleMessage;
+    else if (protocol == "aggregated")     exchangeProtocol = ExchangeProtocol::Aggregated;
+    else if (protocol == "neighbor")       exchangeProtocol = ExchangeProtocol::NeighborCollective;
+    else if (protocol == "shared_memory")  exchangeProtocol = ExchangeProtocol::SharedMemory;
+    else
+        die("Unknown exchange protocol '%s', expected 'sizes_first', 'single_message', 'aggregated', 'neighbor' or 'shared_memory'",
+            protocol.c_str());
+
+    info("MPI exchanges will use '%s' protocol", protocol.c_str());
+}
+
+void Simulation::setHalfShellHalo(bool halfShell)
+{
+    // Stresses of the halo particles are not sent back to their owners
+    if (halfShell)
+        for (auto& entry : interactionMap)
+            if (entry.second->computesStress())
+                die("Half-shell halos can't be used with interaction '%s' that computes stresses",
+                    entry.first.c_str());
+
+    halfShellHalo = halfShell;
+}
+
+void Simulation::setHaloCompression(std::string pvName, bool compress)
+{
+    auto pv = getPVbyNameOrDie(pvName);
+
+    if (dynamic_cast<ObjectVector*>(pv) != nullptr)
+        die("Halo compression is not supported for object vectors (asked for '%s')", pvName.c_str());
+
+    pv->compressedHalo = compress;
+}
+
+void Simulation::setDecomposition(const Decomposition& decomposition)
+{
+    bool beginning =  particleVectors    .empty() &&
+                      wallMap            .empty() &&
+                      interactionMap     .empty() &&
+                      integratorMap      .empty() &&
+                      bouncerMap         .empty() &&
+                      belongingCheckerMap.empty() &&
+                      plugins            .empty();
+
+    if (!beginning)
+        die("Tried to change the domain decomposition of partially initialized simulation! "
+            "Please only call setDecomposition() before registering anything");
+
+    if (decomposition.nranks3D.x != nranks3D.x || decomposition.nranks3D.y != nranks3D.y || decomposition.nranks3D.z != nranks3D.z)
+        die("Decomposition is for %d x %d x %d ranks, but running with %d x %d x %d",
+            decomposition.nranks3D.x, decomposition.nranks3D.y, decomposition.nranks3D.z,
+            nranks3D.x, nranks3D.y, nranks3D.z);
+
+    this->decomposition = decomposition;
+    domain = decomposition.createDomain(rank3D);
+
+    if (!decomposition.isUniform())
+        warn("Using non-uniform domain decomposition, grid-based outputs (e.g. average flow or wall SDF dumps) are not supported");
+
+    info("Domain decomposition changed, subdomain size is [%f %f %f], subdomain starts at [%f %f %f]",
+            domain.localSize.x,  domain.localSize.y,  domain.localSize.z,
+            domain.globalStart.x, domain.globalStart.y, domain.globalStart.z);
+}
+
+Decomposition Simulation::getDecomposition() const
+{
+    return decomposition;
+}
+
+void Simulation::setLoadBalancing(std::string metric, float relaxation, float minSize)
+{
+    if      (metric == "none")      loadMetric = LoadMetric::None;
+    else if (metric == "particles") loadMetric = LoadMetric::Particles;
+    else if (metric == "time")      loadMetric = LoadMetric::Time;
+    else
+        die("Unknown load balancing metric '%s', expected 'none', 'particles' or 'time'", metric.c_str());
+
+    if (relaxation <= 0.0f || relaxation > 1.0f)
+        die("Load balancing relaxation should be in (0, 1], got %f", relaxation);
+
+    if (loadMetric != LoadMetric::None && globalCheckpointEvery <= 0)
+        warn("Load balancing is only done at global checkpoints, but they are disabled");
+
+    balanceRelaxation = relaxation;
+    balanceMinSize    = minSize;
+}
+
+void Simulation::setTaskExecutor(std::string executor, int nthreads)
+{
+    if (executor == "streams")
+        scheduler->setExecutor(TaskScheduler::Executor::Streams);
+    else if (executor == "threads")
+    {
+        int provided;
+        MPI_Check( MPI_Query_thread(&provided) );
+        if (provided < MPI_THREAD_MULTIPLE)
+        {
+            warn("MPI library doesn't provide MPI_THREAD_MULTIPLE, tasks will be executed on CUDA streams instead of threads");
+            scheduler->setExecutor(TaskScheduler::Executor::Streams);
+        }
+        else
+            scheduler->setExecutor(TaskScheduler::Executor::ThreadPool, nthreads);
+    }
+    else
+        die("Unknown task executor '%s', expected 'streams' or 'threads'", executor.c_str());
+}
+
+void Simulation::setCheckpointMode(std::string mode)
+{
+    if (mode == "sync")
+        checkpointWriter.reset();
+    else if (mode == "async")
+    {
+        int provided;
+        MPI_Check( MPI_Query_thread(&provided) );
+        if (provided < MPI_THREAD_MULTIPLE)
+        {
+            warn("MPI library doesn't provide MPI_THREAD_MULTIPLE, checkpoints will be written synchronously");
+            checkpointWriter.reset();
+        }
+        else if (!checkpointWriter)
+            checkpointWriter = std::make_unique<AsyncWriter>(cartComm);
+    }
+    else
+        die("Unknown checkpoint mode '%s', expected 'sync' or 'async'", mode.c_str());
+}
+
+AsyncWriter* Simulation::getCheckpointWriter() const
+{
+    return checkpointWriter.get();
+}
+
+void Simulation::setTracing(std::string path, int dumpEvery, int capacity)
+{
+    if (dumpEvery > 0 && path.find('/') != std::string::npos)
+        createFoldersCollective(cartComm, parentPath(path));
+
+    scheduler->setTracing(path + "_rank" + getStrZeroPadded(rank), rank, dumpEvery, capacity);
+}
+
+void Simulation::setAutoTaskPriorities(bool enabled, int measureSteps, float slackTolerance)
+{
+    scheduler->setAutoPriorities(enabled, measureSteps, slackTolerance);
+}
+
 void Simulation::prepareCellLists()
 {
     info("Preparing cell-lists");
@@ -488,6 +656,11 @@ void Simulation::prepareCellLists()
             
         }
     }
+
+    if (cellListOrdering != CellListOrdering::RowMajor)
+        for (auto& clVec : cellListMap)
+            for (auto& cl : clVec.second)
+                cl->setOrdering(cellListOrdering);
 }
 
 void Simulation::prepareInteractions()
@@ -524,6 +697,13 @@ void Simulation::prepareInteractions()
 
         auto inter = prototype.interaction;
 
+        // Cell-lists of the interactions computed on host are also built there
+        if (inter->getBackend() == ExecutionBackend::Host)
+        {
+            cl1->setBackend(ExecutionBackend::Host);
+            cl2->setBackend(ExecutionBackend::Host);
+        }
+
         regularInteractions.push_back([inter, pv1, pv2, cl1, cl2] (float t, cudaStream_t stream) {
             inter->regular(pv1, pv2, cl1, cl2, t, stream);
         });
@@ -628,6 +808,7 @@ void Simulation::init()
 
     auto redistImp    = std::make_unique<ParticleRedistributor>();
     auto haloImp      = std::make_unique<ParticleHaloExchanger>();
+    auto haloForcesImp = std::make_unique<ParticleForcesReverseExchanger>(haloImp.get());
     auto objRedistImp = std::make_unique<ObjectRedistributor>();
     auto objHaloImp   = std::make_unique<ObjectHaloExchanger>();
     auto objForcesImp = std::make_unique<ObjectForcesReverseExchanger>(objHaloImp.get());
@@ -642,8 +823,13 @@ void Simulation::init()
             {
                 auto cl = cellListMap[pvPtr][0].get();
 
+                pvPtr->halfShellHalo = halfShellHalo;
+
                 haloImp  ->attach(pvPtr, cl);
                 redistImp->attach(pvPtr, cl);
+
+                if (halfShellHalo)
+                    haloForcesImp->attach(pvPtr);
             }
             else
             {
@@ -664,13 +850,18 @@ void Simulation::init()
         makeEngine = [this] (std::unique_ptr<ParticleExchanger> exch) {
             return std::make_unique<SingleNodeEngine> (std::move(exch));
         };
+    else if (exchangeProtocol == ExchangeProtocol::NeighborCollective)
+        makeEngine = [this] (std::unique_ptr<ParticleExchanger> exch) {
+            return std::make_unique<NeighborExchangeEngine> (std::move(exch), cartComm, gpuAwareMPI);
+        };
     else
         makeEngine = [this] (std::unique_ptr<ParticleExchanger> exch) {
-            return std::make_unique<MPIExchangeEngine> (std::move(exch), cartComm, gpuAwareMPI);
+            return std::make_unique<MPIExchangeEngine> (std::move(exch), cartComm, gpuAwareMPI, exchangeProtocol);
         };
     
     redistributor   = makeEngine(std::move(redistImp));
     halo            = makeEngine(std::move(haloImp));
+    haloForces      = makeEngine(std::move(haloForcesImp));
     objRedistibutor = makeEngine(std::move(objRedistImp));
     objHalo         = makeEngine(std::move(objHaloImp));
     objHaloForces   = makeEngine(std::move(objForcesImp));
@@ -704,6 +895,8 @@ void Simulation::assemble()
     auto task_pluginsSerializeSend                = scheduler->createTask("Plugins: serialize and send");
     auto task_haloFinalize                        = scheduler->createTask("Halo finalize");
     auto task_haloForces                          = scheduler->createTask("Halo forces");
+    auto task_haloForcesInit                      = scheduler->createTask("Halo forces exchange: init");
+    auto task_haloForcesFinalize                  = scheduler->createTask("Halo forces exchange: finalize");
     auto task_accumulateForces                    = scheduler->createTask("Accumulate forces");
     auto task_pluginsBeforeIntegration            = scheduler->createTask("Plugins: before integration");
     auto task_objHaloInit                         = scheduler->createTask("Object halo init");
@@ -787,6 +980,17 @@ void Simulation::assemble()
         scheduler->addTask(task_redistributeFinalize, [this] (cudaStream_t stream) {
             redistributor->finalize(stream);
         });
+
+        if (halfShellHalo)
+        {
+            scheduler->addTask(task_haloForcesInit, [this] (cudaStream_t stream) {
+                haloForces->init(stream);
+            });
+
+            scheduler->addTask(task_haloForcesFinalize, [this] (cudaStream_t stream) {
+                haloForces->finalize(stream);
+            });
+        }
     }
 
 
@@ -930,6 +1134,8 @@ void Simulation::assemble()
     scheduler->addDependency(task_haloInit, {}, {task_pluginsBeforeForces});
     scheduler->addDependency(task_haloFinalize, {}, {task_haloInit});
     scheduler->addDependency(task_haloForces, {}, {task_haloFinalize});
+    scheduler->addDependency(task_haloForcesInit, {}, {task_haloForces});
+    scheduler->addDependency(task_haloForcesFinalize, {task_accumulateForces}, {task_haloForcesInit});
 
     scheduler->addDependency(task_accumulateForces, {task_integration}, {task_haloForces, task_localForces});
     scheduler->addDependency(task_pluginsBeforeIntegration, {task_integration}, {task_accumulateForces});
@@ -957,10 +1163,21 @@ void Simulation::assemble()
     scheduler->setHighPriority(task_haloInit);
     scheduler->setHighPriority(task_haloFinalize);
     scheduler->setHighPriority(task_haloForces);
+    scheduler->setHighPriority(task_haloForcesInit);
     scheduler->setHighPriority(task_pluginsSerializeSend);
 
     scheduler->setHighPriority(task_clearObjLocalForces);
     scheduler->setHighPriority(task_objLocalBounce);
+
+    // Tasks calling MPI are executed one at a time and in the same order on all the ranks
+    for (auto task : { scheduler->getTaskId("Checkpoint"),
+                       task_pluginsBeforeForces, task_pluginsSerializeSend, task_pluginsBeforeIntegration,
+                       task_pluginsAfterIntegration, task_pluginsBeforeParticlesDistribution,
+                       task_haloInit, task_haloFinalize, task_haloForcesInit, task_haloForcesFinalize,
+                       task_redistributeInit, task_redistributeFinalize,
+                       task_objHaloInit, task_objHaloFinalize, task_objForcesInit, task_objForcesFinalize,
+                       task_objRedistInit, task_objRedistFinalize, task_wallCheck })
+        scheduler->setOrdered(task);
     
     scheduler->compile();
 
@@ -990,6 +1207,19 @@ void Simulation::run(int nsteps)
     // Finish the redistribution by rebuilding the cell-lists
     scheduler->forceExec( scheduler->getTaskId("Build cell-lists"), 0 );
 
+    scheduler->logTimings();
+
+    // The last checkpoint has to be on disk when run() returns
+    if (checkpointWriter)
+    {
+        checkpointWriter->wait();
+        checkpointWriter->logTimings();
+    }
+
+    // Slack report with the durations measured over this run
+    if (scheduler->getAutoPriorities())
+        scheduler->updatePriorities();
+
     info("Finished with %d iterations", nsteps);
     MPI_Check( MPI_Barrier(cartComm) );
 
@@ -1001,7 +1231,13 @@ void Simulation::run(int nsteps)
         int dummy = -1;
         int tag = 424242;
 
-        MPI_Check( MPI_Send(&dummy, 1, MPI_INT, rank, tag, interComm) );
+        // Each postprocess task waits for all the simulation tasks it serves
+        int interRank, ncompute, npost;
+        MPI_Check( MPI_Comm_rank(interComm, &interRank) );
+        MPI_Check( MPI_Comm_size(interComm, &ncompute) );
+        MPI_Check( MPI_Comm_remote_size(interComm, &npost) );
+
+        MPI_Check( MPI_Send(&dummy, 1, MPI_INT, servingPostTask(interRank, ncompute, npost), tag, interComm) );
         debug("Sending stopping message to the postprocess");
     }
 }
@@ -1024,12 +1260,97 @@ void Simulation::restart(std::string folder)
     restartFolder = folder;
     
     TextIO::read(folder + "_simulation.state", currentTime, currentStep);
+
+    Decomposition restored = decomposition;
+    if (restored.read(folder + "_decomposition.txt"))
+        setDecomposition(restored);
+}
+
+double Simulation::measureLoad() const
+{
+    double load = 0;
+
+    if (loadMetric == LoadMetric::Particles)
+    {
+        for (auto& pv : particleVectors)
+            load += pv->local()->size();
+    }
+    else if (loadMetric == LoadMetric::Time)
+    {
+        // Communication tasks mostly wait for the slower neighbours, don't count them
+        for (auto& t : scheduler->getTimings())
+        {
+            if (t.nExecutions == 0 ||
+                t.label.find("init")     != std::string::npos ||
+                t.label.find("finalize") != std::string::npos ||
+                t.label == "Checkpoint")
+                continue;
+
+            load += t.totalWall / t.nExecutions;
+        }
+    }
+
+    return load;
+}
+
+Decomposition Simulation::balanceDecomposition() const
+{
+    const double load = measureLoad();
+    const int n[3] = {nranks3D.x, nranks3D.y, nranks3D.z};
+    const int coords[3] = {rank3D.x, rank3D.y, rank3D.z};
+
+    std::vector<double> slabLoads[3];
+    for (int d = 0; d < 3; d++)
+    {
+        slabLoads[d].resize(n[d], 0.0);
+        slabLoads[d][coords[d]] = load;
+        MPI_Check( MPI_Allreduce(MPI_IN_PLACE, slabLoads[d].data(), n[d], MPI_DOUBLE, MPI_SUM, cartComm) );
+    }
+
+    double maxLoad, totLoad;
+    int nranks;
+    MPI_Check( MPI_Allreduce(&load, &maxLoad, 1, MPI_DOUBLE, MPI_MAX, cartComm) );
+    MPI_Check( MPI_Allreduce(&load, &totLoad, 1, MPI_DOUBLE, MPI_SUM, cartComm) );
+    MPI_Check( MPI_Comm_size(cartComm, &nranks) );
+
+    if (totLoad > 0)
+        info("Load imbalance (max / mean load per rank) is %f", maxLoad * nranks / totLoad);
+
+    // Subdomains thinner than the largest cut-off radius cannot be handled by the cell-lists and exchangers
+    float minSize = balanceMinSize;
+    for (auto& prototype : interactionPrototypes)
+        minSize = std::max(minSize, prototype.rc);
+
+    return decomposition.balance(slabLoads, minSize, balanceRelaxation);
 }
 
 void Simulation::checkpoint()
 {
-    if (rank == 0)
-        TextIO::write(checkpointFolder + "_simulation.state", currentTime, currentStep);
+    // Waits until the previous asynchronous checkpoint is written
+    if (checkpointWriter) checkpointWriter->begin();
+
+    // Balanced decomposition is only applied on restart, when all the handlers are created again
+    Decomposition saved = decomposition;
+    if (loadMetric != LoadMetric::None)
+        saved = balanceDecomposition();
+    const bool saveDecomposition = loadMetric != LoadMetric::None || !decomposition.isUniform();
+
+    // With asynchronous checkpoints the state is written last,
+    // so that it never refers to an incomplete checkpoint
+    const bool master = rank == 0;
+    const std::string folder = checkpointFolder;
+    const double time = currentTime;
+    const int step = currentStep;
+
+    auto writeState = [master, folder, time, step, saved, saveDecomposition] (MPI_Comm comm) {
+        if (!master) return;
+
+        TextIO::write(folder + "_simulation.state", time, step);
+        if (saveDecomposition)
+            saved.write(folder + "_decomposition.txt");
+    };
+
+    if (!checkpointWriter) writeState(cartComm);
 
     CUDA_Check( cudaDeviceSynchronize() );
     
@@ -1057,6 +1378,12 @@ void Simulation::checkpoint()
         handler->checkpoint(cartComm, checkpointFolder);
     
     CUDA_Check( cudaDeviceSynchronize() );
+
+    if (checkpointWriter)
+    {
+        checkpointWriter->add(writeState);
+        checkpointWriter->submit();
+    }
 }
 
 
@@ -6,6 +6,7 @@
 #include <core/mpi/exchanger_interfaces.h>
 
 #include "domain.h"
+#include "decomposition.h"
 
 #include <tuple>
 #include <vector>
@@ -19,6 +20,8 @@ class ParticleVector;
 class ObjectVector;
 class CellList;
 class TaskScheduler;
+enum class CellListOrdering;
+enum class ExchangeProtocol;
 
 class Wall;
 class Interaction;
@@ -27,6 +30,7 @@ class InitialConditions;
 class Bouncer;
 class ObjectBelongingChecker;
 class SimulationPlugin;
+class AsyncWriter;
 
 
 class Simulation
@@ -69,6 +73,38 @@ public:
             std::string source, std::string inside, std::string outside,
             int checkEvery, int checkpointEvery=0);
 
+    /// Order of the cells of all the cell-lists: "rowmajor", "morton" or "hilbert"
+    void setCellListOrdering(std::string ordering);
+    void setExchangeProtocol(std::string protocol);
+    void setHalfShellHalo(bool halfShell);
+    void setHaloCompression(std::string pvName, bool compress);
+
+    /// Only before registering anything, same as restart()
+    void setDecomposition(const Decomposition& decomposition);
+    Decomposition getDecomposition() const;
+
+    /**
+     * Rebalance the subdomain boundaries at every checkpoint, using
+     * \p metric "particles" (local particle count) or "time" (busy time of the scheduler tasks).
+     * The new decomposition is saved with the checkpoint and used when restarting from it
+     */
+    void setLoadBalancing(std::string metric, float relaxation, float minSize);
+
+    /// How the task graph is executed: "streams" or "threads", see TaskScheduler::Executor
+    void setTaskExecutor(std::string executor, int nthreads);
+    void setTracing(std::string path, int dumpEvery, int capacity);
+    void setAutoTaskPriorities(bool enabled, int measureSteps, float slackTolerance);
+
+    /**
+     * "sync": checkpoints are written in the Checkpoint task (default),
+     * "async": the state is copied to the host and written by a background thread
+     * while the simulation continues, at most one checkpoint is in flight
+     */
+    void setCheckpointMode(std::string mode);
+
+    /// Background writer collecting the current checkpoint, nullptr if checkpoints are synchronous
+    AsyncWriter* getCheckpointWriter() const;
+
 
     void init();
     void run(int nsteps);
@@ -119,11 +155,27 @@ private:
     bool gpuAwareMPI;
     std::unique_ptr<ExchangeEngine> halo;
     std::unique_ptr<ExchangeEngine> redistributor;
+    std::unique_ptr<ExchangeEngine> haloForces;
 
     std::unique_ptr<ExchangeEngine> objHalo;
     std::unique_ptr<ExchangeEngine> objRedistibutor;
     std::unique_ptr<ExchangeEngine> objHaloForces;
 
+    CellListOrdering cellListOrdering;
+    ExchangeProtocol exchangeProtocol;
+    bool halfShellHalo;
+
+    Decomposition decomposition;
+
+    enum class LoadMetric
+    {
+        None, Particles, Time
+    };
+    LoadMetric loadMetric{LoadMetric::None};
+    float balanceRelaxation{1.0f}, balanceMinSize{0.0f};
+
+    std::unique_ptr<AsyncWriter> checkpointWriter;
+
     std::map<std::string, int> pvIdMap;
     std::vector< std::shared_ptr<ParticleVector> > particleVectors;
     std::vector< ObjectVector* >   objectVectors;
@@ -198,6 +250,9 @@ private:
     void prepareBouncers();
     void prepareWalls();
     void execSplitters();
+
+    double measureLoad() const;
+    Decomposition balanceDecomposition() const;
     
     void assemble();
 };
@@ -2,6 +2,8 @@
 #include <unistd.h>
 #include <sstream>
 #include <fstream>
+#include <algorithm>
+#include <iomanip>
 
 #include <core/task_scheduler.h>
 #include <core/logger.h>
@@ -12,6 +14,11 @@ TaskScheduler::TaskScheduler()
     CUDA_Check( cudaDeviceGetStreamPriorityRange(&cudaPriorityLow, &cudaPriorityHigh) );
 }
 
+TaskScheduler::~TaskScheduler()
+{
+    stopWorkers();
+}
+
 TaskScheduler::TaskID TaskScheduler::createTask(const std::string& label)
 {
     auto id = getTaskId(label);
@@ -92,6 +99,14 @@ void TaskScheduler::setHighPriority(TaskID id)
     tasks[id].priority = cudaPriorityHigh;
 }
 
+void TaskScheduler::setOrdered(TaskID id)
+{
+    if (id >= tasks.size() || id < 0)
+        die("No such task with id %d", id);
+
+    tasks[id].ordered = true;
+}
+
 void TaskScheduler::forceExec(TaskID id, cudaStream_t stream)
 {
     if (id >= tasks.size() || id < 0)
@@ -114,20 +129,13 @@ void TaskScheduler::createNodes()
 
         node->id = t.id;
         node->priority = t.priority;
+        node->ordered = t.ordered;
 
         nodes.push_back(std::move(node));
     }
 
     for (auto& n : nodes)
     {
-        // Set streams member according to priority
-        if      (n->priority == cudaPriorityLow)
-            n->streams = &streamsLo;
-        else if (n->priority == cudaPriorityHigh)
-            n->streams = &streamsHi;
-        else
-            n->streams = &streamsLo;
-
         // Set dependencies
         for (auto dep : tasks[n->id].before)
         {
@@ -245,28 +253,257 @@ void TaskScheduler::compile()
     removeEmptyNodes();
 
     logDepsGraph();
+
+    computeCriticalPath();
+    assignPriorities();
+    computeOrderedSequence();
+}
+
+void TaskScheduler::computeOrderedSequence()
+{
+    // Kahn's algorithm, the ready node with the smallest id goes first,
+    // such that the order only depends on the graph
+    auto compareIds = [] (Node* a, Node* b) { return a->id > b->id; };
+    std::priority_queue<Node*, std::vector<Node*>, decltype(compareIds)> S(compareIds);
+    std::unordered_map<Node*, int> nDeps;
+
+    for (auto& n : nodes)
+    {
+        nDeps[n.get()] = n->from_backup.size();
+        if (n->from_backup.empty())
+            S.push(n.get());
+    }
+
+    orderedNodes.clear();
+    while (!S.empty())
+    {
+        auto node = S.top();
+        S.pop();
+
+        if (node->ordered)
+            orderedNodes.push_back(node);
+
+        for (auto dep : node->to)
+            if (--nDeps[dep] == 0)
+                S.push(dep);
+    }
+
+    std::stringstream str;
+    for (auto node : orderedNodes)
+        str << "    " << tasks[node->id].label << std::endl;
+    debug("%d tasks are ordered and will be executed one at a time in the thread pool:\n%s",
+          (int)orderedNodes.size(), str.str().c_str());
+}
+
+void TaskScheduler::computeCriticalPath()
+{
+    // Only use measured durations if all the tasks were measured,
+    // otherwise the path length is the number of tasks
+    bool measured = true;
+    for (auto& n : nodes)
+        if (tasks[n->id].nTimed == 0) measured = false;
+
+    for (auto& n : nodes)
+    {
+        auto& task = tasks[n->id];
+        n->duration = measured ? task.totalWall / task.nTimed : 1.0;
+    }
+
+    // Topological order, Kahn's algorithm again
+    std::vector<Node*> order;
+    std::unordered_map<Node*, int> nDeps;
+    std::queue<Node*> S;
+
+    for (auto& n : nodes)
+    {
+        nDeps[n.get()] = n->from_backup.size();
+        if (n->from_backup.empty())
+            S.push(n.get());
+    }
+
+    while (!S.empty())
+    {
+        auto node = S.front();
+        S.pop();
+        order.push_back(node);
+
+        for (auto dep : node->to)
+            if (--nDeps[dep] == 0)
+                S.push(dep);
+    }
+
+    if (order.size() != nodes.size())
+        die("Task graph contains cycles, only %d out of %d tasks can be executed", (int)order.size(), (int)nodes.size());
+
+    for (auto node : order)
+    {
+        node->earliestStart = 0;
+        for (auto dep : node->from_backup)
+            node->earliestStart = std::max(node->earliestStart, dep->earliestStart + dep->duration);
+    }
+
+    criticalPathLength = 0;
+    for (auto it = order.rbegin(); it != order.rend(); it++)
+    {
+        auto node = *it;
+        double longestNext = 0;
+        for (auto dep : node->to)
+            longestNext = std::max(longestNext, dep->tail);
+
+        node->tail = node->duration + longestNext;
+        criticalPathLength = std::max(criticalPathLength, node->tail);
+    }
+
+    debug("Critical path of the task graph is %f %s long", criticalPathLength, measured ? "ms" : "tasks");
+}
+
+bool TaskScheduler::isCritical(const Node* node) const
+{
+    const double slack = criticalPathLength - node->earliestStart - node->tail;
+    return slack <= prioritySlackTolerance * criticalPathLength;
+}
+
+void TaskScheduler::assignPriorities()
+{
+    for (auto& n : nodes)
+    {
+        n->priority = tasks[n->id].priority;
+
+        if (autoPriorities && isCritical(n.get()))
+            n->priority = cudaPriorityHigh;
+
+        n->streams = n->priority == cudaPriorityHigh ? &streamsHi : &streamsLo;
+    }
+}
+
+void TaskScheduler::setAutoPriorities(bool enabled, int measureSteps, float slackTolerance)
+{
+    if (measureSteps < 0 || slackTolerance < 0.0f)
+        die("Wrong automatic priority parameters: %d measurement steps, slack tolerance %f", measureSteps, slackTolerance);
+
+    autoPriorities         = enabled;
+    priorityMeasureSteps   = measureSteps;
+    prioritySlackTolerance = slackTolerance;
+
+    if (!nodes.empty())
+        assignPriorities();
+}
+
+void TaskScheduler::updatePriorities()
+{
+    computeCriticalPath();
+    assignPriorities();
+    logSlacks();
 }
 
 
 
+void TaskScheduler::setExecutor(Executor executor, int nthreads)
+{
+    if (nthreads < 0)
+        die("Number of scheduler threads should be non-negative, got %d", nthreads);
+
+    if (nthreads == 0)
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+
+    stopWorkers();
+
+    this->executor = executor;
+    this->nthreads = nthreads;
+
+    if (executor == Executor::ThreadPool)
+        debug("Task graph will be executed by a pool of %d threads", nthreads);
+    else
+        debug("Task graph will be executed on CUDA streams");
+}
+
 void TaskScheduler::run()
+{
+    if (executor == Executor::ThreadPool)
+        runThreadPool();
+    else
+        runStreams();
+
+    nExecutions++;
+    CUDA_Check( cudaDeviceSynchronize() );
+
+    if (autoPriorities && nExecutions == priorityMeasureSteps)
+        updatePriorities();
+
+    if (traceDumpEvery > 0 && nExecutions % traceDumpEvery == 0)
+    {
+        std::ostringstream fname;
+        fname << tracePrefix << "_" << std::setw(8) << std::setfill('0') << nExecutions << ".json";
+        dumpTrace(fname.str());
+        traceHead = 0;
+    }
+}
+
+/// @return number of executed functions
+int TaskScheduler::execNode(Node* node, cudaStream_t stream)
+{
+    int nExecuted = 0;
+    for (auto& func_every : tasks[node->id].funcs)
+        if (nExecutions % func_every.second == 0)
+        {
+            func_every.first(stream);
+            nExecuted++;
+        }
+
+    return nExecuted;
+}
+
+void TaskScheduler::recordTiming(Node* node, Clock::time_point start, Clock::time_point end)
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    auto& task = tasks[node->id];
+
+    task.lastWall = ms(end - start).count();
+    task.lastWait = ms(start - node->readyTime).count();
+
+    task.totalWall += task.lastWall;
+    task.totalWait += task.lastWait;
+    task.nTimed++;
+}
+
+void TaskScheduler::recordTrace(Node* node, int64_t lane, int nExecuted, Clock::time_point start, Clock::time_point end)
+{
+    if (traceDumpEvery <= 0) return;
+
+    const int64_t slot = (traceHead++) % traceBuffer.size();
+    traceBuffer[slot] = { node->id, nExecutions, lane, nExecuted, (int)tasks[node->id].funcs.size(), start, end };
+}
+
+void TaskScheduler::runStreams()
 {
     // Kahn's algorithm
     // https://en.wikipedia.org/wiki/Topological_sorting
 
-    auto compareNodes = [] (Node* a, Node* b) {
+    auto compareNodes = [this] (Node* a, Node* b) {
         // lower number means higher priority
-        return a->priority < b->priority;
+        if (!autoPriorities)
+            return a->priority < b->priority;
+
+        // with automatic priorities the longest remaining path goes first
+        if (a->priority != b->priority)
+            return a->priority > b->priority;
+        return a->tail < b->tail;
     };
     std::priority_queue<Node*, std::vector<Node*>, decltype(compareNodes)> S(compareNodes);
     std::vector<std::pair<cudaStream_t, Node*>> workMap;
 
+    std::vector<Clock::time_point> startTimes(tasks.size());
+    std::vector<int> nExecuted(tasks.size());
+
     for (auto& n : nodes)
     {
         n->from = n->from_backup;
 
         if (n->from.empty())
+        {
+            n->readyTime = Clock::now();
             S.push(n.get());
+        }
     }
 
     int completed = 0;
@@ -285,6 +522,9 @@ void TaskScheduler::run()
                     auto node = streamNode_it->second;
 
                     debug("Completed group %s ", tasks[node->id].label.c_str());
+                    const auto end = Clock::now();
+                    recordTiming(node, startTimes[node->id], end);
+                    recordTrace (node, (int64_t)streamNode_it->first, nExecuted[node->id], startTimes[node->id], end);
 
                     // Return freed stream back to the corresponding queue
                     node->streams->push(streamNode_it->first);
@@ -296,7 +536,10 @@ void TaskScheduler::run()
                         {
                             dep->from.remove(node);
                             if (dep->from.empty())
+                            {
+                                dep->readyTime = Clock::now();
                                 S.push(dep);
+                            }
                         }
                     }
 
@@ -334,13 +577,373 @@ void TaskScheduler::run()
         debug("Executing group %s on stream %lld with priority %d", tasks[node->id].label.c_str(), (int64_t)stream, node->priority);
         workMap.push_back({stream, node});
 
-        for (auto& func_every : tasks[node->id].funcs)
-            if (nExecutions % func_every.second == 0)
-                func_every.first(stream);
+        startTimes[node->id] = Clock::now();
+        nExecuted[node->id] = execNode(node, stream);
     }
+}
 
-    nExecutions++;
-    CUDA_Check( cudaDeviceSynchronize() );
+//=================================================================================
+// Thread pool executor
+//=================================================================================
+
+void TaskScheduler::startWorkers()
+{
+    if (!workers.empty()) return;
+
+    int device;
+    CUDA_Check( cudaGetDevice(&device) );
+
+    stopping = false;
+    for (int i = 0; i < nthreads; i++)
+    {
+        auto worker = std::make_unique<Worker>();
+        CUDA_Check( cudaStreamCreateWithPriority(&worker->streamLo, cudaStreamNonBlocking, cudaPriorityLow)  );
+        CUDA_Check( cudaStreamCreateWithPriority(&worker->streamHi, cudaStreamNonBlocking, cudaPriorityHigh) );
+        workers.push_back(std::move(worker));
+    }
+
+    // Start the threads only when all the workers exist, they will steal from each other
+    for (int i = 0; i < nthreads; i++)
+        workers[i]->thread = std::thread(&TaskScheduler::workerLoop, this, i, device);
+}
+
+void TaskScheduler::stopWorkers()
+{
+    if (workers.empty()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+
+    for (auto& worker : workers)
+    {
+        worker->thread.join();
+        CUDA_Check( cudaStreamDestroy(worker->streamLo) );
+        CUDA_Check( cudaStreamDestroy(worker->streamHi) );
+    }
+
+    workers.clear();
+}
+
+void TaskScheduler::pushReady(Node* node, int workerId)
+{
+    node->readyTime = Clock::now();
+
+    // Ordered nodes wait for their turn
+    if (node->ordered)
+    {
+        releaseOrdered(workerId);
+        return;
+    }
+
+    queueReady(node, workerId);
+}
+
+void TaskScheduler::queueReady(Node* node, int workerId)
+{
+    if (node->priority == cudaPriorityHigh && cudaPriorityHigh != cudaPriorityLow)
+    {
+        std::lock_guard<std::mutex> lock(highPriorityMutex);
+        highPriorityReady.push_back(node);
+    }
+    else
+    {
+        auto& worker = *workers[workerId];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.ready.push_back(node);
+    }
+
+    nQueued++;
+
+    // Taking the lock makes sure that no worker misses the notification
+    { std::lock_guard<std::mutex> lock(poolMutex); }
+    workAvailable.notify_one();
+}
+
+/**
+ * Queue the next ordered node if all its dependencies are done
+ * and the previous ordered node has completed
+ */
+void TaskScheduler::releaseOrdered(int workerId)
+{
+    Node* node = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(orderedMutex);
+
+        if (orderedInFlight || nextOrdered >= (int)orderedNodes.size()) return;
+        if (orderedNodes[nextOrdered]->nDepsLeft > 0) return;
+
+        node = orderedNodes[nextOrdered++];
+        orderedInFlight = true;
+    }
+
+    queueReady(node, workerId);
+}
+
+TaskScheduler::Node* TaskScheduler::popReady(int workerId)
+{
+    Node* node = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(highPriorityMutex);
+        if (!highPriorityReady.empty())
+        {
+            node = highPriorityReady.front();
+            highPriorityReady.pop_front();
+        }
+    }
+
+    // Own queue, most recent first
+    if (node == nullptr)
+    {
+        auto& worker = *workers[workerId];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.ready.empty())
+        {
+            node = worker.ready.back();
+            worker.ready.pop_back();
+        }
+    }
+
+    // Steal the oldest work from the others
+    for (int i = 1; i < nthreads && node == nullptr; i++)
+    {
+        auto& victim = *workers[ (workerId + i) % nthreads ];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.ready.empty())
+        {
+            node = victim.ready.front();
+            victim.ready.pop_front();
+        }
+    }
+
+    if (node != nullptr) nQueued--;
+    return node;
+}
+
+void TaskScheduler::workerLoop(int workerId, int device)
+{
+    CUDA_Check( cudaSetDevice(device) );
+    auto& worker = *workers[workerId];
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            workAvailable.wait(lock, [this] () { return nQueued > 0 || stopping; });
+
+            if (stopping) return;
+        }
+
+        Node* node = popReady(workerId);
+        if (node == nullptr) continue;
+
+        const cudaStream_t stream = node->priority == cudaPriorityHigh ? worker.streamHi : worker.streamLo;
+
+        debug("Worker %d executing group %s", workerId, tasks[node->id].label.c_str());
+
+        const auto start = Clock::now();
+        const int nExecuted = execNode(node, stream);
+        CUDA_Check( cudaStreamSynchronize(stream) );
+        const auto end = Clock::now();
+
+        recordTiming(node, start, end);
+        recordTrace (node, workerId, nExecuted, start, end);
+
+        if (node->ordered)
+        {
+            {
+                std::lock_guard<std::mutex> lock(orderedMutex);
+                orderedInFlight = false;
+            }
+            releaseOrdered(workerId);
+        }
+
+        // Owner takes the most recent node, so push the one with the longest remaining path last
+        std::vector<Node*> nowReady;
+        for (auto dep : node->to)
+            if (--dep->nDepsLeft == 0)
+                nowReady.push_back(dep);
+
+        std::sort(nowReady.begin(), nowReady.end(), [] (Node* a, Node* b) { return a->tail < b->tail; });
+        for (auto dep : nowReady)
+            pushReady(dep, workerId);
+
+        if (++nCompleted == (int)nodes.size())
+        {
+            { std::lock_guard<std::mutex> lock(poolMutex); }
+            stepCompleted.notify_all();
+        }
+    }
+}
+
+void TaskScheduler::runThreadPool()
+{
+    startWorkers();
+
+    nCompleted = 0;
+    for (auto& n : nodes)
+        n->nDepsLeft = n->from_backup.size();
+
+    nextOrdered = 0;
+    orderedInFlight = false;
+
+    if (nodes.empty()) return;
+
+    std::vector<Node*> sources;
+    for (auto& n : nodes)
+        if (n->from_backup.empty())
+            sources.push_back(n.get());
+
+    std::sort(sources.begin(), sources.end(), [] (Node* a, Node* b) { return a->tail > b->tail; });
+
+    int workerId = 0;
+    for (auto n : sources)
+    {
+        pushReady(n, workerId);
+        workerId = (workerId + 1) % nthreads;
+    }
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+    stepCompleted.wait(lock, [this] () { return nCompleted == (int)nodes.size(); });
+}
+
+std::vector<TaskScheduler::TaskTiming> TaskScheduler::getTimings() const
+{
+    std::vector<TaskTiming> timings;
+
+    for (auto& n : nodes)
+    {
+        auto& t = tasks[n->id];
+        timings.push_back({t.label, t.nTimed, t.lastWall, t.lastWait, t.totalWall, t.totalWait});
+    }
+
+    return timings;
+}
+
+void TaskScheduler::logTimings() const
+{
+    auto timings = getTimings();
+    std::sort(timings.begin(), timings.end(), [] (const TaskTiming& a, const TaskTiming& b) {
+        return a.totalWall > b.totalWall;
+    });
+
+    std::stringstream str;
+    str << "Task timings (mean over executions, ms):" << std::endl;
+    for (auto& t : timings)
+    {
+        const int n = std::max(t.nExecutions, 1);
+        str << "    " << t.label << ":  wall " << t.totalWall / n << ",  queue wait " << t.totalWait / n << std::endl;
+    }
+
+    info("%s", str.str().c_str());
+}
+
+std::vector<TaskScheduler::TaskSlack> TaskScheduler::getSlacks() const
+{
+    std::vector<TaskSlack> slacks;
+
+    for (auto& n : nodes)
+    {
+        const double slack = criticalPathLength - n->earliestStart - n->tail;
+        slacks.push_back({tasks[n->id].label, n->duration, n->earliestStart, n->tail, slack, isCritical(n.get())});
+    }
+
+    return slacks;
+}
+
+void TaskScheduler::logSlacks() const
+{
+    auto slacks = getSlacks();
+    std::sort(slacks.begin(), slacks.end(), [] (const TaskSlack& a, const TaskSlack& b) {
+        return a.slack < b.slack;
+    });
+
+    std::stringstream str;
+    str << "Task graph critical path is " << criticalPathLength << " long, task slacks:" << std::endl;
+    for (auto& s : slacks)
+        str << "    " << (s.critical ? "* " : "  ") << s.label << ":  duration " << s.duration
+            << ",  earliest start " << s.earliestStart << ",  slack " << s.slack << std::endl;
+
+    info("%s", str.str().c_str());
+}
+
+void TaskScheduler::setTracing(std::string prefix, int pid, int dumpEvery, int capacity)
+{
+    if (dumpEvery < 0 || capacity <= 0)
+        die("Wrong tracing parameters: dump every %d steps, buffer of %d events", dumpEvery, capacity);
+
+    tracePrefix    = prefix;
+    tracePid       = pid;
+    traceDumpEvery = dumpEvery;
+
+    traceBuffer.resize(dumpEvery > 0 ? capacity : 0);
+    traceHead = 0;
+
+    traceEpoch      = std::chrono::system_clock::now();
+    traceClockEpoch = Clock::now();
+}
+
+void TaskScheduler::dumpTrace(std::string fname) const
+{
+    using us = std::chrono::duration<double, std::micro>;
+
+    const int64_t head  = traceHead;
+    const int64_t size  = traceBuffer.size();
+    const int64_t first = std::max((int64_t)0, head - size);
+
+    if (head > size)
+        warn("Trace buffer overflowed, %lld oldest events are lost", (long long)(head - size));
+
+    // Timestamps are microseconds of the wall clock, so that different ranks can be aligned
+    const double epoch = std::chrono::duration_cast<std::chrono::microseconds>(traceEpoch.time_since_epoch()).count();
+    auto timestamp = [&] (Clock::time_point t) {
+        return epoch + us(t - traceClockEpoch).count();
+    };
+
+    // Streams have meaningless huge handles, use small lane ids instead
+    std::unordered_map<int64_t, int> laneIds;
+
+    std::ofstream fout(fname);
+    fout << std::fixed << std::setprecision(3);
+    fout << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+
+    bool firstEvent = true;
+    for (int64_t i = first; i < head; i++)
+    {
+        auto& ev = traceBuffer[i % size];
+
+        auto it = laneIds.find(ev.lane);
+        if (it == laneIds.end())
+            it = laneIds.insert({ev.lane, (int)laneIds.size()}).first;
+
+        if (!firstEvent) fout << ",\n";
+        firstEvent = false;
+
+        fout << "  {\"name\": \"" << tasks[ev.id].label << "\", \"cat\": \"task\", \"ph\": \"X\""
+             << ", \"ts\": "  << timestamp(ev.start)
+             << ", \"dur\": " << us(ev.end - ev.start).count()
+             << ", \"pid\": " << tracePid << ", \"tid\": " << it->second
+             << ", \"args\": {\"step\": " << ev.step
+             << ", \"executed\": " << ev.nExecuted << ", \"functions\": " << ev.nFuncs << "}}";
+    }
+
+    const std::string laneName = executor == Executor::ThreadPool ? "worker " : "stream ";
+    for (auto& lane : laneIds)
+    {
+        if (!firstEvent) fout << ",\n";
+        firstEvent = false;
+
+        fout << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << tracePid << ", \"tid\": " << lane.second
+             << ", \"args\": {\"name\": \"" << laneName << lane.second << "\"}}";
+    }
+
+    fout << "\n]}\n";
+
+    debug("Dumped %lld task events to the trace file '%s'", (long long)(head - first), fname.c_str());
 }
 
 // TODO: use pugixml
@@ -10,8 +10,14 @@
 #include <functional>
 #include <list>
 #include <queue>
+#include <deque>
 #include <unordered_map>
 #include <memory>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #include <cuda_runtime.h>
 
@@ -23,7 +29,45 @@ public:
     
     static const TaskID invalidTaskId = (TaskID) -1;
 
+    /**
+     * How the compiled task graph is executed
+     *
+     * Streams: tasks are launched from the calling thread, each on its own
+     * CUDA stream, and completion is polled with cudaStreamQuery().
+     *
+     * ThreadPool: tasks are executed by a fixed pool of host worker threads
+     * with work-stealing queues. Each worker synchronizes its CUDA stream
+     * after the task, so host work of independent tasks (e.g. halo exchange
+     * and local forces) runs concurrently. Tasks marked with setOrdered()
+     * are executed one at a time in a fixed order, see there
+     */
+    enum class Executor { Streams, ThreadPool };
+
+    /// Time spent by a task, all the times are in milliseconds
+    struct TaskTiming
+    {
+        std::string label;
+        int nExecutions;
+        double lastWall, lastWait;    ///< execution time and time between being ready and started, last time-step
+        double totalWall, totalWait;  ///< same, summed over all executions
+    };
+
+    /**
+     * Position of a task with respect to the critical path of the graph.
+     * Times are in milliseconds if the tasks were timed, otherwise every task costs 1
+     */
+    struct TaskSlack
+    {
+        std::string label;
+        double duration;
+        double earliestStart;  ///< longest path from the graph sources to the task
+        double tail;           ///< longest path from the task start to the graph sinks
+        double slack;          ///< how much the task can be delayed without lengthening the step
+        bool critical;
+    };
+
     TaskScheduler();
+    ~TaskScheduler();
 
     TaskID createTask     (const std::string& label);
     TaskID getTaskId      (const std::string& label);
@@ -33,22 +77,82 @@ public:
     void addDependency(TaskID id, std::vector<TaskID> before, std::vector<TaskID> after);
     void setHighPriority(TaskID id);
 
+    /**
+     * Mark the task as ordered. With Executor::ThreadPool the ordered tasks
+     * never run concurrently with each other, and are started in the same
+     * topological order at every execution of the graph: ties are broken by
+     * the task ids, so identical graphs give identical orders on all the ranks.
+     * Tasks issuing MPI calls have to be ordered, otherwise the per-rank order
+     * of collective calls would depend on the work stealing.
+     *
+     * Has no effect with Executor::Streams, where all the tasks are launched
+     * from the calling thread
+     */
+    void setOrdered(TaskID id);
+
+    /**
+     * Choose the executor, see Executor
+     * @param nthreads number of worker threads for Executor::ThreadPool,
+     *        0 means the number of hardware threads
+     */
+    void setExecutor(Executor executor, int nthreads = 0);
+
+    /**
+     * Derive task priorities from the critical path of the graph instead of
+     * relying on setHighPriority() only. Tasks whose slack is within
+     * \p slackTolerance of the critical path length get high priority, and
+     * among the ready tasks the ones with the longest path to the end of
+     * the graph are launched first. Tasks marked with setHighPriority() keep
+     * high priority.
+     *
+     * Priorities are computed in compile() with unit task costs and
+     * recomputed from the measured durations after \p measureSteps executions
+     */
+    void setAutoPriorities(bool enabled, int measureSteps = 10, float slackTolerance = 0.05f);
+    bool getAutoPriorities() const { return autoPriorities; }
+    void updatePriorities();
+
     void compile();
     void run();
+
+    std::vector<TaskTiming> getTimings() const;
+    void logTimings() const;
+
+    std::vector<TaskSlack> getSlacks() const;
+    void logSlacks() const;
+
+    /**
+     * Record start and end of every executed task into a ring buffer and dump
+     * it in Chrome trace format (viewable with chrome://tracing or Perfetto)
+     * to the file <prefix>_<step>.json every \p dumpEvery executions of the graph
+     *
+     * @param prefix file name prefix, typically contains the rank
+     * @param pid process id in the trace, typically the rank
+     * @param dumpEvery dump period in time-steps, 0 disables tracing
+     * @param capacity size of the ring buffer, older events are overwritten
+     */
+    void setTracing(std::string prefix, int pid, int dumpEvery, int capacity = 100000);
+    void dumpTrace(std::string fname) const;
     void saveDependencyGraph_GraphML(std::string fname) const;
 
     void forceExec(TaskID id, cudaStream_t stream);
 
 private:
 
+    using Clock = std::chrono::steady_clock;
+
     struct Task
     {
         std::string label;
         TaskID id;
         int priority;
+        bool ordered;
 
         std::vector< std::pair<Function, int> > funcs;
         std::vector<TaskID> before, after;
+
+        int nTimed;
+        double lastWall, lastWait, totalWall, totalWait;
     };
 
     struct Node;
@@ -59,7 +163,32 @@ private:
         std::list<Node*> to, from, from_backup;
 
         int priority;
+        bool ordered{false};
         std::queue<cudaStream_t>* streams;
+
+        std::atomic<int> nDepsLeft{0};  ///< used by the thread pool instead of #from
+
+        double duration, earliestStart, tail;  ///< see TaskSlack
+        Clock::time_point readyTime;
+    };
+
+    /// One task execution in the trace
+    struct TraceEvent
+    {
+        TaskID id;
+        int step;
+        int64_t lane;             ///< CUDA stream or worker thread
+        int nExecuted, nFuncs;    ///< functions executed with respect to execEvery out of total
+        Clock::time_point start, end;
+    };
+
+    /// Worker of the thread pool, owns a deque of ready nodes
+    struct Worker
+    {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<Node*> ready;  ///< owner works at the back, thieves steal from the front
+        cudaStream_t streamLo, streamHi;
     };
 
     std::vector<Task> tasks;
@@ -72,6 +201,36 @@ private:
 
     int nExecutions{0};
 
+    Executor executor{Executor::Streams};
+
+    bool autoPriorities{false};
+    int priorityMeasureSteps{10};
+    float prioritySlackTolerance{0.05f};
+    double criticalPathLength{0};
+    int nthreads{0};
+
+    std::vector< std::unique_ptr<Worker> > workers;
+
+    std::mutex highPriorityMutex;
+    std::deque<Node*> highPriorityReady;  ///< high priority nodes are taken before any other
+
+    std::vector<Node*> orderedNodes;  ///< ordered nodes in the order of execution, see setOrdered()
+    std::mutex orderedMutex;
+    int nextOrdered{0};               ///< next ordered node to be released in the current step
+    bool orderedInFlight{false};      ///< an ordered node is queued or running
+
+    std::mutex poolMutex;
+    std::condition_variable workAvailable, stepCompleted;
+    std::atomic<int> nQueued{0}, nCompleted{0};
+    bool stopping{false};
+
+    std::string tracePrefix;
+    int tracePid{0}, traceDumpEvery{0};
+    std::vector<TraceEvent> traceBuffer;
+    std::atomic<int64_t> traceHead{0};
+    std::chrono::system_clock::time_point traceEpoch;  ///< wall clock corresponding to #traceClockEpoch
+    Clock::time_point traceClockEpoch;
+
     std::unordered_map<std::string, TaskID> label2taskId;
 
     Node* getNode     (TaskID id);
@@ -81,4 +240,24 @@ private:
     void removeEmptyNodes();
     void logDepsGraph();
 
+    void computeCriticalPath();
+    void assignPriorities();
+    bool isCritical(const Node* node) const;
+    void computeOrderedSequence();
+
+    int  execNode(Node* node, cudaStream_t stream);
+    void recordTiming(Node* node, Clock::time_point start, Clock::time_point end);
+    void recordTrace(Node* node, int64_t lane, int nExecuted, Clock::time_point start, Clock::time_point end);
+
+    void runStreams();
+    void runThreadPool();
+
+    void startWorkers();
+    void stopWorkers();
+    void workerLoop(int workerId, int device);
+    void pushReady(Node* node, int workerId);
+    void queueReady(Node* node, int workerId);
+    Node* popReady(int workerId);
+    void releaseOrdered(int workerId);
+
 };
@@ -0,0 +1,117 @@
+#include "async_writer.h"
+
+#include <core/logger.h>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+AsyncWriter::AsyncWriter(MPI_Comm comm)
+{
+    int provided;
+    MPI_Check( MPI_Query_thread(&provided) );
+    if (provided < MPI_THREAD_MULTIPLE)
+        die("Asynchronous writer needs MPI_THREAD_MULTIPLE, but MPI library only provides level %d", provided);
+
+    MPI_Check( MPI_Comm_dup(comm, &this->comm) );
+
+    thread = std::thread(&AsyncWriter::writerLoop, this);
+}
+
+AsyncWriter::~AsyncWriter()
+{
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    cv.notify_all();
+    thread.join();
+
+    MPI_Check( MPI_Comm_free(&comm) );
+}
+
+void AsyncWriter::begin()
+{
+    stallStart = Clock::now();
+
+    wait();
+    totalWait += msSince(stallStart);
+
+    collecting.clear();
+}
+
+void AsyncWriter::add(Job job)
+{
+    collecting.push_back(std::move(job));
+}
+
+void AsyncWriter::submit()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::swap(inFlight, collecting);
+        busy = true;
+        nBatches++;
+    }
+    cv.notify_all();
+
+    const double stall = msSince(stallStart);
+    totalStall += stall;
+
+    debug("Checkpoint snapshot took %f ms, writing it in the background", stall);
+}
+
+void AsyncWriter::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] () { return !busy; });
+}
+
+void AsyncWriter::logTimings() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (nBatches == 0) return;
+
+    info("Asynchronous checkpoints: %d submitted, simulation blocked for %.3f ms on average "
+         "(%.3f ms waiting for the previous one), writing took %.3f ms on average (last %.3f ms)",
+         nBatches, totalStall / nBatches, totalWait / nBatches,
+         nWritten > 0 ? totalWrite / nWritten : 0.0, lastWrite);
+}
+
+void AsyncWriter::writerLoop()
+{
+    while (true)
+    {
+        std::vector<Job> jobs;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] () { return busy || quit; });
+
+            if (!busy && quit) return;
+            std::swap(jobs, inFlight);
+        }
+
+        auto start = Clock::now();
+        for (auto& job : jobs)
+            job(comm);
+        const double elapsed = msSince(start);
+
+        debug("Background checkpoint written in %f ms", elapsed);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            totalWrite += elapsed;
+            lastWrite   = elapsed;
+            nWritten++;
+            busy = false;
+        }
+        cv.notify_all();
+    }
+}
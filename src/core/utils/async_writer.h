@@ -0,0 +1,68 @@
+#pragma once
+
+#include <mpi.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Executes batches of I/O jobs (e.g. collective XDMF writes of a checkpoint)
+ * on a background thread, so that the simulation keeps going while the
+ * files are being written.
+ *
+ * A batch is opened with begin(), filled with add() and handed to the thread
+ * with submit(). At most one batch is in flight: begin() blocks until the
+ * previous one is completely written, so that the host snapshots are never
+ * overwritten and the checkpoints are finished in order.
+ *
+ * Jobs receive a private duplicate of the communicator, and have to be added
+ * in the same order on all the ranks as they may be collective.
+ * MPI has to support MPI_THREAD_MULTIPLE.
+ */
+class AsyncWriter
+{
+public:
+    using Job = std::function<void(MPI_Comm)>;
+
+    /// Collective over \p comm
+    AsyncWriter(MPI_Comm comm);
+
+    /// Waits for the last batch to be written
+    ~AsyncWriter();
+
+    /// Start collecting a new batch, waiting for the previous one if it's still being written
+    void begin();
+
+    /// Job will be executed on the background thread after submit()
+    void add(Job job);
+
+    /// Hand the jobs added since begin() to the background thread
+    void submit();
+
+    /// Block until the submitted batch is written
+    void wait();
+
+    /// Log the mean time the simulation was blocked and the mean time spent writing
+    void logTimings() const;
+
+private:
+    MPI_Comm comm;
+
+    std::thread thread;
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+
+    std::vector<Job> collecting, inFlight;
+    bool busy{false}, quit{false};
+
+    // Stall is the time between begin() and submit(), including the wait for the previous batch
+    double totalStall{0}, totalWait{0}, totalWrite{0}, lastWrite{0};
+    int nBatches{0}, nWritten{0};
+    std::chrono::high_resolution_clock::time_point stallStart;
+
+    void writerLoop();
+};
@@ -302,7 +302,7 @@ __device__ inline int atomicAggInc(int *ctr)
 
 
 
-__device__ inline float fastPower(const float x, const float k)
+__device__ __host__ inline float fastPower(const float x, const float k)
 {
     if (fabsf(k - 1.0f)   < 1e-6f) return x;
     if (fabsf(k - 0.5f)   < 1e-6f) return sqrtf(fabsf(x));
@@ -312,6 +312,16 @@ __device__ inline float fastPower(const float x, const float k)
     return powf(fabsf(x), k);
 }
 
+/// Reciprocal square root that can also be called from the host code
+__device__ __host__ inline float invSqrt(const float x)
+{
+#ifdef __CUDA_ARCH__
+    return rsqrtf(x);
+#else
+    return 1.0f / sqrtf(x);
+#endif
+}
+
 #endif
 
 
@@ -30,9 +30,9 @@ float __fmaf_rz(float x, float y, float z)
 
 namespace Logistic
 {
-    __D__ float mean0var1( float seed, uint i, uint j );
-    __D__ float mean0var1( float seed, int i, int j );
-    __D__ float mean0var1( float seed, float i, float j );
+    __HD__ float mean0var1( float seed, uint i, uint j );
+    __HD__ float mean0var1( float seed, int i, int j );
+    __HD__ float mean0var1( float seed, float i, float j );
 }
 
 namespace Logistic
@@ -79,13 +79,19 @@ namespace Logistic
      *****************************************************************/
 
     // floating point version of LCG
-    inline __D__ float rem( float r ) {
+    inline __HD__ float rem( float r ) {
         return r - floorf( r );
     }
 
     // FMA wrapper for the convenience of switching rouding modes
-    inline __D__ float FMA( float x, float y, float z ) {
+    // Host version rounds to nearest, so the host and device streams
+    // of random numbers are NOT bitwise identical
+    inline __HD__ float FMA( float x, float y, float z ) {
+#ifdef __CUDA_ARCH__
         return __fmaf_rz( x, y, z );
+#else
+        return fmaf( x, y, z );
+#endif
     }
 
     // logistic rounds
@@ -115,7 +121,7 @@ namespace Logistic
     };
 
 #else
-    template<int N> inline __D__ float __logistic_core( float x )
+    template<int N> inline __HD__ float __logistic_core( float x )
     {
         float x2 = x * x;
         float r = FMA( FMA( 8.0, x2, -8.0 ), x2, 1.0 );
@@ -126,14 +132,14 @@ namespace Logistic
     };
 #endif
 
-    template<> inline __D__ float __logistic_core<1>( float x ) {
+    template<> inline __HD__ float __logistic_core<1>( float x ) {
         return FMA( 2.0 * x, x, -1.0 );
     }
     template<> struct __logistic_core_flops_counter<1> {
         const static unsigned long long FLOPS = 3;
     };
 
-    template<> inline __D__ float __logistic_core<0>( float x ) {
+    template<> inline __HD__ float __logistic_core<0>( float x ) {
         return x;
     }
     template<> struct __logistic_core_flops_counter<0> {
@@ -157,13 +163,13 @@ namespace Logistic
     // square root of 2
     const static float sqrt2 = 1.41421356237309514547;
 
-    inline __D__ float uniform01( float seed, int i, int j )
+    inline __HD__ float uniform01( float seed, int i, int j )
     {
         float val = mean0var1(seed, i, j) * (0.5f/sqrt2) + 0.5f;
         return max(0.0f, min(1.0f, val));
     }
 
-    inline __D__ float mean0var1( float seed, int u, int v )
+    inline __HD__ float mean0var1( float seed, int u, int v )
     {
         float p = rem( ( ( u & 0x3FF ) * gold ) + u * bronze + ( ( v & 0x3FF ) * silver ) + v * tin ); // safe for large u or v
         float q = rem( seed );
@@ -171,7 +177,7 @@ namespace Logistic
         return l * sqrt2;
     }
 
-    inline __D__ float mean0var1( float seed, uint u, uint v )
+    inline __HD__ float mean0var1( float seed, uint u, uint v )
     {
         // 7 FLOPS
         float p = rem( ( ( u & 0x3FFU ) * gold ) + u * bronze + ( ( v & 0x3FFU ) * silver ) + v * tin ); // safe for large u or v
@@ -186,7 +192,7 @@ namespace Logistic
         const static unsigned long long FLOPS = 9ULL + __logistic_core_flops_counter<N>::FLOPS;
     };
 
-    inline __D__ float mean0var1( float seed, float u, float v )
+    inline __HD__ float mean0var1( float seed, float u, float v )
     {
         float p = rem( sqrtf(u) * gold + sqrtf(v) * silver ); // Acknowledging Dmitry for the use of sqrtf
         float q = rem( seed );
@@ -195,7 +201,7 @@ namespace Logistic
         return l * sqrt2;
     }
 
-    inline __D__ float mean0var1_dual( float seed, float u, float v )
+    inline __HD__ float mean0var1_dual( float seed, float u, float v )
     {
         float p = rem( sqrtf(u) * gold + sqrtf(v) * silver ); // Acknowledging Dmitry for the use of sqrtf
         float q = rem( seed );
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <core/logger.h>
+
+#include <string>
+
+/**
+ * Where the computations of a simulation handler are performed
+ *
+ * Device is the default and only fully supported option,
+ * Host executes the work with OpenMP threads on the CPU
+ * (only available for some of the handlers)
+ */
+enum class ExecutionBackend
+{
+    Device, Host
+};
+
+/// @return human readable name of the backend
+inline std::string backendToString(ExecutionBackend backend)
+{
+    return backend == ExecutionBackend::Host ? "host" : "device";
+}
+
+/// Inverse of backendToString(), dies if the name is unknown
+inline ExecutionBackend backendFromString(std::string name)
+{
+    if (name == "device") return ExecutionBackend::Device;
+    if (name == "host")   return ExecutionBackend::Host;
+
+    die("Unknown execution backend '%s', expected 'device' or 'host'", name.c_str());
+    return ExecutionBackend::Device;
+}
@@ -78,6 +78,7 @@ namespace XDMF
             case Channel::Datatype::Float  : return H5T_NATIVE_FLOAT;
             case Channel::Datatype::Double : return H5T_NATIVE_DOUBLE;
             case Channel::Datatype::Int    : return H5T_NATIVE_INT;
+            case Channel::Datatype::Int64  : return H5T_NATIVE_INT64;
         }
     }
     
@@ -88,6 +89,7 @@ namespace XDMF
             case Channel::Datatype::Float  : return "Float";
             case Channel::Datatype::Double : return "Float";
             case Channel::Datatype::Int    : return "Int";
+            case Channel::Datatype::Int64  : return "Int";
         }
     }
 
@@ -98,6 +100,7 @@ namespace XDMF
             case Channel::Datatype::Float  : return sizeof(float);
             case Channel::Datatype::Double : return sizeof(double);
             case Channel::Datatype::Int    : return sizeof(int);
+            case Channel::Datatype::Int64  : return sizeof(int64_t);
         }
     }
     
@@ -105,7 +108,22 @@ namespace XDMF
     {
         if (precision == sizeof(float)  && str == "Float") return Channel::Datatype::Float;
         if (precision == sizeof(double) && str == "Float") return Channel::Datatype::Double;
-        if (precision == sizeof(int)    && str == "Int")   return Channel::Datatype::Int;
+        if (precision == sizeof(int)     && str == "Int")   return Channel::Datatype::Int;
+        if (precision == sizeof(int64_t) && str == "Int")   return Channel::Datatype::Int64;
         die("Datatype '%s' with precision %d is not supported for reading", str.c_str(), precision);
     }
+
+    Channel::Compression compressionOf(std::string channelName, const std::map<std::string, Channel::Compression>& byName)
+    {
+        auto it = byName.find(channelName);
+        if (it == byName.end()) it = byName.find("");
+
+        return it != byName.end() ? it->second : Channel::Compression();
+    }
+
+    void applyCompression(std::vector<Channel>& channels, const std::map<std::string, Channel::Compression>& byName)
+    {
+        for (auto& ch : channels)
+            ch.compression = compressionOf(ch.name, byName);
+    }
 }
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <map>
 #include <string>
+#include <vector>
 #include <hdf5.h>
 
 namespace XDMF
@@ -17,8 +19,24 @@ namespace XDMF
         
         enum class Datatype
         {
-            Float, Int, Double
+            Float, Int, Int64, Double
         } datatype;
+
+        /**
+         * HDF5 filters applied to the dataset of the channel.
+         * If any is enabled, the dataset is stored in chunks of about #chunkBytes
+         * split along the slowest dimension, the same on all ranks
+         */
+        struct Compression
+        {
+            bool shuffle{false};                ///< byte shuffle, helps the subsequent filters on floats
+            int deflate{0};                     ///< gzip level from 1 to 9, 0 disables deflate
+            unsigned codec{0};                  ///< id of a registered HDF5 filter plugin applied first, e.g. a lossless float codec; 0 disables
+            std::vector<unsigned> codecParams;  ///< passed to the codec as is
+            size_t chunkBytes{4 << 20};
+
+            bool enabled() const { return shuffle || deflate > 0 || codec != 0; }
+        } compression;
         
         Channel(std::string name, void *data, Type type, Datatype datatype = Datatype::Float);
         int nComponents() const;
@@ -37,4 +55,8 @@ namespace XDMF
     int                         datatypeToPrecision (Channel::Datatype dt);
 
     Channel::Datatype infoToDatatype(std::string str, int precision);
+
+    /// Compression of the channels is taken from \p byName, the entry with empty name applies to the channels not listed
+    void applyCompression(std::vector<Channel>& channels, const std::map<std::string, Channel::Compression>& byName);
+    Channel::Compression compressionOf(std::string channelName, const std::map<std::string, Channel::Compression>& byName);
 }
@@ -3,6 +3,9 @@
 #include "hdf5_helpers.h"
 
 #include <core/logger.h>
+#include <core/utils/helper_math.h>
+
+#include <cfloat>
 
 namespace XDMF
 {
@@ -131,6 +134,7 @@ namespace XDMF
     std::vector<hsize_t> VertexGrid::VertexGridDims::getLocalSize()  const {return {nlocal};}
     std::vector<hsize_t> VertexGrid::VertexGridDims::getGlobalSize() const {return {nglobal};}
     std::vector<hsize_t> VertexGrid::VertexGridDims::getOffsets()    const {return {offset, 0};}
+    std::vector<std::pair<hsize_t, hsize_t>> VertexGrid::VertexGridDims::getRanges() const {return ranges;}
 
     const VertexGrid::VertexGridDims* VertexGrid::getGridDims() const    { return &dims; }    
     std::string VertexGrid::getCentering() const                         { return "Node"; }    
@@ -139,8 +143,119 @@ namespace XDMF
     void VertexGrid::write_to_HDF5(hid_t file_id, MPI_Comm comm) const
     {
         Channel posCh(positionChannelName, (void*) positions->data(), Channel::Type::Vector);
+        posCh.compression = positionCompression;
         
         HDF5::writeDataSet(file_id, getGridDims(), posCh);
+
+        if (writeBlockIndex)
+            _writeBlockIndex(file_id, comm);
+    }
+
+    void VertexGrid::_writeBlockIndex(hid_t file_id, MPI_Comm comm) const
+    {
+        std::vector<float3> lower, upper;
+        std::vector<int64_t> offsets, blockSizes;
+        auto pos = (const float3*) positions->data();
+
+        hsize_t start = 0;
+        for (auto size : localBlockSizes)
+        {
+            // Empty blocks are not written, they can't overlap anything
+            if (size > 0)
+            {
+                float3 lo = make_float3( FLT_MAX);
+                float3 hi = make_float3(-FLT_MAX);
+
+                for (hsize_t i = start; i < start + size; i++)
+                {
+                    lo = fminf(lo, pos[i]);
+                    hi = fmaxf(hi, pos[i]);
+                }
+
+                lower.push_back(lo);
+                upper.push_back(hi);
+                offsets.push_back(dims.offset + start);
+                blockSizes.push_back(size);
+            }
+            start += size;
+        }
+
+        if (start != dims.nlocal)
+            die("Blocks of the vertex grid cover %lld vertices out of %lld", (long long)start, (long long)dims.nlocal);
+
+        VertexGridDims blockDims(lower.size(), comm);
+
+        std::vector<Channel> channels = {
+            Channel("block_lower",  lower     .data(), Channel::Type::Vector),
+            Channel("block_upper",  upper     .data(), Channel::Type::Vector),
+            Channel("block_offset", offsets   .data(), Channel::Type::Scalar, Channel::Datatype::Int64),
+            Channel("block_size",   blockSizes.data(), Channel::Type::Scalar, Channel::Datatype::Int64)
+        };
+
+        HDF5::writeData(file_id, &blockDims, channels);
+    }
+
+    void VertexGrid::setBlocks(std::vector<hsize_t> localBlockSizes)
+    {
+        this->localBlockSizes = localBlockSizes;
+        writeBlockIndex = true;
+    }
+
+    void VertexGrid::select_blocks(const std::vector<Block>& blocks)
+    {
+        dims.ranges.clear();
+        dims.nlocal = 0;
+        dims.offset = blocks.empty() ? 0 : blocks[0].offset;
+
+        for (auto& b : blocks)
+        {
+            dims.ranges.push_back({b.offset, b.size});
+            dims.nlocal += b.size;
+        }
+    }
+
+    std::vector<VertexGrid::Block> VertexGrid::read_block_index(hid_t file_id)
+    {
+        std::vector<Block> blocks;
+
+        if (H5Lexists(file_id, "block_offset", H5P_DEFAULT) <= 0)
+            return blocks;
+
+        // Every rank reads the whole index, it's one entry per block
+        auto readAll = [file_id] (std::string name, hid_t datatype, void* data) {
+            hid_t dset_id = H5Dopen(file_id, name.c_str(), H5P_DEFAULT);
+            H5Dread(dset_id, datatype, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+            H5Dclose(dset_id);
+        };
+
+        hid_t dset_id  = H5Dopen(file_id, "block_offset", H5P_DEFAULT);
+        hid_t space_id = H5Dget_space(dset_id);
+        const hsize_t n = H5Sget_simple_extent_npoints(space_id);
+        H5Sclose(space_id);
+        H5Dclose(dset_id);
+
+        std::vector<float3> lower(n), upper(n);
+        std::vector<int64_t> offsets(n), sizes(n);
+
+        readAll("block_lower",  H5T_NATIVE_FLOAT, lower  .data());
+        readAll("block_upper",  H5T_NATIVE_FLOAT, upper  .data());
+        readAll("block_offset", H5T_NATIVE_INT64, offsets.data());
+        readAll("block_size",   H5T_NATIVE_INT64, sizes  .data());
+
+        for (hsize_t i = 0; i < n; i++)
+            blocks.push_back({lower[i], upper[i], (hsize_t)offsets[i], (hsize_t)sizes[i]});
+
+        return blocks;
+    }
+
+    void VertexGrid::setPositionCompression(Channel::Compression compression)
+    {
+        positionCompression = compression;
+    }
+
+    bool VertexGrid::compressed() const
+    {
+        return positionCompression.enabled();
     }
     
     pugi::xml_node VertexGrid::write_to_XMF(pugi::xml_node node, std::string h5filename) const
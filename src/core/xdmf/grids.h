@@ -22,6 +22,12 @@ namespace XDMF
         virtual std::vector<hsize_t> getGlobalSize() const = 0;
         virtual std::vector<hsize_t> getOffsets()    const = 0;
 
+        /**
+         * Several (offset, size) ranges along the first dimension that make up the local data,
+         * empty if it's just one hyperslab given by getOffsets() and getLocalSize()
+         */
+        virtual std::vector<std::pair<hsize_t, hsize_t>> getRanges() const { return {}; }
+
         bool localEmpty()   const;
         bool globalEmpty()  const;
         int getDims()       const;
@@ -39,6 +45,9 @@ namespace XDMF
         virtual void read_from_XMF(const pugi::xml_node &node, std::string &h5filename)         = 0;
         virtual void split_read_access(MPI_Comm comm, int chunk_size=1)                         = 0;
         virtual void read_from_HDF5(hid_t file_id, MPI_Comm comm)                               = 0;        
+
+        /// True if the datasets of the grid itself are written with HDF5 filters
+        virtual bool compressed() const { return false; }
         
         virtual ~Grid() = default;
     };
@@ -80,7 +89,7 @@ namespace XDMF
         
     class VertexGrid : public Grid
     {
-    protected:
+    public:
         
         class VertexGridDims : public GridDims
         {
@@ -91,11 +100,23 @@ namespace XDMF
             std::vector<hsize_t> getLocalSize()  const override;
             std::vector<hsize_t> getGlobalSize() const override;
             std::vector<hsize_t> getOffsets()    const override;
+            std::vector<std::pair<hsize_t, hsize_t>> getRanges() const override;
 
             hsize_t nlocal, nglobal, offset;
+            std::vector<std::pair<hsize_t, hsize_t>> ranges;
+        };
+
+        /**
+         * Range of consecutive vertices and their bounding box.
+         * Checkpoints write the index of the blocks of each rank next to the positions
+         * (see setBlocks()), such that a restart only reads the blocks overlapping its subdomain
+         */
+        struct Block
+        {
+            float3 lower, upper;
+            hsize_t offset, size;
         };
 
-    public:
         const VertexGridDims* getGridDims()                                       const override;        
         std::string getCentering()                                                const override;
         std::shared_ptr<std::vector<float>> getPositions()                        const;
@@ -108,14 +129,30 @@ namespace XDMF
         void read_from_HDF5(hid_t file_id, MPI_Comm comm)                               override;
         
         VertexGrid(std::shared_ptr<std::vector<float>> positions, MPI_Comm comm);
+
+        void setPositionCompression(Channel::Compression compression);
+        bool compressed() const override;
+
+        /// Write the spatial index with the local vertices split into consecutive blocks of these sizes; no index is written by default
+        void setBlocks(std::vector<hsize_t> localBlockSizes);
+
+        /// Read only the given blocks (sorted by offset) instead of split_read_access()
+        void select_blocks(const std::vector<Block>& blocks);
+
+        /// @return all the blocks of the file, empty if it was written without the index
+        static std::vector<Block> read_block_index(hid_t file_id);
         
     protected:
         const std::string positionChannelName = "position";
+        Channel::Compression positionCompression;
+        bool writeBlockIndex{false};
+        std::vector<hsize_t> localBlockSizes;
         VertexGridDims dims;
 
         std::shared_ptr<std::vector<float>> positions;
 
         virtual void _writeTopology(pugi::xml_node& topoNode, std::string h5filename) const;
+        void _writeBlockIndex(hid_t file_id, MPI_Comm comm) const;
     };
 
     class TriangleMeshGrid : public VertexGrid
@@ -1,6 +1,10 @@
 #include "hdf5_helpers.h"
 
 #include <core/logger.h>
+#include <core/utils/timer.h>
+
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
@@ -54,6 +58,15 @@ namespace XDMF
             return file_id;
         }
 
+        hid_t openReadWrite(std::string filename, MPI_Comm comm)
+        {
+            hid_t access_id = createFileAccess(comm);
+            hid_t file_id   = H5Fopen( filename.c_str(), H5F_ACC_RDWR, access_id );
+            H5Pclose(access_id);
+            
+            return file_id;
+        }
+
         hid_t openReadOnly(std::string filename, MPI_Comm comm)
         {
             hid_t access_id = createFileAccess(comm);
@@ -63,6 +76,64 @@ namespace XDMF
             return file_id;
         }
         
+        /**
+         * Dataset creation properties with the filters of the channel
+         *
+         * Chunks span the whole dataset except the slowest dimension, so they only depend
+         * on the global size and are the same on all the ranks, as parallel HDF5 requires.
+         * Writing filtered datasets in parallel needs HDF5 1.10.2 or newer.
+         * \p extendible datasets are always chunked, their first dimension may grow later
+         */
+        static hid_t createDataSetProperties(const std::vector<hsize_t>& globalSize, const Channel& channel, bool extendible = false)
+        {
+            hid_t dcpl_id = H5Pcreate(H5P_DATASET_CREATE);
+            const auto& compression = channel.compression;
+
+            bool filtered = compression.enabled() && globalSize[0] > 0;
+
+#if !H5_VERSION_GE(1, 10, 2)
+            if (filtered)
+                warn("HDF5 %d.%d.%d cannot write compressed datasets in parallel, channel '%s' will not be compressed",
+                     H5_VERS_MAJOR, H5_VERS_MINOR, H5_VERS_RELEASE, channel.name.c_str());
+            filtered = false;
+#endif
+
+            if (!filtered && !extendible)
+                return dcpl_id;
+
+            hsize_t sliceBytes = channel.precision();
+            for (int i = 1; i < globalSize.size(); i++)
+                sliceBytes *= globalSize[i];
+
+            // Extendible datasets don't know their final size, but small ones should not get huge chunks
+            const hsize_t maxRows = extendible ? std::max(globalSize[0], (hsize_t)1024) : globalSize[0];
+
+            std::vector<hsize_t> chunk = globalSize;
+            chunk[0] = std::max((hsize_t)1, std::min(maxRows, (hsize_t)compression.chunkBytes / sliceBytes));
+            H5Pset_chunk(dcpl_id, chunk.size(), chunk.data());
+
+            if (!filtered)
+                return dcpl_id;
+
+            if (compression.codec != 0)
+            {
+                if (H5Zfilter_avail(compression.codec) > 0)
+                    H5Pset_filter(dcpl_id, compression.codec, H5Z_FLAG_MANDATORY,
+                                  compression.codecParams.size(), compression.codecParams.data());
+                else
+                    warn("HDF5 filter %u is not available (check HDF5_PLUGIN_PATH), channel '%s' is written without it",
+                         compression.codec, channel.name.c_str());
+            }
+
+            if (compression.shuffle)
+                H5Pset_shuffle(dcpl_id);
+
+            if (compression.deflate > 0)
+                H5Pset_deflate(dcpl_id, std::min(compression.deflate, 9));
+
+            return dcpl_id;
+        }
+
         void writeDataSet(hid_t file_id, const GridDims* gridDims, const Channel& channel)
         {
             debug2("Writing channel '%s'", channel.name.c_str());
@@ -83,8 +154,9 @@ namespace XDMF
             auto datatype = datatypeToHDF5type(channel.datatype);
             
             hid_t filespace_simple = H5Screate_simple(ndims, globalSize.data(), nullptr);
+            hid_t dcpl_id = createDataSetProperties(globalSize, channel);
 
-            hid_t dset_id = H5Dcreate(file_id, channel.name.c_str(), datatype, filespace_simple, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+            hid_t dset_id = H5Dcreate(file_id, channel.name.c_str(), datatype, filespace_simple, H5P_DEFAULT, dcpl_id, H5P_DEFAULT);
             hid_t xfer_plist_id = H5Pcreate(H5P_DATASET_XFER);
 
             H5Pset_dxpl_mpio(xfer_plist_id, H5FD_MPIO_COLLECTIVE);
@@ -104,10 +176,70 @@ namespace XDMF
 
             H5Sclose(mspace_id);
             H5Sclose(dspace_id);
+            H5Sclose(filespace_simple);
             H5Pclose(xfer_plist_id);
+            H5Pclose(dcpl_id);
             H5Dclose(dset_id);
         }
         
+        void appendDataSet(hid_t file_id, const GridDims* gridDims, const Channel& channel, hsize_t globalOffset)
+        {
+            debug2("Appending channel '%s' after %lld entries", channel.name.c_str(), (long long)globalOffset);
+
+            if (gridDims->getDims() != 1)
+                die("Only one-dimensional grids can be appended to, channel '%s' has %d dimensions",
+                    channel.name.c_str(), gridDims->getDims());
+
+            const int ndims = 2;
+            const hsize_t nlocal  = gridDims->getLocalSize ()[0];
+            const hsize_t nglobal = gridDims->getGlobalSize()[0];
+            const hsize_t offset  = gridDims->getOffsets   ()[0];
+            const hsize_t ncomp   = channel.nComponents();
+
+            std::vector<hsize_t> newSize {globalOffset + nglobal, ncomp};
+            auto datatype = datatypeToHDF5type(channel.datatype);
+
+            hid_t dset_id;
+            if (H5Lexists(file_id, channel.name.c_str(), H5P_DEFAULT) > 0)
+            {
+                dset_id = H5Dopen(file_id, channel.name.c_str(), H5P_DEFAULT);
+                H5Dset_extent(dset_id, newSize.data());
+            }
+            else
+            {
+                std::vector<hsize_t> maxSize {H5S_UNLIMITED, ncomp};
+
+                hid_t filespace_id = H5Screate_simple(ndims, newSize.data(), maxSize.data());
+                hid_t dcpl_id = createDataSetProperties({nglobal, ncomp}, channel, true);
+
+                dset_id = H5Dcreate(file_id, channel.name.c_str(), datatype, filespace_id, H5P_DEFAULT, dcpl_id, H5P_DEFAULT);
+
+                H5Pclose(dcpl_id);
+                H5Sclose(filespace_id);
+            }
+
+            hid_t xfer_plist_id = H5Pcreate(H5P_DATASET_XFER);
+            H5Pset_dxpl_mpio(xfer_plist_id, H5FD_MPIO_COLLECTIVE);
+
+            std::vector<hsize_t> start {globalOffset + offset, 0}, count {nlocal, ncomp};
+            hid_t dspace_id = H5Dget_space(dset_id);
+
+            if (nlocal > 0)
+                H5Sselect_hyperslab(dspace_id, H5S_SELECT_SET, start.data(), nullptr, count.data(), nullptr);
+            else
+                H5Sselect_none(dspace_id);
+
+            hid_t mspace_id = H5Screate_simple(ndims, count.data(), nullptr);
+
+            if (nglobal > 0)
+                H5Dwrite(dset_id, datatype, mspace_id, dspace_id, xfer_plist_id, channel.data);
+
+            H5Sclose(mspace_id);
+            H5Sclose(dspace_id);
+            H5Pclose(xfer_plist_id);
+            H5Dclose(dset_id);
+        }
+
         void writeData(hid_t file_id, const GridDims* gridDims, const std::vector<Channel>& channels)
         {
             for (auto& channel : channels) 
@@ -134,12 +266,29 @@ namespace XDMF
 
             hid_t dspace_id = H5Dget_space(dset_id);
 
+            auto ranges = gridDims->getRanges();
+
             // TODO check if this is needed
-            if (!gridDims->localEmpty())
+            if (gridDims->localEmpty())
+                H5Sselect_none(dspace_id);
+            else if (ranges.empty())
                 H5Sselect_hyperslab(dspace_id, H5S_SELECT_SET, gridDims->getOffsets().data(), nullptr, localSize.data(), nullptr);
             else
+            {
+                // Union of the ranges, read in the order of the file
                 H5Sselect_none(dspace_id);
 
+                for (auto& range : ranges)
+                {
+                    std::vector<hsize_t> start(ndims, 0), count = localSize;
+                    start[0] = range.first;
+                    count[0] = range.second;
+
+                    if (range.second > 0)
+                        H5Sselect_hyperslab(dspace_id, H5S_SELECT_OR, start.data(), nullptr, count.data(), nullptr);
+                }
+            }
+
             hid_t mspace_id = H5Screate_simple(ndims, localSize.data(), nullptr);
 
             if (!gridDims->globalEmpty())
@@ -161,6 +310,44 @@ namespace XDMF
         {
             H5Fclose(file_id);
         }
+
+        struct StorageSizes
+        {
+            hsize_t raw{0}, stored{0};
+        };
+
+        static herr_t addDataSetSizes(hid_t group_id, const char* name, const H5L_info_t* info, void* data)
+        {
+            auto sizes = (StorageSizes*) data;
+
+            hid_t dset_id = H5Oopen(group_id, name, H5P_DEFAULT);
+            if (dset_id < 0) return 0;
+
+            if (H5Iget_type(dset_id) != H5I_DATASET)
+            {
+                H5Oclose(dset_id);
+                return 0;
+            }
+
+            hid_t space_id = H5Dget_space(dset_id);
+            hid_t type_id  = H5Dget_type(dset_id);
+
+            sizes->raw    += H5Sget_simple_extent_npoints(space_id) * H5Tget_size(type_id);
+            sizes->stored += H5Dget_storage_size(dset_id);
+
+            H5Tclose(type_id);
+            H5Sclose(space_id);
+            H5Oclose(dset_id);
+            return 0;
+        }
+
+        /// Size of the data in memory and in the file, summed over all the datasets
+        static StorageSizes getStorageSizes(hid_t file_id)
+        {
+            StorageSizes sizes;
+            H5Literate(file_id, H5_INDEX_NAME, H5_ITER_NATIVE, nullptr, addDataSetSizes, &sizes);
+            return sizes;
+        }
         
         void write(std::string filename, MPI_Comm comm, const Grid *grid, const std::vector<Channel>& channels)
         {
@@ -171,9 +358,34 @@ namespace XDMF
                 return;
             }
             
+            mTimer timer;
+            timer.start();
+
             grid->write_to_HDF5(file_id, comm);
             writeData(file_id, grid->getGridDims(), channels);
-            
+
+            const double ms = timer.elapsed();
+
+            // Files written with filters are always reported, the others only in debug mode:
+            // walking over all the datasets is not free, and the frequent dumps are rarely compressed
+            const bool compressed = grid->compressed() ||
+                std::any_of(channels.begin(), channels.end(), [] (const Channel& ch) { return ch.compression.enabled(); });
+
+            if (compressed || logger.getDebugLvl() >= 4)
+            {
+                auto sizes = getStorageSizes(file_id);
+                const double MB = 1024.0 * 1024.0;
+
+                char report[512];
+                snprintf(report, sizeof(report),
+                         "Wrote %.2f MB of data to '%s' in %.1f ms (%.1f MB/s), %.2f MB on disk, compression ratio %.2f",
+                         sizes.raw / MB, filename.c_str(), ms, sizes.raw / MB / (ms * 1e-3),
+                         sizes.stored / MB, sizes.stored > 0 ? (double)sizes.raw / sizes.stored : 1.0);
+
+                if (compressed) info ("%s", report);
+                else            debug("%s", report);
+            }
+
             close(file_id);
         }
 
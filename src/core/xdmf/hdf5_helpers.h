@@ -14,10 +14,14 @@ namespace XDMF
     {
         hid_t create(std::string filename, MPI_Comm comm);
         hid_t openReadOnly(std::string filename, MPI_Comm comm);
+        hid_t openReadWrite(std::string filename, MPI_Comm comm);
 
         void writeDataSet(hid_t file_id, const GridDims* gridDims, const Channel& channel);
         void writeData   (hid_t file_id, const GridDims* gridDims, const std::vector<Channel>& channels);
 
+        /// Write the local part of a one-dimensional grid after the first \p globalOffset entries of an extendible dataset, created if missing
+        void appendDataSet(hid_t file_id, const GridDims* gridDims, const Channel& channel, hsize_t globalOffset);
+
         void readDataSet (hid_t file_id, const GridDims* gridDims, Channel& channel);
         void readData    (hid_t file_id, const GridDims* gridDims, std::vector<Channel>& channels);
 
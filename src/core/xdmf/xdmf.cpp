@@ -6,6 +6,8 @@
 
 #include <hdf5.h>
 
+#include <algorithm>
+
 #include <core/logger.h>
 #include <core/utils/timer.h>
 #include <core/utils/folders.h>
@@ -32,6 +34,57 @@ namespace XDMF
         write(filename, grid, channels, -1, comm);
     }
 
+    TimeSeriesWriter::TimeSeriesWriter(std::string filename, MPI_Comm comm) :
+        h5Filename(filename + ".h5"), xmfFilename(filename + ".xmf"), comm(comm)
+    {
+        MPI_Check( MPI_Comm_rank(comm, &rank) );
+    }
+
+    void TimeSeriesWriter::append(std::shared_ptr<std::vector<float>> positions, const std::vector<Channel>& channels, float time)
+    {
+        info("Appending step %d to XDMF time series %s", nsteps, xmfFilename.c_str());
+
+        mTimer timer;
+        timer.start();
+
+        VertexGrid grid(positions, comm);
+        auto dims = grid.getGridDims();
+        const hsize_t nglobal = dims->getGlobalSize()[0];
+
+        auto file_id = nsteps == 0 ? HDF5::create(h5Filename, comm) : HDF5::openReadWrite(h5Filename, comm);
+        if (file_id < 0)
+            die("HDF5 failed to open file '%s' for appending", h5Filename.c_str());
+
+        HDF5::appendDataSet(file_id, dims, Channel("position", positions->data(), Channel::Type::Vector), nrows);
+        for (auto& channel : channels)
+            HDF5::appendDataSet(file_id, dims, channel, nrows);
+
+        // Step tables get one row per step, written by the master rank
+        int64_t stepOffset = nrows, stepSize = nglobal;
+        VertexGrid::VertexGridDims stepDims(rank == 0 ? 1 : 0, comm);
+
+        HDF5::appendDataSet(file_id, &stepDims, Channel("step_offset", &stepOffset, Channel::Type::Scalar, Channel::Datatype::Int64), nsteps);
+        HDF5::appendDataSet(file_id, &stepDims, Channel("step_size",   &stepSize,   Channel::Type::Scalar, Channel::Datatype::Int64), nsteps);
+        HDF5::appendDataSet(file_id, &stepDims, Channel("step_time",   &time,       Channel::Type::Scalar), nsteps);
+
+        HDF5::close(file_id);
+
+        // Empty steps are only in the tables, XDMF can't have empty hyperslabs
+        if (rank == 0 && nglobal > 0)
+        {
+            XMF::appendTimeStep(xmfFilename, !xmfCreated, relativePath(h5Filename),
+                                &grid, channels, time, nrows, nrows + nglobal);
+            xmfCreated = true;
+        }
+
+        MPI_Check( MPI_Barrier(comm) );
+
+        nrows += nglobal;
+        nsteps++;
+
+        info("Appending took %f ms", timer.elapsed());
+    }
+
     static long getLocalNumElements(const GridDims *gridDims)
     {
         long n = 1;
@@ -43,7 +96,7 @@ namespace XDMF
     {
         int n = positions.size() / 3;
         const float3 *pos, *vel = nullptr;
-        const int *ids = nullptr;
+        const Channel *idsChannel = nullptr;
 
         pv->local()->resize_anew(n);
         auto& coosvels = pv->local()->coosvels;
@@ -54,12 +107,12 @@ namespace XDMF
                 vel = (const float3*) ch.data;
             
             if (ch.name == "ids")
-                ids = (const int*) ch.data;
+                idsChannel = &ch;
         }
 
         if (n > 0 && vel == nullptr)
             die("Channel 'velocities' is required to read XDMF into a particle vector");
-        if (n > 0 && ids == nullptr)
+        if (n > 0 && idsChannel == nullptr)
             die("Channel 'ids' is required to read XDMF into a particle vector");
 
         pos = (const float3*) positions.data();
@@ -69,7 +122,11 @@ namespace XDMF
             Particle p;
             p.r = pos[i];
             p.u = vel[i];
-            p.i1 = ids[i];
+            // Older checkpoints have 32-bit ids
+            if (idsChannel->datatype == Channel::Datatype::Int64)
+                p.setId( ((const int64_t*) idsChannel->data)[i] );
+            else
+                p.setId( ((const int*)     idsChannel->data)[i] );
             
             coosvels.hostPtr()[i] = p;
         }
@@ -163,8 +220,27 @@ namespace XDMF
         // TODO extra data
     }
     
+    static std::vector<VertexGrid::Block> readBlockIndexH5(std::string h5filename, MPI_Comm comm)
+    {
+        auto file_id = HDF5::openReadOnly(h5filename, comm);
+        if (file_id < 0)
+            die("HDF5 failed to read from file '%s'", h5filename.c_str());
+
+        auto blocks = VertexGrid::read_block_index(file_id);
+        HDF5::close(file_id);
+
+        return blocks;
+    }
+
+    /**
+     * Blocks are picked by ids \p blockIds if given, otherwise by \p filter if the file has an index.
+     * The index is only read in these two cases
+     *
+     * @return true if the blocks were selected with the index
+     */
     template <typename PV>
-    static void readData(std::string filename, MPI_Comm comm, PV *pv, int chunk_size) 
+    static bool readData(std::string filename, MPI_Comm comm, PV *pv, int chunk_size,
+                         const BlockFilter& filter, const std::vector<int>* blockIds, std::vector<int>* selectedIds)
     {
         info("Reading XDMF data from %s", filename.c_str());
 
@@ -179,10 +255,56 @@ namespace XDMF
         mTimer timer;
         timer.start();
         XMF::read(filename, comm, h5filename, &grid, channels);
-        grid.split_read_access(comm, chunk_size);
-
         h5filename = parentPath(filename) + h5filename;
 
+        std::vector<int> ids;
+        bool indexed = false;
+
+        if (blockIds != nullptr || filter)
+        {
+            auto index = readBlockIndexH5(h5filename, comm);
+
+            if (blockIds != nullptr)
+            {
+                ids = *blockIds;
+                indexed = true;
+            }
+            else if (!index.empty())
+            {
+                for (int i = 0; i < index.size(); i++)
+                    if (filter(index[i].lower, index[i].upper))
+                        ids.push_back(i);
+
+                indexed = true;
+                debug("Reading %d blocks out of %d from '%s'", (int)ids.size(), (int)index.size(), h5filename.c_str());
+            }
+
+            std::vector<VertexGrid::Block> selected;
+            for (auto id : ids)
+            {
+                if (id < 0 || id >= index.size())
+                    die("Block %d is not in the index of file '%s' with %d blocks", id, h5filename.c_str(), (int)index.size());
+
+                if (index[id].size % chunk_size != 0)
+                    die("Block %d of file '%s' is not made of whole objects", id, h5filename.c_str());
+
+                selected.push_back(index[id]);
+            }
+
+            std::sort(selected.begin(), selected.end(), [] (const VertexGrid::Block& a, const VertexGrid::Block& b) {
+                return a.offset < b.offset;
+            });
+
+            if (indexed)
+                grid.select_blocks(selected);
+        }
+
+        if (!indexed)
+            grid.split_read_access(comm, chunk_size);
+
+        if (selectedIds != nullptr)
+            *selectedIds = ids;
+
         long nElements = getLocalNumElements(grid.getGridDims());
         channelData.resize(channels.size());        
 
@@ -196,21 +318,23 @@ namespace XDMF
 
         gatherChannels(channels, *positions, pv);
 
+        return indexed;
     }
 
-    void readParticleData(std::string filename, MPI_Comm comm, ParticleVector *pv, int chunk_size)
+    bool readParticleData(std::string filename, MPI_Comm comm, ParticleVector *pv, int chunk_size,
+                          const BlockFilter& filter, std::vector<int>* selected)
     {
-        readData(filename, comm, pv, chunk_size);
+        return readData(filename, comm, pv, chunk_size, filter, nullptr, selected);
     }
 
     
-    void readObjectData(std::string filename, MPI_Comm comm, ObjectVector *ov)
+    void readObjectData(std::string filename, MPI_Comm comm, ObjectVector *ov, const std::vector<int>* blockIds)
     {
-        readData(filename, comm, ov, 1);
+        readData(filename, comm, ov, 1, nullptr, blockIds, nullptr);
     }
 
-    void readRigidObjectData(std::string filename, MPI_Comm comm, RigidObjectVector *rov)
+    void readRigidObjectData(std::string filename, MPI_Comm comm, RigidObjectVector *rov, const std::vector<int>* blockIds)
     {
-        readData(filename, comm, rov, 1);
+        readData(filename, comm, rov, 1, nullptr, blockIds, nullptr);
     }
 }
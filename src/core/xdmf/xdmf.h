@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <vector>
 #include <string>
 #include <memory>
@@ -14,7 +15,50 @@ namespace XDMF
     void write(std::string filename, const Grid* grid, const std::vector<Channel>& channels, float time, MPI_Comm comm);
     void write(std::string filename, const Grid* grid, const std::vector<Channel>& channels, MPI_Comm comm);
 
-    void readParticleData(std::string filename, MPI_Comm comm, ParticleVector* pv, int chunk_size = 1);
-    void readObjectData(std::string filename, MPI_Comm comm, ObjectVector *ov);
-    void readRigidObjectData(std::string filename, MPI_Comm comm, RigidObjectVector *rov);
+    /**
+     * Appends snapshots of particles to a single HDF5 file and a single XMF temporal collection,
+     * instead of a pair of files per snapshot. The steps are stacked along the first dimension
+     * of every dataset; datasets "step_offset", "step_size" and "step_time" give the first row,
+     * the number of rows and the time of each step, so a range of steps is read in one go.
+     * All the calls are collective
+     *
+     * Each step of the XMF file is a hyperslab of the datasets, which keep growing.
+     * The master rank rewrites the (small) XMF file at every append with the new dataset sizes,
+     * so it can be read at any time
+     */
+    class TimeSeriesWriter
+    {
+    public:
+        /// Files are filename.h5 and filename.xmf, created by the first append()
+        TimeSeriesWriter(std::string filename, MPI_Comm comm);
+
+        void append(std::shared_ptr<std::vector<float>> positions, const std::vector<Channel>& channels, float time);
+
+    private:
+        std::string h5Filename, xmfFilename;
+        MPI_Comm comm;
+
+        int rank;
+        int nsteps{0};
+        hsize_t nrows{0};
+        bool xmfCreated{false};
+    };
+
+    /// Selects blocks of the spatial index by their bounding box in global coordinates, see VertexGrid::Block
+    using BlockFilter = std::function<bool(float3 lower, float3 upper)>;
+
+    /**
+     * Each rank reads an even share of the file. If \p filter is given and the file
+     * has a spatial index, each rank only reads the blocks passing the filter instead,
+     * and their ids are returned in \p selected (the same ids are then read from the
+     * object file of an object vector)
+     *
+     * @return true if the blocks were selected with the index
+     */
+    bool readParticleData(std::string filename, MPI_Comm comm, ParticleVector* pv, int chunk_size = 1,
+                          const BlockFilter& filter = nullptr, std::vector<int>* selected = nullptr);
+
+    /// Each rank reads an even share of the file, or only the blocks of the index with ids \p blockIds if given
+    void readObjectData(std::string filename, MPI_Comm comm, ObjectVector *ov, const std::vector<int>* blockIds = nullptr);
+    void readRigidObjectData(std::string filename, MPI_Comm comm, RigidObjectVector *rov, const std::vector<int>* blockIds = nullptr);
 }
@@ -63,6 +63,112 @@ namespace XDMF
             MPI_Check( MPI_Barrier(comm) );
         }
 
+        static void findHDFItems(pugi::xml_node node, std::vector<pugi::xml_node>& items)
+        {
+            for (auto child : node.children())
+            {
+                if (std::string(child.name()) == "DataItem" && std::string(child.attribute("Format").value()) == "HDF")
+                    items.push_back(child);
+                else
+                    findHDFItems(child, items);
+            }
+        }
+
+        // Replace every HDF data item by a hyperslab of its rows [offset, offset + count)
+        static void toHyperSlabs(pugi::xml_node node, hsize_t offset, hsize_t count, hsize_t total)
+        {
+            std::vector<pugi::xml_node> items;
+            findHDFItems(node, items);
+
+            for (auto& item : items)
+            {
+                std::istringstream dimensions( item.attribute("Dimensions").value() );
+                std::vector<hsize_t> dims;
+                hsize_t d;
+                while (dimensions >> d) dims.push_back(d);
+
+                std::vector<hsize_t> start(dims.size(), 0), stride(dims.size(), 1);
+                start[0] = offset;
+                dims[0] = count;
+
+                auto slabNode = item.parent().insert_child_before("DataItem", item);
+                slabNode.append_attribute("ItemType") = "HyperSlab";
+                slabNode.append_attribute("Dimensions") = ::to_string(dims).c_str();
+                slabNode.append_attribute("Type") = "HyperSlab";
+
+                auto selectionNode = slabNode.append_child("DataItem");
+                selectionNode.append_attribute("Dimensions") = ("3 " + std::to_string(dims.size())).c_str();
+                selectionNode.append_attribute("Format") = "XML";
+                selectionNode.text() = (::to_string(start) + " " + ::to_string(stride) + " " + ::to_string(dims)).c_str();
+
+                dims[0] = total;
+                auto dataNode = slabNode.append_copy(item);
+                dataNode.attribute("Dimensions") = ::to_string(dims).c_str();
+
+                item.parent().remove_child(item);
+            }
+        }
+
+        // Rows of the datasets under all the hyperslabs of node
+        static void setHyperSlabTotal(pugi::xml_node node, hsize_t total)
+        {
+            std::vector<pugi::xml_node> items;
+            findHDFItems(node, items);
+
+            for (auto& item : items)
+            {
+                if (std::string(item.parent().attribute("ItemType").value()) != "HyperSlab")
+                    continue;
+
+                std::istringstream dimensions( item.attribute("Dimensions").value() );
+                std::vector<hsize_t> dims;
+                hsize_t d;
+                while (dimensions >> d) dims.push_back(d);
+
+                dims[0] = total;
+                item.attribute("Dimensions") = ::to_string(dims).c_str();
+            }
+        }
+
+        void appendTimeStep(std::string filename, bool create, std::string h5filename, const Grid* grid,
+                            const std::vector<Channel>& channels, float time, hsize_t offset, hsize_t total)
+        {
+            pugi::xml_document doc;
+            pugi::xml_node collection;
+
+            if (create)
+            {
+                auto root = doc.append_child("Xdmf");
+                root.append_attribute("Version") = "3.0";
+
+                collection = root.append_child("Domain").append_child("Grid");
+                collection.append_attribute("Name") = "TimeSeries";
+                collection.append_attribute("GridType") = "Collection";
+                collection.append_attribute("CollectionType") = "Temporal";
+            }
+            else
+            {
+                auto parseResult = doc.load_file(filename.c_str());
+
+                if (!parseResult)
+                    die("parsing error while reading '%s'.\n"
+                        "\tError description: %s", filename.c_str(), parseResult.description());
+
+                collection = doc.child("Xdmf").child("Domain").child("Grid");
+            }
+
+            auto gridNode = grid->write_to_XMF(collection, h5filename);
+            gridNode.append_child("Time").append_attribute("Value") = std::to_string(time).c_str();
+            writeData(gridNode, h5filename, grid, channels);
+            toHyperSlabs(gridNode, offset, grid->getGridDims()->getGlobalSize()[0], total);
+
+            // The datasets have grown since the previous steps were written
+            setHyperSlabTotal(collection, total);
+
+            if (!doc.save_file(filename.c_str()))
+                die("Could not write file '%s' to append a time step", filename.c_str());
+        }
+
         static Channel readDataSet(pugi::xml_node node)
         {
             auto infoNode = node.child("Information");
@@ -16,6 +16,15 @@ namespace XDMF
         void writeData   (pugi::xml_node node, std::string h5filename, const Grid* grid, const std::vector<Channel>& channels);
         void write(std::string filename, std::string h5filename, MPI_Comm comm, const Grid* grid, const std::vector<Channel>& channels, float time);
 
+        /**
+         * Add one step to the temporal collection of \p filename; its data are the rows
+         * [offset, offset + grid size) of the datasets, which have \p total rows.
+         * The number of rows is updated in the steps appended earlier, so the file is valid after every call.
+         * Not collective, the file is created if \p create is set
+         */
+        void appendTimeStep(std::string filename, bool create, std::string h5filename, const Grid* grid,
+                            const std::vector<Channel>& channels, float time, hsize_t offset, hsize_t total);
+
         void read(std::string filename, MPI_Comm comm, std::string &h5filename, Grid *grid, std::vector<Channel> &channels);
     }
 }
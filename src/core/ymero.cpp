@@ -41,9 +41,16 @@ void YMeRo::init(int3 nranks3D, float3 globalDomainSize, std::string logFileName
     MPI_Check( MPI_Comm_size(comm, &nranks) );
     MPI_Check( MPI_Comm_rank(comm, &rank) );
 
-    if      (nranks3D.x * nranks3D.y * nranks3D.z     == nranks) noPostprocess = true;
-    else if (nranks3D.x * nranks3D.y * nranks3D.z * 2 == nranks) noPostprocess = false;
-    else die("Asked for %d x %d x %d processes, but provided %d", nranks3D.x, nranks3D.y, nranks3D.z, nranks);
+    // Each postprocess task serves a group of simulation tasks, see firstServedTask(),
+    // and the tasks are grouped such that every group is one postprocess task followed by its simulation tasks
+    const int ncompute = nranks3D.x * nranks3D.y * nranks3D.z;
+    const int npost = nranks - ncompute;
+
+    if (npost == 0) noPostprocess = true;
+    else if (npost > 0 && npost <= ncompute) noPostprocess = false;
+    else die("Asked for %d x %d x %d processes, but provided %d. Expected the same number, "
+             "or at most as many postprocess tasks as simulation tasks in addition",
+             nranks3D.x, nranks3D.y, nranks3D.z, nranks);
 
     if (rank == 0) sayHello();
 
@@ -59,9 +66,14 @@ void YMeRo::init(int3 nranks3D, float3 globalDomainSize, std::string logFileName
         return;
     }
 
-    info("Program started, splitting communicator");
+    info("Program started, splitting communicator: %d simulation tasks per postprocess task%s",
+         ncompute / npost, ncompute % npost ? " (one more for some of them)" : "");
 
-    computeTask = rank % 2;
+    // Group of postprocess task p starts at rank firstServedTask(p) + p
+    computeTask = 1;
+    for (int p = 0; p < npost; p++)
+        if (rank == firstServedTask(p, ncompute, npost) + p)
+            computeTask = 0;
     MPI_Check( MPI_Comm_split(comm, computeTask, rank, &splitComm) );
 
     if (isComputeTask())
@@ -98,7 +110,10 @@ YMeRo::YMeRo(PyTypes::int3 nranks3D, PyTypes::float3 globalDomainSize,
                    std::string checkpointFolder, bool gpuAwareMPI, bool noSplash) :
                    noSplash(noSplash)
 {
-    MPI_Init(nullptr, nullptr);
+    // Thread pool executor, postprocess workers and asynchronous checkpoints call MPI from several threads,
+    // they check the provided level themselves
+    int provided;
+    MPI_Init_thread(nullptr, nullptr, MPI_THREAD_MULTIPLE, &provided);
     MPI_Comm_dup(MPI_COMM_WORLD, &comm);
     initializedMpi = true;
 
@@ -285,6 +300,7 @@ std::shared_ptr<ParticleVector> YMeRo::makeFrozenWallParticles(std::string pvNam
     }
     
     Simulation wallsim(sim->nranks3D, sim->domain.globalSize, sim->cartComm, MPI_COMM_NULL, false);
+    wallsim.setDecomposition(sim->getDecomposition());
 
     float mass = 1.0;
     auto pv = std::make_shared<ParticleVector>(pvName, mass);
@@ -334,6 +350,7 @@ std::shared_ptr<ParticleVector> YMeRo::makeFrozenRigidParticles(std::shared_ptr<
 
     {
         Simulation eqsim(sim->nranks3D, sim->domain.globalSize, sim->cartComm, MPI_COMM_NULL, false);
+        eqsim.setDecomposition(sim->getDecomposition());
     
         eqsim.registerParticleVector(pv, ic, 0);
         eqsim.registerInteraction(interaction);
@@ -347,6 +364,7 @@ std::shared_ptr<ParticleVector> YMeRo::makeFrozenRigidParticles(std::shared_ptr<
     }
     
     Simulation freezesim(sim->nranks3D, sim->domain.globalSize, sim->cartComm, MPI_COMM_NULL, false);
+    freezesim.setDecomposition(sim->getDecomposition());
 
     freezesim.registerParticleVector(pv, nullptr, 0);
     freezesim.registerParticleVector(shape, icShape, 0);
@@ -437,6 +455,72 @@ void YMeRo::saveDependencyGraph_GraphML(std::string fname) const
         sim->saveDependencyGraph_GraphML(fname);
 }
 
+void YMeRo::setCellListOrdering(std::string ordering)
+{
+    if (isComputeTask())
+        sim->setCellListOrdering(ordering);
+}
+
+void YMeRo::setTaskExecutor(std::string executor, int nthreads)
+{
+    if (isComputeTask())
+        sim->setTaskExecutor(executor, nthreads);
+}
+
+void YMeRo::setCheckpointMode(std::string mode)
+{
+    if (isComputeTask())
+        sim->setCheckpointMode(mode);
+}
+
+void YMeRo::setPostprocessThreads(int nthreads)
+{
+    if (!isComputeTask() && post)
+        post->setWorkers(nthreads);
+}
+
+void YMeRo::setTracing(std::string path, int dumpEvery, int capacity)
+{
+    if (isComputeTask())
+        sim->setTracing(path, dumpEvery, capacity);
+}
+
+void YMeRo::setAutoTaskPriorities(bool enabled, int measureSteps, float slackTolerance)
+{
+    if (isComputeTask())
+        sim->setAutoTaskPriorities(enabled, measureSteps, slackTolerance);
+}
+
+void YMeRo::setExchangeProtocol(std::string protocol)
+{
+    if (isComputeTask())
+        sim->setExchangeProtocol(protocol);
+}
+
+void YMeRo::setHalfShellHalo(bool halfShell)
+{
+    if (isComputeTask())
+        sim->setHalfShellHalo(halfShell);
+}
+
+void YMeRo::setHaloCompression(ParticleVector* pv, bool compress)
+{
+    if (isComputeTask())
+        sim->setHaloCompression(pv->name, compress);
+}
+
+void YMeRo::setDecomposition(std::vector<float> boundariesX, std::vector<float> boundariesY, std::vector<float> boundariesZ)
+{
+    if (isComputeTask())
+        sim->setDecomposition( Decomposition(sim->nranks3D, sim->domain.globalSize, boundariesX, boundariesY, boundariesZ) );
+}
+
+void YMeRo::setLoadBalancing(std::string metric, float relaxation, float minSize)
+{
+    if (isComputeTask())
+        sim->setLoadBalancing(metric, relaxation, minSize);
+}
+
 void YMeRo::startProfiler()
 {
     if (isComputeTask())
@@ -42,6 +42,17 @@ public:
     void startProfiler();
     void stopProfiler();
     void saveDependencyGraph_GraphML(std::string fname) const;
+    void setCellListOrdering(std::string ordering);
+    void setTaskExecutor(std::string executor, int nthreads);
+    void setTracing(std::string path, int dumpEvery, int capacity);
+    void setAutoTaskPriorities(bool enabled, int measureSteps, float slackTolerance);
+    void setCheckpointMode(std::string mode);
+    void setPostprocessThreads(int nthreads);
+    void setExchangeProtocol(std::string protocol);
+    void setHalfShellHalo(bool halfShell);
+    void setHaloCompression(ParticleVector* pv, bool compress);
+    void setDecomposition(std::vector<float> boundariesX, std::vector<float> boundariesY, std::vector<float> boundariesZ);
+    void setLoadBalancing(std::string metric, float relaxation, float minSize);
     
     void run(int niters);
     
@@ -36,5 +36,5 @@ public:
     void setSimulation(Simulation* simulation) { this->simulation = simulation; }
     
 protected:
-    Simulation* simulation;
+    Simulation* simulation{nullptr};
 };
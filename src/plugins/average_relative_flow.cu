@@ -233,7 +233,6 @@ void AverageRelative3D::serializeAndSend(cudaStream_t stream)
 
 
     debug2("Plugin '%s' is now packing the data", name.c_str());
-    waitPrevSend();
     SimpleSerializer::serialize(sendBuffer, currentTime, localDensity, localChannels);
     send(sendBuffer);
 }
@@ -23,10 +23,35 @@ void UniformCartesianDumper::handshake()
     std::vector<int> sizes;
     std::vector<std::string> names;
     SimpleSerializer::deserialize(data, nranks3D, rank3D, resolution, h, sizes, names);
+
+    // Grids of the served simulation tasks are stacked along z and written as one
+    const int n = nSources();
+    for (int i = 1; i < n; i++)
+    {
+        int3 otherNranks3D, otherRank3D, otherResolution;
+        SimpleSerializer::deserialize(sourceData(i), otherNranks3D, otherRank3D, otherResolution);
+
+        if (otherRank3D.x != rank3D.x || otherRank3D.y != rank3D.y || otherRank3D.z != rank3D.z + i ||
+            otherResolution.x != resolution.x || otherResolution.y != resolution.y)
+            die("Plugin '%s' can only combine the subdomains following each other along z", name.c_str());
+    }
+
+    if (nranks3D.z % n != 0 || rank3D.z % n != 0)
+        die("Plugin '%s': number of simulation tasks along z (%d) has to be a multiple of "
+            "the number of the simulation tasks per postprocess task (%d)", name.c_str(), nranks3D.z, n);
+
+    nranks3D.z   /= n;
+    rank3D.z     /= n;
+    resolution.z *= n;
+
+    // Order the tasks by their position, this may be different from their rank
+    MPI_Comm orderedComm;
+    MPI_Check( MPI_Comm_split(comm, 0, (rank3D.x * nranks3D.y + rank3D.y) * nranks3D.z + rank3D.z, &orderedComm) );
         
     int ranksArr[] = {nranks3D.x, nranks3D.y, nranks3D.z};
     int periods[] = {0, 0, 0};
-    MPI_Check( MPI_Cart_create(comm, 3, ranksArr, periods, 0, &cartComm) );
+    MPI_Check( MPI_Cart_create(orderedComm, 3, ranksArr, periods, 0, &cartComm) );
+    MPI_Check( MPI_Comm_free(&orderedComm) );
     grid = std::make_unique<XDMF::UniformGrid>(resolution, h, cartComm);
         
     auto init_channel = [] (XDMF::Channel::Type type, const std::string& str) {
@@ -69,6 +94,18 @@ void UniformCartesianDumper::deserialize(MPI_Status& stat)
 {
     float t;
     SimpleSerializer::deserialize(data, t, recv_density, recv_containers);
+
+    // Cells are ordered with z the slowest, so the stacked grids simply follow each other
+    for (int i = 1; i < nSources(); i++)
+    {
+        std::vector<double> otherDensity;
+        std::vector<std::vector<double>> otherContainers;
+        SimpleSerializer::deserialize(sourceData(i), t, otherDensity, otherContainers);
+
+        recv_density.insert(recv_density.end(), otherDensity.begin(), otherDensity.end());
+        for (int c = 0; c < recv_containers.size(); c++)
+            recv_containers[c].insert(recv_containers[c].end(), otherContainers[c].begin(), otherContainers[c].end());
+    }
     
     debug2("Plugin '%s' will dump right now: simulation time %f, time stamp %d",
            name.c_str(), t, timeStamp);
@@ -46,7 +46,6 @@ void MeshPlugin::serializeAndSend(cudaStream_t stream)
 
     auto& mesh = ov->mesh;
 
-    waitPrevSend();
     SimpleSerializer::serialize(data, ov->name,
                                 mesh->getNvertices(), mesh->getNtriangles(), mesh->triangles,
                                 vertices);
@@ -155,6 +154,14 @@ void MeshDumper::deserialize(MPI_Status& stat)
 
     SimpleSerializer::deserialize(data, ovName, nvertices, ntriangles, connectivity, vertices);
 
+    // Objects of the other served simulation tasks, the mesh is the same
+    for (int i = 1; i < nSources(); i++)
+    {
+        std::vector<float3> otherVertices;
+        SimpleSerializer::deserialize(sourceData(i), ovName, nvertices, ntriangles, connectivity, otherVertices);
+        vertices.insert(vertices.end(), otherVertices.begin(), otherVertices.end());
+    }
+
     std::string tstr = std::to_string(timeStamp++);
     std::string currentFname = path + "/" + ovName + "_" + std::string(5 - tstr.length(), '0') + tstr + ".ply";
 
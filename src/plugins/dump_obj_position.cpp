@@ -47,7 +47,6 @@ void ObjPositionsPlugin::serializeAndSend(cudaStream_t stream)
 
     debug2("Plugin %s is sending now data", name.c_str());
 
-    waitPrevSend();
     SimpleSerializer::serialize(sendBuffer, savedTime, ov->domain, ids, coms, motions);
     send(sendBuffer);
     
@@ -166,6 +165,28 @@ void ObjPositionsDumper::deserialize(MPI_Status& stat)
 
     SimpleSerializer::deserialize(data, curTime, domain, ids, coms, motions);
 
+    // Objects of the other served simulation tasks, moved to the frame of the first one
+    for (int i = 1; i < nSources(); i++)
+    {
+        DomainInfo otherDomain;
+        std::vector<int> otherIds;
+        std::vector<LocalObjectVector::COMandExtent> otherComs;
+        std::vector<RigidMotion> otherMotions;
+
+        SimpleSerializer::deserialize(sourceData(i), curTime, otherDomain, otherIds, otherComs, otherMotions);
+
+        for (auto& c : otherComs)
+        {
+            c.com  = domain.global2local(otherDomain.local2global(c.com));
+            c.low  = domain.global2local(otherDomain.local2global(c.low));
+            c.high = domain.global2local(otherDomain.local2global(c.high));
+        }
+
+        ids    .insert(ids    .end(), otherIds    .begin(), otherIds    .end());
+        coms   .insert(coms   .end(), otherComs   .begin(), otherComs   .end());
+        motions.insert(motions.end(), otherMotions.begin(), otherMotions.end());
+    }
+
     if (activated)
         writePositions(comm, domain, fout, curTime, ids, coms, motions);
 }
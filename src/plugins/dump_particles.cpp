@@ -8,11 +8,14 @@
 
 ParticleSenderPlugin::ParticleSenderPlugin(std::string name, std::string pvName, int dumpEvery,
                                            std::vector<std::string> channelNames,
-                                           std::vector<ChannelType> channelTypes) :
+                                           std::vector<ChannelType> channelTypes,
+                                           ParticleFilter filter) :
     SimulationPlugin(name), pvName(pvName),
-    dumpEvery(dumpEvery), channelNames(channelNames), channelTypes(channelTypes)
+    dumpEvery(dumpEvery), channelNames(channelNames), channelTypes(channelTypes),
+    filter(std::move(filter))
 {
     channelData.resize(channelNames.size());
+    spareChannelData.resize(channelNames.size());
 }
 
 void ParticleSenderPlugin::setup(Simulation* simulation, const MPI_Comm& comm, const MPI_Comm& interComm)
@@ -20,8 +23,10 @@ void ParticleSenderPlugin::setup(Simulation* simulation, const MPI_Comm& comm, c
     SimulationPlugin::setup(simulation, comm, interComm);
 
     pv = simulation->getPVbyNameOrDie(pvName);
+    filter.setup(simulation, name);
 
-    info("Plugin %s initialized for the following particle vector: %s", name.c_str(), pvName.c_str());
+    info("Plugin %s initialized for the following particle vector: %s%s", name.c_str(), pvName.c_str(),
+         filter.active() ? ", only a part of the particles is dumped" : "");
 }
 
 void ParticleSenderPlugin::handshake()
@@ -41,7 +46,6 @@ void ParticleSenderPlugin::handshake()
             break;
         }
 
-    waitPrevSend();
     SimpleSerializer::serialize(sendBuffer, sizes, channelNames);
     send(sendBuffer);
 }
@@ -50,12 +54,34 @@ void ParticleSenderPlugin::beforeForces(cudaStream_t stream)
 {
     if (currentTimeStep % dumpEvery != 0 || currentTimeStep == 0) return;
 
-    particles.genericCopy(&pv->local()->coosvels, stream);
+    // The previous dump may still be sent straight from the host buffers
+    packing = !borrowedSendDone();
+    auto& hostParticles = packing ? spareParticles   : particles;
+    auto& hostChannels  = packing ? spareChannelData : channelData;
+
+    // Only the selected particles leave the device
+    if (filter.active())
+    {
+        filter.select(pv->local(), pv->domain, stream);
+
+        filter.gather(&pv->local()->coosvels, &selectedParticles, stream);
+        hostParticles.genericCopy(&selectedParticles, stream);
+
+        for (int i = 0; i < channelNames.size(); ++i) {
+            auto srcContainer = pv->local()->extraPerParticle.getGenericData(channelNames[i]);
+            filter.gather(srcContainer, &selectedChannel, stream);
+            hostChannels[i].genericCopy(&selectedChannel, stream);
+        }
+
+        return;
+    }
+
+    hostParticles.genericCopy(&pv->local()->coosvels, stream);
 
     for (int i = 0; i < channelNames.size(); ++i) {
         auto name = channelNames[i];
         auto srcContainer = pv->local()->extraPerParticle.getGenericData(name);
-        channelData[i].genericCopy(srcContainer, stream); 
+        hostChannels[i].genericCopy(srcContainer, stream); 
     }
 }
 
@@ -65,19 +91,29 @@ void ParticleSenderPlugin::serializeAndSend(cudaStream_t stream)
 
     debug2("Plugin %s is sending now data", name.c_str());
     
-    for (auto& p : particles)
+    auto& hostParticles = packing ? spareParticles   : particles;
+    auto& hostChannels  = packing ? spareChannelData : channelData;
+
+    for (auto& p : hostParticles)
         p.r = simulation->domain.local2global(p.r);
 
-    debug2("Plugin %s is packing now data", name.c_str());
-    SimpleSerializer::serialize(sendBuffer, currentTime, particles, channelData);
-    send(sendBuffer);
+    if (packing)
+    {
+        SimpleSerializer::serialize(sendBuffer, currentTime, hostParticles, hostChannels);
+        send(sendBuffer);
+    }
+    else
+    {
+        SimpleSerializer::describe(segments, currentTime, hostParticles, hostChannels);
+        send(segments);
+    }
 }
 
 
 
 
-ParticleDumperPlugin::ParticleDumperPlugin(std::string name, std::string path) :
-    PostprocessPlugin(name), path(path), positions(new std::vector<float>())
+ParticleDumperPlugin::ParticleDumperPlugin(std::string name, std::string path, bool timeSeries) :
+    PostprocessPlugin(name), path(path), timeSeries(timeSeries), positions(new std::vector<float>())
 {}
 
 void ParticleDumperPlugin::handshake()
@@ -115,37 +151,67 @@ void ParticleDumperPlugin::handshake()
     // Create the required folder
     createFoldersCollective(comm, parentPath(path));
 
-    debug2("Plugin '%s' was set up to dump channels %s. Path is %s", name.c_str(), allNames.c_str(), path.c_str());
-}
+    if (timeSeries)
+        timeSeriesWriter = std::unique_ptr<XDMF::TimeSeriesWriter>(new XDMF::TimeSeriesWriter(path, comm));
 
-static void unpack_particles(const std::vector<Particle> &particles, std::vector<float> &pos, std::vector<float> &vel)
-{
-    int n = particles.size();
-    pos.resize(3 * n);
-    vel.resize(3 * n);
-
-    for (int i = 0; i < n; ++i) {
-        auto p = particles[i];
-        pos[3*i + 0] = p.r.x;
-        pos[3*i + 1] = p.r.y;
-        pos[3*i + 2] = p.r.z;
-
-        vel[3*i + 0] = p.u.x;
-        vel[3*i + 1] = p.u.y;
-        vel[3*i + 2] = p.u.z;
-    }
+    debug2("Plugin '%s' was set up to dump channels %s. Path is %s", name.c_str(), allNames.c_str(), path.c_str());
 }
 
 float ParticleDumperPlugin::_recvAndUnpack()
 {
     float t;
-    SimpleSerializer::deserialize(data, t, particles, channelData);
-        
-    unpack_particles(particles, *positions, velocities);
-    
+    const int nsrc = nSources();
+
+    // Arrays are read in place, only the particles are rearranged
+    std::vector<ArrayView<Particle>> particles(nsrc);
+    std::vector<std::vector<ArrayView<float>>> channelViews(nsrc);
+
+    int n = 0;
+    for (int i = 0; i < nsrc; i++)
+    {
+        SimpleSerializer::deserialize(sourceData(i), t, particles[i], channelViews[i]);
+        n += particles[i].size();
+    }
+
+    positions->resize(3 * n);
+    velocities.resize(3 * n);
+
+    int id = 0;
+    for (auto& view : particles)
+        for (int i = 0; i < view.size(); i++, id++)
+        {
+            const Particle p = view[i];
+            (*positions)[3*id + 0] = p.r.x;
+            (*positions)[3*id + 1] = p.r.y;
+            (*positions)[3*id + 2] = p.r.z;
+
+            velocities[3*id + 0] = p.u.x;
+            velocities[3*id + 1] = p.u.y;
+            velocities[3*id + 2] = p.u.z;
+        }
+
     channels[0].data = velocities.data();
-    for (int i = 0; i < channelData.size(); i++)
-        channels[i+1].data = channelData[i].data();    
+
+    // Channels of the other served simulation tasks are appended to the first ones
+    channelData.resize(channels.size() - 1);
+    for (int c = 0; c < channelData.size(); c++)
+    {
+        auto& view = channelViews[0][c];
+
+        if (nsrc == 1 && view.aligned())
+        {
+            channels[c+1].data = (void*) view.data();
+            continue;
+        }
+
+        channelData[c].clear();
+        for (auto& views : channelViews)
+            views[c].appendTo(channelData[c]);
+
+        channels[c+1].data = channelData[c].data();
+    }
+
+    return t;
 }
 
 void ParticleDumperPlugin::deserialize(MPI_Status& stat)
@@ -153,6 +219,12 @@ void ParticleDumperPlugin::deserialize(MPI_Status& stat)
     debug2("Plugin '%s' will dump right now", name.c_str());
 
     float t = _recvAndUnpack();
+
+    if (timeSeries)
+    {
+        timeSeriesWriter->append(positions, channels, t);
+        return;
+    }
     
     std::string fname = path + getStrZeroPadded(timeStamp++, zeroPadding);
     
@@ -4,6 +4,8 @@
 #include <string>
 
 #include <plugins/interface.h>
+#include <plugins/simple_serializer.h>
+#include <plugins/particle_filter.h>
 #include <core/containers.h>
 #include <core/datatypes.h>
 
@@ -20,9 +22,11 @@ public:
         Scalar, Vector, Tensor6
     };
     
+    /// Only the particles selected by \p filter are sent, all of them by default
     ParticleSenderPlugin(std::string name, std::string pvName, int dumpEvery,
                          std::vector<std::string> channelNames,
-                         std::vector<ChannelType> channelTypes);
+                         std::vector<ChannelType> channelTypes,
+                         ParticleFilter filter = ParticleFilter());
 
     void setup(Simulation *simulation, const MPI_Comm& comm, const MPI_Comm& interComm) override;
     void handshake() override;
@@ -43,14 +47,26 @@ protected:
     std::vector<ChannelType> channelTypes;
     std::vector<HostBuffer<float>> channelData;
 
+    // Used instead of the buffers above while the previous dump is still read from them,
+    // that dump is then packed into the send ring
+    HostBuffer<Particle> spareParticles;
+    std::vector<HostBuffer<float>> spareChannelData;
+    bool packing = false;
+
     std::vector<char> sendBuffer;
+    MessageSegments segments;
+
+    ParticleFilter filter;
+    DeviceBuffer<Particle> selectedParticles;
+    DeviceBuffer<float> selectedChannel;
 };
 
 
 class ParticleDumperPlugin : public PostprocessPlugin
 {
 public:
-    ParticleDumperPlugin(std::string name, std::string path);
+    /// With \p timeSeries all the dumps are appended to <path>.h5 and <path>.xmf
+    ParticleDumperPlugin(std::string name, std::string path, bool timeSeries = false);
 
     void deserialize(MPI_Status& stat) override;
     void handshake() override;
@@ -63,7 +79,9 @@ protected:
     const int zeroPadding = 5;
     std::string path;
 
-    std::vector<Particle> particles;
+    bool timeSeries;
+    std::unique_ptr<XDMF::TimeSeriesWriter> timeSeriesWriter;
+
     std::vector<float> velocities;
     std::shared_ptr<std::vector<float>> positions;
 
@@ -26,7 +26,6 @@ void ParticleWithMeshSenderPlugin::handshake()
 
     auto& mesh = static_cast<ObjectVector*>(pv)->mesh;
 
-    waitPrevSend();
     SimpleSerializer::serialize(sendBuffer, mesh->getNvertices(), mesh->triangles);
     send(sendBuffer);
 }
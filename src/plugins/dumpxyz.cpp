@@ -5,6 +5,7 @@
 #include <core/simulation.h>
 #include <core/pvs/particle_vector.h>
 #include "utils/xyz.h"
+#include "utils/dcd.h"
 
 
 XYZPlugin::XYZPlugin(std::string name, std::string pvName, int dumpEvery) :
@@ -37,17 +38,18 @@ void XYZPlugin::serializeAndSend(cudaStream_t stream)
     for (auto& p : downloaded)
         p.r = simulation->domain.local2global(p.r);
 
-    waitPrevSend();
     SimpleSerializer::serialize(data, pv->name, downloaded);
     send(data);
 }
 
 //=================================================================================
 
-XYZDumper::XYZDumper(std::string name, std::string path) :
-        PostprocessPlugin(name), path(path)
+XYZDumper::XYZDumper(std::string name, std::string path, Format format) :
+        PostprocessPlugin(name), path(path), format(format)
 {    }
 
+XYZDumper::~XYZDumper() = default;
+
 void XYZDumper::setup(const MPI_Comm& comm, const MPI_Comm& interComm)
 {
     PostprocessPlugin::setup(comm, interComm);
@@ -60,11 +62,28 @@ void XYZDumper::deserialize(MPI_Status& stat)
 
     SimpleSerializer::deserialize(data, pvName, ps);
 
+    for (int i = 1; i < nSources(); i++)
+    {
+        std::vector<Particle> otherPs;
+        SimpleSerializer::deserialize(sourceData(i), pvName, otherPs);
+        ps.insert(ps.end(), otherPs.begin(), otherPs.end());
+    }
+
+    if (!activated) return;
+
+    if (format == Format::DCD)
+    {
+        if (!dcdWriter)
+            dcdWriter = std::unique_ptr<DCDWriter>(new DCDWriter(path + "/" + pvName + ".dcd"));
+
+        dcdWriter->write(comm, ps.data(), ps.size());
+        return;
+    }
+
     std::string tstr = std::to_string(timeStamp++);
     std::string currentFname = path + "/" + pvName + "_" + std::string(5 - tstr.length(), '0') + tstr + ".xyz";
 
-    if (activated)
-        writeXYZ(comm, currentFname, ps.data(), ps.size());
+    writeXYZ(comm, currentFname, ps.data(), ps.size());
 }
 
 
@@ -4,9 +4,11 @@
 #include <core/containers.h>
 #include <core/datatypes.h>
 
+#include <memory>
 #include <vector>
 
 class ParticleVector;
+class DCDWriter;
 class CellList;
 
 class XYZPlugin : public SimulationPlugin
@@ -35,20 +37,29 @@ public:
 
 class XYZDumper : public PostprocessPlugin
 {
+public:
+    enum class Format {
+        XYZ, DCD
+    };
+
 private:
     std::string path;
     int3 nranks3D;
+    Format format;
 
     bool activated = true;
     int timeStamp = 0;
 
     std::vector<Particle> ps;
 
+    /// All the frames go to one file <path>/<pv_name>.dcd
+    std::unique_ptr<DCDWriter> dcdWriter;
+
 public:
-    XYZDumper(std::string name, std::string path);
+    XYZDumper(std::string name, std::string path, Format format = Format::XYZ);
 
     void deserialize(MPI_Status& stat) override;
     void setup(const MPI_Comm& comm, const MPI_Comm& interComm) override;
 
-    ~XYZDumper() {};
+    ~XYZDumper();
 };
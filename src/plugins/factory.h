@@ -142,15 +142,19 @@ namespace PluginFactory
 
     static std::pair< ParticleSenderPlugin*, ParticleDumperPlugin* >
     createDumpParticlesPlugin(bool computeTask, std::string name, ParticleVector *pv, int dumpEvery,
-                              std::vector< std::pair<std::string, std::string> > channels, std::string path)
+                              std::vector< std::pair<std::string, std::string> > channels, std::string path,
+                              bool timeSeries, std::vector<float> box, std::vector<float> sphere,
+                              Wall* wall, PyTypes::float2 sdfRange, int subsampleEvery)
     {
         std::vector<std::string> names;
         std::vector<ParticleSenderPlugin::ChannelType> types;
 
         extractChannelInfos(channels, names, types);
+
+        ParticleFilter filter(box, sphere, wall != nullptr ? wall->name : "", make_float2(sdfRange), subsampleEvery);
         
-        auto simPl  = computeTask ? new ParticleSenderPlugin(name, pv->name, dumpEvery, names, types) : nullptr;
-        auto postPl = computeTask ? nullptr : new ParticleDumperPlugin(name, path);
+        auto simPl  = computeTask ? new ParticleSenderPlugin(name, pv->name, dumpEvery, names, types, std::move(filter)) : nullptr;
+        auto postPl = computeTask ? nullptr : new ParticleDumperPlugin(name, path, timeSeries);
 
         return { simPl, postPl };
     }
@@ -171,10 +175,15 @@ namespace PluginFactory
     }
 
     static std::pair< XYZPlugin*, XYZDumper* >
-        createDumpXYZPlugin(bool computeTask, std::string name, ParticleVector* pv, int dumpEvery, std::string path)
+        createDumpXYZPlugin(bool computeTask, std::string name, ParticleVector* pv, int dumpEvery, std::string path, std::string format)
     {
+        XYZDumper::Format fmt;
+        if      (format == "xyz") fmt = XYZDumper::Format::XYZ;
+        else if (format == "dcd") fmt = XYZDumper::Format::DCD;
+        else die("Unknown format '%s' of plugin '%s', expected 'xyz' or 'dcd'", format.c_str(), name.c_str());
+
         auto simPl  = computeTask ? new XYZPlugin(name, pv->name, dumpEvery) : nullptr;
-        auto postPl = computeTask ? nullptr : new XYZDumper(name, path);
+        auto postPl = computeTask ? nullptr : new XYZDumper(name, path, fmt);
 
         return { simPl, postPl };
     }
@@ -1,8 +1,11 @@
 #include "interface.h"
+#include "simple_serializer.h"
+
+#include <core/utils/timer.h>
 
 
 SimulationPlugin::SimulationPlugin(std::string name) :
-    Plugin<YmrSimulationObject>(name), sizeReq(MPI_REQUEST_NULL), dataReq(MPI_REQUEST_NULL)
+    Plugin<YmrSimulationObject>(name), sendSlots(2)
 {}
 
 void SimulationPlugin::beforeForces               (cudaStream_t stream) {};
@@ -25,39 +28,127 @@ void SimulationPlugin::setup(Simulation* simulation, const MPI_Comm& comm, const
     debug("Setting up simulation plugin '%s', MPI tag is %d", name.c_str(), _tag());
     this->simulation = simulation;
     _setup(comm, interComm);
+
+    if (interComm == MPI_COMM_NULL) return;
+
+    // Consecutive simulation tasks share the same postprocess task
+    int interRank, ncompute, npost;
+    MPI_Check( MPI_Comm_rank(interComm, &interRank) );
+    MPI_Check( MPI_Comm_size(interComm, &ncompute) );
+    MPI_Check( MPI_Comm_remote_size(interComm, &npost) );
+    postRank = servingPostTask(interRank, ncompute, npost);
 }
 
 void SimulationPlugin::finalize()
 {
     debug3("Plugin %s is finishing all the communications", name.c_str());
-    MPI_Check( MPI_Wait(&sizeReq, MPI_STATUS_IGNORE) );
-    MPI_Check( MPI_Wait(&dataReq, MPI_STATUS_IGNORE) );
+    waitAllSends();
+
+    if (nStalls > 0)
+        info("Plugin '%s' waited for the postprocess %d times, %f ms in total. Consider more send buffers",
+             name.c_str(), nStalls, stallTime);
 }
 
-void SimulationPlugin::waitPrevSend()
+void SimulationPlugin::setSendBuffers(int n)
 {
-    MPI_Check( MPI_Wait(&sizeReq, MPI_STATUS_IGNORE) );
-    MPI_Check( MPI_Wait(&dataReq, MPI_STATUS_IGNORE) );
-    sizeReq = MPI_REQUEST_NULL;
-    dataReq = MPI_REQUEST_NULL;
+    if (n < 1)
+        die("Plugin '%s' needs at least one send buffer, got %d", name.c_str(), n);
+
+    // Slots can't move while their messages are in flight
+    waitAllSends();
+    sendSlots.resize(n);
+    nextSlot = 0;
 }
 
-void SimulationPlugin::send(const std::vector<char>& data)
+void SimulationPlugin::waitAllSends()
 {
-    send(data.data(), data.size());
+    for (auto& slot : sendSlots)
+        MPI_Check( MPI_Waitall(2, slot.requests, MPI_STATUSES_IGNORE) );
+
+    borrowedSlot = -1;
 }
 
-void SimulationPlugin::send(const void* data, int sizeInBytes)
+bool SimulationPlugin::borrowedSendDone()
+{
+    if (borrowedSlot < 0) return true;
+
+    int done;
+    MPI_Check( MPI_Testall(2, sendSlots[borrowedSlot].requests, &done, MPI_STATUSES_IGNORE) );
+
+    if (done) borrowedSlot = -1;
+    return done;
+}
+
+SimulationPlugin::SendSlot& SimulationPlugin::acquireSendSlot()
+{
+    // Slot is free below, so is the message borrowing the arrays if it was sent from there
+    if (nextSlot == borrowedSlot) borrowedSlot = -1;
+
+    auto& slot = sendSlots[nextSlot];
+    nextSlot = (nextSlot + 1) % sendSlots.size();
+
+    int done;
+    MPI_Check( MPI_Testall(2, slot.requests, &done, MPI_STATUSES_IGNORE) );
+
+    if (!done)
+    {
+        mTimer timer;
+        timer.start();
+        MPI_Check( MPI_Waitall(2, slot.requests, MPI_STATUSES_IGNORE) );
+
+        const double elapsed = timer.elapsed();
+        nStalls++;
+        stallTime += elapsed;
+
+        debug("Plugin '%s' waited %f ms for the postprocess to receive the oldest message", name.c_str(), elapsed);
+    }
+
+    return slot;
+}
+
+void SimulationPlugin::issueSend(SendSlot& slot)
 {
-    // So that async Isend of the size works on
-    // valid address
-    localSendSize = sizeInBytes;
+    slot.size = slot.buffer.size();
+
+    debug2("Plugin '%s' is sending the data (%d bytes)", name.c_str(), slot.size);
+    MPI_Check( MPI_Issend(&slot.size, 1, MPI_INT, postRank, 2*_tag(), interComm, &slot.requests[0]) );
+    MPI_Check( MPI_Issend(slot.buffer.data(), slot.size, MPI_BYTE, postRank, 2*_tag()+1, interComm, &slot.requests[1]) );
+}
 
-    waitPrevSend();
-        
-    debug2("Plugin '%s' has is sending the data (%d bytes)", name.c_str(), sizeInBytes);
-    MPI_Check( MPI_Issend(&localSendSize, 1, MPI_INT, rank, 2*_tag(), interComm, &sizeReq) );
-    MPI_Check( MPI_Issend(data, sizeInBytes, MPI_BYTE, rank, 2*_tag()+1, interComm, &dataReq) );
+void SimulationPlugin::send(std::vector<char>& data)
+{
+    auto& slot = acquireSendSlot();
+    slot.buffer.swap(data);
+    issueSend(slot);
+}
+
+void SimulationPlugin::send(MessageSegments& segments)
+{
+    const int slotId = nextSlot;
+    auto& slot = acquireSendSlot();
+    borrowedSlot = slotId;
+    slot.size = segments.totalSize();
+
+    debug2("Plugin '%s' is sending the data (%d bytes), %d arrays are read in place",
+           name.c_str(), slot.size, segments.nBorrowed());
+
+    // Swapping keeps the packed part where the datatype points to
+    MPI_Datatype type = segments.createType();
+    segments.swapArena(slot.buffer);
+
+    MPI_Check( MPI_Issend(&slot.size, 1, MPI_INT, postRank, 2*_tag(), interComm, &slot.requests[0]) );
+    MPI_Check( MPI_Issend(MPI_BOTTOM, 1, type, postRank, 2*_tag()+1, interComm, &slot.requests[1]) );
+
+    // Pending sends keep the type alive
+    MPI_Check( MPI_Type_free(&type) );
+}
+
+void SimulationPlugin::send(const void* data, int sizeInBytes)
+{
+    // Slot keeps its capacity, so the payload is copied once and usually without allocating
+    auto& slot = acquireSendSlot();
+    slot.buffer.assign((const char*)data, (const char*)data + sizeInBytes);
+    issueSend(slot);
 }
 
 
@@ -71,34 +162,59 @@ PostprocessPlugin::PostprocessPlugin(std::string name) :
 MPI_Request PostprocessPlugin::waitData()
 {
     MPI_Request req;
-    MPI_Check( MPI_Irecv(&size, 1, MPI_INT, rank, 2*_tag(), interComm, &req) );
+    MPI_Check( MPI_Irecv(&size, 1, MPI_INT, firstSource, 2*_tag(), interComm, &req) );
     return req;
 }
 
-void PostprocessPlugin::recv()
+static void recvMessage(std::vector<char>& buffer, int size, int source, int tag, MPI_Comm interComm, const std::string& name)
 {
-    data.resize(size);
+    buffer.resize(size);
     MPI_Status status;
     int count;
-    MPI_Check( MPI_Recv(data.data(), size, MPI_BYTE, rank, 2*_tag()+1, interComm, &status) );
+    MPI_Check( MPI_Recv(buffer.data(), size, MPI_BYTE, source, tag, interComm, &status) );
     MPI_Check( MPI_Get_count(&status, MPI_BYTE, &count) );
 
     if (count != size)
         error("Plugin '%s' was going to receive %d bytes, but actually got %d. That may be fatal",
               name.c_str(), size, count);
 
-    debug3("Plugin '%s' has received the data (%d bytes)", name.c_str(), count);
+    debug3("Plugin '%s' has received the data from simulation task %d (%d bytes)", name.c_str(), source, count);
 }
 
-void PostprocessPlugin::deserialize(MPI_Status& stat) {};
+void PostprocessPlugin::recv()
+{
+    recvMessage(data, size, firstSource, 2*_tag()+1, interComm, name);
+
+    // The other simulation tasks send their messages at the same time step, no need to poll them
+    for (int i = 0; i < otherData.size(); i++)
+    {
+        const int source = firstSource + i + 1;
+        int otherSize;
+        MPI_Check( MPI_Recv(&otherSize, 1, MPI_INT, source, 2*_tag(), interComm, MPI_STATUS_IGNORE) );
+        recvMessage(otherData[i], otherSize, source, 2*_tag()+1, interComm, name);
+    }
+}
 
-void PostprocessPlugin::setup(const MPI_Comm& comm, const MPI_Comm& interComm)
+int PostprocessPlugin::nSources() const
 {
-    debug("Setting up postproc plugin '%s', MPI tag is %d", name.c_str(), _tag());
-    _setup(comm, interComm);
+    return otherData.size() + 1;
 }
 
+const std::vector<char>& PostprocessPlugin::sourceData(int i) const
+{
+    return i == 0 ? data : otherData[i-1];
+}
 
+void PostprocessPlugin::deserialize(MPI_Status& stat) {};
 
+void PostprocessPlugin::setup(const MPI_Comm& comm, const MPI_Comm& interComm)
+{
+    debug("Setting up postproc plugin '%s', MPI tag is %d", name.c_str(), _tag());
+    _setup(comm, interComm);
 
+    int ncompute;
+    MPI_Check( MPI_Comm_remote_size(interComm, &ncompute) );
 
+    firstSource = firstServedTask(rank, ncompute, nranks);
+    otherData.resize(firstServedTask(rank+1, ncompute, nranks) - firstSource - 1);
+}
@@ -7,6 +7,29 @@
 #include "core/ymero_object.h"
 
 class Simulation;
+class MessageSegments;
+
+/**
+ * Simulation tasks are served by the postprocess tasks in groups of consecutive ranks,
+ * the first ncompute % npost groups have one simulation task more than the others.
+ * Postprocess task \p postRank serves the simulation tasks
+ * [firstServedTask(postRank), firstServedTask(postRank+1))
+ */
+inline int firstServedTask(int postRank, int ncompute, int npost)
+{
+    const int base = ncompute / npost, rem = ncompute % npost;
+    return postRank * base + (postRank < rem ? postRank : rem);
+}
+
+/// Postprocess task serving simulation task \p computeRank, see firstServedTask()
+inline int servingPostTask(int computeRank, int ncompute, int npost)
+{
+    const int base = ncompute / npost, rem = ncompute % npost;
+    const int nlarger = rem * (base + 1);
+
+    if (computeRank < nlarger) return computeRank / (base + 1);
+    return rem + (computeRank - nlarger) / base;
+}
 
 template<class Base>
 class Plugin : public Base
@@ -59,18 +82,58 @@ public:
     virtual void setup(Simulation* simulation, const MPI_Comm& comm, const MPI_Comm& interComm);
     virtual void finalize();
 
+    /**
+     * Up to \p n messages may be in flight to the postprocess,
+     * the simulation only waits when all of them are still not received
+     */
+    void setSendBuffers(int n);
+
     virtual ~SimulationPlugin() = default;
 
 protected:
-    int localSendSize;
-    MPI_Request sizeReq, dataReq;
-
     float currentTime;
     int currentTimeStep;
 
-    void waitPrevSend();
-    void send(const std::vector<char>& data);
+    /// Takes over the contents of \p data (swaps it with a free buffer), so it can be refilled right away
+    void send(std::vector<char>& data);
     void send(const void* data, int sizeInBytes);
+
+    /**
+     * Sends the message without packing its large arrays, MPI reads them in place.
+     * They must not be changed before borrowedSendDone(), the packed part is taken over like in send(data)
+     */
+    void send(MessageSegments& segments);
+
+    /// Wait until all the messages of this plugin are received
+    void waitAllSends();
+
+    /// Check without waiting whether the last message sent with send(segments) has been received
+    bool borrowedSendDone();
+
+private:
+    struct SendSlot
+    {
+        std::vector<char> buffer;
+        int size;
+        MPI_Request requests[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+    };
+
+    // Ring of buffers, reused in the order they were sent
+    std::vector<SendSlot> sendSlots;
+    int nextSlot = 0;
+
+    // Slot of the message still reading the arrays in place, -1 if none
+    int borrowedSlot = -1;
+
+    // Back-pressure of the postprocess: how many times and how long the simulation waited for a free buffer
+    int nStalls = 0;
+    double stallTime = 0;
+
+    // Postprocess task receiving the messages, several simulation tasks may share it
+    int postRank;
+
+    SendSlot& acquireSendSlot();
+    void issueSend(SendSlot& slot);
 };
 
 
@@ -91,8 +154,23 @@ public:
     virtual ~PostprocessPlugin() = default;
 
 protected:
+    /// Message of the first served simulation task
     std::vector<char> data;
-    int size;    
+    int size;
+
+    /// Number of the simulation tasks served by this task, each of them sends its own message
+    int nSources() const;
+
+    /**
+     * Message of the i-th served simulation task, in the order of their ranks.
+     * sourceData(0) is #data.
+     * Plugins merge them into one contribution of this task to the collective output
+     */
+    const std::vector<char>& sourceData(int i) const;
+
+private:
+    int firstSource;
+    std::vector<std::vector<char>> otherData;
 };
 
 
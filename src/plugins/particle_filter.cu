@@ -0,0 +1,141 @@
+#include "particle_filter.h"
+
+#include <core/simulation.h>
+#include <core/pvs/particle_vector.h>
+#include <core/pvs/views/pv.h>
+#include <core/walls/interface.h>
+#include <core/utils/kernel_launch.h>
+#include <core/utils/cuda_common.h>
+
+#include <extern/cub/cub/device/device_scan.cuh>
+
+namespace ParticleFilterKernels
+{
+
+__global__ void markSelected(PVview view, DomainInfo domain, ParticleFilter::Params params, const float* sdfs, int* flags)
+{
+    const int pid = blockIdx.x * blockDim.x + threadIdx.x;
+    if (pid >= view.size) return;
+
+    const Particle p(view.particles, pid);
+    const float sdf = sdfs != nullptr ? sdfs[pid] : 0.0f;
+
+    flags[pid] = params.keep(p.getId(), domain.local2global(p.r), sdf) ? 1 : 0;
+}
+
+__global__ void gatherSelected(int n, const int* flags, const int* offsets, const float* src, float* dst, int words)
+{
+    const int gid = blockIdx.x * blockDim.x + threadIdx.x;
+    const int pid = gid / words;
+    const int word = gid % words;
+    if (pid >= n || !flags[pid]) return;
+
+    dst[offsets[pid] * words + word] = src[pid * words + word];
+}
+
+} // namespace ParticleFilterKernels
+
+
+ParticleFilter::ParticleFilter(std::vector<float> box, std::vector<float> sphere,
+                               std::string wallName, float2 sdfRange, int every) :
+    wallName(wallName)
+{
+    if (!box.empty())
+    {
+        if (box.size() != 6)
+            die("Particle filter needs 6 numbers for a box: low and high corners, got %d", (int)box.size());
+
+        params.useBox = true;
+        params.low  = make_float3(box[0], box[1], box[2]);
+        params.high = make_float3(box[3], box[4], box[5]);
+    }
+
+    if (!sphere.empty())
+    {
+        if (sphere.size() != 4)
+            die("Particle filter needs 4 numbers for a sphere: center and radius, got %d", (int)sphere.size());
+
+        params.useSphere = true;
+        params.center  = make_float3(sphere[0], sphere[1], sphere[2]);
+        params.radius2 = sphere[3] * sphere[3];
+    }
+
+    if (wallName != "")
+    {
+        params.useSdf = true;
+        params.sdfMin = sdfRange.x;
+        params.sdfMax = sdfRange.y;
+    }
+
+    if (every < 1)
+        die("Particle filter can keep one particle out of %d", every);
+    params.every = every;
+}
+
+void ParticleFilter::setup(Simulation* simulation, std::string pluginName)
+{
+    if (!params.useSdf) return;
+
+    wall = dynamic_cast<SDF_basedWall*>(simulation->getWallByNameOrDie(wallName));
+
+    if (wall == nullptr)
+        die("Plugin '%s' can only select particles by distance to SDF-based walls, but got wall '%s'",
+            pluginName.c_str(), wallName.c_str());
+}
+
+bool ParticleFilter::active() const
+{
+    return params.useBox || params.useSphere || params.useSdf || params.every > 1;
+}
+
+void ParticleFilter::select(LocalParticleVector* lpv, DomainInfo domain, cudaStream_t stream)
+{
+    PVview view(lpv->pv, lpv);
+    nParticles = view.size;
+
+    if (wall != nullptr)
+        wall->sdfPerParticle(lpv, &sdfs, nullptr, 0.0f, stream);
+
+    // One more entry, such that the scan ends with the total
+    flags  .resize_anew(nParticles + 1);
+    offsets.resize_anew(nParticles + 1);
+    flags.clear(stream);
+
+    const int nthreads = 128;
+    SAFE_KERNEL_LAUNCH(
+            ParticleFilterKernels::markSelected,
+            getNblocks(view.size, nthreads), nthreads, 0, stream,
+            view, domain, params, wall != nullptr ? sdfs.devPtr() : nullptr, flags.devPtr() );
+
+    size_t bufSize;
+    cub::DeviceScan::ExclusiveSum(nullptr, bufSize, flags.devPtr(), offsets.devPtr(), nParticles+1, stream);
+    scanBuffer.resize_anew(bufSize);
+    cub::DeviceScan::ExclusiveSum(scanBuffer.devPtr(), bufSize, flags.devPtr(), offsets.devPtr(), nParticles+1, stream);
+
+    CUDA_Check( cudaMemcpyAsync(total.hostPtr(), offsets.devPtr() + nParticles, sizeof(int), cudaMemcpyDeviceToHost, stream) );
+    CUDA_Check( cudaStreamSynchronize(stream) );
+    nSelected = total[0];
+
+    debug2("Particle filter selected %d out of %d particles of '%s'", nSelected, nParticles, lpv->pv->name.c_str());
+}
+
+void ParticleFilter::gather(const GPUcontainer* src, GPUcontainer* dst, cudaStream_t stream)
+{
+    const int entryBytes = src->datatype_size();
+    if (entryBytes % sizeof(float) != 0 || entryBytes % dst->datatype_size() != 0)
+        die("Particle filter can't gather entries of %d bytes into entries of %d bytes",
+            entryBytes, dst->datatype_size());
+
+    if (src->size() != nParticles)
+        die("Particle filter selected from %d particles, but got an array of %d", nParticles, src->size());
+
+    const int words = entryBytes / sizeof(float);
+    dst->resize_anew(nSelected * entryBytes / dst->datatype_size());
+
+    const int nthreads = 128;
+    SAFE_KERNEL_LAUNCH(
+            ParticleFilterKernels::gatherSelected,
+            getNblocks(nParticles * words, nthreads), nthreads, 0, stream,
+            nParticles, flags.devPtr(), offsets.devPtr(),
+            (const float*)src->genericDevPtr(), (float*)dst->genericDevPtr(), words );
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <core/containers.h>
+#include <core/datatypes.h>
+#include <core/domain.h>
+#include <core/utils/cpu_gpu_defines.h>
+#include <core/utils/helper_math.h>
+
+#include <string>
+#include <vector>
+
+class LocalParticleVector;
+class SDF_basedWall;
+class Simulation;
+
+/**
+ * Selects a part of the particles to dump: the ones inside all the given regions
+ * (box, sphere, distance range to an SDF-based wall), and out of them
+ * one in every \e every, picked by a hash of the particle id.
+ * The same particles are therefore picked at every dump, whatever rank they are on.
+ *
+ * Selection is done on the device and keeps the order of the particles,
+ * only the selected particles and their channels are then gathered and downloaded.
+ */
+class ParticleFilter
+{
+public:
+    /// Device side description of the filter
+    struct Params
+    {
+        bool useBox = false;
+        float3 low, high;
+
+        bool useSphere = false;
+        float3 center;
+        float radius2;
+
+        bool useSdf = false;
+        float sdfMin, sdfMax;
+
+        int every = 1;
+
+        /// \p r is in global coordinates
+        __HD__ inline bool keep(int64_t id, float3 r, float sdf) const
+        {
+            if (useBox && (r.x < low.x || r.x >= high.x ||
+                           r.y < low.y || r.y >= high.y ||
+                           r.z < low.z || r.z >= high.z))
+                return false;
+
+            if (useSphere && dot(r - center, r - center) > radius2)
+                return false;
+
+            if (useSdf && (sdf < sdfMin || sdf > sdfMax))
+                return false;
+
+            return every <= 1 || mixId((uint64_t)id) % every == 0;
+        }
+
+        /// Bits of the ids are mixed such that the subsampling does not follow the spatial order of the ids
+        __HD__ static inline uint64_t mixId(uint64_t x)
+        {
+            x ^= x >> 30;  x *= 0xbf58476d1ce4e5b9ull;
+            x ^= x >> 27;  x *= 0x94d049bb133111ebull;
+            x ^= x >> 31;
+            return x;
+        }
+    };
+
+    /**
+     * @param box empty, or low and high corners of the box in global coordinates (6 numbers)
+     * @param sphere empty, or center and radius of the sphere in global coordinates (4 numbers)
+     * @param wallName empty, or name of the SDF-based wall
+     * @param sdfRange particles with the wall SDF within this range are kept.
+     *        SDF is negative in the simulation domain and positive inside the wall,
+     *        the default keeps a layer of thickness 1 next to the wall
+     * @param every keep one particle out of that many
+     */
+    ParticleFilter(std::vector<float> box = {}, std::vector<float> sphere = {},
+                   std::string wallName = "", float2 sdfRange = make_float2(-1, 0), int every = 1);
+
+    void setup(Simulation* simulation, std::string pluginName);
+
+    /// False if all the particles are kept
+    bool active() const;
+
+    /// Find the selected particles of \p lpv, waits for the \p stream to get their number
+    void select(LocalParticleVector* lpv, DomainInfo domain, cudaStream_t stream);
+
+    /// Number of particles found by the last select()
+    int size() const { return nSelected; }
+
+    /**
+     * Copy the entries of the selected particles from the per-particle array \p src to \p dst.
+     * Entries have to be made of 4-byte words, \p dst is resized
+     */
+    void gather(const GPUcontainer* src, GPUcontainer* dst, cudaStream_t stream);
+
+private:
+    Params params;
+    std::string wallName;
+    SDF_basedWall* wall = nullptr;
+
+    int nParticles = 0, nSelected = 0;
+
+    DeviceBuffer<float> sdfs;
+    DeviceBuffer<int> flags, offsets;
+    PinnedBuffer<int> total{1};
+    DeviceBuffer<char> scanBuffer;
+};
@@ -216,7 +216,6 @@ void PinObjectPlugin::serializeAndSend(cudaStream_t stream)
     if (rov != nullptr)
         torques.downloadFromDevice(stream);
 
-    waitPrevSend();
     SimpleSerializer::serialize(sendBuffer, currentTime, reportEvery, forces, torques);
     send(sendBuffer);
 
@@ -255,6 +254,16 @@ void ReportPinObjectPlugin::deserialize(MPI_Status& stat)
 
     SimpleSerializer::deserialize(data, currentTime, nsamples, forces, torques);
 
+    // All the simulation tasks report all the objects, sum up the served ones first
+    for (int i = 1; i < nSources(); i++)
+    {
+        std::vector<float4> otherForces, otherTorques;
+        SimpleSerializer::deserialize(sourceData(i), currentTime, nsamples, otherForces, otherTorques);
+
+        for (int j = 0; j < forces.size();  j++) forces [j] += otherForces [j];
+        for (int j = 0; j < torques.size(); j++) torques[j] += otherTorques[j];
+    }
+
     MPI_Check( MPI_Reduce( (rank == 0 ? MPI_IN_PLACE : forces.data()),  forces.data(),  forces.size()*4,  MPI_FLOAT, MPI_SUM, 0, comm) );
     MPI_Check( MPI_Reduce( (rank == 0 ? MPI_IN_PLACE : torques.data()), torques.data(), torques.size()*4, MPI_FLOAT, MPI_SUM, 0, comm) );
 
@@ -1,11 +1,177 @@
 #pragma once
 
 #include <core/containers.h>
+#include <mpi.h>
 #include <string>
 #include <cstring>
+#include <cstdint>
 #include <vector>
 #include <type_traits>
 
+/**
+ * Read-only view of a serialized array of POD, pointing into the message
+ * instead of copying it out. Valid while the message buffer is alive and unchanged.
+ *
+ * Arrays are not aligned in the messages: elements are read with memcpy,
+ * and data() may only be dereferenced if aligned()
+ */
+template<typename T>
+class ArrayView
+{
+public:
+    int  size()  const { return n; }
+    bool empty() const { return n == 0; }
+
+    const T* data() const { return (const T*)ptr; }
+    bool aligned() const { return (uintptr_t)ptr % alignof(T) == 0; }
+
+    T operator[](int i) const
+    {
+        T v;
+        memcpy(&v, ptr + i * sizeof(T), sizeof(T));
+        return v;
+    }
+
+    void appendTo(std::vector<T>& v) const
+    {
+        const int start = v.size();
+        v.resize(start + n);
+        memcpy(v.data() + start, ptr, n * sizeof(T));
+    }
+
+private:
+    friend class SimpleSerializer;
+
+    const char* ptr = nullptr;
+    int n = 0;
+};
+
+/**
+ * Serialized message described as a list of memory segments instead of a single buffer.
+ * Sizes, scalars, strings and small arrays are packed into an arena that is reused
+ * from one message to the next, large arrays of POD are only referenced, such that
+ * MPI reads them in place. The layout is the same as of SimpleSerializer::serialize().
+ *
+ * Referenced arrays must not change until the message is sent.
+ */
+class MessageSegments
+{
+public:
+    /// Arrays of POD of at least that many bytes are referenced instead of packed
+    int minBorrowedBytes = 4096;
+
+    int totalSize() const { return total; }
+    int nBorrowed() const;
+
+    /// Copy the message into a contiguous buffer
+    void gather(std::vector<char>& buf) const;
+
+    /**
+     * Datatype describing the whole message with absolute addresses,
+     * to be used with MPI_BOTTOM and count 1. Has to be freed by the caller
+     */
+    MPI_Datatype createType() const;
+
+    /**
+     * Give the packed part away to \p buffer, which may still be in use while the message
+     * is being sent, and take over the storage of \p buffer as the next arena
+     */
+    void swapArena(std::vector<char>& buffer);
+
+private:
+    friend class SimpleSerializer;
+
+    // Borrowed segments have ptr set, others are stored at offset in the arena,
+    // which may be reallocated while the message is being described
+    struct Segment
+    {
+        const char* ptr;
+        int offset, size;
+    };
+
+    std::vector<char> arena;
+    std::vector<Segment> segments;
+    int total = 0;
+
+    void clear();
+    void pack  (const void* src, int size);
+    void borrow(const void* src, int size);
+    const char* address(const Segment& s) const { return s.ptr ? s.ptr : arena.data() + s.offset; }
+};
+
+inline int MessageSegments::nBorrowed() const
+{
+    int n = 0;
+    for (auto& s : segments)
+        if (s.ptr != nullptr) n++;
+    return n;
+}
+
+inline void MessageSegments::clear()
+{
+    arena.clear();
+    segments.clear();
+    total = 0;
+}
+
+inline void MessageSegments::pack(const void* src, int size)
+{
+    const int offset = arena.size();
+    arena.resize(offset + size);
+    memcpy(arena.data() + offset, src, size);
+
+    if (!segments.empty() && segments.back().ptr == nullptr)
+        segments.back().size += size;
+    else
+        segments.push_back({nullptr, offset, size});
+
+    total += size;
+}
+
+inline void MessageSegments::borrow(const void* src, int size)
+{
+    segments.push_back({(const char*)src, 0, size});
+    total += size;
+}
+
+inline void MessageSegments::gather(std::vector<char>& buf) const
+{
+    buf.resize(total);
+
+    char* dst = buf.data();
+    for (auto& s : segments)
+    {
+        memcpy(dst, address(s), s.size);
+        dst += s.size;
+    }
+}
+
+inline MPI_Datatype MessageSegments::createType() const
+{
+    const int n = segments.size();
+    std::vector<int> lengths(n);
+    std::vector<MPI_Aint> displacements(n);
+
+    for (int i = 0; i < n; i++)
+    {
+        lengths[i] = segments[i].size;
+        MPI_Check( MPI_Get_address(address(segments[i]), &displacements[i]) );
+    }
+
+    MPI_Datatype type;
+    MPI_Check( MPI_Type_create_hindexed(n, lengths.data(), displacements.data(), MPI_BYTE, &type) );
+    MPI_Check( MPI_Type_commit(&type) );
+    return type;
+}
+
+inline void MessageSegments::swapArena(std::vector<char>& buffer)
+{
+    arena.swap(buffer);
+    arena.clear();
+    segments.clear();
+    total = 0;
+}
+
 // Only POD types and std::vectors/HostBuffers/PinnedBuffers of POD and std::strings are supported
 // Container size will be serialized too
 class SimpleSerializer
@@ -64,6 +230,18 @@ private:
         return (int)s.length() + sizeof(int);
     }
 
+    template<typename T> static int sizeOfOne(const ArrayView<T>& v) { return v.size() * sizeof(T) + sizeof(int); }
+
+    template<typename T>
+    static int sizeOfOne(const std::vector<ArrayView<T>>& v)
+    {
+        int tot = sizeof(int);
+        for (auto& element : v)
+            tot += sizeOfOne(element);
+
+        return tot;
+    }
+
     template<typename Arg>
     static int sizeOfOne(const Arg& arg)
     {
@@ -193,6 +371,29 @@ private:
         s.assign(buf, buf+sz);
     }
 
+    template<typename T>
+    static void unpackOne(const char* buf, ArrayView<T>& v)
+    {
+        v.n = *((int*)buf);
+        assert(v.n >= 0);
+        v.ptr = buf + sizeof(int);
+    }
+
+    template<typename T>
+    static void unpackOne(const char* buf, std::vector<ArrayView<T>>& v)
+    {
+        const int sz = *((int*)buf);
+        assert(sz >= 0);
+        v.resize(sz);
+        buf += sizeof(int);
+
+        for (auto& element : v)
+        {
+            unpackOne(buf, element);
+            buf += sizeOfOne(element);
+        }
+    }
+
     template<typename T>
     static void unpackOne(const char* buf, T& v)
     {
@@ -201,6 +402,74 @@ private:
 
     //============================================================================
 
+    // Elements that are not containers are packed byte by byte, even if they are not POD (e.g. Particle),
+    // so arrays of them can be referenced in place
+    template<typename T> struct IsNested                  : std::false_type {};
+    template<typename T> struct IsNested<std::vector <T>> : std::true_type  {};
+    template<typename T> struct IsNested<HostBuffer  <T>> : std::true_type  {};
+    template<typename T> struct IsNested<PinnedBuffer<T>> : std::true_type  {};
+    template<typename T> struct IsNested<ArrayView   <T>> : std::true_type  {};
+    template<typename C, typename Tr, typename A> struct IsNested<std::basic_string<C, Tr, A>> : std::true_type {};
+
+    template <typename T>
+    using EnableIfFlat   = typename std::enable_if< !IsNested<typename std::remove_cv<T>::type>::value >::type*;
+
+    template <typename T>
+    using EnableIfNested = typename std::enable_if<  IsNested<typename std::remove_cv<T>::type>::value >::type*;
+
+    /// Overload for the vectors of plain old data and other flat types
+    template<typename Vec, EnableIfFlat<ValType<Vec>> = nullptr>
+    static void describeVec(MessageSegments& segs, const Vec& v)
+    {
+        const int sz = v.size();
+        const int bytes = sz * sizeof(ValType<Vec>);
+        segs.pack(&sz, sizeof(int));
+
+        if (bytes >= segs.minBorrowedBytes)
+            segs.borrow(v.data(), bytes);
+        else
+            segs.pack(v.data(), bytes);
+    }
+
+    /// Overload for the vectors of other vectors or strings
+    template<typename Vec, EnableIfNested<ValType<Vec>> = nullptr>
+    static void describeVec(MessageSegments& segs, const Vec& v)
+    {
+        const int sz = v.size();
+        segs.pack(&sz, sizeof(int));
+
+        for (auto& element : v)
+            describeOne(segs, element);
+    }
+
+    template<typename T> static void describeOne(MessageSegments& segs, const std::vector <T>& v) { describeVec(segs, v); }
+    template<typename T> static void describeOne(MessageSegments& segs, const HostBuffer  <T>& v) { describeVec(segs, v); }
+    template<typename T> static void describeOne(MessageSegments& segs, const PinnedBuffer<T>& v) { describeVec(segs, v); }
+
+    static void describeOne(MessageSegments& segs, const std::string& s)
+    {
+        const int sz = s.length();
+        segs.pack(&sz, sizeof(int));
+        segs.pack(s.c_str(), sz);
+    }
+
+    template<typename T>
+    static void describeOne(MessageSegments& segs, const T& v)
+    {
+        segs.pack(&v, sizeOfOne(v));
+    }
+
+    static void describeAll(MessageSegments&) {}
+
+    template<typename Arg, typename... OthArgs>
+    static void describeAll(MessageSegments& segs, const Arg& arg, const OthArgs&... othArgs)
+    {
+        describeOne(segs, arg);
+        describeAll(segs, othArgs...);
+    }
+
+    //============================================================================
+
     template<typename Arg>
     static void unpack(const char* buf, Arg& arg)
     {
@@ -232,6 +501,17 @@ public:
         unpack(buf.data(), args...);
     }
 
+    /**
+     * Same message as serialize(), but the large arrays are only referenced by \p segs.
+     * ArrayView arguments may be used in deserialize() to read the arrays without copies
+     */
+    template<typename... Args>
+    static void describe(MessageSegments& segs, const Args&... args)
+    {
+        segs.clear();
+        describeAll(segs, args...);
+    }
+
 
     // Unsafe variants
     template<typename... Args>
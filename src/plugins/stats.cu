@@ -76,7 +76,6 @@ void SimulationStats::serializeAndSend(cudaStream_t stream)
     if (needToDump)
     {
         float tm = timer.elapsedAndReset() / (currentTimeStep < fetchEvery ? 1.0f : fetchEvery);
-        waitPrevSend();
         SimpleSerializer::serialize(sendBuffer, tm, currentTime, currentTimeStep, nparticles, momentum, energy, maxvel);
         send(sendBuffer);
         needToDump = false;
@@ -117,8 +116,32 @@ void PostprocessStats::deserialize(MPI_Status& stat)
 
     SimpleSerializer::deserialize(data, realTime, currentTime, currentTimeStep, nparticles, momentum, energy, maxvel);
 
-    MPI_Check( MPI_Reduce(&nparticles, &minNparticles, 1, MPI_INT, MPI_MIN, 0, comm) );
-    MPI_Check( MPI_Reduce(&nparticles, &maxNparticles, 1, MPI_INT, MPI_MAX, 0, comm) );
+    // Min and max are over the simulation tasks, not over the postprocess ones
+    int localMin = nparticles, localMax = nparticles;
+
+    for (int i = 1; i < nSources(); i++)
+    {
+        float otherRealTime;
+        int otherNparticles;
+        std::vector<ReductionType> otherMomentum, otherEnergy;
+        std::vector<float> otherMaxvel;
+
+        SimpleSerializer::deserialize(sourceData(i), otherRealTime, currentTime, currentTimeStep,
+                                      otherNparticles, otherMomentum, otherEnergy, otherMaxvel);
+
+        localMin = std::min(localMin, otherNparticles);
+        localMax = std::max(localMax, otherNparticles);
+        nparticles += otherNparticles;
+
+        energy[0] += otherEnergy[0];
+        for (int d = 0; d < 3; d++)
+            momentum[d] += otherMomentum[d];
+        maxvel[0] = std::max(maxvel[0], otherMaxvel[0]);
+        realTime  = std::max(realTime,  otherRealTime);
+    }
+
+    MPI_Check( MPI_Reduce(&localMin, &minNparticles, 1, MPI_INT, MPI_MIN, 0, comm) );
+    MPI_Check( MPI_Reduce(&localMax, &maxNparticles, 1, MPI_INT, MPI_MAX, 0, comm) );
     
     MPI_Check( MPI_Reduce(rank == 0 ? MPI_IN_PLACE : &nparticles,     &nparticles,     1, MPI_INT,          MPI_SUM, 0, comm) );
     MPI_Check( MPI_Reduce(rank == 0 ? MPI_IN_PLACE : energy.data(),   energy.data(),   1, mpiReductionType, MPI_SUM, 0, comm) );
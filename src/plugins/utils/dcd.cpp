@@ -0,0 +1,152 @@
+#include "dcd.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+// Fortran unformatted records: every block is surrounded by its size in bytes
+static const int32_t controlRecordSize = 84, titleRecordSize = 164, natomsRecordSize = 4;
+static const MPI_Offset headerSize = 2*4 + controlRecordSize + 2*4 + titleRecordSize + 2*4 + natomsRecordSize;
+
+static std::vector<char> makeHeader(int nframes, int32_t natoms)
+{
+    std::vector<char> header(headerSize, 0);
+    char *dst = header.data();
+
+    auto putInt = [&dst] (int32_t v) {
+        memcpy(dst, &v, sizeof(v));
+        dst += sizeof(v);
+    };
+
+    auto putStr = [&dst] (std::string s, int len) {
+        memset(dst, ' ', len);
+        memcpy(dst, s.c_str(), std::min((int)s.length(), len));
+        dst += len;
+    };
+
+    int32_t control[20] = {0};
+    control[0]  = nframes;  // NSET
+    control[1]  = 0;        // ISTART
+    control[2]  = 1;        // NSAVC
+    control[19] = 24;       // CHARMM version, no unit cell
+
+    putInt(controlRecordSize);
+    putStr("CORD", 4);
+    for (auto c : control) putInt(c);
+    putInt(controlRecordSize);
+
+    putInt(titleRecordSize);
+    putInt(2);
+    putStr("Created by YMeRo", 80);
+    putStr("Particle positions", 80);
+    putInt(titleRecordSize);
+
+    putInt(natomsRecordSize);
+    putInt(natoms);
+    putInt(natomsRecordSize);
+
+    return header;
+}
+
+DCDWriter::DCDWriter(std::string fname) :
+    fname(fname)
+{}
+
+void DCDWriter::write(MPI_Comm comm, const Particle *particles, int np)
+{
+    int rank;
+    MPI_Check( MPI_Comm_rank(comm, &rank) );
+
+    int64_t n = np, total = 0, offset = 0, maxId = -1;
+    for (int i = 0; i < np; i++)
+        maxId = std::max(maxId, particles[i].getId());
+
+    MPI_Check( MPI_Allreduce(&n, &total, 1, MPI_INT64_T, MPI_SUM, comm) );
+    MPI_Check( MPI_Allreduce(MPI_IN_PLACE, &maxId, 1, MPI_INT64_T, MPI_MAX, comm) );
+    MPI_Check( MPI_Exscan(&n, &offset, 1, MPI_INT64_T, MPI_SUM, comm) );
+    if (rank == 0) offset = 0;
+
+    if (natoms < 0)
+    {
+        natoms = total;
+        if (4 * natoms > INT_MAX)
+            die("DCD file '%s' cannot hold %lld particles", fname.c_str(), (long long)natoms);
+    }
+
+    if (total != natoms)
+    {
+        warn("DCD file '%s' is for %lld particles, skipping a frame with %lld",
+             fname.c_str(), (long long)natoms, (long long)total);
+        return;
+    }
+
+    const bool byId = (maxId == natoms-1);
+    if (!byId && nframes == 0)
+        warn("Particle ids are not 0 ... N-1, order of the particles in DCD file '%s' may change between frames", fname.c_str());
+
+    info("dcd dump to %s: frame %d, total number of particles: %lld", fname.c_str(), nframes, (long long)natoms);
+
+    // Position of each particle in the frame
+    std::vector<std::pair<int64_t, int>> slots(np);
+    for (int i = 0; i < np; i++)
+        slots[i] = { byId ? particles[i].getId() : offset + i, i };
+    std::sort(slots.begin(), slots.end());
+
+    // Frame is three records: x, y and z of all the particles. Master rank writes the record sizes,
+    // everything goes with one collective write through a file view in the frame
+    const int64_t recordLength = natoms + 2;
+    const int32_t recordBytes = 4 * natoms;
+
+    std::vector<float> buffer;
+    std::vector<MPI_Aint> displacements;
+
+    auto addMarker = [&] (int64_t pos) {
+        float marker;
+        memcpy(&marker, &recordBytes, sizeof(marker));
+        buffer.push_back(marker);
+        displacements.push_back(pos * sizeof(float));
+    };
+
+    for (int k = 0; k < 3; k++)
+    {
+        const int64_t start = k * recordLength;
+        if (rank == 0) addMarker(start);
+
+        for (auto& s : slots)
+        {
+            const float3 r = particles[s.second].r;
+            buffer.push_back(k == 0 ? r.x : (k == 1 ? r.y : r.z));
+            displacements.push_back( (start + 1 + s.first) * sizeof(float) );
+        }
+
+        if (rank == 0) addMarker(start + natoms + 1);
+    }
+
+    MPI_File f;
+    MPI_Check( MPI_File_open(comm, fname.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &f) );
+    if (nframes == 0)
+        MPI_Check( MPI_File_set_size(f, 0) );
+
+    nframes++;
+
+    // Header keeps the number of frames
+    if (rank == 0)
+    {
+        auto header = makeHeader(nframes, natoms);
+        MPI_Check( MPI_File_write_at(f, 0, header.data(), header.size(), MPI_CHAR, MPI_STATUS_IGNORE) );
+    }
+
+    MPI_Datatype filetype;
+    MPI_Check( MPI_Type_create_hindexed_block(displacements.size(), 1, displacements.data(), MPI_FLOAT, &filetype) );
+    MPI_Check( MPI_Type_commit(&filetype) );
+
+    const MPI_Offset frameStart = headerSize + (MPI_Offset)(nframes-1) * 3 * recordLength * sizeof(float);
+    MPI_Check( MPI_File_set_view(f, frameStart, MPI_FLOAT, filetype, "native", MPI_INFO_NULL) );
+
+    MPI_Status status;
+    MPI_Check( MPI_File_write_at_all(f, 0, buffer.data(), buffer.size(), MPI_FLOAT, &status) );
+
+    MPI_Check( MPI_Type_free(&filetype) );
+    MPI_Check( MPI_File_close(&f) );
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <mpi.h>
+#include <string>
+#include <core/datatypes.h>
+
+/**
+ * Appends frames of particle positions to a binary trajectory in the CHARMM DCD format.
+ * Particles are placed in the frame by their ids if the ids are 0 ... N-1,
+ * and in the order of the ranks otherwise (then it may change from frame to frame).
+ * All the frames must have the same number of particles, others are skipped.
+ */
+class DCDWriter
+{
+public:
+    DCDWriter(std::string fname);
+
+    /// Collective, one MPI_File_write_at_all per frame
+    void write(MPI_Comm comm, const Particle *particles, int np);
+
+private:
+    std::string fname;
+    int nframes{0};
+    int64_t natoms{-1};
+};
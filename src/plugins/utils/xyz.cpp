@@ -1,7 +1,87 @@
 #include "xyz.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Enough for any int and for the floats that fall back to snprintf,
+// fields are at most maxFieldLength-1 characters long
+static const int maxFieldLength = 48;
+
+// "-2147483648"
+static const int maxIntLength = 11;
+
+// Writes the digits of v in reverse order, returns the number of digits
+static int reverseDigits(char *dst, uint64_t v, int minDigits = 1)
+{
+    int n = 0;
+    while (v > 0 || n < minDigits)
+    {
+        dst[n++] = '0' + v % 10;
+        v /= 10;
+    }
+    return n;
+}
+
+static char* putRightAligned(char *dst, const char *reversed, int len, int width)
+{
+    for (int i = len; i < width; i++)
+        *(dst++) = ' ';
+
+    for (int i = len-1; i >= 0; i--)
+        *(dst++) = reversed[i];
+
+    return dst;
+}
+
+static char* putInt(char *dst, int v)
+{
+    char tmp[maxFieldLength];
+    int len = reverseDigits(tmp, std::abs((int64_t)v));
+    if (v < 0) tmp[len++] = '-';
+
+    return putRightAligned(dst, tmp, len, 0);
+}
+
+/**
+ * Same as std::fixed with std::setprecision(precision) and std::setw(width),
+ * without going through the streams
+ */
+static char* putFixed(char *dst, float v, int width, int precision)
+{
+    char tmp[maxFieldLength];
+    double scale = 1;
+    for (int i = 0; i < precision; i++) scale *= 10;
+
+    const double scaled = std::fabs((double)v) * scale;
+
+    // Huge numbers, infs and nans are rare, let the C library deal with them
+    if (!std::isfinite(v) || scaled > 1e18)
+    {
+        int len = std::min( snprintf(tmp, maxFieldLength, "%*.*f", width, precision, v), maxFieldLength-1 );
+        for (int i = 0; i < len; i++)
+            *(dst++) = tmp[i];
+        return dst;
+    }
+
+    // With a few digits of precision the product is exact in double,
+    // and rounding half to even then matches printf
+    const uint64_t q = (uint64_t) std::nearbyint(scaled);
+    const uint64_t iscale = (uint64_t)scale;
+
+    int len = reverseDigits(tmp, q % iscale, precision);
+    if (precision > 0) tmp[len++] = '.';
+    len += reverseDigits(tmp + len, q / iscale);
+    if (std::signbit(v)) tmp[len++] = '-';
+
+    return putRightAligned(dst, tmp, len, width);
+}
+
 void writeXYZ(MPI_Comm comm, std::string fname, const Particle *particles, int np)
 {
+    const int width = 10, precision = 5;
+
     int rank;
     MPI_Check( MPI_Comm_rank(comm, &rank) );
 
@@ -9,37 +89,39 @@ void writeXYZ(MPI_Comm comm, std::string fname, const Particle *particles, int n
     MPI_Check( MPI_Reduce(rank == 0 ? MPI_IN_PLACE : &n, &n, 1, MPI_INT, MPI_SUM, 0, comm) );
 
     MPI_File f;
-    MPI_Check( MPI_File_open(comm, fname.c_str(), MPI_MODE_CREATE|MPI_MODE_DELETE_ON_CLOSE|MPI_MODE_WRONLY, MPI_INFO_NULL, &f) );
-    MPI_Check( MPI_File_close(&f) );
     MPI_Check( MPI_File_open(comm, fname.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &f) );
+    MPI_Check( MPI_File_set_size(f, 0) );
 
-    std::stringstream ss;
-    ss.setf(std::ios::fixed, std::ios::floatfield);
-    ss.precision(5);
+    // rank, then 3 coordinates each preceded by a space, then the newline
+    const size_t maxLineLength = maxIntLength + 3 * (1 + maxFieldLength-1) + 1;
+    const size_t maxHeaderLength = maxIntLength + sizeof("\n# created by YMeRo\n");
+    std::vector<char> content(maxLineLength * np + maxHeaderLength);
+    char *dst = content.data();
 
     if (rank == 0) {
-        ss <<  n << "\n";
-        ss << "# created by YMeRo" << "\n";
+        dst += sprintf(dst, "%d\n# created by YMeRo\n", n);
 
         info("xyz dump to %s: total number of particles: %d", fname.c_str(), n);
     }
 
-    for(int i = 0; i < np; ++i) {
+    for (int i = 0; i < np; ++i) {
         const Particle& p = particles[i];
 
-        ss << rank << " "
-           << std::setw(10) << p.r.x << " "
-           << std::setw(10) << p.r.y << " "
-           << std::setw(10) << p.r.z << "\n";
+        dst = putInt(dst, rank);
+        *(dst++) = ' ';
+        dst = putFixed(dst, p.r.x, width, precision);
+        *(dst++) = ' ';
+        dst = putFixed(dst, p.r.y, width, precision);
+        *(dst++) = ' ';
+        dst = putFixed(dst, p.r.z, width, precision);
+        *(dst++) = '\n';
     }
 
-    std::string content = ss.str();
-
-    MPI_Offset len = content.size();
+    MPI_Offset len = dst - content.data();
     MPI_Offset offset = 0;
     MPI_Check( MPI_Exscan(&len, &offset, 1, MPI_OFFSET, MPI_SUM, comm));
 
     MPI_Status status;
-    MPI_Check( MPI_File_write_at_all(f, offset, content.c_str(), len, MPI_CHAR, &status) );
+    MPI_Check( MPI_File_write_at_all(f, offset, content.data(), len, MPI_CHAR, &status) );
     MPI_Check( MPI_File_close(&f));
 }
@@ -0,0 +1,50 @@
+#!/usr/bin/env python
+
+import ymero as ymr
+import argparse
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--box", type=float, nargs=6, default=[])
+parser.add_argument("--every", type=int, default=1)
+args = parser.parse_args()
+
+ranks  = (1, 1, 1)
+domain = (4, 4, 4)
+
+u = ymr.ymero(ranks, domain, debug_level=3, log_filename='log')
+
+# One particle in the middle of every unit cell,
+# the id of the particle is 16*x + 4*y + z and is stored in the x velocity
+n = 4
+pos = [[x + 0.5, y + 0.5, z + 0.5] for x in range(n) for y in range(n) for z in range(n)]
+vel = [[float(i), 0.0, 0.0] for i in range(len(pos))]
+
+pv = ymr.ParticleVectors.ParticleVector('pv', mass = 1)
+ic = ymr.InitialConditions.FromArray(pos=pos, vel=vel)
+u.registerParticleVector(pv=pv, ic=ic)
+
+dumpEvery = 1
+
+pvDump = ymr.Plugins.createDumpParticles('partDump', pv, dumpEvery, [], 'h5/filtered-',
+                                         box=args.box, subsample_every=args.every)
+u.registerPlugins(pvDump)
+
+u.run(2)
+
+# TEST: dump.h5.filter.box
+# cd dump
+# rm -rf h5 h5.filter.out.txt
+# ymr.run --runargs "-n 2" ./h5.filter.py --box 1 0 0 3 2 4 > /dev/null
+# ymr.post h5dump -d velocity h5/filtered-00000.h5 | awk '/^ *\(/ {print $2}' | tr -d , | sort -n > h5.filter.out.txt
+
+# TEST: dump.h5.filter.subsample
+# cd dump
+# rm -rf h5 h5.filter.out.txt
+# ymr.run --runargs "-n 2" ./h5.filter.py --every 3 > /dev/null
+# ymr.post h5dump -d velocity h5/filtered-00000.h5 | awk '/^ *\(/ {print $2}' | tr -d , | sort -n > h5.filter.out.txt
+
+# TEST: dump.h5.filter.box.subsample
+# cd dump
+# rm -rf h5 h5.filter.out.txt
+# ymr.run --runargs "-n 2" ./h5.filter.py --box 1 0 0 3 2 4 --every 3 > /dev/null
+# ymr.post h5dump -d velocity h5/filtered-00000.h5 | awk '/^ *\(/ {print $2}' | tr -d , | sort -n > h5.filter.out.txt
@@ -0,0 +1,41 @@
+#!/usr/bin/env python
+
+import ymero as ymr
+
+ranks  = (2, 1, 1)
+domain = (4, 2, 2)
+
+u = ymr.ymero(ranks, domain, debug_level=3, log_filename='log')
+
+# Both dumpers get a message at every step, so they are processed by the workers at the same time
+u.setPostprocessThreads(2)
+
+vel = [[0.3, 0.2, 0.1],
+       [0.3, 0.2, 0.1],
+       [0.3, 0.2, 0.1]]
+
+pos1 = [[1., 0.25, 0.5],
+        [1., 0.50, 0.5],
+        [1., 0.75, 0.5]]
+
+pos2 = [[3., 0.25, 1.5],
+        [3., 0.50, 1.5],
+        [3., 0.75, 1.5]]
+
+pv1 = ymr.ParticleVectors.ParticleVector('pv1', mass = 1)
+pv2 = ymr.ParticleVectors.ParticleVector('pv2', mass = 1)
+u.registerParticleVector(pv=pv1, ic=ymr.InitialConditions.FromArray(pos1, vel))
+u.registerParticleVector(pv=pv2, ic=ymr.InitialConditions.FromArray(pos2, vel))
+
+dumpEvery = 1
+
+u.registerPlugins(ymr.Plugins.createDumpParticles('dump1', pv1, dumpEvery, [], 'h5/pv1-'))
+u.registerPlugins(ymr.Plugins.createDumpParticles('dump2', pv2, dumpEvery, [], 'h5/pv2-'))
+
+u.run(11)
+
+# TEST: dump.h5.threads
+# cd dump
+# rm -rf h5 h5.threads.out.txt
+# ymr.run --runargs "-n 4" ./h5.threads.py > /dev/null
+# for f in h5/pv1-*.h5 h5/pv2-*.h5; do ymr.post h5dump -d position $f | grep "):" | awk '{print $2, $3, $4}' | tr -d , ; done | sort > h5.threads.out.txt
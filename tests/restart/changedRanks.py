@@ -0,0 +1,89 @@
+#!/usr/bin/env python
+
+import ymero as ymr
+import numpy as np
+import argparse
+import trimesh
+
+from mpi4py import MPI
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--restart", action='store_true', default=False)
+parser.add_argument("--ranks", type=int, nargs=3)
+parser.add_argument("--objects", action='store_true', default=False)
+args = parser.parse_args()
+
+comm   = MPI.COMM_WORLD
+ranks  = args.ranks
+domain = (8, 8, 8)
+
+if args.restart:
+    u = ymr.ymero(MPI._addressof(comm), ranks, domain, debug_level=3, log_filename='log', checkpoint_every=0)
+else:
+    u = ymr.ymero(MPI._addressof(comm), ranks, domain, debug_level=3, log_filename='log', checkpoint_every=5)
+
+if args.objects:
+    mesh = trimesh.creation.icosphere(subdivisions=1, radius = 0.1)
+    udx_mesh = ymr.ParticleVectors.MembraneMesh(mesh.vertices.tolist(), mesh.faces.tolist())
+    pv = ymr.ParticleVectors.MembraneVector("pv", mass=1.0, mesh=udx_mesh)
+else:
+    pv = ymr.ParticleVectors.ParticleVector('pv', mass = 1)
+
+if args.restart:
+    ic = ymr.InitialConditions.Restart("restart/")
+elif args.objects:
+    nobjs = 10
+    pos = [ np.array(domain) * t for t in np.linspace(0.05, 0.95, nobjs) ]
+    Q = [ np.array([1.0, 0., 0., 0.])  for i in range(nobjs) ]
+    pos_q = np.concatenate((pos, Q), axis=1)
+    ic = ymr.InitialConditions.Membrane(pos_q.tolist())
+else:
+    ic = ymr.InitialConditions.Uniform(density=2)
+
+u.registerParticleVector(pv=pv, ic=ic)
+
+u.run(7)
+
+rank = comm.Get_rank()
+
+if pv:
+    color = 1
+else:
+    color = 0
+comm = comm.Split(color, rank)
+
+if pv:
+    ids = pv.get_indices()
+    pos = pv.getCoordinates()
+    vel = pv.getVelocities()
+
+    data = np.hstack((np.atleast_2d(ids).T, pos, vel))
+    data = comm.gather(data, root=0)
+
+    if comm.Get_rank() == 0:
+        data = np.concatenate(data)
+        data = data[data[:,0].argsort()]
+
+        # Restart on another number of ranks has to give back the same particles
+        if args.restart:
+            initial = np.loadtxt("initial.txt")
+            if data.shape == initial.shape:
+                res = [0, np.max(np.abs(data - initial))]
+            else:
+                res = [data.shape[0] - initial.shape[0], -1]
+            np.savetxt("parts.out.txt", [res], fmt="%d %.4f")
+        else:
+            np.savetxt("initial.txt", data)
+
+
+# TEST: restart.changedRanks
+# cd restart
+# rm -rf restart parts.out.txt initial.txt
+# ymr.run --runargs "-n 4" ./changedRanks.py --ranks 1 2 2           > /dev/null
+# ymr.run --runargs "-n 2" ./changedRanks.py --ranks 2 1 1 --restart > /dev/null
+
+# TEST: restart.changedRanks.objects
+# cd restart
+# rm -rf restart parts.out.txt initial.txt
+# ymr.run --runargs "-n 4" ./changedRanks.py --ranks 1 2 2 --objects           > /dev/null
+# ymr.run --runargs "-n 2" ./changedRanks.py --ranks 2 1 1 --objects --restart > /dev/null
@@ -9,6 +9,8 @@ from mpi4py import MPI
 parser = argparse.ArgumentParser()
 parser.add_argument("--restart", action='store_true', default=False)
 parser.add_argument("--ranks", type=int, nargs=3)
+parser.add_argument("--async_checkpoint", action='store_true', default=False)
+parser.add_argument("--compress", action='store_true', default=False)
 args = parser.parse_args()
 
 ranks  = args.ranks
@@ -21,8 +23,14 @@ if args.restart:
 else:
     u = ymr.ymero(MPI._addressof(comm), ranks, domain, debug_level=3, log_filename='log', checkpoint_every=5)
 
+if args.async_checkpoint:
+    u.setCheckpointMode("async")
+
 pv = ymr.ParticleVectors.ParticleVector('pv', mass = 1)
 
+if args.compress:
+    pv.setCheckpointCompression(shuffle=True, deflate=4)
+
 if args.restart:
     ic = ymr.InitialConditions.Restart("restart/")
 else:
@@ -68,3 +76,30 @@ if args.restart and pv:
 # ymr.run --runargs "-n 4" ./particleVector.py --ranks 1 2 2 --restart > /dev/null
 # cat parts.txt | sort > parts.out.txt
 
+# TEST: restart.particleVector.async
+# cd restart
+# rm -rf restart parts.out.txt parts.txt
+# ymr.run --runargs "-n 1" ./particleVector.py --ranks 1 1 1 --async_checkpoint > /dev/null
+# ymr.run --runargs "-n 1" ./particleVector.py --ranks 1 1 1 --restart          > /dev/null
+# cat parts.txt | sort > parts.out.txt
+
+# TEST: restart.particleVector.async.mpi
+# cd restart
+# rm -rf restart parts.out.txt parts.txt
+# ymr.run --runargs "-n 4" ./particleVector.py --ranks 1 2 2 --async_checkpoint > /dev/null
+# ymr.run --runargs "-n 4" ./particleVector.py --ranks 1 2 2 --restart          > /dev/null
+# cat parts.txt | sort > parts.out.txt
+
+# TEST: restart.particleVector.compressed
+# cd restart
+# rm -rf restart parts.out.txt parts.txt
+# ymr.run --runargs "-n 1" ./particleVector.py --ranks 1 1 1 --compress  > /dev/null
+# ymr.run --runargs "-n 1" ./particleVector.py --ranks 1 1 1 --restart   > /dev/null
+# cat parts.txt | sort > parts.out.txt
+
+# TEST: restart.particleVector.compressed.mpi
+# cd restart
+# rm -rf restart parts.out.txt parts.txt
+# ymr.run --runargs "-n 4" ./particleVector.py --ranks 1 2 2 --compress  > /dev/null
+# ymr.run --runargs "-n 4" ./particleVector.py --ranks 1 2 2 --restart   > /dev/null
+# cat parts.txt | sort > parts.out.txt
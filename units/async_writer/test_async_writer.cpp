@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <core/logger.h>
+#include <core/utils/async_writer.h>
+
+Logger logger;
+
+/// Messages of the jobs, the writer thread and the test thread may append concurrently
+struct Journal
+{
+    std::mutex mutex;
+    std::vector<std::string> messages;
+
+    void note(std::string msg)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        messages.push_back(msg);
+    }
+
+    std::vector<std::string> get()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return messages;
+    }
+};
+
+/**
+ * Batches mimic Simulation::checkpoint(): several data jobs and the state job
+ * added last. Every batch has to be written completely and in order,
+ * with the state after the data it refers to
+ */
+TEST(AsyncWriter, batchesInOrder)
+{
+    const int nbatches = 4, njobs = 3;
+
+    Journal journal;
+    AsyncWriter writer(MPI_COMM_WORLD);
+
+    for (int b = 0; b < nbatches; b++)
+    {
+        writer.begin();
+
+        // begin() returns only when the previous batch is written
+        if (b > 0)
+            ASSERT_EQ(journal.get().back(), std::to_string(b-1) + ".state");
+
+        for (int j = 0; j < njobs; j++)
+            writer.add([&journal, b, j] (MPI_Comm comm) {
+                // Jobs may be collective
+                int sum, one = 1, nranks;
+                MPI_Check( MPI_Comm_size(comm, &nranks) );
+                MPI_Check( MPI_Allreduce(&one, &sum, 1, MPI_INT, MPI_SUM, comm) );
+                ASSERT_EQ(sum, nranks);
+
+                journal.note(std::to_string(b) + "." + std::to_string(j));
+            });
+
+        writer.add([&journal, b] (MPI_Comm comm) {
+            journal.note(std::to_string(b) + ".state");
+        });
+
+        writer.submit();
+    }
+
+    writer.wait();
+
+    std::vector<std::string> expected;
+    for (int b = 0; b < nbatches; b++)
+    {
+        for (int j = 0; j < njobs; j++)
+            expected.push_back(std::to_string(b) + "." + std::to_string(j));
+        expected.push_back(std::to_string(b) + ".state");
+    }
+
+    ASSERT_EQ(journal.get(), expected);
+}
+
+/// submit() hands the batch over without waiting for it, wait() blocks until it is written
+TEST(AsyncWriter, submitDoesNotBlock)
+{
+    Journal journal;
+    AsyncWriter writer(MPI_COMM_WORLD);
+
+    std::promise<void> submitted;
+    auto submittedFuture = submitted.get_future();
+
+    writer.begin();
+    writer.add([&] (MPI_Comm comm) {
+        // Can only proceed once the simulation thread is past submit()
+        submittedFuture.wait();
+        journal.note("written");
+    });
+    writer.submit();
+
+    journal.note("submitted");
+    submitted.set_value();
+
+    writer.wait();
+    journal.note("waited");
+
+    ASSERT_EQ(journal.get(), std::vector<std::string>({"submitted", "written", "waited"}));
+}
+
+/// Jobs get a private duplicate of the communicator, their messages can't match those of the simulation
+TEST(AsyncWriter, privateCommunicator)
+{
+    AsyncWriter writer(MPI_COMM_WORLD);
+
+    int result = MPI_UNEQUAL;
+    writer.begin();
+    writer.add([&result] (MPI_Comm comm) {
+        MPI_Check( MPI_Comm_compare(comm, MPI_COMM_WORLD, &result) );
+    });
+    writer.submit();
+    writer.wait();
+
+    ASSERT_EQ(result, MPI_CONGRUENT);
+}
+
+int main(int argc, char ** argv)
+{
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    logger.init(MPI_COMM_WORLD, "async_writer.log", 9);
+
+    if (provided < MPI_THREAD_MULTIPLE)
+    {
+        warn("MPI library doesn't provide MPI_THREAD_MULTIPLE, the asynchronous writer can't be tested");
+        MPI_Finalize();
+        return 0;
+    }
+
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
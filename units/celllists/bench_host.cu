@@ -0,0 +1,71 @@
+#include <core/pvs/particle_vector.h>
+#include <core/celllist.h>
+#include <core/logger.h>
+
+#include "../timer.h"
+
+#include <gtest/gtest.h>
+#include <random>
+
+/**
+ * Throughput of the host cell-list build for 1M - 50M particles at density 8
+ * Disabled by default, run with --gtest_also_run_disabled_tests
+ */
+static void benchmarkHostBuild(int np, float density, int nrepeats)
+{
+    const float L = cbrtf(np / density);
+    const float3 length = make_float3(L);
+
+    ParticleVector pv("bench", 1.0f);
+    pv.local()->resize_anew(np);
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> udistr(-0.5f*L, 0.5f*L);
+
+    auto& coosvels = pv.local()->coosvels;
+    for (int i = 0; i < np; i++)
+    {
+        coosvels[i].r  = make_float3(udistr(gen), udistr(gen), udistr(gen));
+        coosvels[i].u  = make_float3(0.0f);
+        coosvels[i].i1 = i;
+        coosvels[i].i2 = 0;
+    }
+    coosvels.uploadToDevice(0);
+
+    CellList cells(&pv, 1.0f, length);
+    cells.setBackend(ExecutionBackend::Host);
+
+    Timer timer;
+    int64_t tsort = 0, tbuild = 0;
+
+    for (int i = 0; i < nrepeats; i++)
+    {
+        timer.start();
+        cells.sortHost();
+        tsort += timer.elapsed();
+
+        pv.cellListStamp++;
+
+        timer.start();
+        cells.build(0);
+        CUDA_Check( cudaStreamSynchronize(0) );
+        tbuild += timer.elapsed();
+    }
+
+    const double sortRate  = (double)np * nrepeats / (tsort  * 1e-9);
+    const double buildRate = (double)np * nrepeats / (tbuild * 1e-9);
+
+    printf("%9d particles, %8d cells:  sort %7.2f Mparticles/s,  build with transfers %7.2f Mparticles/s\n",
+           np, cells.totcells, sortRate * 1e-6, buildRate * 1e-6);
+
+    ASSERT_EQ(cells.cellStarts[cells.totcells], np);
+}
+
+TEST (CELLLISTS, DISABLED_HostBuildBenchmark)
+{
+    const float density = 8.0f;
+    const int nrepeats = 5;
+
+    for (int np : {1000000, 5000000, 10000000, 25000000, 50000000})
+        benchmarkHostBuild(np, density, nrepeats);
+}
@@ -18,14 +18,17 @@
 Logger logger;
 bool verbose = false;
 
-void test_domain(float3 length, float rc, float density)
+void test_domain(float3 length, float rc, float density, ExecutionBackend backend = ExecutionBackend::Device,
+                 CellListOrdering ordering = CellListOrdering::RowMajor)
 {
     bool success = true;
     float3 domainStart = -length / 2.0f;
-    DomainInfo domain{length, {0,0,0}, length};
+    DomainInfo domain{length, {0,0,0}, length, length, length};
 
     ParticleVector dpds("dpd", 1.0f);
     CellList *cells = new PrimaryCellList(&dpds, rc, length);
+    cells->setBackend(backend);
+    cells->setOrdering(ordering);
 
     UniformIC ic(density);
     ic.exec(MPI_COMM_WORLD, &dpds, domain, 0);
@@ -44,6 +47,18 @@ void test_domain(float3 length, float rc, float density)
 
     dpds.local()->coosvels.downloadFromDevice(0, ContainersSynch::Synch);
 
+    // cell ordering tables are only accessible from the host through that
+    const CellListInfo hinfo = cells->cellInfoHost();
+
+    for (int cid=0; cid < hinfo.totcells; cid++)
+        if (hinfo.encode(hinfo.decode(cid)) != cid)
+        {
+            success = false;
+
+            if (verbose)
+                printf("cid %d is encoded back as %d\n", cid, hinfo.encode(hinfo.decode(cid)));
+        }
+
     HostBuffer<int> hcellsStart(cells->totcells+1);
     HostBuffer<int> hcellsSize(cells->totcells+1);
 
@@ -60,7 +75,7 @@ void test_domain(float3 length, float rc, float density)
         float3 coo{initial[pid].r.x, initial[pid].r.y, initial[pid].r.z};
         float3 vel{initial[pid].u.x, initial[pid].u.y, initial[pid].u.z};
 
-        int actCid = cells->getCellId(coo);
+        int actCid = hinfo.getCellId(coo);
         if (actCid >= 0)
         {
             cellscount[actCid]++;
@@ -98,7 +113,7 @@ void test_domain(float3 length, float rc, float density)
                 fabs(coo.x - cooDev.x), fabs(coo.y - cooDev.y), fabs(coo.z - cooDev.z),
                 fabs(vel.x - velDev.x), fabs(vel.y - velDev.y), fabs(vel.z - velDev.z) });
 
-            int actCid = cells->getCellId<CellListsProjection::NoClamp>(cooDev);
+            int actCid = hinfo.getCellId<CellListsProjection::NoClamp>(cooDev);
 
             if (cid != actCid || diff > 1e-5)
             {
@@ -142,6 +157,23 @@ TEST (CELLLISTS, DensityVaries)
     test_domain(domain, rc, 8.0);
 }
 
+TEST (CELLLISTS, HostBuild)
+{
+    float rc = 1.0, density = 8.0;
+
+    test_domain(make_float3(64, 32, 16), rc, density, ExecutionBackend::Host);
+    test_domain(make_float3(32, 32, 32), 1.2, density, ExecutionBackend::Host);
+}
+
+TEST (CELLLISTS, CurveOrderings)
+{
+    float rc = 1.0, density = 8.0;
+
+    test_domain(make_float3(64, 32, 16), rc, density, ExecutionBackend::Device, CellListOrdering::Morton);
+    test_domain(make_float3(24, 17, 9),  rc, density, ExecutionBackend::Device, CellListOrdering::Hilbert);
+    test_domain(make_float3(24, 17, 9),  rc, density, ExecutionBackend::Host,   CellListOrdering::Morton);
+}
+
 int main(int argc, char **argv)
 {
     MPI_Init(&argc, &argv);
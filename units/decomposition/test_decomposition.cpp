@@ -0,0 +1,104 @@
+#include <core/decomposition.h>
+#include <core/logger.h>
+
+#include <vector>
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+Logger logger;
+
+TEST (Decomposition, Uniform)
+{
+    Decomposition dec({4, 2, 1}, {64, 32, 16});
+
+    ASSERT_TRUE(dec.isUniform());
+
+    auto domain = dec.createDomain({1, 1, 0});
+
+    ASSERT_FLOAT_EQ(domain.globalStart.x, 16.0f);
+    ASSERT_FLOAT_EQ(domain.globalStart.y, 16.0f);
+    ASSERT_FLOAT_EQ(domain.localSize.x,   16.0f);
+
+    // Uniform shifts are the subdomain size
+    auto shift = domain.neighbourShift({1, -1, 0});
+    ASSERT_FLOAT_EQ(shift.x,  16.0f);
+    ASSERT_FLOAT_EQ(shift.y, -16.0f);
+    ASSERT_FLOAT_EQ(shift.z,   0.0f);
+}
+
+TEST (Decomposition, NonUniformNeighbours)
+{
+    Decomposition dec({3, 1, 1}, {30, 10, 10}, {0, 5, 20, 30}, {}, {});
+
+    ASSERT_FALSE(dec.isUniform());
+
+    auto domain = dec.createDomain({0, 0, 0});
+
+    ASSERT_FLOAT_EQ(domain.localSize.x,          5.0f);
+    ASSERT_FLOAT_EQ(domain.upperNeighbourSize.x, 15.0f);
+    ASSERT_FLOAT_EQ(domain.lowerNeighbourSize.x, 10.0f); // periodic
+
+    // Center of the upper neighbour seen from the center of this subdomain
+    ASSERT_FLOAT_EQ(domain.neighbourShift({1, 0, 0}).x,   10.0f);
+    ASSERT_FLOAT_EQ(domain.neighbourShift({-1, 0, 0}).x, -7.5f);
+
+    auto coords = dec.locate({19.9f, 3.0f, 9.9f});
+    ASSERT_EQ(coords.x, 1);
+    ASSERT_EQ(coords.y, 0);
+    ASSERT_EQ(coords.z, 0);
+
+    ASSERT_EQ(dec.locate({30.0f, 3.0f, 3.0f}).x, -1);
+}
+
+TEST (Decomposition, Balance)
+{
+    Decomposition dec({4, 1, 1}, {40, 10, 10});
+
+    // Two first slabs are three times more loaded
+    std::vector<double> loads[3] = { {3, 3, 1, 1}, {8}, {8} };
+    auto balanced = dec.balance(loads, 1.0f, 1.0f);
+
+    // Cumulative load reaches 2 out of 8 at 2/3 of the first slab
+    auto& b = balanced.boundaries[0];
+    ASSERT_NEAR(b[1], 20.0f/3.0f, 1e-4f);
+    ASSERT_NEAR(b[2], 40.0f/3.0f, 1e-4f);
+    ASSERT_NEAR(b[3], 20.0f,      1e-4f);
+
+    // Half way with relaxation
+    auto relaxed = dec.balance(loads, 1.0f, 0.5f);
+    ASSERT_NEAR(relaxed.boundaries[0][1], 0.5f * (10.0f + 20.0f/3.0f), 1e-4f);
+
+    // Minimum size is respected
+    std::vector<double> skewed[3] = { {100, 0, 0, 0}, {8}, {8} };
+    auto clamped = dec.balance(skewed, 8.0f, 1.0f);
+    for (int i = 0; i < 4; i++)
+        ASSERT_GE(clamped.boundaries[0][i+1] - clamped.boundaries[0][i], 8.0f - 1e-4f);
+}
+
+TEST (Decomposition, ReadWrite)
+{
+    Decomposition dec({3, 1, 1}, {30, 10, 10}, {0, 5.5f, 20.25f, 30}, {}, {});
+    dec.write("decomposition.txt");
+
+    Decomposition restored({3, 1, 1}, {30, 10, 10});
+    ASSERT_TRUE(restored.read("decomposition.txt"));
+
+    for (int i = 0; i < 4; i++)
+        ASSERT_FLOAT_EQ(restored.boundaries[0][i], dec.boundaries[0][i]);
+
+    Decomposition other({2, 1, 1}, {30, 10, 10});
+    ASSERT_FALSE(other.read("decomposition.txt"));
+}
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+    logger.init(MPI_COMM_WORLD, "decomposition.log", 9);
+
+    testing::InitGoogleTest(&argc, argv);
+    auto ret = RUN_ALL_TESTS();
+
+    MPI_Finalize();
+    return ret;
+}
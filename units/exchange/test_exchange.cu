@@ -0,0 +1,205 @@
+#include <core/pvs/particle_vector.h>
+#include <core/celllist.h>
+#include <core/decomposition.h>
+#include <core/logger.h>
+#include <core/containers.h>
+#include <core/mpi/api.h>
+#include <core/initial_conditions/uniform_ic.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+Logger logger;
+
+/// Id and position of the halo particles, sorted such that the order of arrival doesn't matter
+using Halo = std::vector< std::tuple<int64_t, float, float, float> >;
+
+/// Periodic cartesian communicator over \p comm with its domain and the local particles of several ParticleVectors
+struct Setup
+{
+    MPI_Comm cartComm;
+    int nranks;
+    DomainInfo domain;
+    std::vector< std::vector<Particle> > particles;
+};
+
+static Setup makeSetup(MPI_Comm comm, float3 localSize, std::vector<float> densities)
+{
+    Setup setup;
+    int dims[3] = {0, 0, 0}, periods[3] = {1, 1, 1}, coords[3], rank;
+
+    MPI_Check( MPI_Comm_size(comm, &setup.nranks) );
+    MPI_Check( MPI_Dims_create(setup.nranks, 3, dims) );
+    MPI_Check( MPI_Cart_create(comm, 3, dims, periods, 0, &setup.cartComm) );
+    MPI_Check( MPI_Comm_rank(setup.cartComm, &rank) );
+    MPI_Check( MPI_Cart_coords(setup.cartComm, rank, 3, coords) );
+
+    const int3 nranks3D = make_int3(dims[0], dims[1], dims[2]);
+    Decomposition decomposition(nranks3D, localSize * make_float3(nranks3D));
+    setup.domain = decomposition.createDomain(make_int3(coords[0], coords[1], coords[2]));
+
+    for (auto density : densities)
+    {
+        ParticleVector pv("ic", 1.0f);
+        UniformIC ic(density);
+        ic.exec(setup.cartComm, &pv, setup.domain, 0);
+
+        std::vector<Particle> particles(pv.local()->coosvels.begin(), pv.local()->coosvels.end());
+        for (auto& p : particles)
+            p.u = make_float3(drand48() - 0.5, drand48() - 0.5, drand48() - 0.5);
+
+        setup.particles.push_back(particles);
+    }
+
+    return setup;
+}
+
+static std::unique_ptr<ExchangeEngine> makeEngine(std::unique_ptr<ParticleExchanger> exch, MPI_Comm cartComm, ExchangeProtocol protocol)
+{
+    if (protocol == ExchangeProtocol::NeighborCollective)
+        return std::make_unique<NeighborExchangeEngine> (std::move(exch), cartComm);
+
+    return std::make_unique<MPIExchangeEngine> (std::move(exch), cartComm, false, protocol);
+}
+
+/**
+ * Exchange the halos of all the ParticleVectors of the \p setup \p nrepeats times with the given \p protocol.
+ * ParticleVector \p skipped (if not -1) has a valid halo and is not exchanged.
+ * Halos are returned for every repetition and every ParticleVector
+ */
+static std::vector< std::vector<Halo> > exchangeHalos(const Setup& setup, ExchangeProtocol protocol, int skipped, int nrepeats)
+{
+    const float rc = 1.0f;
+    const int npvs = setup.particles.size();
+
+    std::vector< std::unique_ptr<ParticleVector> > pvs;
+    std::vector< std::unique_ptr<CellList> > cls;
+    auto exchanger = std::make_unique<ParticleHaloExchanger>();
+
+    for (int i = 0; i < npvs; i++)
+    {
+        auto& particles = setup.particles[i];
+
+        // Names are the same for every protocol, tags don't depend on them
+        auto pv = std::make_unique<ParticleVector>("pv" + std::to_string(i), 1.0f);
+        pv->domain = setup.domain;
+        pv->local()->resize_anew(particles.size());
+        std::copy(particles.begin(), particles.end(), pv->local()->coosvels.hostPtr());
+        pv->local()->coosvels.uploadToDevice(0);
+
+        auto cl = std::make_unique<PrimaryCellList>(pv.get(), rc, setup.domain.localSize);
+        cl->build(0);
+
+        exchanger->attach(pv.get(), cl.get());
+        pvs.push_back(std::move(pv));
+        cls.push_back(std::move(cl));
+    }
+
+    auto engine = makeEngine(std::move(exchanger), setup.cartComm, protocol);
+
+    std::vector< std::vector<Halo> > res;
+    for (int rep = 0; rep < nrepeats; rep++)
+    {
+        for (int i = 0; i < npvs; i++)
+            pvs[i]->haloValid = (i == skipped);
+
+        engine->init(0);
+        engine->finalize(0);
+
+        std::vector<Halo> halos;
+        for (auto& pv : pvs)
+        {
+            auto& coosvels = pv->halo()->coosvels;
+            coosvels.downloadFromDevice(0);
+
+            Halo halo;
+            for (int j = 0; j < pv->halo()->size(); j++)
+            {
+                const Particle& p = coosvels[j];
+                halo.push_back(std::make_tuple(p.getId(), p.r.x, p.r.y, p.r.z));
+            }
+            std::sort(halo.begin(), halo.end());
+            halos.push_back(halo);
+        }
+
+        res.push_back(halos);
+    }
+
+    return res;
+}
+
+/**
+ * Every exchange with the \p protocol has to give the same halos as with ExchangeProtocol::SizesFirst.
+ * Exchange is repeated such that the buffers and requests kept between the exchanges are reused
+ */
+static void compareProtocols(ExchangeProtocol protocol, int skipped, float3 localSize = make_float3(8, 8, 8))
+{
+    const int nrepeats = 3;
+    auto setup = makeSetup(MPI_COMM_WORLD, localSize, {8.0f, 2.0f, 4.0f});
+
+    auto reference = exchangeHalos(setup, ExchangeProtocol::SizesFirst, skipped, nrepeats);
+    auto halos     = exchangeHalos(setup, protocol,                     skipped, nrepeats);
+
+    for (int rep = 0; rep < nrepeats; rep++)
+        for (int i = 0; i < setup.particles.size(); i++)
+        {
+            if (i == skipped)
+                ASSERT_TRUE(halos[rep][i].empty()) << "skipped pv" << i << " got a halo";
+            else
+                ASSERT_FALSE(halos[rep][i].empty());
+
+            ASSERT_EQ(halos[rep][i].size(), reference[rep][i].size()) << "pv" << i << ", repetition " << rep;
+            ASSERT_TRUE(halos[rep][i] == reference[rep][i]) << "pv" << i << ", repetition " << rep;
+        }
+
+    MPI_Check( MPI_Comm_free(&setup.cartComm) );
+}
+
+TEST(Exchange, singleMessage)
+{
+    compareProtocols(ExchangeProtocol::SingleMessage, -1);
+    compareProtocols(ExchangeProtocol::SingleMessage,  1);
+}
+
+TEST(Exchange, aggregated)
+{
+    compareProtocols(ExchangeProtocol::Aggregated, -1);
+    compareProtocols(ExchangeProtocol::Aggregated,  1);
+}
+
+TEST(Exchange, neighborCollective)
+{
+    compareProtocols(ExchangeProtocol::NeighborCollective, -1);
+    compareProtocols(ExchangeProtocol::NeighborCollective,  1);
+}
+
+/// All the neighbours are on the node if the test is run on a single node
+TEST(Exchange, sharedMemory)
+{
+    compareProtocols(ExchangeProtocol::SharedMemory, -1);
+    compareProtocols(ExchangeProtocol::SharedMemory,  1);
+}
+
+/**
+ * The halos of the first exchange (about 1.7 MB) don't fit into the initial
+ * shared window of 1 MB: the part that doesn't fit goes through MPI,
+ * the next exchanges go through the grown window
+ */
+TEST(Exchange, sharedMemoryMixed)
+{
+    compareProtocols(ExchangeProtocol::SharedMemory, -1, make_float3(24, 24, 24));
+    compareProtocols(ExchangeProtocol::SharedMemory,  1, make_float3(24, 24, 24));
+}
+
+int main(int argc, char ** argv)
+{
+    MPI_Init(&argc, &argv);
+    logger.init(MPI_COMM_WORLD, "exchange.log", 9);
+
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
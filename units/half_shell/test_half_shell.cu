@@ -0,0 +1,152 @@
+#include <core/pvs/particle_vector.h>
+#include <core/celllist.h>
+#include <core/decomposition.h>
+#include <core/logger.h>
+#include <core/containers.h>
+#include <core/mpi/api.h>
+#include <core/interactions/pairwise.h>
+#include <core/interactions/pairwise_interactions/norandom_dpd.h>
+#include <core/initial_conditions/uniform_ic.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+
+Logger logger;
+
+static std::unique_ptr<ExchangeEngine> makeEngine(std::unique_ptr<ParticleExchanger> exch, MPI_Comm cartComm, int nranks)
+{
+    if (nranks == 1)
+        return std::make_unique<SingleNodeEngine> (std::move(exch));
+    else
+        return std::make_unique<MPIExchangeEngine> (std::move(exch), cartComm, false);
+}
+
+/**
+ * Local DPD forces, including the halo contributions, either with the full-shell
+ * halo or with the half-shell halo and the forces sent back to the owners.
+ * Forces are returned by particle id
+ */
+static std::map<int64_t, float3> forcesWithHalo(MPI_Comm cartComm, int nranks, DomainInfo domain,
+                                                const PinnedBuffer<Particle>& particles, bool halfShell)
+{
+    const float rc = 1.0f;
+    ParticleVector dpds("dpd", 1.0f);
+    dpds.domain = domain;
+    dpds.halfShellHalo = halfShell;
+
+    const int np = particles.size();
+    dpds.local()->resize_anew(np);
+    dpds.local()->coosvels.copy(particles, 0);
+    dpds.local()->extraPerParticle.getData<Particle>("old_particles")->copy(particles, 0);
+
+    PrimaryCellList cells(&dpds, rc, domain.localSize);
+    cells.build(0);
+
+    auto haloImp = std::make_unique<ParticleHaloExchanger>();
+    auto haloForcesImp = std::make_unique<ParticleForcesReverseExchanger>(haloImp.get());
+    haloImp->attach(&dpds, &cells);
+    haloForcesImp->attach(&dpds);
+
+    auto halo       = makeEngine(std::move(haloImp),       cartComm, nranks);
+    auto haloForces = makeEngine(std::move(haloForcesImp), cartComm, nranks);
+
+    halo->init(0);
+    halo->finalize(0);
+
+    Pairwise_Norandom_DPD dpdInt(rc, 50.0f, 20.0f, 1.0f, 0.002f, 1.0f);
+    InteractionPair<Pairwise_Norandom_DPD> inter("dpd", rc, dpdInt);
+
+    dpds.local()->forces.clear(0);
+    inter.regular(&dpds, &dpds, &cells, &cells, 0, 0);
+    inter.halo   (&dpds, &dpds, &cells, &cells, 0, 0);
+
+    if (halfShell)
+    {
+        haloForces->init(0);
+        haloForces->finalize(0);
+    }
+
+    HostBuffer<Force> frcs;
+    frcs.copy(dpds.local()->forces, 0);
+    dpds.local()->coosvels.downloadFromDevice(0);
+    CUDA_Check( cudaDeviceSynchronize() );
+
+    std::map<int64_t, float3> res;
+    for (int i = 0; i < dpds.local()->size(); i++)
+        res[dpds.local()->coosvels[i].getId()] = frcs[i].f;
+
+    return res;
+}
+
+static void compareHalfShell(MPI_Comm comm, float3 localSize)
+{
+    int nranks, rank;
+    int dims[3] = {0, 0, 0}, periods[3] = {1, 1, 1}, coords[3];
+    MPI_Comm cartComm;
+
+    MPI_Check( MPI_Comm_size(comm, &nranks) );
+    MPI_Check( MPI_Dims_create(nranks, 3, dims) );
+    MPI_Check( MPI_Cart_create(comm, 3, dims, periods, 0, &cartComm) );
+    MPI_Check( MPI_Comm_rank(cartComm, &rank) );
+    MPI_Check( MPI_Cart_coords(cartComm, rank, 3, coords) );
+
+    const int3 nranks3D = make_int3(dims[0], dims[1], dims[2]);
+    Decomposition decomposition(nranks3D, localSize * make_float3(nranks3D));
+    DomainInfo domain = decomposition.createDomain(make_int3(coords[0], coords[1], coords[2]));
+
+    ParticleVector dpds("dpd", 1.0f);
+    UniformIC ic(8.0);
+    ic.exec(cartComm, &dpds, domain, 0);
+
+    // Random velocities, such that the dissipative forces are checked as well
+    auto& particles = dpds.local()->coosvels;
+    srand48(rank);
+    for (auto& p : particles)
+        p.u = make_float3(drand48() - 0.5, drand48() - 0.5, drand48() - 0.5);
+    particles.uploadToDevice(0);
+
+    auto full = forcesWithHalo(cartComm, nranks, domain, particles, false);
+    auto half = forcesWithHalo(cartComm, nranks, domain, particles, true);
+
+    ASSERT_EQ(full.size(), half.size());
+
+    double linf = 0;
+    for (auto& entry : full)
+    {
+        auto it = half.find(entry.first);
+        ASSERT_TRUE(it != half.end()) << "particle " << entry.first << " is missing with the half-shell halo";
+
+        const float3 diff = entry.second - it->second;
+        linf = std::max(linf, (double)std::max(fabs(diff.x), std::max(fabs(diff.y), fabs(diff.z))));
+    }
+
+    double globalLinf;
+    MPI_Check( MPI_Allreduce(&linf, &globalLinf, 1, MPI_DOUBLE, MPI_MAX, cartComm) );
+
+    if (rank == 0)
+        fprintf(stderr, "Half-shell vs full-shell halo on %d ranks, Linf norm: %f\n", nranks, globalLinf);
+    ASSERT_LE(globalLinf, 0.002);
+
+    MPI_Check( MPI_Comm_free(&cartComm) );
+}
+
+TEST(HalfShell, cubicSubdomains)
+{
+    compareHalfShell(MPI_COMM_WORLD, make_float3(8, 8, 8));
+}
+
+TEST(HalfShell, elongatedSubdomains)
+{
+    compareHalfShell(MPI_COMM_WORLD, make_float3(16, 7, 5));
+}
+
+int main(int argc, char ** argv)
+{
+    MPI_Init(&argc, &argv);
+    logger.init(MPI_COMM_WORLD, "half_shell.log", 9);
+
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -46,7 +46,7 @@ int main(int argc, char ** argv)
     ParticleVector dpds("dpd", 1.0f);
     PrimaryCellList cells(&dpds, rc, length);
 
-    DomainInfo domain{length, domainStart, length};
+    DomainInfo domain{length, domainStart, length, length, length};
 
     InitialConditions* ic = new UniformIC(8.0);
     ic->exec(MPI_COMM_WORLD, &dpds, domain,  0);
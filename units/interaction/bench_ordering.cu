@@ -0,0 +1,66 @@
+#include <core/pvs/particle_vector.h>
+#include <core/celllist.h>
+#include <core/logger.h>
+#include <core/containers.h>
+#include <core/interactions/pairwise.h>
+#include <core/interactions/pairwise_interactions/norandom_dpd.h>
+#include <core/initial_conditions/uniform_ic.h>
+
+#include "../timer.h"
+
+#include <gtest/gtest.h>
+
+/**
+ * Pair-force throughput of the host backend for different cell orderings
+ * Disabled by default, run with --gtest_also_run_disabled_tests
+ */
+static double benchmarkOrdering(float3 length, float density, CellListOrdering ordering, int nrepeats)
+{
+    DomainInfo domain{length, {0,0,0}, length, length, length};
+    const float rc = 1.0f;
+
+    ParticleVector dpds("dpd", 1.0f);
+    UniformIC ic(density);
+    ic.exec(MPI_COMM_WORLD, &dpds, domain, 0);
+
+    PrimaryCellList cells(&dpds, rc, length);
+    cells.setBackend(ExecutionBackend::Host);
+    cells.setOrdering(ordering);
+    cells.build(0);
+
+    Pairwise_Norandom_DPD dpdInt(rc, 50.0f, 20.0f, 1.0f, 0.002f, 1.0f);
+    InteractionPair<Pairwise_Norandom_DPD> inter("dpd", rc, dpdInt);
+    inter.setBackend(ExecutionBackend::Host);
+
+    // warm-up, also makes the host copies
+    inter.regular(&dpds, &dpds, &cells, &cells, 0, 0);
+
+    Timer timer;
+    timer.start();
+
+    for (int i = 0; i < nrepeats; i++)
+        inter.regular(&dpds, &dpds, &cells, &cells, 0, 0);
+
+    CUDA_Check( cudaDeviceSynchronize() );
+    const double seconds = timer.elapsed() * 1e-9;
+
+    // Each particle considers all its neighbours within the cut-off
+    const double neighbours = density * 4.0 / 3.0 * M_PI * rc*rc*rc;
+    return dpds.local()->size() * neighbours * nrepeats / seconds;
+}
+
+TEST (Interactions, DISABLED_CellOrderingBenchmark)
+{
+    const float density = 8.0f;
+    const int nrepeats = 10;
+
+    for (auto length : {make_float3(32, 32, 32), make_float3(64, 64, 64), make_float3(128, 64, 64)})
+    {
+        const double rowMajor = benchmarkOrdering(length, density, CellListOrdering::RowMajor, nrepeats);
+        const double morton   = benchmarkOrdering(length, density, CellListOrdering::Morton,   nrepeats);
+        const double hilbert  = benchmarkOrdering(length, density, CellListOrdering::Hilbert,  nrepeats);
+
+        printf("domain %4.0f x %4.0f x %4.0f:  row-major %7.2f,  Morton %7.2f,  Hilbert %7.2f  Mpairs/s\n",
+               length.x, length.y, length.z, rowMajor * 1e-6, morton * 1e-6, hilbert * 1e-6);
+    }
+}
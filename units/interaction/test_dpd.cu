@@ -8,6 +8,7 @@
 #include <core/interactions/pairwise.h>
 #include <core/interactions/pairwise_interactions/norandom_dpd.h>
 #include <core/initial_conditions/uniform_ic.h>
+#include <core/task_scheduler.h>
 
 #include <gtest/gtest.h>
 
@@ -43,9 +44,9 @@ void makeCells(const Particle* __restrict__ input, Particle* __restrict__ output
         cellsStartSize[i] -= cellsSize[i];
 }
 
-void execute(MPI_Comm comm, float3 length)
+void execute(MPI_Comm comm, float3 length, ExecutionBackend backend = ExecutionBackend::Device, float verletSkin = 0.0f)
 {
-    DomainInfo domain{length, {0,0,0}, length};
+    DomainInfo domain{length, {0,0,0}, length, length, length};
 
     const float rc = 1.0f;
     ParticleVector dpds1("dpd1", 1.0f);
@@ -103,6 +104,8 @@ void execute(MPI_Comm comm, float3 length)
 
     Pairwise_Norandom_DPD dpdInt(rc, adpd, gammadpd, kbT, dt, k);
     Interaction *inter = new InteractionPair<Pairwise_Norandom_DPD>("dpd", rc, dpdInt);
+    inter->setBackend(backend);
+    inter->setVerletList(verletSkin);
 
     PinnedBuffer<int> counter(1);
 
@@ -270,6 +273,266 @@ void execute(MPI_Comm comm, float3 length)
 
 }
 
+/**
+ * Self interaction forces of a single ParticleVector made of \p particles,
+ * with the given cell ordering. Forces are indexed by the particle ids
+ */
+std::vector<float3> selfForcesById(const std::vector<Particle>& particles, float3 length, CellListOrdering ordering)
+{
+    const float rc = 1.0f;
+    const int np = particles.size();
+
+    ParticleVector dpds("dpd", 1.0f);
+    dpds.local()->resize_anew(np);
+    for (int i = 0; i < np; i++)
+        dpds.local()->coosvels[i] = particles[i];
+    dpds.local()->coosvels.uploadToDevice(0);
+
+    PrimaryCellList cells(&dpds, rc, length);
+    cells.setOrdering(ordering);
+    cells.build(0);
+
+    Pairwise_Norandom_DPD dpdInt(rc, 50.0f, 20.0f, 1.0f, 0.002f, 1.0f);
+    InteractionPair<Pairwise_Norandom_DPD> inter("dpd", rc, dpdInt);
+
+    dpds.local()->forces.clear(0);
+    inter.regular(&dpds, &dpds, &cells, &cells, 0, 0);
+
+    HostBuffer<Force> frcs;
+    frcs.copy(dpds.local()->forces, 0);
+    dpds.local()->coosvels.downloadFromDevice(0);
+    CUDA_Check( cudaDeviceSynchronize() );
+
+    std::vector<float3> res(np);
+    for (int i = 0; i < np; i++)
+        res[dpds.local()->coosvels[i].getId()] = frcs[i].f;
+
+    return res;
+}
+
+void compareOrderings(MPI_Comm comm, float3 length, CellListOrdering ordering)
+{
+    DomainInfo domain{length, {0,0,0}, length, length, length};
+
+    ParticleVector dpds("dpd", 1.0f);
+    UniformIC ic(8.0);
+    ic.exec(comm, &dpds, domain, 0);
+
+    const int np = dpds.local()->size();
+    std::vector<Particle> particles(np);
+    for (int i = 0; i < np; i++)
+    {
+        particles[i] = dpds.local()->coosvels[i];
+        particles[i].u = make_float3(drand48() - 0.5, drand48() - 0.5, drand48() - 0.5);
+    }
+
+    auto reference = selfForcesById(particles, length, CellListOrdering::RowMajor);
+    auto curve     = selfForcesById(particles, length, ordering);
+
+    double linf = 0;
+    for (int i = 0; i < np; i++)
+    {
+        const float3 diff = reference[i] - curve[i];
+        linf = max(linf, (double)max(fabs(diff.x), max(fabs(diff.y), fabs(diff.z))));
+    }
+
+    fprintf(stderr, "Ordering %d vs row-major, %d particles, Linf norm: %f\n", (int)ordering, np, linf);
+    ASSERT_LE(linf, 0.002);
+}
+
+/// Self interaction forces of \p pv indexed by the particle ids
+std::vector<float3> forcesById(ParticleVector* pv)
+{
+    const int np = pv->local()->size();
+
+    HostBuffer<Force> frcs;
+    frcs.copy(pv->local()->forces, 0);
+    pv->local()->coosvels.downloadFromDevice(0);
+    CUDA_Check( cudaDeviceSynchronize() );
+
+    std::vector<float3> res(np);
+    for (int i = 0; i < np; i++)
+        res[pv->local()->coosvels[i].getId()] = frcs[i].f;
+
+    return res;
+}
+
+/**
+ * Advance the particles of \p pv by \p dt with their velocities.
+ * Particles are reflected from the boundaries, such that they stay in the domain
+ * and none of them jumps across it
+ */
+void moveParticles(ParticleVector* pv, float3 length, float dt)
+{
+    auto& particles = pv->local()->coosvels;
+    particles.downloadFromDevice(0);
+
+    auto reflect = [] (float& x, float& u, float L) {
+        if (x < -0.5f*L) { x = -L - x; u = -u; }
+        if (x >= 0.5f*L) { x =  L - x; u = -u; }
+    };
+
+    for (auto& p : particles)
+    {
+        p.r += dt * p.u;
+        reflect(p.r.x, p.u.x, length.x);
+        reflect(p.r.y, p.u.y, length.y);
+        reflect(p.r.z, p.u.z, length.z);
+    }
+
+    particles.uploadToDevice(0);
+    pv->cellListStamp++;
+}
+
+/**
+ * Move the particles for several steps, such that they cross the skin
+ * and the Verlet lists are rebuilt. At every step the forces have to
+ * match the ones computed by traversing the cells
+ */
+void compareVerletSteps(MPI_Comm comm, float3 length, float skin, int nsteps, float dt)
+{
+    DomainInfo domain{length, {0,0,0}, length, length, length};
+    const float rc = 1.0f;
+
+    ParticleVector dpdsCells ("dpd_cells",  1.0f);
+    ParticleVector dpdsVerlet("dpd_verlet", 1.0f);
+
+    UniformIC ic(8.0);
+    ic.exec(comm, &dpdsCells, domain, 0);
+
+    const int np = dpdsCells.local()->size();
+    for (auto& p : dpdsCells.local()->coosvels)
+        p.u = make_float3(drand48() - 0.5, drand48() - 0.5, drand48() - 0.5);
+    dpdsCells.local()->coosvels.uploadToDevice(0);
+
+    dpdsVerlet.local()->resize_anew(np);
+    dpdsVerlet.local()->coosvels.copy(dpdsCells.local()->coosvels, 0);
+
+    PrimaryCellList cellsCells (&dpdsCells,  rc, length);
+    PrimaryCellList cellsVerlet(&dpdsVerlet, rc, length);
+
+    Pairwise_Norandom_DPD dpdInt(rc, 50.0f, 20.0f, 1.0f, 0.002f, 1.0f);
+    InteractionPair<Pairwise_Norandom_DPD> interCells ("dpd_cells",  rc, dpdInt);
+    InteractionPair<Pairwise_Norandom_DPD> interVerlet("dpd_verlet", rc, dpdInt);
+    interVerlet.setVerletList(skin);
+
+    for (int step = 0; step < nsteps; step++)
+    {
+        cellsCells. build(0);
+        cellsVerlet.build(0);
+
+        dpdsCells. local()->forces.clear(0);
+        dpdsVerlet.local()->forces.clear(0);
+
+        interCells. regular(&dpdsCells,  &dpdsCells,  &cellsCells,  &cellsCells,  0, 0);
+        interVerlet.regular(&dpdsVerlet, &dpdsVerlet, &cellsVerlet, &cellsVerlet, 0, 0);
+
+        auto reference = forcesById(&dpdsCells);
+        auto verlet    = forcesById(&dpdsVerlet);
+        ASSERT_EQ(reference.size(), verlet.size());
+
+        double linf = 0;
+        for (int i = 0; i < reference.size(); i++)
+        {
+            const float3 diff = reference[i] - verlet[i];
+            linf = max(linf, (double)max(fabs(diff.x), max(fabs(diff.y), fabs(diff.z))));
+        }
+
+        ASSERT_LE(linf, 0.002) << "step " << step;
+
+        moveParticles(&dpdsCells,  length, dt);
+        moveParticles(&dpdsVerlet, length, dt);
+    }
+
+    ASSERT_EQ(interVerlet.verletLists.size(), 1);
+    const int nrebuilds = interVerlet.verletLists.begin()->second->getRebuildCount();
+    fprintf(stderr, "Verlet lists with skin %f were built %d times in %d steps\n", skin, nrebuilds, nsteps);
+
+    // Displacements were tracked across steps, and the skin was crossed
+    ASSERT_GT(nrebuilds, 1);
+    ASSERT_LT(nrebuilds, nsteps);
+}
+
+/**
+ * Local and halo host interactions running concurrently on the thread pool
+ * have to give the same forces as the device backend running them one by one.
+ * Halo are the periodic images of the particles close to the upper x face
+ */
+void compareHostThreadPool(MPI_Comm comm, float3 length, int nrepeats)
+{
+    DomainInfo domain{length, {0,0,0}, length, length, length};
+    const float rc = 1.0f;
+
+    ParticleVector dpds("dpd", 1.0f);
+    UniformIC ic(8.0);
+    ic.exec(comm, &dpds, domain, 0);
+
+    for (auto& p : dpds.local()->coosvels)
+        p.u = make_float3(drand48() - 0.5, drand48() - 0.5, drand48() - 0.5);
+    dpds.local()->coosvels.uploadToDevice(0);
+
+    std::vector<Particle> images;
+    for (auto p : dpds.local()->coosvels)
+        if (p.r.x >= 0.5f*length.x - rc)
+        {
+            p.r.x -= length.x;
+            images.push_back(p);
+        }
+
+    auto lhalo = dpds.halo();
+    lhalo->resize_anew(images.size());
+    std::copy(images.begin(), images.end(), lhalo->coosvels.hostPtr());
+    lhalo->coosvels.uploadToDevice(0);
+
+    PrimaryCellList cells(&dpds, rc, length);
+    cells.build(0);
+
+    Pairwise_Norandom_DPD dpdInt(rc, 50.0f, 20.0f, 1.0f, 0.002f, 1.0f);
+    InteractionPair<Pairwise_Norandom_DPD> interDevice("dpd_device", rc, dpdInt);
+    InteractionPair<Pairwise_Norandom_DPD> interHost  ("dpd_host",   rc, dpdInt);
+    interHost.setBackend(ExecutionBackend::Host);
+
+    dpds.local()->forces.clear(0);
+    interDevice.regular(&dpds, &dpds, &cells, &cells, 0, 0);
+    interDevice.halo   (&dpds, &dpds, &cells, &cells, 0, 0);
+    auto reference = forcesById(&dpds);
+
+    TaskScheduler scheduler;
+    scheduler.setExecutor(TaskScheduler::Executor::ThreadPool, 2);
+
+    auto clear = scheduler.createTask("Clear forces");
+    auto local = scheduler.createTask("Local forces");
+    auto halo  = scheduler.createTask("Halo forces");
+
+    scheduler.addTask(clear, [&](cudaStream_t stream) { dpds.local()->forces.clear(stream); });
+    scheduler.addTask(local, [&](cudaStream_t stream) { interHost.regular(&dpds, &dpds, &cells, &cells, 0, stream); });
+    scheduler.addTask(halo,  [&](cudaStream_t stream) { interHost.halo   (&dpds, &dpds, &cells, &cells, 0, stream); });
+
+    scheduler.addDependency(local, {}, {clear});
+    scheduler.addDependency(halo,  {}, {clear});
+    scheduler.compile();
+
+    for (int rep = 0; rep < nrepeats; rep++)
+    {
+        // Host copies of the cell-list are made again every time
+        dpds.cellListStamp++;
+        cells.build(0);
+
+        scheduler.run();
+        auto host = forcesById(&dpds);
+        ASSERT_EQ(reference.size(), host.size());
+
+        double linf = 0;
+        for (int i = 0; i < reference.size(); i++)
+        {
+            const float3 diff = reference[i] - host[i];
+            linf = max(linf, (double)max(fabs(diff.x), max(fabs(diff.y), fabs(diff.z))));
+        }
+
+        ASSERT_LE(linf, 0.002) << "repetition " << rep;
+    }
+}
+
 TEST(Interactions, smallDomain)
 {
     float3 length{3, 4, 5};
@@ -282,6 +545,35 @@ TEST(Interactions, largerDomain)
     execute(MPI_COMM_WORLD, length);
 }
 
+TEST(Interactions, hostBackend)
+{
+    float3 length{24, 17, 9};
+    execute(MPI_COMM_WORLD, length, ExecutionBackend::Host);
+}
+
+TEST(Interactions, hostBackendThreadPool)
+{
+    compareHostThreadPool(MPI_COMM_WORLD, make_float3(24, 17, 9), 20);
+}
+
+TEST(Interactions, verletList)
+{
+    float3 length{24, 17, 9};
+    execute(MPI_COMM_WORLD, length, ExecutionBackend::Device, 0.3f);
+}
+
+TEST(Interactions, verletListSteps)
+{
+    compareVerletSteps(MPI_COMM_WORLD, make_float3(24, 17, 9), 0.3f, 40, 0.02f);
+}
+
+TEST(Interactions, curveOrderings)
+{
+    compareOrderings(MPI_COMM_WORLD, make_float3(24, 17, 9),  CellListOrdering::Hilbert);
+    compareOrderings(MPI_COMM_WORLD, make_float3(16, 16, 16), CellListOrdering::Hilbert);
+    compareOrderings(MPI_COMM_WORLD, make_float3(24, 17, 9),  CellListOrdering::Morton);
+}
+
 int main(int argc, char ** argv)
 {
     MPI_Init(&argc, &argv);
@@ -0,0 +1,173 @@
+#include <core/pvs/extra_data/packers.h>
+#include <core/containers.h>
+#include <core/logger.h>
+#include <core/utils/cuda_common.h>
+#include <core/utils/kernel_launch.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+Logger logger;
+
+__global__ void roundTrip1d(int n, const float* x, float* res, float L, float slab)
+{
+    const int i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i >= n) return;
+
+    res[i] = CompressedParticle::decode1d(CompressedParticle::encode1d(x[i], L, slab), L, slab);
+}
+
+__global__ void roundTripParticles(int n, const Particle* src, Particle* dst, float3 L, float slab)
+{
+    const int i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i >= n) return;
+
+    CompressedParticle cp;
+    cp.encode(src[i], L, slab);
+    dst[i] = cp.decode(L, slab);
+}
+
+static std::vector<float> decodeEncoded(const std::vector<float>& x, float L, float slab)
+{
+    const int n = x.size();
+    PinnedBuffer<float> src(n), dst(n);
+    std::copy(x.begin(), x.end(), src.hostPtr());
+    src.uploadToDevice(0);
+
+    const int nthreads = 128;
+    SAFE_KERNEL_LAUNCH(
+            roundTrip1d,
+            getNblocks(n, nthreads), nthreads, 0, 0,
+            n, src.devPtr(), dst.devPtr(), L, slab );
+
+    dst.downloadFromDevice(0);
+    return std::vector<float>(dst.begin(), dst.end());
+}
+
+/// Largest allowed error at \p x: half of the step of the range \p x falls in
+static float allowedError(float x, float L, float slab)
+{
+    const float lo = -0.5f*L, hi = 0.5f*L;
+    float quantum;
+
+    if      (x < lo) quantum = slab / CompressedParticle::slabCodes;
+    else if (x < hi) quantum = L    / CompressedParticle::insideCodes;
+    else             quantum = slab / (CompressedParticle::slabCodes - 1);
+
+    // Rounding of the float arithmetics on top of the quantization
+    return 0.5f * quantum * 1.01f + 1e-6f * (0.5f*L + slab);
+}
+
+static void checkPositions(float L, float slab)
+{
+    const float lo = -0.5f*L, hi = 0.5f*L;
+
+    std::vector<float> x;
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> udistr(lo - slab, hi + slab);
+    for (int i = 0; i < 100000; i++)
+        x.push_back(udistr(gen));
+
+    // Edges of the slabs and of the subdomain, and their neighbourhood
+    for (float edge : {lo - slab, lo, hi, hi + slab})
+        for (float eps : {0.0f, 1e-6f, -1e-6f, 1e-4f, -1e-4f})
+        {
+            const float v = edge + eps * (slab + L);
+            if (v >= lo - slab && v <= hi + slab)
+                x.push_back(v);
+        }
+
+    auto res = decodeEncoded(x, L, slab);
+
+    float maxRelErr = 0;
+    for (int i = 0; i < x.size(); i++)
+    {
+        const float err = fabsf(res[i] - x[i]);
+        const float allowed = allowedError(x[i], L, slab);
+        ASSERT_LE(err, allowed) << "x = " << x[i] << " decoded to " << res[i];
+        maxRelErr = std::max(maxRelErr, err / allowed);
+    }
+
+    // Outer edges are exact
+    auto edges = decodeEncoded({lo - slab, hi + slab}, L, slab);
+    ASSERT_FLOAT_EQ(edges[0], lo - slab);
+    ASSERT_FLOAT_EQ(edges[1], hi + slab);
+
+    fprintf(stderr, "L = %f, slab = %f: largest error is %f of the allowed\n", L, slab, maxRelErr);
+}
+
+TEST(CompressedParticle, positions)
+{
+    checkPositions(8.0f,  2.0f);
+    checkPositions(48.0f, 2.0f);
+    checkPositions(5.0f,  1.25f);
+}
+
+TEST(CompressedParticle, particles)
+{
+    const float3 L = make_float3(16, 8, 5);
+    const float slab = 2.0f;
+    const int n = 10000;
+
+    PinnedBuffer<Particle> src(n), dst(n);
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> unit(0, 1);
+    for (int i = 0; i < n; i++)
+    {
+        Particle p;
+        p.r = make_float3( (unit(gen) - 0.5f) * (L.x + 2*slab),
+                           (unit(gen) - 0.5f) * (L.y + 2*slab),
+                           (unit(gen) - 0.5f) * (L.z + 2*slab) );
+
+        // Velocities of very different magnitudes, down to the subnormal half numbers
+        const float scale = powf(10.0f, 8*unit(gen) - 6);
+        p.u = make_float3( (unit(gen) - 0.5f) * scale, (unit(gen) - 0.5f) * scale, (unit(gen) - 0.5f) * scale );
+        if (i == 0) p.u = make_float3(0.0f, -0.0f, 0.0f);
+
+        p.setId( (int64_t)i * 0x1234567ll );
+        src[i] = p;
+    }
+    src.uploadToDevice(0);
+
+    const int nthreads = 128;
+    SAFE_KERNEL_LAUNCH(
+            roundTripParticles,
+            getNblocks(n, nthreads), nthreads, 0, 0,
+            n, src.devPtr(), dst.devPtr(), L, slab );
+    dst.downloadFromDevice(0);
+
+    // Half precision: 11 significant bits, smallest subnormal is 2^-24
+    auto checkHalf = [] (float u, float res) {
+        const float allowed = std::max( fabsf(u) * ldexpf(1.0f, -11), ldexpf(1.0f, -25) );
+        ASSERT_LE(fabsf(res - u), allowed) << "velocity " << u << " decoded to " << res;
+    };
+
+    for (int i = 0; i < n; i++)
+    {
+        const Particle& p = src[i];
+        const Particle& q = dst[i];
+
+        ASSERT_LE(fabsf(q.r.x - p.r.x), allowedError(p.r.x, L.x, slab));
+        ASSERT_LE(fabsf(q.r.y - p.r.y), allowedError(p.r.y, L.y, slab));
+        ASSERT_LE(fabsf(q.r.z - p.r.z), allowedError(p.r.z, L.z, slab));
+
+        checkHalf(p.u.x, q.u.x);
+        checkHalf(p.u.y, q.u.y);
+        checkHalf(p.u.z, q.u.z);
+
+        ASSERT_EQ(q.idKey(), p.idKey());
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    MPI_Init(&argc, &argv);
+    logger.init(MPI_COMM_WORLD, "packers.log", 9);
+
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,281 @@
+#include <core/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define private public
+#include <plugins/interface.h>
+#include <plugins/simple_serializer.h>
+
+Logger logger;
+
+class TestSender : public SimulationPlugin
+{
+public:
+    TestSender() : SimulationPlugin("test_ring") {}
+
+    bool needPostproc() override { return true; }
+
+    /// Messages go to this very rank, there is no postprocess
+    void connectToSelf()
+    {
+        _setup(MPI_COMM_SELF, MPI_COMM_SELF);
+        postRank = 0;
+    }
+
+    using SimulationPlugin::send;
+    using SimulationPlugin::waitAllSends;
+    using SimulationPlugin::borrowedSendDone;
+
+    /// Receive the oldest message sent by connectToSelf() plugin
+    std::vector<char> recvOwn()
+    {
+        int size;
+        MPI_Check( MPI_Recv(&size, 1, MPI_INT, 0, 2*_tag(), interComm, MPI_STATUS_IGNORE) );
+
+        std::vector<char> data(size);
+        MPI_Check( MPI_Recv(data.data(), size, MPI_BYTE, 0, 2*_tag()+1, interComm, MPI_STATUS_IGNORE) );
+        return data;
+    }
+};
+
+class TestReceiver : public PostprocessPlugin
+{
+public:
+    TestReceiver() : PostprocessPlugin("test_ring") {}
+
+    using PostprocessPlugin::nSources;
+    using PostprocessPlugin::sourceData;
+};
+
+static std::vector<char> makeMessage(int id, int size)
+{
+    std::vector<char> msg(size);
+    for (int i = 0; i < size; i++)
+        msg[i] = (char)(id * 31 + i);
+    return msg;
+}
+
+/// Slots are used in turn, and refilling a free slot reuses its memory
+TEST(SendRing, slotReuse)
+{
+    const int nslots = 3, size = 1000;
+
+    TestSender plugin;
+    plugin.connectToSelf();
+    plugin.setSendBuffers(nslots);
+
+    std::vector<const char*> storage;
+    for (int i = 0; i < nslots; i++)
+    {
+        auto msg = makeMessage(i, size);
+        plugin.send(msg.data(), size);
+        storage.push_back(plugin.sendSlots[i].buffer.data());
+    }
+
+    for (int i = 0; i < nslots; i++)
+        ASSERT_EQ(plugin.recvOwn(), makeMessage(i, size));
+
+    // Smaller messages fit into the slots packed before
+    for (int i = nslots; i < 3*nslots; i++)
+    {
+        const int slot = i % nslots;
+        auto msg = makeMessage(i, size - i);
+        plugin.send(msg.data(), msg.size());
+
+        ASSERT_EQ(plugin.sendSlots[slot].buffer.data(), storage[slot]) << "message " << i;
+        ASSERT_EQ(plugin.recvOwn(), msg);
+    }
+
+    plugin.waitAllSends();
+    ASSERT_EQ(plugin.nStalls, 0);
+}
+
+/// Simulation only waits when all the slots are still in flight, and that is counted
+TEST(SendRing, stallCounting)
+{
+    const int nslots = 2, size = 100;
+
+    TestSender plugin;
+    plugin.connectToSelf();
+    plugin.setSendBuffers(nslots);
+
+    for (int i = 0; i < nslots; i++)
+    {
+        auto msg = makeMessage(i, size);
+        plugin.send(msg.data(), size);
+    }
+    ASSERT_EQ(plugin.nStalls, 0);
+
+    // Postprocess is late with the first message
+    std::vector<char> first;
+    std::thread lateReceiver([&] () {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        first = plugin.recvOwn();
+    });
+
+    auto msg = makeMessage(nslots, size);
+    plugin.send(msg.data(), size);
+    lateReceiver.join();
+
+    ASSERT_EQ(plugin.nStalls, 1);
+    ASSERT_GT(plugin.stallTime, 0.0);
+    ASSERT_EQ(first, makeMessage(0, size));
+
+    for (int i = 1; i <= nslots; i++)
+        ASSERT_EQ(plugin.recvOwn(), makeMessage(i, size));
+
+    plugin.waitAllSends();
+    ASSERT_EQ(plugin.nStalls, 1);
+}
+
+/// Only the message read in place keeps its arrays busy, packed messages sent after it don't
+TEST(SendRing, borrowedSend)
+{
+    const int nslots = 2, size = 100;
+
+    TestSender plugin;
+    plugin.connectToSelf();
+    plugin.setSendBuffers(nslots);
+    ASSERT_TRUE(plugin.borrowedSendDone());
+
+    std::vector<float> array(4096, 1.0f);
+    MessageSegments segments;
+    SimpleSerializer::describe(segments, array);
+    ASSERT_EQ(segments.nBorrowed(), 1);
+
+    plugin.send(segments);
+    ASSERT_FALSE(plugin.borrowedSendDone());
+
+    auto msg = makeMessage(1, size);
+    plugin.send(msg.data(), size);
+    ASSERT_FALSE(plugin.borrowedSendDone());
+
+    std::vector<char> expected;
+    SimpleSerializer::serialize(expected, array);
+    ASSERT_EQ(plugin.recvOwn(), expected);
+
+    // Synchronous send completes once matched, the receive is done by now
+    while (!plugin.borrowedSendDone())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // Packed message in the slot of the borrowed one doesn't make it busy again
+    msg = makeMessage(2, size);
+    plugin.send(msg.data(), size);
+    ASSERT_TRUE(plugin.borrowedSendDone());
+
+    ASSERT_EQ(plugin.recvOwn(), makeMessage(1, size));
+    ASSERT_EQ(plugin.recvOwn(), makeMessage(2, size));
+
+    plugin.waitAllSends();
+    ASSERT_EQ(plugin.nStalls, 0);
+}
+
+/// Every simulation task is served by exactly one postprocess task, in groups of consecutive ranks of almost the same size
+TEST(SendRing, postRankGroups)
+{
+    // Uneven example: groups {0, 1, 2}, {3, 4}
+    ASSERT_EQ(firstServedTask(1, 5, 2), 3);
+    ASSERT_EQ(servingPostTask(2, 5, 2), 0);
+    ASSERT_EQ(servingPostTask(3, 5, 2), 1);
+
+    for (int ncompute = 1; ncompute <= 40; ncompute++)
+        for (int npost = 1; npost <= ncompute; npost++)
+        {
+            ASSERT_EQ(firstServedTask(0,     ncompute, npost), 0);
+            ASSERT_EQ(firstServedTask(npost, ncompute, npost), ncompute);
+
+            for (int p = 0; p < npost; p++)
+            {
+                const int first = firstServedTask(p, ncompute, npost), end = firstServedTask(p+1, ncompute, npost);
+                const int groupSize = end - first;
+
+                ASSERT_GE(groupSize, ncompute / npost);
+                ASSERT_LE(groupSize, ncompute / npost + 1);
+
+                for (int c = first; c < end; c++)
+                    ASSERT_EQ(servingPostTask(c, ncompute, npost), p) << ncompute << " simulation tasks, " << npost << " postprocess tasks";
+            }
+        }
+}
+
+/**
+ * Ranks are split like YMeRo does, with postprocess tasks serving different numbers
+ * of simulation tasks when there are 5 ranks: every message has to arrive to its postprocess task
+ */
+TEST(SendRing, unevenGroups)
+{
+    int rank, nranks;
+    MPI_Check( MPI_Comm_rank(MPI_COMM_WORLD, &rank) );
+    MPI_Check( MPI_Comm_size(MPI_COMM_WORLD, &nranks) );
+    if (nranks < 2) return;
+
+    const int npost = nranks / 2, ncompute = nranks - npost;
+
+    int computeTask = 1;
+    for (int p = 0; p < npost; p++)
+        if (rank == firstServedTask(p, ncompute, npost) + p)
+            computeTask = 0;
+
+    MPI_Comm splitComm, interComm;
+    MPI_Check( MPI_Comm_split(MPI_COMM_WORLD, computeTask, rank, &splitComm) );
+    MPI_Check( MPI_Intercomm_create(splitComm, 0, MPI_COMM_WORLD, computeTask ? 0 : 1, 0, &interComm) );
+
+    int localRank;
+    MPI_Check( MPI_Comm_rank(splitComm, &localRank) );
+
+    if (computeTask)
+    {
+        TestSender plugin;
+        plugin.setup(nullptr, splitComm, interComm);
+        ASSERT_EQ(plugin.postRank, servingPostTask(localRank, ncompute, npost));
+
+        plugin.send(&localRank, sizeof(localRank));
+        plugin.waitAllSends();
+    }
+    else
+    {
+        TestReceiver plugin;
+        plugin.setup(splitComm, interComm);
+
+        const int first = firstServedTask(localRank, ncompute, npost);
+        ASSERT_EQ(plugin.nSources(), firstServedTask(localRank+1, ncompute, npost) - first);
+
+        auto req = plugin.waitData();
+        MPI_Check( MPI_Wait(&req, MPI_STATUS_IGNORE) );
+        plugin.recv();
+
+        for (int i = 0; i < plugin.nSources(); i++)
+        {
+            int source;
+            ASSERT_EQ(plugin.sourceData(i).size(), sizeof(source));
+            memcpy(&source, plugin.sourceData(i).data(), sizeof(source));
+            ASSERT_EQ(source, first + i);
+        }
+    }
+
+    MPI_Check( MPI_Comm_free(&interComm) );
+    MPI_Check( MPI_Comm_free(&splitComm) );
+}
+
+int main(int argc, char ** argv)
+{
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    logger.init(MPI_COMM_WORLD, "plugins.log", 9);
+
+    if (provided < MPI_THREAD_MULTIPLE)
+    {
+        warn("MPI library doesn't provide MPI_THREAD_MULTIPLE, the send ring can't be tested");
+        MPI_Finalize();
+        return 0;
+    }
+
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,173 @@
+#include <core/pvs/particle_vector.h>
+#include <core/decomposition.h>
+#include <core/logger.h>
+#include <core/utils/folders.h>
+#include <core/xdmf/xdmf.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+Logger logger;
+
+/// Id and global position of the local particles, sorted such that the order in the file doesn't matter
+using Entries = std::vector< std::tuple<int64_t, float, float, float> >;
+
+static const std::string restartPath = "restart_ids/";
+
+/// Periodic cartesian communicator over \p comm with the domain of this rank
+static MPI_Comm makeCartComm(MPI_Comm comm, float3 localSize, DomainInfo& domain)
+{
+    MPI_Comm cartComm;
+    int nranks, rank, dims[3] = {0, 0, 0}, periods[3] = {1, 1, 1}, coords[3];
+
+    MPI_Check( MPI_Comm_size(comm, &nranks) );
+    MPI_Check( MPI_Dims_create(nranks, 3, dims) );
+    MPI_Check( MPI_Cart_create(comm, 3, dims, periods, 0, &cartComm) );
+    MPI_Check( MPI_Comm_rank(cartComm, &rank) );
+    MPI_Check( MPI_Cart_coords(cartComm, rank, 3, coords) );
+
+    const int3 nranks3D = make_int3(dims[0], dims[1], dims[2]);
+    Decomposition decomposition(nranks3D, localSize * make_float3(nranks3D));
+    domain = decomposition.createDomain(make_int3(coords[0], coords[1], coords[2]));
+
+    return cartComm;
+}
+
+static Particle randomParticle(const DomainInfo& domain, int64_t id)
+{
+    Particle p;
+    p.r = make_float3( (drand48() - 0.5) * domain.localSize.x,
+                       (drand48() - 0.5) * domain.localSize.y,
+                       (drand48() - 0.5) * domain.localSize.z );
+    p.u = make_float3(drand48() - 0.5, drand48() - 0.5, drand48() - 0.5);
+    p.setId(id);
+    return p;
+}
+
+static Entries localEntries(ParticleVector* pv)
+{
+    pv->local()->coosvels.downloadFromDevice(0, ContainersSynch::Synch);
+
+    Entries res;
+    for (const auto& p : pv->local()->coosvels)
+    {
+        auto r = pv->domain.local2global(p.r);
+        res.push_back(std::make_tuple(p.getId(), r.x, r.y, r.z));
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+static Entries restartEntries(MPI_Comm cartComm, const DomainInfo& domain, std::string name)
+{
+    ParticleVector pv(name, 1.0f);
+    pv.domain = domain;
+    pv.restart(cartComm, restartPath);
+    return localEntries(&pv);
+}
+
+/// Ids have to match exactly, positions are shifted to the local coordinates and back
+static void compareEntries(const Entries& restarted, const Entries& expected)
+{
+    const float tol = 1e-5f;
+
+    ASSERT_EQ(restarted.size(), expected.size());
+    for (int i = 0; i < expected.size(); i++)
+    {
+        ASSERT_EQ(std::get<0>(restarted[i]), std::get<0>(expected[i])) << "particle " << i;
+        ASSERT_NEAR(std::get<1>(restarted[i]), std::get<1>(expected[i]), tol) << "id " << std::get<0>(expected[i]);
+        ASSERT_NEAR(std::get<2>(restarted[i]), std::get<2>(expected[i]), tol) << "id " << std::get<0>(expected[i]);
+        ASSERT_NEAR(std::get<3>(restarted[i]), std::get<3>(expected[i]), tol) << "id " << std::get<0>(expected[i]);
+    }
+}
+
+/// Ids above 2^31 and 2^32 must survive checkpoint and restart unchanged
+TEST(Restart, ids64bit)
+{
+    const int n = 1000;
+    DomainInfo domain;
+    auto cartComm = makeCartComm(MPI_COMM_WORLD, make_float3(8, 8, 8), domain);
+
+    int rank;
+    MPI_Check( MPI_Comm_rank(cartComm, &rank) );
+    createFoldersCollective(cartComm, restartPath);
+
+    ParticleVector pv("pv64", 1.0f, n);
+    pv.domain = domain;
+    for (int i = 0; i < n; i++)
+    {
+        // Half of the ids need the sign bit of the lower part, half need the upper part
+        const int64_t base = (i % 2 == 0) ? (1ll << 31) : (5ll << 32);
+        pv.local()->coosvels[i] = randomParticle(domain, base + (int64_t)rank * n + i);
+    }
+    pv.local()->coosvels.uploadToDevice(0);
+
+    auto expected = localEntries(&pv);
+    pv.checkpoint(cartComm, restartPath);
+
+    auto restarted = restartEntries(cartComm, domain, "pv64");
+
+    compareEntries(restarted, expected);
+
+    MPI_Check( MPI_Comm_free(&cartComm) );
+}
+
+/// Checkpoints written before the ids were extended have a 32-bit "ids" channel and no spatial index
+TEST(Restart, ids32bitFile)
+{
+    const int n = 1000;
+    DomainInfo domain;
+    auto cartComm = makeCartComm(MPI_COMM_WORLD, make_float3(8, 8, 8), domain);
+
+    int rank;
+    MPI_Check( MPI_Comm_rank(cartComm, &rank) );
+    createFoldersCollective(cartComm, restartPath);
+
+    auto positions = std::make_shared<std::vector<float>>();
+    std::vector<float> velocities;
+    std::vector<int> ids;
+    Entries expected;
+
+    for (int i = 0; i < n; i++)
+    {
+        // Largest ids that fit into the old format are included
+        const int id = (i < 10) ? 0x7fffffff - rank * 10 - i : rank * n + i;
+        auto p = randomParticle(domain, id);
+        auto r = domain.local2global(p.r);
+
+        positions->insert(positions->end(), {r.x, r.y, r.z});
+        velocities.insert(velocities.end(), {p.u.x, p.u.y, p.u.z});
+        ids.push_back(id);
+        expected.push_back(std::make_tuple((int64_t)id, r.x, r.y, r.z));
+    }
+    std::sort(expected.begin(), expected.end());
+
+    {
+        XDMF::VertexGrid grid(positions, cartComm);
+        std::vector<XDMF::Channel> channels = {
+            XDMF::Channel("velocity", velocities.data(), XDMF::Channel::Type::Vector),
+            XDMF::Channel("ids",      ids.data(),        XDMF::Channel::Type::Scalar, XDMF::Channel::Datatype::Int)
+        };
+        XDMF::write(restartPath + "pv32", &grid, channels, cartComm);
+    }
+
+    auto restarted = restartEntries(cartComm, domain, "pv32");
+
+    compareEntries(restarted, expected);
+
+    MPI_Check( MPI_Comm_free(&cartComm) );
+}
+
+int main(int argc, char ** argv)
+{
+    MPI_Init(&argc, &argv);
+    logger.init(MPI_COMM_WORLD, "restart.log", 9);
+
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
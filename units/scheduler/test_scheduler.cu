@@ -2,6 +2,11 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <fstream>
 
 #include <core/logger.h>
 #include <core/task_scheduler.h>
@@ -23,7 +28,7 @@ void verifyDep(const std::string& before, const std::string& after,
     ASSERT_LT(itb, ita);
 }
 
-TEST(Scheduler, Order)
+void checkOrder(TaskScheduler::Executor executor)
 {
     //  A1,A2 - B -----------
     //              \        \
@@ -33,7 +38,14 @@ TEST(Scheduler, Order)
     //                        G
 
     TaskScheduler scheduler;
+    scheduler.setExecutor(executor, 4);
+
     std::vector<std::string> messages;
+    std::mutex mutex;
+    auto say = [&] (std::string msg) {
+        std::lock_guard<std::mutex> lock(mutex);
+        messages.push_back(msg);
+    };
 
     auto A1 = scheduler.createTask("A1");
     auto A2 = scheduler.createTask("A2");
@@ -45,15 +57,15 @@ TEST(Scheduler, Order)
     auto F  = scheduler.createTask("F");
     auto G  = scheduler.createTask("G");
 
-    scheduler.addTask(A1, [&](cudaStream_t s){ messages.push_back("a1"); });
-    scheduler.addTask(A2, [&](cudaStream_t s){ messages.push_back("a2"); });
-    scheduler.addTask(B , [&](cudaStream_t s){ messages.push_back("b" ); });
-    scheduler.addTask(C , [&](cudaStream_t s){ messages.push_back("c" ); });
-    scheduler.addTask(D1, [&](cudaStream_t s){ messages.push_back("d1"); });
-    scheduler.addTask(D2, [&](cudaStream_t s){ messages.push_back("d2"); });
-    scheduler.addTask(E , [&](cudaStream_t s){ messages.push_back("e" ); });
-    scheduler.addTask(F , [&](cudaStream_t s){ messages.push_back("f" ); });
-    scheduler.addTask(G , [&](cudaStream_t s){ messages.push_back("g" ); });
+    scheduler.addTask(A1, [&](cudaStream_t s){ say("a1"); });
+    scheduler.addTask(A2, [&](cudaStream_t s){ say("a2"); });
+    scheduler.addTask(B , [&](cudaStream_t s){ say("b" ); });
+    scheduler.addTask(C , [&](cudaStream_t s){ say("c" ); });
+    scheduler.addTask(D1, [&](cudaStream_t s){ say("d1"); });
+    scheduler.addTask(D2, [&](cudaStream_t s){ say("d2"); });
+    scheduler.addTask(E , [&](cudaStream_t s){ say("e" ); });
+    scheduler.addTask(F , [&](cudaStream_t s){ say("f" ); });
+    scheduler.addTask(G , [&](cudaStream_t s){ say("g" ); });
                 
     scheduler.addDependency(B, {}, {A1, A2});
     scheduler.addDependency(D1, {}, {B, C});
@@ -82,6 +94,159 @@ TEST(Scheduler, Order)
     verifyDep("b" , "e", messages);
 }
 
+TEST(Scheduler, Order)
+{
+    checkOrder(TaskScheduler::Executor::Streams);
+}
+
+TEST(Scheduler, OrderThreadPool)
+{
+    checkOrder(TaskScheduler::Executor::ThreadPool);
+}
+
+TEST(Scheduler, OrderedTasks)
+{
+    // Independent tasks, every second one is ordered
+    TaskScheduler scheduler;
+    scheduler.setExecutor(TaskScheduler::Executor::ThreadPool, 4);
+
+    const int ntasks = 16;
+    std::vector<std::string> sequence;
+    std::atomic<int> running{0}, maxRunning{0};
+
+    for (int i = 0; i < ntasks; i++)
+    {
+        auto id = scheduler.createTask("T" + std::to_string(i));
+        const bool ordered = i % 2 == 0;
+
+        scheduler.addTask(id, [&, i, ordered] (cudaStream_t s) {
+            if (!ordered)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                return;
+            }
+
+            const int now = ++running;
+            int prev = maxRunning;
+            while (now > prev && !maxRunning.compare_exchange_weak(prev, now));
+
+            sequence.push_back("T" + std::to_string(i));
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            running--;
+        });
+
+        if (ordered) scheduler.setOrdered(id);
+    }
+
+    scheduler.compile();
+
+    for (int run = 0; run < 5; run++)
+    {
+        sequence.clear();
+        scheduler.run();
+
+        ASSERT_EQ(sequence.size(), ntasks / 2);
+        for (int i = 0; i < ntasks / 2; i++)
+            ASSERT_EQ(sequence[i], "T" + std::to_string(2*i));
+    }
+
+    ASSERT_EQ(maxRunning, 1);
+}
+
+TEST(Scheduler, Timings)
+{
+    TaskScheduler scheduler;
+    scheduler.setExecutor(TaskScheduler::Executor::ThreadPool, 2);
+
+    auto A = scheduler.createTask("A");
+    auto B = scheduler.createTask("B");
+
+    scheduler.addTask(A, [](cudaStream_t s){ std::this_thread::sleep_for(std::chrono::milliseconds(5)); });
+    scheduler.addTask(B, [](cudaStream_t s){ });
+    scheduler.addDependency(B, {}, {A});
+
+    scheduler.compile();
+    scheduler.run();
+    scheduler.run();
+
+    for (auto& t : scheduler.getTimings())
+    {
+        ASSERT_EQ(t.nExecutions, 2);
+        if (t.label == "A") ASSERT_GE(t.lastWall, 5.0);
+        if (t.label == "B") ASSERT_LT(t.lastWall, 5.0);
+    }
+}
+
+TEST(Scheduler, CriticalPath)
+{
+    TaskScheduler scheduler;
+
+    auto A1 = scheduler.createTask("A1");
+    auto A2 = scheduler.createTask("A2");
+    auto B  = scheduler.createTask("B");
+    auto C  = scheduler.createTask("C");
+
+    scheduler.addTask(A1, [](cudaStream_t s){ });
+    scheduler.addTask(A2, [](cudaStream_t s){ });
+    scheduler.addTask(B,  [](cudaStream_t s){ std::this_thread::sleep_for(std::chrono::milliseconds(10)); });
+    scheduler.addTask(C,  [](cudaStream_t s){ });
+
+    scheduler.addDependency(A2, {C}, {A1});
+    scheduler.addDependency(B,  {C}, {});
+
+    scheduler.setAutoPriorities(true, 2);
+    scheduler.compile();
+
+    auto findSlack = [&scheduler] (std::string label) {
+        for (auto& s : scheduler.getSlacks())
+            if (s.label == label) return s;
+        return TaskScheduler::TaskSlack{};
+    };
+
+    // Unit costs: the longest chain is A1 -> A2 -> C
+    ASSERT_TRUE (findSlack("A1").critical);
+    ASSERT_TRUE (findSlack("C") .critical);
+    ASSERT_FALSE(findSlack("B") .critical);
+    ASSERT_EQ(findSlack("B").slack, 1.0);
+
+    // Measured costs: B is much longer than A1 + A2
+    scheduler.run();
+    scheduler.run();
+
+    ASSERT_TRUE (findSlack("B") .critical);
+    ASSERT_FALSE(findSlack("A1").critical);
+    ASSERT_GT(findSlack("A2").slack, 5.0);
+}
+
+TEST(Scheduler, Trace)
+{
+    TaskScheduler scheduler;
+
+    auto A = scheduler.createTask("A");
+    auto B = scheduler.createTask("B");
+
+    scheduler.addTask(A, [](cudaStream_t s){ });
+    scheduler.addTask(B, [](cudaStream_t s){ }, 2);
+    scheduler.addDependency(B, {}, {A});
+
+    scheduler.setTracing("trace", 0, 2);
+    scheduler.compile();
+    scheduler.run();
+    scheduler.run();
+
+    std::ifstream fin("trace_00000002.json");
+    ASSERT_TRUE(fin.good());
+
+    std::string content( (std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>() );
+
+    int nEvents = 0;
+    for (size_t pos = content.find("\"ph\": \"X\""); pos != std::string::npos; pos = content.find("\"ph\": \"X\"", pos+1))
+        nEvents++;
+
+    ASSERT_EQ(nEvents, 4);
+    ASSERT_NE(content.find("\"executed\": 0"), std::string::npos);
+}
+
 TEST(Scheduler, Benchmark)
 {
     TaskScheduler scheduler;
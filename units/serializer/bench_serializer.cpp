@@ -0,0 +1,97 @@
+#include <plugins/simple_serializer.h>
+#include <core/containers.h>
+#include <core/datatypes.h>
+
+#include "../timer.h"
+
+#include <vector>
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+/**
+ * Cost of a particle dump message on the host: packing it on the sender side
+ * and reading the particles and channels on the receiver side,
+ * with copies into vectors or with segments and views.
+ * Disabled by default, run with --gtest_also_run_disabled_tests
+ */
+struct DumpTimes
+{
+    double send, recv;
+};
+
+static DumpTimes benchmarkCopies(const std::vector<Particle>& particles, const std::vector<std::vector<float>>& channels, int nrepeats)
+{
+    std::vector<char> buf;
+    std::vector<Particle> recvParticles;
+    std::vector<std::vector<float>> recvChannels;
+    float t = 0, sum = 0;
+
+    Timer timer;
+    timer.start();
+    for (int i = 0; i < nrepeats; i++)
+        SimpleSerializer::serialize(buf, t, particles, channels);
+    const double send = timer.elapsed() * 1e-6 / nrepeats;
+
+    timer.start();
+    for (int i = 0; i < nrepeats; i++)
+    {
+        SimpleSerializer::deserialize(buf, t, recvParticles, recvChannels);
+        for (auto& p : recvParticles) sum += p.r.x;
+    }
+    const double recv = timer.elapsed() * 1e-6 / nrepeats;
+
+    // Keep the reads from being optimized out
+    if (sum == 42) printf(" ");
+    return {send, recv};
+}
+
+static DumpTimes benchmarkViews(const std::vector<Particle>& particles, const std::vector<std::vector<float>>& channels, int nrepeats)
+{
+    MessageSegments segs;
+    std::vector<char> buf;
+    ArrayView<Particle> recvParticles;
+    std::vector<ArrayView<float>> recvChannels;
+    float t = 0, sum = 0;
+
+    // Sending the segments costs one datatype creation instead of the packing
+    Timer timer;
+    timer.start();
+    for (int i = 0; i < nrepeats; i++)
+    {
+        SimpleSerializer::describe(segs, t, particles, channels);
+        MPI_Datatype type = segs.createType();
+        MPI_Check( MPI_Type_free(&type) );
+    }
+    const double send = timer.elapsed() * 1e-6 / nrepeats;
+
+    segs.gather(buf);
+
+    timer.start();
+    for (int i = 0; i < nrepeats; i++)
+    {
+        SimpleSerializer::deserialize(buf, t, recvParticles, recvChannels);
+        for (int j = 0; j < recvParticles.size(); j++) sum += recvParticles[j].r.x;
+    }
+    const double recv = timer.elapsed() * 1e-6 / nrepeats;
+
+    if (sum == 42) printf(" ");
+    return {send, recv};
+}
+
+TEST (Serializer, DISABLED_ParticleDumpBenchmark)
+{
+    const int nrepeats = 20;
+
+    for (int n : {10000, 100000, 1000000, 4000000})
+    {
+        std::vector<Particle> particles(n, Particle({1, 2, 3, 0}, {4, 5, 6, 0}));
+        std::vector<std::vector<float>> channels{ std::vector<float>(n, 1.0f), std::vector<float>(3*n, 2.0f) };
+
+        auto copies = benchmarkCopies(particles, channels, nrepeats);
+        auto views  = benchmarkViews (particles, channels, nrepeats);
+
+        printf("%8d particles:  send: copies %8.3f ms, segments %8.3f ms;  receive: copies %8.3f ms, views %8.3f ms\n",
+               n, copies.send, views.send, copies.recv, views.recv);
+    }
+}
@@ -90,6 +90,80 @@ TEST(Serializer, Mixed)
 
 }
 
+TEST(Serializer, ArrayViews)
+{
+    float s1 = 1, d1;
+    std::string s2 = "odd", d2;
+    std::vector<Particle> s3{ Particle({0,1,2,3}, {4,5,6,7}), Particle({8,9,10,11}, {12,13,14,15}) };
+    std::vector<std::vector<float>> s4{ {1,2,3}, {}, {4,5} };
+    std::vector<char> buf;
+
+    SimpleSerializer::serialize(buf, s1, s2, s3, s4);
+
+    // The string leaves the particles unaligned
+    ArrayView<Particle> d3;
+    std::vector<ArrayView<float>> d4;
+    SimpleSerializer::deserialize(buf, d1, d2, d3, d4);
+
+    myassert(s1 == d1 && s2 == d2, "mismatch on the scalars");
+    myassert(d3.size() == s3.size(), "mismatch on the number of particles");
+    for (int i = 0; i < s3.size(); i++)
+        myassert(d3[i].r.y == s3[i].r.y && d3[i].u.z == s3[i].u.z, "mismatch on particle " + std::to_string(i));
+
+    myassert(d4.size() == s4.size(), "mismatch on the number of arrays");
+    for (int i = 0; i < s4.size(); i++)
+    {
+        std::vector<float> copy;
+        d4[i].appendTo(copy);
+        myassert(copy == s4[i], "mismatch on array " + std::to_string(i));
+    }
+}
+
+TEST(Serializer, SegmentsMatchSerialize)
+{
+    int s1 = 42;
+    std::string s2 = "name";
+    std::vector<double> s3(1000, 3.14), s4{1, 2};
+    std::vector<std::vector<int>> s5{ std::vector<int>(2000, 7), {1} };
+
+    std::vector<char> reference, gathered;
+    SimpleSerializer::serialize(reference, s1, s2, s3, s4, s5);
+
+    MessageSegments segs;
+    SimpleSerializer::describe(segs, s1, s2, s3, s4, s5);
+
+    // s3 and the first array of s5 are large enough to be left in place
+    myassert(segs.nBorrowed() == 2, "expected 2 borrowed arrays, got " + std::to_string(segs.nBorrowed()));
+    myassert(segs.totalSize() == reference.size(), "mismatch on the message size");
+
+    segs.gather(gathered);
+    myassert(gathered == reference, "gathered message differs from the serialized one");
+}
+
+TEST(Serializer, SegmentsSentAsDatatype)
+{
+    std::vector<float> s1(5000, 1.5f);
+    std::vector<std::string> s2{"density", "velocity"};
+    HostBuffer<Particle> s3(1000);
+    for (int i = 0; i < s3.size(); i++)
+        s3[i] = Particle({(float)i, 0, 0, i}, {0, 0, 0, 0});
+
+    std::vector<char> reference;
+    SimpleSerializer::serialize(reference, s1, s2, s3);
+
+    MessageSegments segs;
+    SimpleSerializer::describe(segs, s1, s2, s3);
+
+    MPI_Datatype type = segs.createType();
+    std::vector<char> received(segs.totalSize());
+    MPI_Check( MPI_Sendrecv(MPI_BOTTOM, 1, type, 0, 0,
+                            received.data(), received.size(), MPI_BYTE, 0, 0,
+                            MPI_COMM_SELF, MPI_STATUS_IGNORE) );
+    MPI_Check( MPI_Type_free(&type) );
+
+    myassert(received == reference, "received message differs from the serialized one");
+}
+
 int main(int argc, char **argv)
 {
     MPI_Init(&argc, &argv);
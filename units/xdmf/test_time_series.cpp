@@ -0,0 +1,206 @@
+#include <core/xdmf/xdmf.h>
+#include <core/logger.h>
+
+#include <extern/pugixml/src/pugixml.hpp>
+
+#include <gtest/gtest.h>
+
+#include <hdf5.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+Logger logger;
+
+/// Rows of this rank in step \p step, some steps are empty on all the ranks
+static int localRows(int step, int rank)
+{
+    const int base[] = {3, 0, 7, 1};
+    return base[step] == 0 ? 0 : base[step] + rank;
+}
+
+/// Unique value for every row of every step
+static float rowValue(int step, int rank, int i)
+{
+    return step * 1000.0f + rank * 100.0f + i;
+}
+
+template<typename T>
+static std::vector<T> readDataSet(hid_t file_id, std::string name, hid_t datatype)
+{
+    hid_t dset_id  = H5Dopen(file_id, name.c_str(), H5P_DEFAULT);
+    hid_t space_id = H5Dget_space(dset_id);
+
+    std::vector<T> data(H5Sget_simple_extent_npoints(space_id));
+    H5Dread(dset_id, datatype, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+
+    H5Sclose(space_id);
+    H5Dclose(dset_id);
+    return data;
+}
+
+static std::vector<long> parseNumbers(std::string text)
+{
+    std::istringstream in(text);
+    std::vector<long> res;
+    long v;
+    while (in >> v) res.push_back(v);
+    return res;
+}
+
+/// Every step of the XMF file has to refer to the datasets with their current number of rows
+static void checkTotalRows(std::string xmfFilename, long totalRows)
+{
+    pugi::xml_document doc;
+    ASSERT_TRUE(doc.load_file(xmfFilename.c_str()));
+
+    auto collection = doc.child("Xdmf").child("Domain").child("Grid");
+    ASSERT_TRUE(collection.first_child());
+
+    for (auto grid : collection.children("Grid"))
+    {
+        std::vector<pugi::xml_node> slabs = { grid.child("Geometry").child("DataItem") };
+        for (auto attr : grid.children("Attribute"))
+            slabs.push_back(attr.child("DataItem"));
+
+        for (auto slab : slabs)
+        {
+            auto data = slab.first_child().next_sibling();
+            ASSERT_EQ(parseNumbers(data.attribute("Dimensions").value())[0], totalRows);
+        }
+    }
+}
+
+TEST(TimeSeries, appendAndReadBack)
+{
+    const int nsteps = 4;
+    const std::string filename = "time_series";
+
+    int rank, nranks;
+    MPI_Check( MPI_Comm_rank(MPI_COMM_WORLD, &rank) );
+    MPI_Check( MPI_Comm_size(MPI_COMM_WORLD, &nranks) );
+
+    std::vector<long> stepSizes;
+    {
+        XDMF::TimeSeriesWriter writer(filename, MPI_COMM_WORLD);
+
+        for (int step = 0; step < nsteps; step++)
+        {
+            const int n = localRows(step, rank);
+            auto positions = std::make_shared<std::vector<float>>(3*n);
+            std::vector<float> velocities(3*n);
+
+            for (int i = 0; i < n; i++)
+                for (int d = 0; d < 3; d++)
+                {
+                    (*positions)[3*i + d] = rowValue(step, rank, i);
+                    velocities  [3*i + d] = -rowValue(step, rank, i);
+                }
+
+            std::vector<XDMF::Channel> channels = { XDMF::Channel("velocity", velocities.data(), XDMF::Channel::Type::Vector) };
+            writer.append(positions, channels, 0.5f * step);
+
+            long total = 0;
+            for (int r = 0; r < nranks; r++)
+                total += localRows(step, r);
+            stepSizes.push_back(total);
+
+            // XMF file is valid while the writer is still appending
+            if (rank == 0)
+            {
+                long totalRows = 0;
+                for (auto size : stepSizes) totalRows += size;
+                checkTotalRows(filename + ".xmf", totalRows);
+            }
+        }
+    }
+
+    if (rank != 0) return;
+
+    long totalRows = 0;
+    std::vector<long> stepOffsets;
+    for (auto size : stepSizes)
+    {
+        stepOffsets.push_back(totalRows);
+        totalRows += size;
+    }
+
+    // Step tables and data in the HDF5 file
+    hid_t file_id = H5Fopen((filename + ".h5").c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    ASSERT_GE(file_id, 0);
+
+    auto offsets    = readDataSet<int64_t>(file_id, "step_offset", H5T_NATIVE_INT64);
+    auto sizes      = readDataSet<int64_t>(file_id, "step_size",   H5T_NATIVE_INT64);
+    auto times      = readDataSet<float>  (file_id, "step_time",   H5T_NATIVE_FLOAT);
+    auto positions  = readDataSet<float>  (file_id, "position",    H5T_NATIVE_FLOAT);
+    auto velocities = readDataSet<float>  (file_id, "velocity",    H5T_NATIVE_FLOAT);
+    H5Fclose(file_id);
+
+    ASSERT_EQ(offsets.size(), nsteps);
+    ASSERT_EQ(positions.size(), 3*totalRows);
+    ASSERT_EQ(velocities.size(), 3*totalRows);
+
+    for (int step = 0; step < nsteps; step++)
+    {
+        ASSERT_EQ(offsets[step], stepOffsets[step]);
+        ASSERT_EQ(sizes[step],   stepSizes[step]);
+        ASSERT_FLOAT_EQ(times[step], 0.5f * step);
+
+        // Ranks are stacked in order within a step
+        long row = offsets[step];
+        for (int r = 0; r < nranks; r++)
+            for (int i = 0; i < localRows(step, r); i++, row++)
+            {
+                ASSERT_EQ(positions [3*row],  rowValue(step, r, i));
+                ASSERT_EQ(velocities[3*row], -rowValue(step, r, i));
+            }
+    }
+
+    // Every non-empty step is a hyperslab of the full datasets in the XMF file
+    pugi::xml_document doc;
+    ASSERT_TRUE(doc.load_file((filename + ".xmf").c_str()));
+
+    auto collection = doc.child("Xdmf").child("Domain").child("Grid");
+    int step = 0;
+    for (auto grid : collection.children("Grid"))
+    {
+        while (stepSizes[step] == 0) step++;
+
+        ASSERT_FLOAT_EQ(grid.child("Time").attribute("Value").as_float(), 0.5f * step);
+
+        std::vector<pugi::xml_node> slabs = { grid.child("Geometry").child("DataItem") };
+        for (auto attr : grid.children("Attribute"))
+            slabs.push_back(attr.child("DataItem"));
+
+        for (auto slab : slabs)
+        {
+            ASSERT_STREQ(slab.attribute("ItemType").value(), "HyperSlab");
+
+            auto selection = slab.first_child();
+            auto data      = selection.next_sibling();
+
+            // start, stride and count of the rows
+            auto numbers = parseNumbers(selection.text().get());
+            ASSERT_EQ(numbers.size(), 6);
+            ASSERT_EQ(numbers[0], stepOffsets[step]);
+            ASSERT_EQ(numbers[4], stepSizes[step]);
+
+            ASSERT_EQ(parseNumbers(slab.attribute("Dimensions").value())[0], stepSizes[step]);
+            ASSERT_EQ(parseNumbers(data.attribute("Dimensions").value())[0], totalRows);
+        }
+
+        step++;
+    }
+
+    for (; step < nsteps; step++)
+        ASSERT_EQ(stepSizes[step], 0);
+}
+
+int main(int argc, char ** argv)
+{
+    MPI_Init(&argc, &argv);
+    logger.init(MPI_COMM_WORLD, "time_series.log", 9);
+
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
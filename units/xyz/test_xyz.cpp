@@ -0,0 +1,229 @@
+#include <plugins/utils/xyz.h>
+#include <plugins/utils/dcd.h>
+#include <core/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+Logger logger;
+
+/// Values that are hard to print right, followed by random ones
+static std::vector<float> testValues()
+{
+    std::vector<float> vals = {
+        0.0f, -0.0f, 1.0f, -1.0f,
+        // Exact ties at the 5th digit: printf rounds them half to even
+        0.015625f, -0.015625f, 3.0f/64, -3.0f/64, 5.0f/64, 0.5f,
+        // Rounding to zero keeps the sign
+        1e-6f, -1e-6f, -4e-6f, 5e-6f, -5e-6f,
+        // Carry over all the digits
+        9.999995f, -9.999995f, 99999.99999f,
+        1234.5678f, -98765.4321f,
+        // Large magnitudes, around the switch to snprintf
+        1e12f, 1e13f, -1e13f, 2e13f, -2e13f, FLT_MAX, -FLT_MAX,
+        FLT_MIN, -FLT_MIN, 1.4e-45f,
+        NAN, -NAN, INFINITY, -INFINITY
+    };
+
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> udistr(-100, 100);
+    std::uniform_int_distribution<uint32_t> bits;
+
+    for (int i = 0; i < 100000; i++)
+    {
+        vals.push_back(udistr(gen));
+
+        // Any float, including the exotic ones
+        uint32_t b = bits(gen);
+        float f;
+        memcpy(&f, &b, sizeof(f));
+        vals.push_back(f);
+    }
+
+    while (vals.size() % 3 != 0)
+        vals.push_back(0.0f);
+
+    return vals;
+}
+
+TEST(XYZ, sameAsPrintf)
+{
+    int rank, nranks;
+    MPI_Check( MPI_Comm_rank(MPI_COMM_WORLD, &rank) );
+    MPI_Check( MPI_Comm_size(MPI_COMM_WORLD, &nranks) );
+
+    auto vals = testValues();
+    const int np = vals.size() / 3;
+
+    std::vector<Particle> particles(np);
+    for (int i = 0; i < np; i++)
+        particles[i].r = make_float3(vals[3*i], vals[3*i+1], vals[3*i+2]);
+
+    const std::string fname = "test.xyz";
+    writeXYZ(MPI_COMM_WORLD, fname, particles.data(), np);
+
+    if (rank != 0) return;
+
+    std::vector<std::string> expected = { std::to_string(np * nranks), "# created by YMeRo" };
+    char buf[256];
+    for (int r = 0; r < nranks; r++)
+        for (int i = 0; i < np; i++)
+        {
+            snprintf(buf, sizeof(buf), "%d %10.5f %10.5f %10.5f", r, vals[3*i], vals[3*i+1], vals[3*i+2]);
+            expected.push_back(buf);
+        }
+
+    std::ifstream fin(fname);
+    std::string line;
+    size_t lineId = 0;
+    while (std::getline(fin, line))
+    {
+        ASSERT_LT(lineId, expected.size());
+        ASSERT_EQ(line, expected[lineId]) << "line " << lineId;
+        lineId++;
+    }
+
+    ASSERT_EQ(lineId, expected.size());
+}
+
+/// Minimal reader of the DCD files written by DCDWriter, without the unit cell
+struct DCDFile
+{
+    int32_t nframes, natoms;
+    std::vector< std::vector<float3> > frames;
+};
+
+static int32_t readInt(std::ifstream& fin)
+{
+    int32_t v;
+    fin.read((char*)&v, sizeof(v));
+    return v;
+}
+
+static std::vector<float> readRecord(std::ifstream& fin, int32_t expectedBytes)
+{
+    const int32_t nbytes = readInt(fin);
+    EXPECT_EQ(nbytes, expectedBytes);
+
+    std::vector<float> data(nbytes / sizeof(float));
+    fin.read((char*)data.data(), nbytes);
+
+    EXPECT_EQ(readInt(fin), nbytes) << "record is not closed by its size";
+    return data;
+}
+
+static DCDFile readDCD(std::string fname)
+{
+    DCDFile res;
+    std::ifstream fin(fname, std::ios::binary);
+
+    EXPECT_EQ(readInt(fin), 84);
+    char magic[4];
+    fin.read(magic, 4);
+    EXPECT_EQ(std::string(magic, 4), "CORD");
+    res.nframes = readInt(fin);
+    fin.ignore(19 * sizeof(int32_t));
+    EXPECT_EQ(readInt(fin), 84);
+
+    EXPECT_EQ(readInt(fin), 164);
+    fin.ignore(164);
+    EXPECT_EQ(readInt(fin), 164);
+
+    EXPECT_EQ(readInt(fin), 4);
+    res.natoms = readInt(fin);
+    EXPECT_EQ(readInt(fin), 4);
+
+    for (int f = 0; f < res.nframes; f++)
+    {
+        auto x = readRecord(fin, 4 * res.natoms);
+        auto y = readRecord(fin, 4 * res.natoms);
+        auto z = readRecord(fin, 4 * res.natoms);
+
+        std::vector<float3> frame(res.natoms);
+        for (int i = 0; i < res.natoms; i++)
+            frame[i] = make_float3(x[i], y[i], z[i]);
+        res.frames.push_back(frame);
+    }
+
+    // Nothing after the last frame
+    fin.peek();
+    EXPECT_TRUE(fin.eof());
+
+    return res;
+}
+
+static float3 positionOf(int64_t id, int frame)
+{
+    return make_float3(id + 0.25f * frame, -0.5f * id, 1000.0f * frame - id);
+}
+
+/// Particles with ids 0 ... N-1 shuffled over the ranks come back in the order of the ids
+TEST(DCD, roundTrip)
+{
+    const int np = 1000, nframes = 3;
+    const std::string fname = "test.dcd";
+
+    int rank, nranks;
+    MPI_Check( MPI_Comm_rank(MPI_COMM_WORLD, &rank) );
+    MPI_Check( MPI_Comm_size(MPI_COMM_WORLD, &nranks) );
+
+    // Ids of the ranks are interleaved and shuffled
+    std::vector<int64_t> ids;
+    for (int i = 0; i < np; i++)
+        ids.push_back((int64_t)i * nranks + rank);
+
+    std::mt19937 gen(rank);
+    std::vector<Particle> particles(np);
+
+    DCDWriter writer(fname);
+    for (int f = 0; f < nframes; f++)
+    {
+        std::shuffle(ids.begin(), ids.end(), gen);
+        for (int i = 0; i < np; i++)
+        {
+            particles[i].setId(ids[i]);
+            particles[i].r = positionOf(ids[i], f);
+        }
+
+        writer.write(MPI_COMM_WORLD, particles.data(), np);
+    }
+
+    // Frame with a different number of particles is skipped
+    writer.write(MPI_COMM_WORLD, particles.data(), rank == 0 ? np-1 : np);
+
+    if (rank != 0) return;
+
+    auto dcd = readDCD(fname);
+
+    ASSERT_EQ(dcd.nframes, nframes);
+    ASSERT_EQ(dcd.natoms, np * nranks);
+    ASSERT_EQ(dcd.frames.size(), nframes);
+
+    for (int f = 0; f < nframes; f++)
+        for (int64_t id = 0; id < dcd.natoms; id++)
+        {
+            const float3 expected = positionOf(id, f);
+            const float3 r = dcd.frames[f][id];
+            ASSERT_EQ(r.x, expected.x) << "frame " << f << ", id " << id;
+            ASSERT_EQ(r.y, expected.y) << "frame " << f << ", id " << id;
+            ASSERT_EQ(r.z, expected.z) << "frame " << f << ", id " << id;
+        }
+}
+
+int main(int argc, char ** argv)
+{
+    MPI_Init(&argc, &argv);
+    logger.init(MPI_COMM_WORLD, "xyz.log", 9);
+
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}